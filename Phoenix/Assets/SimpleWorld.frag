@@ -3,6 +3,7 @@
 in vec3 pass_UV;
 in vec3 pass_normal;
 flat in uint pass_color;
+in float pass_light;
 // in vec3 pass_pos;
 
 uniform sampler2DArray u_TexArray;
@@ -49,4 +50,5 @@ void main()
 
 	vec4 result = vec4(ambient, 1.0) + vec4(diffuse, 1.0) * objectColor * lightIntensity;
 	out_FragColor = result * texture(u_TexArray, pass_UV) * u_Brightness;
+	out_FragColor.rgb *= pass_light;
 }
@@ -4,7 +4,8 @@ layout (location = 0) in vec3 a_Vertex;
 layout (location = 1) in vec3 a_UV;
 layout (location = 2) in vec3 a_Normal;
 layout (location = 3) in uint a_Color;
-// layout (location = 4) in vec3 a_Pos;
+layout (location = 4) in float a_Light;
+// layout (location = 5) in vec3 a_Pos;
 
 uniform mat4 u_model;
 uniform mat4 u_view;
@@ -13,6 +14,7 @@ uniform mat4 u_projection;
 out vec3 pass_UV;
 out vec3 pass_normal;
 flat out uint pass_color;
+out float pass_light;
 // out vec3 pass_pos;
 
 void main()
@@ -22,5 +24,17 @@ void main()
 	pass_UV = a_UV;
 	pass_normal = a_Normal;
 	pass_color = a_Color;
+
+	// a_Light = (binary) aassssbbbb, ambient occlusion from 0 to 3, then sky
+	// light and block light from 0 to 15 each.
+	// every level darker than full is a fifth dimmer.
+	float ao = floor(a_Light / 256.0);
+	float light = a_Light - ao * 256.0;
+	float sky = floor(light / 16.0);
+	float block = light - sky * 16.0;
+	pass_light = pow(0.8, 15.0 - max(sky, block));
+
+	// a corner tucked in between blocks gets less light from around it.
+	pass_light *= mix(0.4, 1.0, ao / 3.0);
 	// pass_pos = a_Pos;
 }
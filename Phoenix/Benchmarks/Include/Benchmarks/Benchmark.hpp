@@ -0,0 +1,176 @@
+// Copyright 2019-20 Genten Studios
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+// may be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#define PHX_BENCHMARK_CONCAT_INTERNAL(a, b) a##b
+#define PHX_BENCHMARK_CONCAT(a, b) PHX_BENCHMARK_CONCAT_INTERNAL(a, b)
+
+/**
+ * @brief Registers a function as a benchmark.
+ *
+ * @param name A string naming the benchmark.
+ * @param function A void(State&) function to run.
+ * @param ... Arguments to run the benchmark with, once each. The benchmark
+ * runs once without an argument if none are given.
+ */
+#define PHX_BENCHMARK(name, function, ...)                        \
+	static phx::benchmarks::Registrar PHX_BENCHMARK_CONCAT(       \
+	    phxBenchmark, __LINE__)(name, function, {__VA_ARGS__})
+
+namespace phx::benchmarks
+{
+	/**
+	 * @brief Controls a single run of a benchmark.
+	 *
+	 * Only the time spent inside the keepRunning loop counts, so anything a
+	 * benchmark sets up before it is left out of the results.
+	 *
+	 * @paragraph Usage
+	 * @code
+	 * void meshChunk(benchmarks::State& state)
+	 * {
+	 *     voxels::Chunk chunk = makeChunk(state.getArgument());
+	 *     while (state.keepRunning())
+	 *     {
+	 *         benchmarks::doNotOptimize(ChunkMesher::mesh(&chunk, ...));
+	 *     }
+	 *
+	 *     state.setItemsProcessed(state.getIterations());
+	 * }
+	 * PHX_BENCHMARK("ChunkMesher::mesh", meshChunk, 0, 1, 2);
+	 * @endcode
+	 */
+	class State
+	{
+	public:
+		State(std::size_t iterations, std::int64_t argument);
+
+		/**
+		 * @brief Starts the timer on the first call, and stops it once the
+		 * benchmark has run for enough iterations.
+		 * @return Whether to run another iteration.
+		 */
+		bool keepRunning();
+
+		/**
+		 * @brief Leaves work done between these out of the results, such as
+		 * resetting something every iteration.
+		 *
+		 * Only the wall clock is read here, the time paused is taken off
+		 * the processor time too once the benchmark finishes.
+		 */
+		void pauseTiming();
+		void resumeTiming();
+
+		std::size_t  getIterations() const { return m_iterations; }
+		std::int64_t getArgument() const { return m_argument; }
+
+		/**
+		 * @brief Sets how many items or bytes were handled in total, which
+		 * are reported per second.
+		 */
+		void setItemsProcessed(std::uint64_t items) { m_items = items; }
+		void setBytesProcessed(std::uint64_t bytes) { m_bytes = bytes; }
+
+		std::uint64_t getItemsProcessed() const { return m_items; }
+		std::uint64_t getBytesProcessed() const { return m_bytes; }
+
+		/// The wall clock and processor time spent, in seconds.
+		double getRealTime() const { return m_realTime; }
+		double getCPUTime() const { return m_cpuTime; }
+
+	private:
+		void startTimer();
+		void stopTimer();
+
+	private:
+		std::size_t  m_iterations;
+		std::size_t  m_remaining;
+		std::int64_t m_argument;
+		bool         m_started = false;
+
+		std::uint64_t m_items = 0;
+		std::uint64_t m_bytes = 0;
+
+		std::chrono::steady_clock::time_point m_realStart;
+		std::chrono::steady_clock::time_point m_pauseStart;
+		std::clock_t                          m_cpuStart   = 0;
+		double                                m_realTime   = 0.0;
+		double                                m_cpuTime    = 0.0;
+		double                                m_pausedTime = 0.0;
+	};
+
+	using BenchmarkFunction = void (*)(State&);
+
+	struct Benchmark
+	{
+		std::string               name;
+		BenchmarkFunction         function;
+		std::vector<std::int64_t> arguments;
+	};
+
+	/**
+	 * @brief Gets every registered benchmark, in the order they were
+	 * registered within each file.
+	 */
+	std::vector<Benchmark>& getBenchmarks();
+
+	/**
+	 * @brief Adds a benchmark when constructed, use PHX_BENCHMARK rather
+	 * than creating these by hand.
+	 */
+	class Registrar
+	{
+	public:
+		Registrar(const char* name, BenchmarkFunction function,
+		          std::vector<std::int64_t> arguments);
+	};
+
+	/**
+	 * @brief Stops the compiler from optimizing away a value that is
+	 * otherwise unused.
+	 */
+	template <typename T>
+	inline void doNotOptimize(const T& value)
+	{
+#if defined(_MSC_VER)
+		static volatile const void* sink;
+		sink = &value;
+#else
+		asm volatile("" : : "r,m"(value) : "memory");
+#endif
+	}
+} // namespace phx::benchmarks
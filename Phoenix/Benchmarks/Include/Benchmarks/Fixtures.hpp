@@ -0,0 +1,78 @@
+// Copyright 2019-20 Genten Studios
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+// may be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <Common/Math/Math.hpp>
+#include <Common/Voxels/BlockReferrer.hpp>
+#include <Common/Voxels/Chunk.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace phx::benchmarks
+{
+	/**
+	 * @brief The contents of a chunk, from the cheapest to mesh to the most
+	 * expensive.
+	 */
+	enum class ChunkPattern : std::int64_t
+	{
+		/// Nothing but air.
+		EMPTY = 0,
+
+		/// Nothing but stone, only the outside faces are visible.
+		FULL = 1,
+
+		/// Alternating stone and air, every face of every block is visible.
+		CHECKERBOARD = 2,
+
+		/// Rolling hills of stone topped with grass, roughly what a player
+		/// actually sees.
+		TERRAIN = 3
+	};
+
+	/**
+	 * @brief Gets the blocks used by every benchmark, the core blocks plus
+	 * core.stone, core.grass, core.lamp, which gives off light, and
+	 * core.water, a liquid.
+	 */
+	voxels::BlockReferrer& getReferrer();
+
+	/**
+	 * @brief Creates a chunk filled with a pattern.
+	 * @param position The position of the chunk, in blocks.
+	 */
+	voxels::Chunk makeChunk(const math::vec3& position, ChunkPattern pattern);
+
+	/**
+	 * @brief Serializes a chunk the way the server sends it.
+	 */
+	std::vector<std::byte> serializeChunk(const voxels::Chunk& chunk);
+} // namespace phx::benchmarks
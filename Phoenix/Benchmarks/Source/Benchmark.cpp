@@ -0,0 +1,100 @@
+// Copyright 2019-20 Genten Studios
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+// may be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <Benchmarks/Benchmark.hpp>
+
+#include <algorithm>
+
+using namespace phx::benchmarks;
+
+State::State(std::size_t iterations, std::int64_t argument)
+    : m_iterations(iterations), m_remaining(iterations), m_argument(argument)
+{
+}
+
+bool State::keepRunning()
+{
+	if (!m_started)
+	{
+		m_started = true;
+		startTimer();
+	}
+
+	if (m_remaining == 0)
+	{
+		stopTimer();
+		return false;
+	}
+
+	--m_remaining;
+	return true;
+}
+
+void State::pauseTiming() { m_pauseStart = std::chrono::steady_clock::now(); }
+
+void State::resumeTiming()
+{
+	m_pausedTime += std::chrono::duration<double>(
+	                    std::chrono::steady_clock::now() - m_pauseStart)
+	                    .count();
+}
+
+void State::startTimer()
+{
+	m_realStart = std::chrono::steady_clock::now();
+	m_cpuStart  = std::clock();
+}
+
+void State::stopTimer()
+{
+	// the processor clock is slow to read next to the wall clock, so it's
+	// only read at either end of the run and time spent paused is taken
+	// off both, as the work done while paused is on this thread.
+	const double real = std::chrono::duration<double>(
+	                        std::chrono::steady_clock::now() - m_realStart)
+	                        .count();
+	const double cpu = static_cast<double>(std::clock() - m_cpuStart) /
+	                   static_cast<double>(CLOCKS_PER_SEC);
+
+	m_realTime = std::max(real - m_pausedTime, 0.0);
+	m_cpuTime  = std::max(cpu - m_pausedTime, 0.0);
+}
+
+std::vector<Benchmark>& phx::benchmarks::getBenchmarks()
+{
+	// a function local so registering from static initializers in other
+	// files can't run before it is constructed.
+	static std::vector<Benchmark> benchmarks;
+	return benchmarks;
+}
+
+Registrar::Registrar(const char* name, BenchmarkFunction function,
+                     std::vector<std::int64_t> arguments)
+{
+	getBenchmarks().push_back({name, function, std::move(arguments)});
+}
@@ -0,0 +1,131 @@
+// Copyright 2019-20 Genten Studios
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+// may be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <Benchmarks/Fixtures.hpp>
+
+#include <Common/Utility/Serializer.hpp>
+
+#include <cmath>
+
+using namespace phx;
+using namespace phx::benchmarks;
+
+namespace
+{
+	void addBlock(voxels::BlockReferrer& referrer, const std::string& id,
+	              voxels::BlockCategory category, std::uint8_t light = 0)
+	{
+		voxels::BlockType block;
+		block.displayName      = id;
+		block.id               = id;
+		block.category         = category;
+		block.lightLevel       = light;
+		block.uniqueIdentifier = referrer.referrer.size();
+
+		referrer.referrer.add(block.id, block.uniqueIdentifier);
+		referrer.blocks.add(block.uniqueIdentifier, block);
+	}
+} // namespace
+
+voxels::BlockReferrer& phx::benchmarks::getReferrer()
+{
+	// the referrer can't be copied, its unknown block points into itself.
+	static voxels::BlockReferrer referrer;
+	static const bool            initialized = [] {
+		addBlock(referrer, "core.stone", voxels::BlockCategory::SOLID);
+		addBlock(referrer, "core.grass", voxels::BlockCategory::SOLID);
+		addBlock(referrer, "core.lamp", voxels::BlockCategory::SOLID, 15);
+		addBlock(referrer, "core.water", voxels::BlockCategory::LIQUID);
+		return true;
+	}();
+	static_cast<void>(initialized);
+
+	return referrer;
+}
+
+voxels::Chunk phx::benchmarks::makeChunk(const math::vec3& position,
+                                         ChunkPattern      pattern)
+{
+	using voxels::Chunk;
+
+	voxels::BlockReferrer& referrer = getReferrer();
+	voxels::BlockType* air =
+	    referrer.blocks.get(voxels::BlockType::AIR_BLOCK);
+	voxels::BlockType* stone =
+	    referrer.blocks.get(*referrer.referrer.get("core.stone"));
+	voxels::BlockType* grass =
+	    referrer.blocks.get(*referrer.referrer.get("core.grass"));
+
+	Chunk chunk(position, &referrer);
+	auto& blocks = chunk.getBlocks();
+	blocks.resize(Chunk::CHUNK_MAX_BLOCKS, air);
+
+	for (int z = 0; z < Chunk::CHUNK_DEPTH; ++z)
+	{
+		for (int x = 0; x < Chunk::CHUNK_WIDTH; ++x)
+		{
+			const int height = static_cast<int>(
+			    8.f + 4.f * std::sin((position.x + x) * 0.4f) *
+			              std::cos((position.z + z) * 0.3f));
+
+			for (int y = 0; y < Chunk::CHUNK_HEIGHT; ++y)
+			{
+				voxels::BlockType* block = air;
+				switch (pattern)
+				{
+				case ChunkPattern::EMPTY:
+					break;
+				case ChunkPattern::FULL:
+					block = stone;
+					break;
+				case ChunkPattern::CHECKERBOARD:
+					block = (x + y + z) % 2 == 0 ? stone : air;
+					break;
+				case ChunkPattern::TERRAIN:
+					if (y < height - 1)
+						block = stone;
+					else if (y == height - 1)
+						block = grass;
+					break;
+				}
+
+				blocks[Chunk::getVectorIndex(x, y, z)] = block;
+			}
+		}
+	}
+
+	return chunk;
+}
+
+std::vector<std::byte> phx::benchmarks::serializeChunk(
+    const voxels::Chunk& chunk)
+{
+	Serializer ser;
+	ser << chunk;
+	return ser.getBuffer();
+}
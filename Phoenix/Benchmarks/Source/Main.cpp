@@ -0,0 +1,387 @@
+// Copyright 2019-20 Genten Studios
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+// may be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <Benchmarks/Benchmark.hpp>
+
+#include <Common/Logger.hpp>
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace phx;
+using namespace phx::benchmarks;
+
+namespace
+{
+	struct Options
+	{
+		std::string  filter;
+		double       minTime     = 0.5;
+		unsigned int repetitions = 1;
+		bool         list        = false;
+		std::string  output;
+	};
+
+	// a single run of a benchmark, times are per iteration in nanoseconds.
+	struct Result
+	{
+		std::string name;
+		std::size_t iterations;
+		double      realTime;
+		double      cpuTime;
+		double      itemsPerSecond;
+		double      bytesPerSecond;
+	};
+
+	void printUsage()
+	{
+		std::cout
+		    << "Usage: PhoenixBenchmarks [options]\n"
+		       "  --filter <text>      only run benchmarks with this in their "
+		       "name\n"
+		       "  --min-time <s>       how long to run each benchmark for "
+		       "(0.5)\n"
+		       "  --repetitions <n>    how many times to run each benchmark "
+		       "(1)\n"
+		       "  --list               list the benchmarks without running "
+		       "them\n"
+		       "  --output <file>      also write the results as JSON\n";
+	}
+
+	bool parseOptions(int argc, char** argv, Options& options)
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			const std::string arg = argv[i];
+			if (arg == "--list")
+			{
+				options.list = true;
+				continue;
+			}
+
+			if (arg == "--help" || i + 1 >= argc)
+			{
+				return false;
+			}
+
+			const std::string value = argv[++i];
+			if (arg == "--filter")
+			{
+				options.filter = value;
+			}
+			else if (arg == "--min-time")
+			{
+				options.minTime = std::stod(value);
+			}
+			else if (arg == "--repetitions")
+			{
+				options.repetitions = static_cast<unsigned int>(
+				    std::max(1ul, std::stoul(value)));
+			}
+			else if (arg == "--output")
+			{
+				options.output = value;
+			}
+			else
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	std::string nameOf(const Benchmark& benchmark, std::size_t argument)
+	{
+		if (benchmark.arguments.empty())
+		{
+			return benchmark.name;
+		}
+
+		return benchmark.name + '/' +
+		       std::to_string(benchmark.arguments[argument]);
+	}
+
+	/**
+	 * @brief Runs a benchmark with more and more iterations until it takes
+	 * long enough to be measured reliably.
+	 */
+	Result run(const Benchmark& benchmark, std::int64_t argument,
+	           const std::string& name, double minTime)
+	{
+		std::size_t iterations = 1;
+		while (true)
+		{
+			State state(iterations, argument);
+			benchmark.function(state);
+
+			const double elapsed = state.getRealTime();
+			if (elapsed >= minTime || iterations >= 1000000000)
+			{
+				const double perIteration =
+				    1e9 / static_cast<double>(iterations);
+				return {name,
+				        iterations,
+				        state.getRealTime() * perIteration,
+				        state.getCPUTime() * perIteration,
+				        static_cast<double>(state.getItemsProcessed()) /
+				            elapsed,
+				        static_cast<double>(state.getBytesProcessed()) /
+				            elapsed};
+			}
+
+			// aim a little past the minimum so the next run is the last, but
+			// don't trust the estimate while runs are still tiny.
+			double multiplier = 10.0;
+			if (elapsed / minTime > 0.1)
+			{
+				multiplier = minTime * 1.4 / elapsed;
+			}
+
+			iterations = std::max(
+			    iterations + 1,
+			    static_cast<std::size_t>(static_cast<double>(iterations) *
+			                             multiplier));
+		}
+	}
+
+	void printResult(const Result& result)
+	{
+		std::cout << std::left << std::setw(48) << result.name << std::right
+		          << std::setw(14) << std::fixed << std::setprecision(0)
+		          << result.realTime << " ns" << std::setw(14)
+		          << result.cpuTime << " ns" << std::setw(12)
+		          << result.iterations;
+
+		if (result.itemsPerSecond > 0.0)
+		{
+			std::cout << "  " << std::setprecision(3)
+			          << result.itemsPerSecond / 1e6 << "M items/s";
+		}
+		if (result.bytesPerSecond > 0.0)
+		{
+			std::cout << "  " << std::setprecision(3)
+			          << result.bytesPerSecond / (1024.0 * 1024.0) << " MiB/s";
+		}
+
+		std::cout << std::endl;
+	}
+
+	nlohmann::json toJSON(const Result& result, const std::string& runName,
+	                      const std::string& runType, std::size_t repetitions,
+	                      std::size_t index)
+	{
+		nlohmann::json json;
+		json["name"]        = result.name;
+		json["run_name"]    = runName;
+		json["run_type"]    = runType;
+		json["repetitions"] = repetitions;
+		if (runType == "iteration")
+		{
+			json["repetition_index"] = index;
+		}
+		json["iterations"] = result.iterations;
+		json["real_time"]  = result.realTime;
+		json["cpu_time"]   = result.cpuTime;
+		json["time_unit"]  = "ns";
+		if (result.itemsPerSecond > 0.0)
+		{
+			json["items_per_second"] = result.itemsPerSecond;
+		}
+		if (result.bytesPerSecond > 0.0)
+		{
+			json["bytes_per_second"] = result.bytesPerSecond;
+		}
+
+		return json;
+	}
+
+	/**
+	 * @brief Combines repetitions of a benchmark into a mean, median and
+	 * standard deviation.
+	 */
+	std::vector<Result> aggregate(const std::vector<Result>& results)
+	{
+		const auto combine = [&results](const std::string& suffix,
+		                                auto&& statistic) {
+			Result combined = results.front();
+			combined.name += '_' + suffix;
+			combined.realTime       = statistic(&Result::realTime);
+			combined.cpuTime        = statistic(&Result::cpuTime);
+			combined.itemsPerSecond = statistic(&Result::itemsPerSecond);
+			combined.bytesPerSecond = statistic(&Result::bytesPerSecond);
+			return combined;
+		};
+
+		const auto mean = [&results](double Result::*field) {
+			double total = 0.0;
+			for (const auto& result : results)
+			{
+				total += result.*field;
+			}
+			return total / static_cast<double>(results.size());
+		};
+
+		const auto median = [&results](double Result::*field) {
+			std::vector<double> values;
+			for (const auto& result : results)
+			{
+				values.push_back(result.*field);
+			}
+			std::sort(values.begin(), values.end());
+
+			const std::size_t middle = values.size() / 2;
+			return values.size() % 2 == 0
+			           ? (values[middle - 1] + values[middle]) / 2.0
+			           : values[middle];
+		};
+
+		const auto stddev = [&results, &mean](double Result::*field) {
+			const double average = mean(field);
+			double       total   = 0.0;
+			for (const auto& result : results)
+			{
+				total += (result.*field - average) * (result.*field - average);
+			}
+			return std::sqrt(total /
+			                 static_cast<double>(results.size() - 1));
+		};
+
+		return {combine("mean", mean), combine("median", median),
+		        combine("stddev", stddev)};
+	}
+} // namespace
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!parseOptions(argc, argv, options))
+	{
+		printUsage();
+		return EXIT_FAILURE;
+	}
+
+	// benchmarked code logs, which would only add noise.
+	LoggerConfig config;
+	config.verbosity = LogVerbosity::WARNING;
+	Logger::initialize(config);
+
+	nlohmann::json benchmarks = nlohmann::json::array();
+
+	std::cout << std::left << std::setw(48) << "Benchmark" << std::right
+	          << std::setw(17) << "Time" << std::setw(17) << "CPU"
+	          << std::setw(12) << "Iterations" << '\n'
+	          << std::string(94, '-') << std::endl;
+
+	for (const auto& benchmark : getBenchmarks())
+	{
+		const std::size_t arguments =
+		    std::max<std::size_t>(1, benchmark.arguments.size());
+
+		for (std::size_t i = 0; i < arguments; ++i)
+		{
+			const std::string name = nameOf(benchmark, i);
+			if (name.find(options.filter) == std::string::npos)
+			{
+				continue;
+			}
+
+			if (options.list)
+			{
+				std::cout << name << std::endl;
+				continue;
+			}
+
+			const std::int64_t argument =
+			    benchmark.arguments.empty() ? 0 : benchmark.arguments[i];
+
+			std::vector<Result> results;
+			for (unsigned int r = 0; r < options.repetitions; ++r)
+			{
+				results.push_back(
+				    run(benchmark, argument, name, options.minTime));
+				printResult(results.back());
+				benchmarks.push_back(toJSON(results.back(), name, "iteration",
+				                            options.repetitions, r));
+			}
+
+			if (results.size() > 1)
+			{
+				for (const auto& result : aggregate(results))
+				{
+					printResult(result);
+
+					nlohmann::json json = toJSON(result, name, "aggregate",
+					                             options.repetitions, 0);
+					json["aggregate_name"] =
+					    result.name.substr(result.name.rfind('_') + 1);
+					benchmarks.push_back(json);
+				}
+			}
+		}
+	}
+
+	if (!options.output.empty())
+	{
+		char date[32];
+		const std::time_t now = std::time(nullptr);
+		std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S",
+		              std::localtime(&now));
+
+		// the same layout as Google Benchmark's, so its compare.py can diff
+		// two runs.
+		nlohmann::json results;
+		results["context"]["date"]       = date;
+		results["context"]["executable"] = argv[0];
+		results["context"]["num_cpus"]   = std::thread::hardware_concurrency();
+#ifdef NDEBUG
+		results["context"]["library_build_type"] = "release";
+#else
+		results["context"]["library_build_type"] = "debug";
+#endif
+		results["benchmarks"] = benchmarks;
+
+		std::ofstream file(options.output);
+		file << std::setw(4) << results << std::endl;
+	}
+
+	Logger::teardown();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,472 @@
+// Copyright 2019-20 Genten Studios
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+// may be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <Benchmarks/Benchmark.hpp>
+#include <Benchmarks/Fixtures.hpp>
+
+#include <Common/PlayerView.hpp>
+#include <Common/Position.hpp>
+#include <Common/Utility/BlockingQueue.hpp>
+#include <Common/Voxels/Map.hpp>
+
+#include <entt/entt.hpp>
+
+#include <memory>
+#include <random>
+
+using namespace phx;
+using namespace phx::benchmarks;
+
+namespace
+{
+	using ChunkQueue =
+	    BlockingQueue<std::pair<math::vec3, std::vector<std::byte>>>;
+
+	/// The map used by these benchmarks spans -RADIUS to RADIUS chunks on
+	/// each axis.
+	constexpr int RADIUS = 4;
+
+	math::vec3 chunkPosition(int x, int y, int z)
+	{
+		return {static_cast<float>(x * voxels::Chunk::CHUNK_WIDTH),
+		        static_cast<float>(y * voxels::Chunk::CHUNK_HEIGHT),
+		        static_cast<float>(z * voxels::Chunk::CHUNK_DEPTH)};
+	}
+
+	voxels::BlockType* getBlock(const std::string& id)
+	{
+		return getReferrer().blocks.get(*getReferrer().referrer.get(id));
+	}
+
+	/**
+	 * @brief Fills a map through its chunk queue, the same way a client is
+	 * sent chunks, so nothing is generated or written to disk.
+	 */
+	void fillMap(voxels::Map& map, ChunkQueue& queue)
+	{
+		for (int x = -RADIUS; x <= RADIUS; ++x)
+		{
+			for (int y = -RADIUS; y <= RADIUS; ++y)
+			{
+				for (int z = -RADIUS; z <= RADIUS; ++z)
+				{
+					// chunks carry their position, so each needs its own data.
+					const math::vec3 position = chunkPosition(x, y, z);
+					const voxels::Chunk chunk =
+					    makeChunk(position, ChunkPattern::TERRAIN);
+					queue.push({position, serializeChunk(chunk)});
+				}
+			}
+		}
+
+		// the first miss drains the whole queue into the map.
+		map.getChunk(chunkPosition(RADIUS + 1, 0, 0));
+	}
+
+	void getChunkHot(State& state)
+	{
+		ChunkQueue  queue;
+		voxels::Map map(&queue, &getReferrer());
+		fillMap(map, queue);
+
+		const math::vec3 position = chunkPosition(1, 2, 3);
+		while (state.keepRunning())
+		{
+			doNotOptimize(map.getChunk(position));
+		}
+
+		state.setItemsProcessed(state.getIterations());
+	}
+
+	void getChunkCold(State& state)
+	{
+		const auto data =
+		    serializeChunk(makeChunk({0, 0, 0}, ChunkPattern::TERRAIN));
+		const math::vec3 position = chunkPosition(1, 2, 3);
+
+		ChunkQueue                   queue;
+		std::unique_ptr<voxels::Map> map;
+
+		// every iteration loads a chunk the map hasn't seen before, which
+		// decodes it from the queue. the map is replaced every so often so
+		// long runs don't fill memory with chunks.
+		int i = 0;
+		while (state.keepRunning())
+		{
+			state.pauseTiming();
+			if (i % 256 == 0)
+			{
+				map = std::make_unique<voxels::Map>(&queue, &getReferrer());
+			}
+
+			const math::vec3 next = chunkPosition(i++ % 256, 0, 0) + position;
+			queue.push({next, data});
+			state.resumeTiming();
+
+			doNotOptimize(map->getChunk(next));
+		}
+
+		state.setItemsProcessed(state.getIterations());
+	}
+
+	void getBlockAtHot(State& state)
+	{
+		ChunkQueue  queue;
+		voxels::Map map(&queue, &getReferrer());
+		fillMap(map, queue);
+
+		// random blocks spread over the map so every lookup isn't in the
+		// same chunk.
+		const float extent = static_cast<float>(RADIUS * 16);
+
+		std::mt19937                          random(0);
+		std::uniform_real_distribution<float> coordinate(0.f, extent);
+		std::vector<math::vec3>               positions(1024);
+		for (auto& position : positions)
+		{
+			position = {coordinate(random), coordinate(random),
+			            coordinate(random)};
+		}
+
+		std::size_t i = 0;
+		while (state.keepRunning())
+		{
+			doNotOptimize(map.getBlockAt(positions[i++ % positions.size()]));
+		}
+
+		state.setItemsProcessed(state.getIterations());
+	}
+
+	/// The edit benchmarks change a cube of EDIT_SIZE blocks.
+	constexpr int EDIT_SIZE = 32;
+
+	void setBlockAtFill(State& state)
+	{
+		ChunkQueue  queue;
+		voxels::Map map(&queue, &getReferrer());
+		fillMap(map, queue);
+
+		voxels::BlockType* blocks[] = {getBlock("core.stone"),
+		                               getBlock("core.grass")};
+
+		std::size_t i = 0;
+		while (state.keepRunning())
+		{
+			voxels::BlockType* block = blocks[i++ % 2];
+			for (int z = 0; z < EDIT_SIZE; ++z)
+			{
+				for (int y = 0; y < EDIT_SIZE; ++y)
+				{
+					for (int x = 0; x < EDIT_SIZE; ++x)
+					{
+						map.setBlockAt({static_cast<float>(x),
+						                static_cast<float>(y),
+						                static_cast<float>(z)},
+						               block);
+					}
+				}
+			}
+		}
+
+		state.setItemsProcessed(state.getIterations() * EDIT_SIZE *
+		                        EDIT_SIZE * EDIT_SIZE);
+	}
+
+	void editFill(State& state)
+	{
+		ChunkQueue  queue;
+		voxels::Map map(&queue, &getReferrer());
+		fillMap(map, queue);
+
+		voxels::BlockType* blocks[] = {getBlock("core.stone"),
+		                               getBlock("core.grass")};
+
+		const math::vec3 to = {EDIT_SIZE - 1, EDIT_SIZE - 1, EDIT_SIZE - 1};
+
+		std::size_t i = 0;
+		while (state.keepRunning())
+		{
+			voxels::Map::Edit edit = map.beginEdit();
+			doNotOptimize(edit.fill({0, 0, 0}, to, blocks[i++ % 2]));
+		}
+
+		state.setItemsProcessed(state.getIterations() * EDIT_SIZE *
+		                        EDIT_SIZE * EDIT_SIZE);
+	}
+
+	/// The block tick benchmarks keep this many updates scheduled.
+	constexpr std::size_t SCHEDULED_TICKS = 1 << 20;
+
+	/**
+	 * @brief Schedules updates for random blocks of the map, spread over
+	 * the next thousand or so ticks with some far enough out to miss the
+	 * timing wheel.
+	 */
+	void scheduleTicks(voxels::BlockTicker& ticker, std::size_t count,
+	                   std::mt19937& random)
+	{
+		std::uniform_int_distribution<int> chunk(-RADIUS, RADIUS);
+		std::uniform_int_distribution<std::size_t> index(
+		    0, voxels::Chunk::CHUNK_MAX_BLOCKS - 1);
+		std::uniform_int_distribution<std::uint64_t> delay(1, 1024);
+
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			ticker.schedule(
+			    chunkPosition(chunk(random), chunk(random), chunk(random)),
+			    index(random), delay(random));
+		}
+	}
+
+	void scheduleBlockTicks(State& state)
+	{
+		std::mt19937                         random(0);
+		std::unique_ptr<voxels::BlockTicker> ticker;
+
+		while (state.keepRunning())
+		{
+			state.pauseTiming();
+			ticker = std::make_unique<voxels::BlockTicker>();
+			state.resumeTiming();
+
+			scheduleTicks(*ticker, SCHEDULED_TICKS, random);
+		}
+
+		state.setItemsProcessed(state.getIterations() * SCHEDULED_TICKS);
+	}
+
+	void runBlockTicks(State& state)
+	{
+		ChunkQueue  queue;
+		voxels::Map map(&queue, &getReferrer());
+		fillMap(map, queue);
+
+		std::size_t updates = 0;
+		map.getTicker().setBudget(0);
+		map.getTicker().setHandler(
+		    [&updates](const math::vec3&, voxels::BlockType* block,
+		               voxels::BlockTicker::TickType) {
+			    doNotOptimize(block);
+			    ++updates;
+		    });
+
+		// each iteration is a tick, with about a thousand updates due.
+		std::mt19937 random(0);
+		while (state.keepRunning())
+		{
+			if (map.getTicker().getPending() < SCHEDULED_TICKS / 2)
+			{
+				state.pauseTiming();
+				scheduleTicks(map.getTicker(),
+				              SCHEDULED_TICKS - map.getTicker().getPending(),
+				              random);
+				state.resumeTiming();
+			}
+
+			map.tick();
+		}
+
+		state.setItemsProcessed(updates);
+	}
+
+	void lightChunks(State& state)
+	{
+		std::unique_ptr<ChunkQueue>  queue;
+		std::unique_ptr<voxels::Map> map;
+
+		std::size_t chunks = 0;
+		while (state.keepRunning())
+		{
+			state.pauseTiming();
+			queue = std::make_unique<ChunkQueue>();
+			map   = std::make_unique<voxels::Map>(queue.get(), &getReferrer());
+			fillMap(*map, *queue);
+			map->getLightEngine().setBudget(0);
+			state.resumeTiming();
+
+			map->enableLighting();
+			chunks += static_cast<std::size_t>((2 * RADIUS + 1) *
+			                                   (2 * RADIUS + 1) *
+			                                   (2 * RADIUS + 1));
+		}
+
+		state.setItemsProcessed(chunks);
+	}
+
+	/**
+	 * @brief Swaps a block back and forth on a lit map, each edit
+	 * relighting everything it touches before the next.
+	 */
+	void relightBlock(State& state, voxels::BlockType* first,
+	                  voxels::BlockType* second)
+	{
+		ChunkQueue  queue;
+		voxels::Map map(&queue, &getReferrer());
+		fillMap(map, queue);
+		map.enableLighting();
+		map.getLightEngine().setBudget(0);
+
+		voxels::BlockType* blocks[] = {first, second};
+
+		// in the open, just above the hills of the middle chunk.
+		const math::vec3 position = {4, 14, 4};
+		map.setBlockAt(position, second);
+
+		std::size_t i = 0;
+		while (state.keepRunning())
+		{
+			map.setBlockAt(position, blocks[i++ % 2]);
+		}
+
+		state.setItemsProcessed(state.getIterations());
+	}
+
+	// only block light changes, the lamp's light filling the air around.
+	void relightLamp(State& state)
+	{
+		relightBlock(state, getBlock("core.lamp"), getBlock("core.stone"));
+	}
+
+	// only sky light changes, the block shading the ground below.
+	void relightSky(State& state)
+	{
+		relightBlock(state, getBlock("core.stone"),
+		             getReferrer().blocks.get(voxels::BlockType::AIR_BLOCK));
+	}
+
+	/**
+	 * @brief Floods every bit of air in the map with water and lets it
+	 * settle, so ticks only pay for liquid that is still moving, which is
+	 * none.
+	 */
+	void tickSettledLiquid(State& state)
+	{
+		ChunkQueue  queue;
+		voxels::Map map(&queue, &getReferrer());
+		fillMap(map, queue);
+		map.enableLiquids();
+		map.getLiquidEngine().setBudget(0);
+
+		const float low  = static_cast<float>(-RADIUS * 16);
+		const float high = static_cast<float>((RADIUS + 1) * 16 - 1);
+		map.beginEdit().replace(
+		    {low, low, low}, {high, high, high},
+		    getReferrer().blocks.get(voxels::BlockType::AIR_BLOCK),
+		    getBlock("core.water"));
+
+		while (map.getLiquidEngine().getActive() > 0)
+		{
+			map.tick();
+		}
+
+		while (state.keepRunning())
+		{
+			map.tick();
+		}
+
+		state.setItemsProcessed(state.getIterations());
+	}
+
+	/**
+	 * @brief Pours water onto the hills of the middle chunk until it
+	 * settles, then takes the source away and lets it drain, over and over.
+	 * Each iteration is a tick.
+	 */
+	void tickFlowingLiquid(State& state)
+	{
+		ChunkQueue  queue;
+		voxels::Map map(&queue, &getReferrer());
+		fillMap(map, queue);
+		map.enableLiquids();
+		map.getLiquidEngine().setBudget(0);
+
+		voxels::BlockType* blocks[] = {
+		    getBlock("core.water"),
+		    getReferrer().blocks.get(voxels::BlockType::AIR_BLOCK)};
+
+		const math::vec3 position = {8, 15, 8};
+
+		std::size_t i = 0;
+		while (state.keepRunning())
+		{
+			if (map.getLiquidEngine().getActive() == 0)
+			{
+				state.pauseTiming();
+				map.setBlockAt(position, blocks[i++ % 2]);
+				state.resumeTiming();
+			}
+
+			map.tick();
+		}
+
+		state.setItemsProcessed(state.getIterations());
+	}
+
+	// the argument is the view distance, in chunks.
+	void updatePlayerView(State& state)
+	{
+		ChunkQueue  queue;
+		voxels::Map map(&queue, &getReferrer());
+		fillMap(map, queue);
+
+		entt::registry registry;
+		entt::entity   entity = registry.create();
+		registry.emplace<Position>(entity, Position {});
+		registry.emplace<PlayerView>(entity, &map);
+
+		const int viewDistance = static_cast<int>(state.getArgument());
+
+		// each iteration starts from a player who hasn't seen anything, the
+		// same as a player joining or teleporting.
+		std::size_t chunks = 0;
+		while (state.keepRunning())
+		{
+			state.pauseTiming();
+			registry.get<PlayerView>(entity).chunks.clear();
+			state.resumeTiming();
+
+			chunks = PlayerView::update(&registry, entity, viewDistance).size();
+		}
+
+		state.setItemsProcessed(state.getIterations() * chunks);
+	}
+} // namespace
+
+PHX_BENCHMARK("Map::getChunk/hot", getChunkHot);
+PHX_BENCHMARK("Map::getChunk/cold", getChunkCold);
+PHX_BENCHMARK("Map::getBlockAt/hot", getBlockAtHot);
+PHX_BENCHMARK("Map::setBlockAt/fill", setBlockAtFill);
+PHX_BENCHMARK("Map::Edit::fill", editFill);
+PHX_BENCHMARK("PlayerView::update", updatePlayerView, 1, 2, 4);
+PHX_BENCHMARK("BlockTicker::schedule", scheduleBlockTicks);
+PHX_BENCHMARK("BlockTicker::tick", runBlockTicks);
+PHX_BENCHMARK("LightEngine::add", lightChunks);
+PHX_BENCHMARK("LightEngine::update/lamp", relightLamp);
+PHX_BENCHMARK("LightEngine::update/sky", relightSky);
+PHX_BENCHMARK("LiquidEngine::tick/settled", tickSettledLiquid);
+PHX_BENCHMARK("LiquidEngine::tick/flowing", tickFlowingLiquid);
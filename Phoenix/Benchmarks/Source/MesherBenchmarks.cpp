@@ -0,0 +1,116 @@
+// Copyright 2019-20 Genten Studios
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+// may be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <Benchmarks/Benchmark.hpp>
+#include <Benchmarks/Fixtures.hpp>
+
+#include <Client/Graphics/ChunkMesher.hpp>
+
+#include <vector>
+
+using namespace phx;
+using namespace phx::benchmarks;
+
+namespace
+{
+	// the argument is the ChunkPattern to mesh.
+	void meshChunk(State& state)
+	{
+		client::BlockRegistry blockRegistry;
+
+		// blocks without textures of their own use unknown.png, which is
+		// all the mesher needs to find in here.
+		blockRegistry.buildRenderInfo({{"Assets/unknown.png", 0}});
+
+		voxels::Chunk chunk = makeChunk(
+		    {0, 0, 0}, static_cast<ChunkPattern>(state.getArgument()));
+
+		std::size_t vertices = 0;
+		while (state.keepRunning())
+		{
+			const auto mesh = gfx::ChunkMesher::mesh(&chunk, &blockRegistry);
+			vertices = mesh.size();
+			doNotOptimize(mesh);
+		}
+
+		state.setItemsProcessed(state.getIterations());
+		state.setBytesProcessed(state.getIterations() * vertices *
+		                        sizeof(float));
+	}
+
+	// the same, with the chunk surrounded by chunks of the same pattern so
+	// ambient occlusion and light are read across its borders.
+	void meshSurroundedChunk(State& state)
+	{
+		client::BlockRegistry blockRegistry;
+		blockRegistry.buildRenderInfo({{"Assets/unknown.png", 0}});
+
+		const auto pattern = static_cast<ChunkPattern>(state.getArgument());
+
+		std::vector<voxels::Chunk> chunks;
+		chunks.reserve(27);
+
+		gfx::ChunkMesher::Neighbourhood neighbours {};
+		for (int dz = -1, n = 0; dz <= 1; ++dz)
+		{
+			for (int dy = -1; dy <= 1; ++dy)
+			{
+				for (int dx = -1; dx <= 1; ++dx, ++n)
+				{
+					chunks.push_back(makeChunk(
+					    {static_cast<float>(dx * voxels::Chunk::CHUNK_WIDTH),
+					     static_cast<float>(dy * voxels::Chunk::CHUNK_HEIGHT),
+					     static_cast<float>(dz * voxels::Chunk::CHUNK_DEPTH)},
+					    pattern));
+					neighbours[n] = &chunks.back();
+				}
+			}
+		}
+
+		// the chunk in the middle.
+		voxels::Chunk& chunk = chunks[13];
+
+		std::size_t vertices = 0;
+		while (state.keepRunning())
+		{
+			const auto mesh =
+			    gfx::ChunkMesher::mesh(&chunk, &blockRegistry, &neighbours);
+			vertices = mesh.size();
+			doNotOptimize(mesh);
+		}
+
+		state.setItemsProcessed(state.getIterations());
+		state.setBytesProcessed(state.getIterations() * vertices *
+		                        sizeof(float));
+	}
+} // namespace
+
+// empty, full, checkerboard and terrain.
+PHX_BENCHMARK("ChunkMesher::mesh", meshChunk, 0, 1, 2, 3);
+PHX_BENCHMARK("ChunkMesher::mesh/surrounded", meshSurroundedChunk, 0, 1, 2,
+              3);
@@ -0,0 +1,90 @@
+// Copyright 2019-20 Genten Studios
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+// may be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <Benchmarks/Benchmark.hpp>
+
+#include <Common/Utility/BlockingQueue.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace phx;
+using namespace phx::benchmarks;
+
+namespace
+{
+	// the argument is the number of threads pushing while one thread pops.
+	void pushPop(State& state)
+	{
+		BlockingQueue<int> queue;
+
+		const std::size_t producers = static_cast<std::size_t>(
+		    std::max<std::int64_t>(1, state.getArgument()));
+
+		std::atomic<bool>        start {false};
+		std::vector<std::thread> threads;
+		for (std::size_t p = 0; p < producers; ++p)
+		{
+			// the first thread also pushes whatever doesn't divide evenly.
+			std::size_t count = state.getIterations() / producers;
+			if (p == 0)
+			{
+				count += state.getIterations() % producers;
+			}
+
+			threads.emplace_back([&queue, &start, count] {
+				while (!start.load(std::memory_order_acquire))
+				{
+					std::this_thread::yield();
+				}
+
+				for (std::size_t i = 0; i < count; ++i)
+				{
+					queue.push(static_cast<int>(i));
+				}
+			});
+		}
+
+		start.store(true, std::memory_order_release);
+		while (state.keepRunning())
+		{
+			doNotOptimize(queue.pop());
+		}
+
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+
+		state.setItemsProcessed(state.getIterations());
+	}
+} // namespace
+
+PHX_BENCHMARK("BlockingQueue/push+pop", pushPop, 1, 2, 4);
@@ -0,0 +1,97 @@
+// Copyright 2019-20 Genten Studios
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+// may be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <Benchmarks/Benchmark.hpp>
+
+#include <Common/Registry.hpp>
+#include <Common/Voxels/Block.hpp>
+
+#include <string>
+#include <vector>
+
+using namespace phx;
+using namespace phx::benchmarks;
+
+namespace
+{
+	/// Roughly how many blocks a modded game registers.
+	constexpr std::size_t BLOCKS = 256;
+
+	using HashedBlocks = Registry<std::size_t, voxels::BlockType>;
+	using DenseBlocks  = DenseRegistry<voxels::BlockType>;
+
+	void getByName(State& state)
+	{
+		Registry<std::string, std::size_t> registry;
+		std::vector<std::string>           names;
+		for (std::size_t i = 0; i < BLOCKS; ++i)
+		{
+			names.push_back("mod.block_" + std::to_string(i));
+			registry.add(names.back(), i);
+		}
+
+		std::size_t i = 0;
+		while (state.keepRunning())
+		{
+			doNotOptimize(registry.get(names[i++ % BLOCKS]));
+		}
+
+		state.setItemsProcessed(state.getIterations());
+	}
+
+	template <typename BlockRegistry>
+	void getByID(State& state)
+	{
+		BlockRegistry registry;
+		for (std::size_t i = 0; i < BLOCKS; ++i)
+		{
+			voxels::BlockType block;
+			block.uniqueIdentifier = i;
+			registry.add(i, block);
+		}
+
+		// the order chunks are decoded in is close to random.
+		std::vector<std::size_t> ids;
+		for (std::size_t i = 0; i < 4096; ++i)
+		{
+			ids.push_back((i * 7919) % BLOCKS);
+		}
+
+		std::size_t i = 0;
+		while (state.keepRunning())
+		{
+			doNotOptimize(registry.get(ids[i++ % ids.size()]));
+		}
+
+		state.setItemsProcessed(state.getIterations());
+	}
+} // namespace
+
+PHX_BENCHMARK("Registry::get/name", getByName);
+PHX_BENCHMARK("Registry::get/id", getByID<HashedBlocks>);
+PHX_BENCHMARK("DenseRegistry::get/id", getByID<DenseBlocks>);
@@ -0,0 +1,127 @@
+// Copyright 2019-20 Genten Studios
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+// may be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <Benchmarks/Benchmark.hpp>
+#include <Benchmarks/Fixtures.hpp>
+
+#include <Common/Input.hpp>
+#include <Common/Utility/Serializer.hpp>
+
+using namespace phx;
+using namespace phx::benchmarks;
+
+namespace
+{
+	void encodeChunk(State& state)
+	{
+		const voxels::Chunk chunk = makeChunk({0, 0, 0}, ChunkPattern::TERRAIN);
+
+		std::size_t bytes = 0;
+		while (state.keepRunning())
+		{
+			Serializer ser;
+			ser << chunk;
+			bytes = ser.getBuffer().size();
+			doNotOptimize(ser.getBuffer());
+		}
+
+		state.setItemsProcessed(state.getIterations());
+		state.setBytesProcessed(state.getIterations() * bytes);
+	}
+
+	void decodeChunk(State& state)
+	{
+		const auto data =
+		    serializeChunk(makeChunk({0, 0, 0}, ChunkPattern::TERRAIN));
+
+		while (state.keepRunning())
+		{
+			voxels::Chunk chunk({0, 0, 0}, &getReferrer());
+
+			Serializer ser;
+			ser.borrowBuffer(data.data(), data.size());
+			ser >> chunk;
+			doNotOptimize(chunk.getBlocks());
+		}
+
+		state.setItemsProcessed(state.getIterations());
+		state.setBytesProcessed(state.getIterations() * data.size());
+	}
+
+	InputState makeInput()
+	{
+		InputState input;
+		input.forward  = true;
+		input.left     = true;
+		input.rotation = {1000000, 200000, 0};
+		input.sequence = 1234;
+		return input;
+	}
+
+	void encodeInput(State& state)
+	{
+		const InputState input = makeInput();
+
+		std::size_t bytes = 0;
+		while (state.keepRunning())
+		{
+			Serializer ser;
+			ser << input;
+			bytes = ser.getBuffer().size();
+			doNotOptimize(ser.getBuffer());
+		}
+
+		state.setItemsProcessed(state.getIterations());
+		state.setBytesProcessed(state.getIterations() * bytes);
+	}
+
+	void decodeInput(State& state)
+	{
+		Serializer encoded;
+		encoded << makeInput();
+		const auto data = encoded.getBuffer();
+
+		while (state.keepRunning())
+		{
+			InputState input;
+
+			Serializer ser;
+			ser.borrowBuffer(data.data(), data.size());
+			ser >> input;
+			doNotOptimize(input);
+		}
+
+		state.setItemsProcessed(state.getIterations());
+		state.setBytesProcessed(state.getIterations() * data.size());
+	}
+} // namespace
+
+PHX_BENCHMARK("Serializer/encode/Chunk", encodeChunk);
+PHX_BENCHMARK("Serializer/decode/Chunk", decodeChunk);
+PHX_BENCHMARK("Serializer/encode/InputState", encodeInput);
+PHX_BENCHMARK("Serializer/decode/InputState", decodeInput);
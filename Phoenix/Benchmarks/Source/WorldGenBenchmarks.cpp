@@ -0,0 +1,203 @@
+// Copyright 2019-20 Genten Studios
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+// may be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <Benchmarks/Benchmark.hpp>
+#include <Benchmarks/Fixtures.hpp>
+
+#include <Common/Math/Noise.hpp>
+#include <Common/Utility/ThreadPool.hpp>
+#include <Common/Voxels/WorldGenerator.hpp>
+
+#include <memory>
+#include <vector>
+
+using namespace phx;
+using namespace phx::benchmarks;
+
+namespace
+{
+	constexpr std::size_t SAMPLES = voxels::Chunk::CHUNK_MAX_BLOCKS;
+
+	/// The parallel benchmark generates COLUMNS x COLUMNS columns of chunks,
+	/// each COLUMN_HEIGHT chunks tall.
+	constexpr int COLUMNS       = 8;
+	constexpr int COLUMN_HEIGHT = 4;
+
+	struct Samples
+	{
+		std::vector<float> x;
+		std::vector<float> y;
+		std::vector<float> z;
+		std::vector<float> out;
+	};
+
+	// a chunk worth of sample positions, laid out the way the generator
+	// samples them.
+	Samples makeSamples()
+	{
+		Samples samples;
+		for (int z = 0; z < voxels::Chunk::CHUNK_DEPTH; ++z)
+		{
+			for (int y = 0; y < voxels::Chunk::CHUNK_HEIGHT; ++y)
+			{
+				for (int x = 0; x < voxels::Chunk::CHUNK_WIDTH; ++x)
+				{
+					samples.x.push_back(x * 0.06f);
+					samples.y.push_back(y * 0.06f);
+					samples.z.push_back(z * 0.06f);
+				}
+			}
+		}
+		samples.out.resize(SAMPLES);
+
+		return samples;
+	}
+
+	void perlinScalar(State& state)
+	{
+		const math::Noise noise(1234);
+		Samples           samples = makeSamples();
+
+		while (state.keepRunning())
+		{
+			for (std::size_t i = 0; i < SAMPLES; ++i)
+			{
+				samples.out[i] =
+				    noise.perlin(samples.x[i], samples.y[i], samples.z[i]);
+			}
+			doNotOptimize(samples.out.data());
+		}
+
+		state.setItemsProcessed(state.getIterations() * SAMPLES);
+	}
+
+	void perlinBatch(State& state)
+	{
+		const math::Noise noise(1234);
+		Samples           samples = makeSamples();
+
+		while (state.keepRunning())
+		{
+			noise.perlin(samples.x.data(), samples.y.data(), samples.z.data(),
+			             samples.out.data(), SAMPLES);
+			doNotOptimize(samples.out.data());
+		}
+
+		state.setItemsProcessed(state.getIterations() * SAMPLES);
+	}
+
+	// the argument is the chunk's height, in chunks, since chunks above the
+	// terrain skip most of the work.
+	void generateChunk(State& state)
+	{
+		voxels::NoiseGenerator generator(&getReferrer(), 1234);
+
+		const math::vec3 position = {
+		    0.f, static_cast<float>(state.getArgument() * 16), 0.f};
+
+		int i = 0;
+		while (state.keepRunning())
+		{
+			// a new column each time, so the heightmap isn't reused.
+			voxels::Chunk chunk(position + math::vec3 {i++ * 16.f, 0.f, 0.f},
+			                    &getReferrer());
+			generator.generate(chunk);
+			doNotOptimize(chunk.getBlocks().data());
+		}
+
+		state.setItemsProcessed(state.getIterations());
+	}
+
+	// the argument is the number of threads, including the caller. a pool
+	// asked for no workers makes one per core, so one thread runs without a
+	// pool at all.
+	void generateParallel(State& state)
+	{
+		voxels::NoiseGenerator      generator(&getReferrer(), 1234);
+		std::unique_ptr<ThreadPool> pool;
+		if (state.getArgument() > 1)
+		{
+			pool = std::make_unique<ThreadPool>(
+			    static_cast<std::size_t>(state.getArgument() - 1),
+			    "Benchmark");
+		}
+
+		constexpr std::size_t COLUMN_COUNT = COLUMNS * COLUMNS;
+
+		int offset = 0;
+		while (state.keepRunning())
+		{
+			state.pauseTiming();
+			std::vector<voxels::Chunk> chunks;
+			chunks.reserve(COLUMN_COUNT * COLUMN_HEIGHT);
+			for (int x = 0; x < COLUMNS; ++x)
+			{
+				for (int z = 0; z < COLUMNS; ++z)
+				{
+					for (int y = 0; y < COLUMN_HEIGHT; ++y)
+					{
+						const math::vec3 position = {
+						    (x + offset) * 16.f, (y - COLUMN_HEIGHT / 2) * 16.f,
+						    z * 16.f};
+						chunks.emplace_back(position, &getReferrer());
+					}
+				}
+			}
+			offset += COLUMNS;
+			state.resumeTiming();
+
+			const auto generateColumn = [&](std::size_t column) {
+				for (int y = 0; y < COLUMN_HEIGHT; ++y)
+				{
+					generator.generate(chunks[column * COLUMN_HEIGHT + y]);
+				}
+			};
+
+			if (pool != nullptr)
+			{
+				pool->parallelFor(COLUMN_COUNT, generateColumn);
+			}
+			else
+			{
+				for (std::size_t column = 0; column < COLUMN_COUNT; ++column)
+				{
+					generateColumn(column);
+				}
+			}
+		}
+
+		state.setItemsProcessed(state.getIterations() * COLUMN_COUNT *
+		                        COLUMN_HEIGHT);
+	}
+} // namespace
+
+PHX_BENCHMARK("Noise::perlin/scalar", perlinScalar);
+PHX_BENCHMARK("Noise::perlin/batch", perlinBatch);
+PHX_BENCHMARK("NoiseGenerator::generate", generateChunk, -1, 0, 1);
+PHX_BENCHMARK("NoiseGenerator::generate/parallel", generateParallel, 1, 2, 4,
+              8);
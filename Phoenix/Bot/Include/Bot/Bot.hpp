@@ -0,0 +1,186 @@
+// Copyright 2019-20 Genten Studios
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+// may be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <Bot/Samples.hpp>
+
+#include <Client/Network.hpp>
+
+#include <Common/Input.hpp>
+#include <Common/Math/Math.hpp>
+#include <Common/Network/Address.hpp>
+#include <Common/Position.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <random>
+
+namespace phx::bot
+{
+	/**
+	 * @brief How a bot moves around the world.
+	 */
+	enum class Pattern
+	{
+		/// @brief Wanders in a random direction, changing it every so often.
+		RANDOM_WALK,
+
+		/// @brief Flies in a straight line, streaming in new chunks the whole
+		/// time.
+		FLIGHT,
+
+		/// @brief Stays roughly in place and changes the blocks in front of
+		/// it with the server's setblock command, which the server has to
+		/// turn on with server:edit_command.
+		EDIT
+	};
+
+	/**
+	 * @brief The measurements a bot has taken.
+	 */
+	struct Statistics
+	{
+		/// @brief The time between server states arriving, in milliseconds.
+		/// Network jitter and batching show up here as well as the server's
+		/// tick rate.
+		Samples stateInterval;
+
+		/// @brief The time the server's ticks took, in milliseconds, as
+		/// reported in each state it sends.
+		Samples serverTick;
+
+		/// @brief The round trip time to the server, in milliseconds.
+		Samples roundTrip;
+
+		/// @brief How long chunks took to arrive after they were needed, in
+		/// milliseconds.
+		Samples chunkLatency;
+
+		std::size_t inputs = 0;
+		std::size_t states = 0;
+		std::size_t chunks = 0;
+		std::size_t edits  = 0;
+	};
+
+	/**
+	 * @brief A simulated player, connected through the real client networking.
+	 *
+	 * Each bot owns a client::Network, so it connects, batches and parses
+	 * packets exactly like PhoenixClient does. Input states are built the same
+	 * way InputQueue builds them, from a scripted pattern instead of the
+	 * keyboard and camera.
+	 *
+	 * To measure chunk latency, the bot predicts its own position from the
+	 * inputs it has sent, using the same movement rules as the server. A chunk
+	 * arriving is measured against when the bot's predicted position last
+	 * crossed a chunk boundary (or when it connected, for the first view).
+	 * Lost input states make the prediction drift slightly, so this is an
+	 * upper bound rather than an exact figure.
+	 */
+	class Bot
+	{
+	public:
+		using Clock = std::chrono::steady_clock;
+
+	public:
+		/**
+		 * @brief Creates a bot and connects it to a server.
+		 * @param address The address of the server.
+		 * @param pattern How the bot should move.
+		 * @param seed The seed for the bot's random decisions.
+		 */
+		Bot(const net::Address& address, Pattern pattern, std::uint32_t seed);
+		~Bot();
+
+		/**
+		 * @brief Checks whether the bot managed to connect.
+		 * @return Whether the bot is connected to the server.
+		 */
+		bool isConnected();
+
+		/**
+		 * @brief Sends the next input and processes anything received.
+		 * @param dt The time between ticks, the server's tick length.
+		 */
+		void tick(float dt);
+
+		/**
+		 * @brief Processes everything received since the last update.
+		 *
+		 * This should be called far more often than tick, the time data is
+		 * processed is the time it's considered to have arrived.
+		 */
+		void update();
+
+		/**
+		 * @brief Records the round trip time last seen by the network thread.
+		 */
+		void sampleRoundTrip();
+
+		/**
+		 * @brief Gets the total amount of data sent and received.
+		 * @return The amount of data sent and received, in bytes.
+		 */
+		std::uint64_t getTotalSentData() const;
+		std::uint64_t getTotalReceivedData() const;
+
+		const Statistics& getStatistics() const { return m_statistics; }
+
+	private:
+		InputState nextInput();
+		void       predict(const InputState& input, float dt);
+
+		static math::vec3i toChunk(const math::vec3& position);
+
+	private:
+		std::unique_ptr<client::Network> m_network;
+		bool                             m_connected = false;
+		Pattern                          m_pattern;
+		std::mt19937                     m_random;
+
+		Statistics m_statistics;
+
+		std::size_t m_sequence = 0;
+		std::size_t m_ticks    = 0;
+
+		// where the bot is heading, changed by the pattern.
+		InputState m_heading;
+		float      m_yaw = 0.f;
+
+		// where the server should think we are.
+		Position    m_predicted;
+		math::vec3i m_predictedChunk;
+
+		Clock::time_point m_needChunksAt;
+
+		std::size_t       m_lastStateSequence = 0;
+		Clock::time_point m_lastStateAt;
+	};
+} // namespace phx::bot
@@ -0,0 +1,77 @@
+// Copyright 2019-20 Genten Studios
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+// may be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace phx::bot
+{
+	/**
+	 * @brief Collects measurements so percentiles can be reported.
+	 *
+	 * Every sample is kept, which is fine for the length of a benchmark run
+	 * (a few hundred thousand samples at most) and keeps percentiles exact.
+	 */
+	class Samples
+	{
+	public:
+		/**
+		 * @brief Records a new sample.
+		 * @param value The value measured.
+		 */
+		void record(double value);
+
+		/**
+		 * @brief Adds every sample from another set to this one.
+		 * @param other The samples to add.
+		 */
+		void merge(const Samples& other);
+
+		std::size_t count() const { return m_values.size(); }
+		bool        empty() const { return m_values.empty(); }
+
+		double mean() const;
+		double max() const;
+
+		/**
+		 * @brief Gets a percentile of the samples.
+		 * @param percentile The percentile wanted, between 0 and 100.
+		 * @return The value at the percentile, or 0 if there are no samples.
+		 */
+		double percentile(double percentile) const;
+
+	private:
+		void sort() const;
+
+	private:
+		mutable std::vector<double> m_values;
+		mutable bool                m_sorted = true;
+	};
+} // namespace phx::bot
@@ -0,0 +1,258 @@
+// Copyright 2019-20 Genten Studios
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+// may be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <Bot/Bot.hpp>
+
+#include <Common/Logger.hpp>
+#include <Common/Movement.hpp>
+#include <Common/Voxels/Chunk.hpp>
+
+#include <cmath>
+#include <string>
+
+using namespace phx::bot;
+using namespace phx;
+
+// how often a wandering bot picks a new direction, in ticks.
+static const std::size_t WANDER_INTERVAL = 40;
+
+// how often an editing bot changes a block, in ticks.
+static const std::size_t EDIT_INTERVAL = 10;
+
+// how far an editing bot turns every tick, in radians.
+static const float EDIT_TURN_SPEED = 0.05f;
+
+Bot::Bot(const net::Address& address, Pattern pattern, std::uint32_t seed)
+    : m_network(std::make_unique<client::Network>(address)),
+      m_pattern(pattern), m_random(seed)
+{
+	std::uniform_real_distribution<float> angle(0.f, 2.f * math::PI);
+	m_yaw = angle(m_random);
+
+	m_predictedChunk = toChunk(m_predicted.position);
+	m_needChunksAt   = Clock::now();
+
+	// the host belongs to the network thread once it starts.
+	m_connected = m_network->getHost()->getPeerCount() > 0;
+	m_network->start();
+}
+
+Bot::~Bot() { m_network->stop(); }
+
+bool Bot::isConnected() { return m_connected; }
+
+void Bot::tick(float dt)
+{
+	const InputState input = nextInput();
+	m_network->sendState(input);
+	++m_statistics.inputs;
+
+	predict(input, dt);
+
+	if (m_pattern == Pattern::EDIT && m_ticks % EDIT_INTERVAL == 0)
+	{
+		// the block a couple of blocks ahead, found the same way the server
+		// finds the block a player is looking at. every other edit clears
+		// it again so the world doesn't fill up.
+		math::vec3 target = (m_predicted.position / 2.f) + .5f +
+		                    m_predicted.getDirection() * 2.f;
+		target.floor();
+
+		const char* block =
+		    (m_statistics.edits % 2 == 0) ? "core.stone" : "core.air";
+		m_network->sendMessage(
+		    "/setblock " + std::to_string(static_cast<int>(target.x)) + " " +
+		    std::to_string(static_cast<int>(target.y)) + " " +
+		    std::to_string(static_cast<int>(target.z)) + " " + block);
+		++m_statistics.edits;
+	}
+}
+
+void Bot::update()
+{
+	const auto now = Clock::now();
+
+	client::ConfirmedState state;
+	while (m_network->stateQueue.try_pop(state))
+	{
+		const std::size_t sequence = state.sequence;
+		if (m_statistics.states > 0 && sequence > m_lastStateSequence)
+		{
+			const std::chrono::duration<double, std::milli> elapsed =
+			    now - m_lastStateAt;
+			m_statistics.stateInterval.record(
+			    elapsed.count() /
+			    static_cast<double>(sequence - m_lastStateSequence));
+		}
+
+		// the first tick has no tick before it to report.
+		if (state.tickTime > 0)
+		{
+			m_statistics.serverTick.record(
+			    static_cast<double>(state.tickTime) / 1000.0);
+		}
+
+		m_lastStateSequence = sequence;
+		m_lastStateAt       = now;
+		++m_statistics.states;
+	}
+
+	std::pair<math::vec3, std::vector<std::byte>> chunk;
+	while (m_network->chunkQueue.try_pop(chunk))
+	{
+		const std::chrono::duration<double, std::milli> latency =
+		    now - m_needChunksAt;
+		m_statistics.chunkLatency.record(latency.count());
+		++m_statistics.chunks;
+	}
+
+	std::string message;
+	while (m_network->messageQueue.try_pop(message))
+	{
+		// nobody's reading the chat.
+	}
+}
+
+void Bot::sampleRoundTrip()
+{
+	// nothing is known about the connection until the server has replied.
+	if (m_connected && m_statistics.states > 0)
+	{
+		m_statistics.roundTrip.record(m_network->getRoundTripTime().count());
+	}
+}
+
+std::uint64_t Bot::getTotalSentData() const
+{
+	return m_network->getTotalSentData();
+}
+
+std::uint64_t Bot::getTotalReceivedData() const
+{
+	return m_network->getTotalReceivedData();
+}
+
+InputState Bot::nextInput()
+{
+	++m_sequence;
+	++m_ticks;
+
+	switch (m_pattern)
+	{
+	case Pattern::RANDOM_WALK:
+		if (m_ticks % WANDER_INTERVAL == 1)
+		{
+			std::bernoulli_distribution           coin(0.5);
+			std::bernoulli_distribution           climb(0.2);
+			std::uniform_real_distribution<float> angle(0.f, 2.f * math::PI);
+
+			m_heading          = InputState {};
+			m_heading.forward  = coin(m_random);
+			m_heading.backward = !m_heading.forward && coin(m_random);
+			m_heading.left     = coin(m_random);
+			m_heading.right    = !m_heading.left && coin(m_random);
+			m_heading.up       = climb(m_random);
+			m_heading.down     = !m_heading.up && climb(m_random);
+
+			m_yaw = angle(m_random);
+		}
+		break;
+
+	case Pattern::FLIGHT:
+		m_heading.forward = true;
+		break;
+
+	case Pattern::EDIT:
+		// kept in [0, 2pi) like a camera's rotation, or the rotation sent
+		// would overflow on a long run.
+		m_yaw = std::fmod(m_yaw + EDIT_TURN_SPEED, 2.f * math::PI);
+		break;
+	}
+
+	// built the same way InputQueue builds a state from the camera.
+	InputState input = m_heading;
+	input.rotation.x = static_cast<int>(m_yaw * 360000.0);
+	input.rotation.y = 0;
+	input.sequence   = m_sequence;
+
+	return input;
+}
+
+void Bot::predict(const InputState& input, float dt)
+{
+	// this mirrors ActorSystem::tick on the server.
+	m_predicted.rotation.x = static_cast<float>(input.rotation.x) / 360000.0;
+	m_predicted.rotation.y = static_cast<float>(input.rotation.y) / 360000.0;
+
+	const auto moveSpeed = static_cast<float>(DEFAULT_MOVE_SPEED);
+
+	if (input.forward)
+	{
+		m_predicted.position += m_predicted.getForward() * dt * moveSpeed;
+	}
+	else if (input.backward)
+	{
+		m_predicted.position -= m_predicted.getForward() * dt * moveSpeed;
+	}
+
+	if (input.left)
+	{
+		m_predicted.position -= m_predicted.getRight() * dt * moveSpeed;
+	}
+	else if (input.right)
+	{
+		m_predicted.position += m_predicted.getRight() * dt * moveSpeed;
+	}
+
+	if (input.up)
+	{
+		m_predicted.position.y += dt * moveSpeed;
+	}
+	else if (input.down)
+	{
+		m_predicted.position.y -= dt * moveSpeed;
+	}
+
+	const math::vec3i chunk = toChunk(m_predicted.position);
+	if (!(chunk == m_predictedChunk))
+	{
+		// the server will start sending the chunks that came into view as
+		// soon as it processes this input.
+		m_predictedChunk = chunk;
+		m_needChunksAt   = Clock::now();
+	}
+}
+
+phx::math::vec3i Bot::toChunk(const math::vec3& position)
+{
+	// the same (truncating) conversion the server uses to decide when to
+	// send chunks.
+	return {static_cast<int>(position.x) / voxels::Chunk::CHUNK_WIDTH,
+	        static_cast<int>(position.y) / voxels::Chunk::CHUNK_HEIGHT,
+	        static_cast<int>(position.z) / voxels::Chunk::CHUNK_DEPTH};
+}
@@ -0,0 +1,337 @@
+// Copyright 2019-20 Genten Studios
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+// may be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <Bot/Bot.hpp>
+
+#include <Common/Logger.hpp>
+
+#include <nlohmann/json.hpp>
+
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace phx;
+
+namespace
+{
+	struct Options
+	{
+		std::string  host     = "127.0.0.1";
+		enet_uint16  port     = 7777;
+		std::size_t  bots     = 10;
+		std::string  pattern  = "mixed";
+		unsigned int duration = 60;
+		unsigned int tick     = 50;
+		unsigned int seed     = 0;
+		std::string  output;
+	};
+
+	void printUsage()
+	{
+		std::cout
+		    << "Usage: PhoenixBot [options]\n"
+		       "  --host <address>     server to connect to (127.0.0.1)\n"
+		       "  --port <port>        port to connect to (7777)\n"
+		       "  --bots <count>       number of simulated players (10)\n"
+		       "  --pattern <pattern>  walk, flight, edit or mixed (mixed)\n"
+		       "  --duration <s>       how long to run for (60)\n"
+		       "  --tick <ms>          time between inputs (50)\n"
+		       "  --seed <seed>        seed for the bots' decisions (0)\n"
+		       "  --output <file>      also write the results as JSON\n";
+	}
+
+	bool parseOptions(int argc, char** argv, Options& options)
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			const std::string arg = argv[i];
+			if (arg == "--help" || i + 1 >= argc)
+			{
+				return false;
+			}
+
+			const std::string value = argv[++i];
+			if (arg == "--host")
+			{
+				options.host = value;
+			}
+			else if (arg == "--port")
+			{
+				options.port = static_cast<enet_uint16>(std::stoul(value));
+			}
+			else if (arg == "--bots")
+			{
+				options.bots = std::stoul(value);
+			}
+			else if (arg == "--pattern")
+			{
+				options.pattern = value;
+			}
+			else if (arg == "--duration")
+			{
+				options.duration = std::stoul(value);
+			}
+			else if (arg == "--tick")
+			{
+				options.tick = std::stoul(value);
+			}
+			else if (arg == "--seed")
+			{
+				options.seed = std::stoul(value);
+			}
+			else if (arg == "--output")
+			{
+				options.output = value;
+			}
+			else
+			{
+				return false;
+			}
+		}
+
+		return options.pattern == "walk" || options.pattern == "flight" ||
+		       options.pattern == "edit" || options.pattern == "mixed";
+	}
+
+	bot::Pattern patternFor(const Options& options, std::size_t bot)
+	{
+		if (options.pattern == "walk")
+		{
+			return bot::Pattern::RANDOM_WALK;
+		}
+		if (options.pattern == "flight")
+		{
+			return bot::Pattern::FLIGHT;
+		}
+		if (options.pattern == "edit")
+		{
+			return bot::Pattern::EDIT;
+		}
+
+		// mixed, spread evenly.
+		return static_cast<bot::Pattern>(bot % 3);
+	}
+
+	nlohmann::json summarize(const bot::Samples& samples)
+	{
+		nlohmann::json json;
+		json["count"] = samples.count();
+		json["mean"]  = samples.mean();
+		json["p50"]   = samples.percentile(50);
+		json["p90"]   = samples.percentile(90);
+		json["p99"]   = samples.percentile(99);
+		json["max"]   = samples.max();
+		return json;
+	}
+
+	void printSamples(const std::string& name, const bot::Samples& samples)
+	{
+		std::cout << std::left << std::setw(24) << name << std::right
+		          << std::fixed << std::setprecision(2) << std::setw(10)
+		          << samples.percentile(50) << std::setw(10)
+		          << samples.percentile(90) << std::setw(10)
+		          << samples.percentile(99) << std::setw(10) << samples.max()
+		          << "  (" << samples.count() << " samples)\n";
+	}
+} // namespace
+
+#undef main
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!parseOptions(argc, argv, options))
+	{
+		printUsage();
+		return EXIT_FAILURE;
+	}
+
+	LoggerConfig config;
+	config.verbosity = LogVerbosity::WARNING;
+	Logger::initialize(config);
+
+	const net::Address address(options.host, options.port);
+
+	// the server only accepts /setblock when it's been turned on, edits
+	// are silently dropped otherwise.
+	if (options.pattern == "edit" || options.pattern == "mixed")
+	{
+		std::cout << "Editing bots need server:edit_command set to 1 in the "
+		             "server's config.txt."
+		          << std::endl;
+	}
+
+	std::vector<std::unique_ptr<bot::Bot>> bots;
+	bots.reserve(options.bots);
+
+	std::cout << "Connecting " << options.bots << " bots to " << options.host
+	          << ":" << options.port << "..." << std::endl;
+
+	for (std::size_t i = 0; i < options.bots; ++i)
+	{
+		auto bot = std::make_unique<bot::Bot>(
+		    address, patternFor(options, i),
+		    options.seed + static_cast<unsigned int>(i));
+
+		if (!bot->isConnected())
+		{
+			LOG_WARNING("BOT") << "Bot " << i << " failed to connect.";
+			continue;
+		}
+
+		bots.push_back(std::move(bot));
+	}
+
+	if (bots.empty())
+	{
+		LOG_FATAL("BOT") << "No bots could connect, is the server running?";
+		Logger::teardown();
+		return EXIT_FAILURE;
+	}
+
+	std::cout << bots.size() << " bots connected, running for "
+	          << options.duration << " seconds." << std::endl;
+
+	using Clock = bot::Bot::Clock;
+
+	const float dt         = static_cast<float>(options.tick) / 1000.f;
+	const auto  tickLength = std::chrono::milliseconds(options.tick);
+	const auto  start      = Clock::now();
+	const auto  end        = start + std::chrono::seconds(options.duration);
+
+	auto nextTick   = start;
+	auto nextSample = start;
+
+	while (Clock::now() < end)
+	{
+		for (auto& bot : bots)
+		{
+			bot->tick(dt);
+		}
+
+		nextTick += tickLength;
+
+		// process received data until the next tick, often enough that the
+		// arrival times are accurate to about a millisecond.
+		while (Clock::now() < nextTick)
+		{
+			for (auto& bot : bots)
+			{
+				bot->update();
+			}
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+
+		if (Clock::now() >= nextSample)
+		{
+			for (auto& bot : bots)
+			{
+				bot->sampleRoundTrip();
+			}
+
+			nextSample += std::chrono::seconds(1);
+		}
+	}
+
+	const std::chrono::duration<double> elapsed = Clock::now() - start;
+	const std::size_t                   connected = bots.size();
+
+	bot::Statistics total;
+	std::uint64_t   sent     = 0;
+	std::uint64_t   received = 0;
+	for (auto& bot : bots)
+	{
+		const bot::Statistics& stats = bot->getStatistics();
+		total.serverTick.merge(stats.serverTick);
+		total.stateInterval.merge(stats.stateInterval);
+		total.roundTrip.merge(stats.roundTrip);
+		total.chunkLatency.merge(stats.chunkLatency);
+		total.inputs += stats.inputs;
+		total.states += stats.states;
+		total.chunks += stats.chunks;
+		total.edits += stats.edits;
+
+		sent += bot->getTotalSentData();
+		received += bot->getTotalReceivedData();
+	}
+
+	bots.clear();
+
+	const double seconds    = elapsed.count();
+	const double upstream   = static_cast<double>(sent) / seconds;
+	const double downstream = static_cast<double>(received) / seconds;
+	const double botCount   = static_cast<double>(connected);
+
+	std::cout << "\n"
+	          << std::left << std::setw(24) << "(milliseconds)" << std::right
+	          << std::setw(10) << "p50" << std::setw(10) << "p90"
+	          << std::setw(10) << "p99" << std::setw(10) << "max" << "\n";
+	printSamples("server tick time", total.serverTick);
+	printSamples("state interval", total.stateInterval);
+	printSamples("round trip time", total.roundTrip);
+	printSamples("chunk latency", total.chunkLatency);
+
+	std::cout << "\nupstream:   " << upstream / 1024.0 << " KiB/s ("
+	          << upstream / 1024.0 / botCount << " KiB/s per bot)\n"
+	          << "downstream: " << downstream / 1024.0 << " KiB/s ("
+	          << downstream / 1024.0 / botCount << " KiB/s per bot)\n"
+	          << "inputs sent: " << total.inputs
+	          << ", states received: " << total.states
+	          << ", chunks received: " << total.chunks
+	          << ", edits sent: " << total.edits << std::endl;
+
+	if (!options.output.empty())
+	{
+		nlohmann::json results;
+		results["bots"]           = connected;
+		results["pattern"]        = options.pattern;
+		results["duration"]       = seconds;
+		results["serverTickTime"] = summarize(total.serverTick);
+		results["stateInterval"]  = summarize(total.stateInterval);
+		results["roundTripTime"]  = summarize(total.roundTrip);
+		results["chunkLatency"]   = summarize(total.chunkLatency);
+		results["upstream"]       = upstream;
+		results["downstream"]     = downstream;
+		results["inputs"]         = total.inputs;
+		results["states"]         = total.states;
+		results["chunks"]         = total.chunks;
+		results["edits"]          = total.edits;
+
+		std::ofstream file(options.output);
+		file << std::setw(4) << results << std::endl;
+	}
+
+	Logger::teardown();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,98 @@
+// Copyright 2019-20 Genten Studios
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+// may be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <Bot/Samples.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+using namespace phx::bot;
+
+void Samples::record(double value)
+{
+	m_values.push_back(value);
+	m_sorted = false;
+}
+
+void Samples::merge(const Samples& other)
+{
+	m_values.insert(m_values.end(), other.m_values.begin(),
+	                other.m_values.end());
+	m_sorted = false;
+}
+
+double Samples::mean() const
+{
+	if (m_values.empty())
+	{
+		return 0.0;
+	}
+
+	return std::accumulate(m_values.begin(), m_values.end(), 0.0) /
+	       static_cast<double>(m_values.size());
+}
+
+double Samples::max() const
+{
+	if (m_values.empty())
+	{
+		return 0.0;
+	}
+
+	return *std::max_element(m_values.begin(), m_values.end());
+}
+
+double Samples::percentile(double percentile) const
+{
+	if (m_values.empty())
+	{
+		return 0.0;
+	}
+
+	sort();
+
+	// nearest rank.
+	const double rank = std::ceil(percentile / 100.0 *
+	                              static_cast<double>(m_values.size()));
+	const std::size_t index =
+	    std::clamp<std::size_t>(static_cast<std::size_t>(rank), 1,
+	                            m_values.size()) -
+	    1;
+
+	return m_values[index];
+}
+
+void Samples::sort() const
+{
+	if (!m_sorted)
+	{
+		std::sort(m_values.begin(), m_values.end());
+		m_sorted = true;
+	}
+}
@@ -39,7 +39,9 @@
 #include <Client/Voxels/BlockRegistry.hpp>
 
 #include <Common/Voxels/Chunk.hpp>
+#include <Common/Voxels/Map.hpp>
 
+#include <array>
 #include <vector>
 
 namespace phx::gfx
@@ -65,23 +67,41 @@ namespace phx::gfx
 	 * @brief Meshes a chunk.
 	 *
 	 * This mesher does not understand "smart"/"greedy" meshing, it will mesh
-	 * only this chunk, and will not take neighbor chunks into account as of
-	 * yet. As the project gains maturity and we have more features, this will
-	 * be improved.
+	 * only this chunk. Faces are still only culled against blocks in this
+	 * chunk, but the chunks around it are looked at for light and ambient
+	 * occlusion so seams between chunks match.
 	 *
 	 * @paragraph Usage
 	 * @code
-	 * auto mesh = ChunkMesher::mesh(chunk, renderer->getTextureTable(),
-	 * blockRegistry);
+	 * blockRegistry->buildRenderInfo(renderer->getTextureTable());
+	 * auto neighbours = ChunkMesher::getNeighbourhood(map, chunk);
+	 * auto mesh = ChunkMesher::mesh(chunk, blockRegistry, &neighbours);
 	 * @endcode
 	 *
+	 * The render info of the block registry must have been built after
+	 * textures were loaded, ChunkRenderer::prep does this.
+	 *
+	 * Each face carries the light of the block in front of it, as packed
+	 * by Chunk::getLight, with the ambient occlusion of each corner from 0
+	 * (tucked in) to 3 (open) packed above it. Chunks that aren't lit are
+	 * meshed fully lit, and without a neighbourhood the edges of the chunk
+	 * are taken to be open.
 	 */
 	class ChunkMesher
 	{
 	public:
+		/**
+		 * @brief The chunks around a chunk and the chunk itself, indexed by
+		 * (dx + 1) + 3 * ((dy + 1) + 3 * (dz + 1)) for offsets of -1 to 1
+		 * chunks. Chunks that aren't loaded are nullptr.
+		 */
+		using Neighbourhood = std::array<const voxels::Chunk*, 27>;
+
+		static Neighbourhood getNeighbourhood(voxels::Map*         map,
+		                                      const voxels::Chunk* chunk);
+
 		static std::vector<float> mesh(
-		    voxels::Chunk*                                chunk,
-		    const ChunkRenderer::AssociativeTextureTable& texTable,
-		    client::BlockRegistry*                        blockRegistry);
+		    voxels::Chunk* chunk, client::BlockRegistry* blockRegistry,
+		    const Neighbourhood* neighbours = nullptr);
 	};
 } // namespace phx::gfx
@@ -136,6 +136,16 @@ namespace phx::gfx
 		 */
 		const AssociativeTextureTable& getTextureTable() const;
 
+	private:
+		/**
+		 * @brief Rebuilds the block render info if blocks have been
+		 * registered since it was last built.
+		 *
+		 * Textures of blocks registered after prep aren't in the texture
+		 * array, so those blocks are drawn with the unknown texture.
+		 */
+		void refreshRenderInfo();
+
 	private:
 		client::BlockRegistry* m_blockRegistry;
 		voxels::Map*           m_map;
@@ -156,11 +166,13 @@ namespace phx::gfx
 
 		unsigned int            m_textureArray = 0;
 		AssociativeTextureTable m_textureTable;
+		std::size_t             m_renderInfoRevision = 0;
 
 		const int m_vertexAttributeLocation = 0;
 		const int m_uvAttributeLocation     = 1;
 		const int m_normalAttributeLocation = 2;
 		const int m_colorAttributeLocation  = 3;
+		const int m_lightAttributeLocation  = 4;
 
 		unsigned int   m_selectionBoxVAO = 0;
 		unsigned int   m_selectionBoxVBO = 0;
@@ -36,14 +36,40 @@
 #include <Common/Utility/BlockingQueue.hpp>
 #include <Common/Voxels/Chunk.hpp>
 
+#include <atomic>
+#include <cstdint>
+#include <memory>
 #include <thread>
 
 namespace phx::client
 {
+	/**
+	 * @brief A state confirmed by the server.
+	 */
+	struct ConfirmedState
+	{
+		Position    position;
+		std::size_t sequence;
+
+		/// @brief How long the server's tick before this one took, in
+		/// microseconds.
+		std::uint32_t tickTime;
+	};
+
 	class Network
 	{
 	public:
 		Network(const phx::net::Address& address);
+
+		/**
+		 * @brief Connects to a server through a specific transport.
+		 *
+		 * @param address The address of the server
+		 * @param transport The transport to connect with, such as a
+		 * LoopbackTransport for a server running in the same process
+		 */
+		Network(const phx::net::Address&             address,
+		        std::unique_ptr<phx::net::Transport> transport);
 		~Network();
 
 	private:
@@ -97,15 +123,71 @@ namespace phx::client
 		 */
 		void sendMessage(const std::string& message);
 
+		/**
+		 * @brief Sends an event packet to the server
+		 *
+		 * @param event The event data
+		 */
+		void sendEvent(const std::string& event);
+
+		/**
+		 * @brief Gets the host used to talk to the server
+		 *
+		 * @return The underlying host, for connection statistics
+		 */
+		phx::net::Host* getHost() { return m_client; }
+
+		/**
+		 * @brief Gets the round trip time to the server
+		 *
+		 * This is sampled on the network thread whenever a packet arrives,
+		 * so it is safe to read from any thread.
+		 *
+		 * @return The last round trip time seen, 0 before anything arrives
+		 */
+		time::ms getRoundTripTime() const
+		{
+			return time::ms(m_roundTrip.load(std::memory_order_relaxed));
+		}
+
+		/**
+		 * @brief Gets the total bytes sent to and received from the server
+		 *
+		 * These are copied from the host by the network thread whenever a
+		 * packet arrives and after every poll, so they are safe to read
+		 * from any thread.
+		 *
+		 * @return The totals as of the last poll
+		 */
+		std::uint32_t getTotalSentData() const
+		{
+			return m_sentData.load(std::memory_order_relaxed);
+		}
+
+		std::uint32_t getTotalReceivedData() const
+		{
+			return m_receivedData.load(std::memory_order_relaxed);
+		}
+
 		phx::BlockingQueue<std::string> messageQueue;
-		phx::BlockingQueue<std::pair<Position, size_t>> stateQueue;
+		phx::BlockingQueue<ConfirmedState> stateQueue;
 		phx::BlockingQueue<std::pair<math::vec3, std::vector<std::byte>>>
 		    chunkQueue;
 
 	private:
-		bool            m_running = false;
-		phx::net::Host* m_client;
-		std::thread     m_thread;
-		std::size_t     m_currentSequence;
+		// must be called from the network thread, or once it has stopped.
+		void publishTotals();
+
+	private:
+		std::atomic<bool> m_running {false};
+		phx::net::Host*   m_client;
+		std::thread       m_thread;
+		std::size_t       m_currentSequence = 0;
+		phx::InputHistory m_inputHistory;
+
+		// written by the network thread, read by anyone.
+		std::atomic<unsigned int>  m_roundTrip {0};
+		std::atomic<std::uint32_t> m_sentData {0};
+		std::atomic<std::uint32_t> m_receivedData {0};
 	};
 } // namespace phx::client
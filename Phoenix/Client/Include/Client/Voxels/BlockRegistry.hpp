@@ -32,12 +32,34 @@
 #include <Common/Registry.hpp>
 #include <Common/Voxels/BlockReferrer.hpp>
 
+#include <algorithm>
+#include <array>
+#include <cstdint>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
 namespace phx::client
 {
+	/**
+	 * @brief Everything the mesher needs to know about a block, flattened so
+	 * it can be read without touching the block itself.
+	 */
+	struct BlockRenderInfo
+	{
+		/// @brief The texture array layer of each face, in BlockFace order.
+		std::array<std::uint32_t, 6> layers = {};
+
+		/// @brief Whether the block is meshed at all.
+		bool solid = false;
+
+		/// @brief Whether the block hides the faces of blocks next to it.
+		bool opaque = false;
+
+		/// @brief The bitpacked color of the block.
+		unsigned color = 0;
+	};
+
 	/**
 	 * @brief Acts as a register for block data throughout the client
 	 * application.
@@ -63,6 +85,83 @@ namespace phx::client
 
 		Registry<std::size_t, std::vector<std::string>> textures;
 
+		/// @brief Render info of every block, indexed by its unique ID.
+		std::vector<BlockRenderInfo> renderInfo;
+
+		/// @brief Goes up every time a block is registered, so render info
+		/// built before then can be spotted and rebuilt.
+		std::size_t revision = 0;
+
+		/**
+		 * @brief Rebuilds the render info of every registered block.
+		 *
+		 * This must be called once textures are loaded, since it resolves
+		 * each block's texture paths into texture array layers.
+		 *
+		 * @param textureTable The layer each texture path is loaded into.
+		 */
+		void buildRenderInfo(
+		    const std::unordered_map<std::string, std::size_t>& textureTable)
+		{
+			renderInfo.assign(referrer.blocks.capacity(), {});
+
+			// textures that failed to load use the unknown texture instead.
+			std::uint32_t unknownLayer = 0;
+			auto          unknown = textureTable.find("Assets/unknown.png");
+			if (unknown != textureTable.end())
+			{
+				unknownLayer = static_cast<std::uint32_t>(unknown->second);
+			}
+
+			for (std::size_t id = 0; id < renderInfo.size(); ++id)
+			{
+				// holes in the IDs render as the unknown block, as they would
+				// have done through the registry.
+				const voxels::BlockType* block = referrer.blocks.get(id);
+				const auto*              paths = textures.get(id);
+
+				BlockRenderInfo& info = renderInfo[id];
+				info.solid  = block->category == voxels::BlockCategory::SOLID;
+				info.opaque = info.solid;
+				info.color  = block->color;
+
+				for (std::size_t face = 0; face < info.layers.size(); ++face)
+				{
+					info.layers[face] = unknownLayer;
+					if (paths->empty())
+					{
+						continue;
+					}
+
+					// a block with anything but 6 textures uses its first
+					// one for every face.
+					const std::string& path =
+					    paths->size() == info.layers.size() ? (*paths)[face]
+					                                        : (*paths)[0];
+
+					auto layer = textureTable.find(path);
+					if (layer != textureTable.end())
+					{
+						info.layers[face] =
+						    static_cast<std::uint32_t>(layer->second);
+					}
+				}
+			}
+		}
+
+		/**
+		 * @brief Gets the render info of a block.
+		 * @param id The unique ID of the block.
+		 * @return The render info of the block, or the unknown block's if
+		 * it doesn't exist.
+		 */
+		const BlockRenderInfo& getRenderInfo(std::size_t id) const
+		{
+			return id < renderInfo.size()
+			           ? renderInfo[id]
+			           : renderInfo[voxels::BlockType::UNKNOWN_BLOCK];
+		}
+
 		void registerAPI(cms::ModManager* manager)
 		{
 			manager->registerFunction(
@@ -124,6 +223,16 @@ namespace phx::client
 					    block.category = voxels::BlockCategory::SOLID;
 			    	}
 
+				    sol::optional<int> light = luaBlock["light"];
+				    if (light)
+				    {
+					    block.lightLevel = static_cast<std::uint8_t>(
+					        std::clamp(*light, 0, 15));
+				    }
+
+				    block.mod = cms::LuaProfiler::get().getModID(
+				        manager->getCurrentModName());
+
 				    sol::optional<sol::function> onPlace = luaBlock["onPlace"];
 				    if (onPlace)
 				    {
@@ -167,6 +276,8 @@ namespace phx::client
 				    {
 					    textures.add(blockUID, *luaTextures);
 				    }
+
+				    ++revision;
 			    });
 		}
 	};
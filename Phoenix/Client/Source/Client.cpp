@@ -31,6 +31,7 @@
 #include <Client/SplashScreen.hpp>
 
 #include <Common/Logger.hpp>
+#include <Common/Profiling/Profiler.hpp>
 #include <Common/Settings.hpp>
 
 using namespace phx::client;
@@ -121,6 +122,7 @@ void Client::run()
 	Settings::get()->load("settings.txt");
     LoggerConfig config;
     config.verbosity = LogVerbosity::DEBUG;
+    config.threaded  = true;
     Logger::initialize(config);
 
 	audio::Audio::initialize();
@@ -130,6 +132,8 @@ void Client::run()
 	SplashScreen* splashScreen = new SplashScreen();
 	m_layerStack.pushLayer(splashScreen);
 
+	profiling::Profiler::setThreadName("Main");
+
 	std::size_t last = SDL_GetPerformanceCounter();
 	while (m_window.isRunning())
 	{
@@ -146,6 +150,7 @@ void Client::run()
 		m_audioPool->tick();
 
 		m_window.endFrame();
+		profiling::Profiler::endFrame();
 	}
 
 	delete m_audioPool;
@@ -154,4 +159,7 @@ void Client::run()
 	audio::Audio::teardown();
 
 	Settings::get()->save("settings.txt");
+
+	// flushes anything still queued by the threaded logger.
+	Logger::teardown();
 }
@@ -29,6 +29,9 @@
 #include <Client/DebugOverlay.hpp>
 
 #include <Client/Graphics/ImGuiExtensions.hpp>
+
+#include <Common/Profiling/Profiler.hpp>
+
 #include <imgui.h>
 
 #include <glad/glad.h>
@@ -86,6 +89,52 @@ void DebugOverlay::tick(float dt)
 			ImGui::PlotVariable("Frame Time: ", FLT_MAX);
 		}
 	}
+
+	if (ImGui::CollapsingHeader("Profiler"))
+	{
+		for (const auto& thread : profiling::Profiler::getStatistics())
+		{
+			if (!ImGui::TreeNode(thread.name.c_str()))
+			{
+				continue;
+			}
+
+			ImGui::Columns(6, "ProfilerColumns");
+			ImGui::Text("Zone");
+			ImGui::NextColumn();
+			ImGui::Text("Calls");
+			ImGui::NextColumn();
+			ImGui::Text("Total ms");
+			ImGui::NextColumn();
+			ImGui::Text("Avg ms");
+			ImGui::NextColumn();
+			ImGui::Text("Max ms");
+			ImGui::NextColumn();
+			ImGui::Text("p99 ms");
+			ImGui::NextColumn();
+			ImGui::Separator();
+
+			for (const auto& zone : thread.zones)
+			{
+				ImGui::Text("%*s%s", static_cast<int>(zone.depth * 2), "",
+				            zone.name);
+				ImGui::NextColumn();
+				ImGui::Text("%zu", zone.calls);
+				ImGui::NextColumn();
+				ImGui::Text("%.3f", zone.total);
+				ImGui::NextColumn();
+				ImGui::Text("%.3f", zone.average);
+				ImGui::NextColumn();
+				ImGui::Text("%.3f", zone.max);
+				ImGui::NextColumn();
+				ImGui::Text("%.3f", zone.p99);
+				ImGui::NextColumn();
+			}
+
+			ImGui::Columns(1);
+			ImGui::TreePop();
+		}
+	}
 	ImGui::End();
 
 	++m_time;
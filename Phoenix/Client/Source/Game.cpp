@@ -29,6 +29,8 @@
 #include <Client/Client.hpp>
 #include <Client/Game.hpp>
 
+#include <Common/CMS/EventBus.hpp>
+#include <Common/CMS/LuaProfiler.hpp>
 #include <Common/CMS/ModManager.hpp>
 #include <Common/Utility/Serializer.hpp>
 
@@ -76,6 +78,10 @@ Game::Game(gfx::Window* window, entt::registry* registry, bool networked)
 	    "core.command.register",
 	    [](std::string command, std::string help, sol::function f) {});
 
+	// the server generates the world, the client only receives it.
+	m_modManager->registerFunction("voxel.worldgen.register",
+	                               [](sol::table pass) {});
+
 	m_modManager->registerFunction("core.print", [=](const std::string& text) {
 		m_network->sendMessage(text);
 	});
@@ -98,6 +104,7 @@ Game::Game(gfx::Window* window, entt::registry* registry, bool networked)
 	Client::get()->getAudioPool()->queue(backMusic);
 
 	Settings::get()->registerAPI(m_modManager);
+	cms::EventBus::get().registerAPI(m_modManager);
 	InputMap::get()->registerAPI(m_modManager);
 	CommandBook::get()->registerAPI(m_modManager);
 
@@ -266,6 +273,9 @@ void Game::onAttach()
 		m_map = new voxels::Map(m_save, "map1", &m_blockRegistry.referrer);
 	}
 
+	// only the client needs light, for meshing.
+	m_map->enableLighting();
+
 	if (m_network)
 	{
 		m_chat = new gfx::ChatBox(m_window, &m_network->messageQueue);
@@ -461,10 +471,14 @@ void Game::tick(float dt)
 	m_renderPipeline.setVector3("u_LightDir", lightdir);
 	m_renderPipeline.setFloat("u_Brightness", 0.6f);
 
+	m_map->updateLight();
 	m_worldRenderer->tick(dt);
 	m_worldRenderer->renderSelectionBox();
 
 	m_chat->draw();
+
+	cms::EventBus::get().dispatch();
+	cms::LuaProfiler::get().endTick();
 }
 
 void Game::confirmState(const Position& position)
@@ -484,7 +498,8 @@ void Game::confirmState(const Position& position)
 	auto confirmation = m_network->stateQueue.pop();
 
 	// Discard any inputStates older than the confirmationState
-	while (!m_states.empty() && m_states.front().sequence < confirmation.second)
+	while (!m_states.empty() &&
+	       m_states.front().sequence < confirmation.sequence)
 	{
 		m_states.pop_front();
 	}
@@ -494,7 +509,7 @@ void Game::confirmState(const Position& position)
 	// it.
 	auto      entity = m_registry->create();
 	Position& pos    = m_registry->emplace<Position>(
-        entity, confirmation.first.rotation, confirmation.first.position);
+        entity, confirmation.position.rotation, confirmation.position.position);
 	m_registry->emplace<Movement>(
 	    entity, m_registry->get<Movement>(m_player).moveSpeed);
 	for (const auto& inputState : m_states)
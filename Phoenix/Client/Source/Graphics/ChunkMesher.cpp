@@ -29,8 +29,15 @@
 #include <Client/Graphics/ChunkMesher.hpp>
 
 #include <Common/Math/Math.hpp>
+#include <Common/Profiling/Profiler.hpp>
+#include <Common/Profiling/Tracer.hpp>
 #include <Common/Voxels/Block.hpp>
 #include <Common/Voxels/Chunk.hpp>
+#include <Common/Voxels/Map.hpp>
+
+#include <array>
+#include <bitset>
+#include <cstdint>
 
 static const phx::math::vec3 CUBE_VERTS[] = {
     // front
@@ -132,143 +139,435 @@ static const phx::math::vec2 CUBE_UV[] = {
     phx::math::vec2(0.f, 1.f),
 };
 
+static const phx::math::vec3 FACE_NORMALS[] = {
+    phx::math::vec3(0.f, 0.f, -1.f), // front
+    phx::math::vec3(-1.f, 0.f, 0.f), // left
+    phx::math::vec3(0.f, 0.f, 1.f),  // back
+    phx::math::vec3(1.f, 0.f, 0.f),  // right
+    phx::math::vec3(0.f, 1.f, 0.f),  // top
+    phx::math::vec3(0.f, -1.f, 0.f), // bottom
+};
+
 const int ACTUAL_CUBE_SIZE  = 2;
 const int NUM_FACES_IN_CUBE = 6;
 const int NUM_VERTS_IN_FACE = 6;
 
+// x, y, z, u, v, texture layer, normal x, y, z, color and light.
+const int NUM_FLOATS_IN_VERT = 11;
+
+// a face is a quad of these four of its vertices, split into two triangles
+// along one diagonal or the other.
+const int NUM_CORNERS_IN_FACE               = 4;
+const int QUAD_CORNERS[NUM_CORNERS_IN_FACE] = {0, 1, 2, 4};
+const int QUAD[NUM_VERTS_IN_FACE]           = {0, 1, 2, 2, 3, 0};
+const int FLIPPED_QUAD[NUM_VERTS_IN_FACE]   = {1, 2, 3, 3, 0, 1};
+
+// faces of chunks that aren't lit are fully lit, and faces on the edge of
+// the loaded map are taken to be out under the sky.
+const std::uint8_t FULL_LIGHT = 0xFF;
+const std::uint8_t SKY_LIGHT  = 0xF0;
+
 using namespace phx;
 using namespace gfx;
 
-std::vector<float> ChunkMesher::mesh(
-    voxels::Chunk*                                chunk,
-    const ChunkRenderer::AssociativeTextureTable& texTable,
-    client::BlockRegistry*                        blockRegistry)
+namespace
 {
-	std::vector<float> mesh;
-
-	auto&      blocks   = chunk->getBlocks();
-	math::vec3 chunkPos = chunk->getChunkPos();
-
-	// funky lambda here, fix in the future, but this is actually a bit tidier
-	// than otherwise.
-	auto addBlockFace = [&mesh, &chunkPos, &blockRegistry,
-	                     &texTable](voxels::BlockType* block, BlockFace face,
-	                                math::vec3 pos) {
-		// we don't need to worry about nullptr being returned here since we
-		// have
-		// setup the unknown return val in the BlockRegistry constructor.
-		const auto* textures =
-		    blockRegistry->textures.get(block->uniqueIdentifier);
-
-		std::size_t texLayer = 0;
-		if (textures->size() != 6)
-		{
-			// we can ALWAYS guarantee 1 texture since core:unknown will have
-			// unknown.png registered. (the textures for core:unknown will be
-			// returned from the texture registry if a block's tex are not
-			// found.)
-			texLayer = texTable.at((*textures)[0]);
-		}
-		else
+	using voxels::Chunk;
+
+	// the chunk is copied with a border of a block from the chunks around
+	// it, so blocks on the edge can look at their neighbours like any other.
+	constexpr int PADDED       = Chunk::CHUNK_WIDTH + 2;
+	constexpr int PADDED_LAYER = PADDED * PADDED;
+	constexpr int PADDED_SIZE  = PADDED * PADDED * PADDED;
+
+	static_assert(Chunk::CHUNK_WIDTH == Chunk::CHUNK_HEIGHT &&
+	                  Chunk::CHUNK_WIDTH == Chunk::CHUNK_DEPTH,
+	              "The padded copy of a chunk is a cube.");
+
+	constexpr int toPadded(int x, int y, int z)
+	{
+		return (x + 1) + PADDED * ((y + 1) + PADDED * (z + 1));
+	}
+
+	constexpr int toOffset(int x, int y, int z)
+	{
+		return x + PADDED * (y + PADDED * z);
+	}
+
+	// the offset of the block in front of each face, in BlockFace order.
+	const int FACE_STEP[] = {
+	    toOffset(0, 0, -1), toOffset(-1, 0, 0), toOffset(0, 0, 1),
+	    toOffset(1, 0, 0),  toOffset(0, 1, 0),  toOffset(0, -1, 0)};
+
+	// the order faces are emitted in for each block.
+	const BlockFace FACE_ORDER[] = {BlockFace::LEFT,   BlockFace::RIGHT,
+	                                BlockFace::BOTTOM, BlockFace::TOP,
+	                                BlockFace::FRONT,  BlockFace::BACK};
+
+	constexpr std::uint8_t faceBit(BlockFace face)
+	{
+		return static_cast<std::uint8_t>(1u << static_cast<unsigned>(face));
+	}
+
+	using Occlusion = std::array<std::uint8_t, NUM_CORNERS_IN_FACE>;
+
+	/**
+	 * @brief For each corner of each face, the offsets of the three blocks
+	 * that can shade it: the two beside the corner and the one diagonal
+	 * to it, all in front of the face.
+	 */
+	using OccluderTable =
+	    std::array<std::array<std::array<int, 3>, NUM_CORNERS_IN_FACE>,
+	               NUM_FACES_IN_CUBE>;
+
+	const OccluderTable& getOccluders()
+	{
+		static const OccluderTable table = [] {
+			OccluderTable occluders {};
+			for (int face = 0; face < NUM_FACES_IN_CUBE; ++face)
+			{
+				const math::vec3 normal = FACE_NORMALS[face];
+				const int        nx     = static_cast<int>(normal.x);
+				const int        ny     = static_cast<int>(normal.y);
+
+				for (int corner = 0; corner < NUM_CORNERS_IN_FACE; ++corner)
+				{
+					// the corners of the cube are a block out on every
+					// axis, which is the diagonal block in front of it.
+					const math::vec3 vert =
+					    CUBE_VERTS[face * NUM_VERTS_IN_FACE +
+					               QUAD_CORNERS[corner]];
+					const int x = static_cast<int>(vert.x);
+					const int y = static_cast<int>(vert.y);
+					const int z = static_cast<int>(vert.z);
+
+					// the sides keep one of the two axes along the face.
+					auto& blocks = occluders[face][corner];
+					if (nx != 0)
+					{
+						blocks = {toOffset(x, y, 0), toOffset(x, 0, z),
+						          toOffset(x, y, z)};
+					}
+					else if (ny != 0)
+					{
+						blocks = {toOffset(x, y, 0), toOffset(0, y, z),
+						          toOffset(x, y, z)};
+					}
+					else
+					{
+						blocks = {toOffset(x, 0, z), toOffset(0, y, z),
+						          toOffset(x, y, z)};
+					}
+				}
+			}
+
+			return occluders;
+		}();
+
+		return table;
+	}
+
+	// 3 is unshaded, 0 is a corner tucked in between two blocks.
+	std::uint8_t getOcclusion(std::uint8_t side1, std::uint8_t side2,
+	                          std::uint8_t corner)
+	{
+		if (side1 != 0 && side2 != 0)
 		{
-			texLayer = texTable.at((*textures)[static_cast<std::size_t>(face)]);
+			return 0;
 		}
 
-		math::vec3 normals;
-		switch (face)
+		return static_cast<std::uint8_t>(3 - (side1 + side2 + corner));
+	}
+
+	float* addBlockFace(float* out, BlockFace face, float x, float y, float z,
+	                    float texLayer, float color, std::uint8_t light,
+	                    const Occlusion& occlusion)
+	{
+		const int        first  = static_cast<int>(face) * NUM_VERTS_IN_FACE;
+		const math::vec3 normal = FACE_NORMALS[static_cast<int>(face)];
+
+		// the quad is split along the diagonal through its darker corners,
+		// or the shading would run one way across the face and not the
+		// other depending on how it's turned.
+		const int* order =
+		    occlusion[0] + occlusion[2] > occlusion[1] + occlusion[3]
+		        ? FLIPPED_QUAD
+		        : QUAD;
+
+		for (int vert = 0; vert < NUM_VERTS_IN_FACE; ++vert)
 		{
-		case BlockFace::FRONT:
-			normals = math::vec3(0, 0, -1);
-			break;
+			const int corner = order[vert];
+			const int i      = first + QUAD_CORNERS[corner];
+
+			*out++ = CUBE_VERTS[i].x + x;
+			*out++ = CUBE_VERTS[i].y + y;
+			*out++ = CUBE_VERTS[i].z + z;
 
-		case BlockFace::LEFT:
-			normals = math::vec3(-1, 0, 0);
-			break;
+			*out++ = CUBE_UV[i].x;
+			*out++ = CUBE_UV[i].y;
 
-		case BlockFace::BACK:
-			normals = math::vec3(0, 0, 1);
-			break;
+			*out++ = texLayer;
 
-		case BlockFace::RIGHT:
-			normals = math::vec3(1, 0, 0);
-			break;
+			*out++ = normal.x;
+			*out++ = normal.y;
+			*out++ = normal.z;
 
-		case BlockFace::TOP:
-			normals = math::vec3(0, 1, 0);
-			break;
+			*out++ = color;
+
+			// the occlusion of the corner sits above the light.
+			*out++ = static_cast<float>(light | (occlusion[corner] << 8));
+		}
+
+		return out;
+	}
 
-		case BlockFace::BOTTOM:
-			normals = math::vec3(0, -1, 0);
-			break;
+	/**
+	 * @brief Copies the border of a chunk's padded copy from the chunks
+	 * around it. Blocks of missing chunks are left empty and unlit.
+	 */
+	void copyBorder(const ChunkMesher::Neighbourhood& neighbours,
+	                client::BlockRegistry* blockRegistry, bool lit,
+	                std::array<std::uint8_t, PADDED_SIZE>& occluders,
+	                std::array<std::uint8_t, PADDED_SIZE>& light)
+	{
+		// only the layer of a neighbour touching the chunk is copied.
+		const auto range = [](int side, int size) {
+			return side < 0 ? std::make_pair(size - 1, size - 1)
+			                : side > 0 ? std::make_pair(0, 0)
+			                           : std::make_pair(0, size - 1);
+		};
+
+		for (int dz = -1, n = 0; dz <= 1; ++dz)
+		{
+			for (int dy = -1; dy <= 1; ++dy)
+			{
+				for (int dx = -1; dx <= 1; ++dx, ++n)
+				{
+					const Chunk* neighbour = neighbours[n];
+					const bool self = dx == 0 && dy == 0 && dz == 0;
+					if (neighbour == nullptr || self)
+					{
+						continue;
+					}
+
+					const auto& blocks = neighbour->getBlocks();
+					const auto& source = neighbour->getLight();
+
+					const auto rangeX = range(dx, Chunk::CHUNK_WIDTH);
+					const auto rangeY = range(dy, Chunk::CHUNK_HEIGHT);
+					const auto rangeZ = range(dz, Chunk::CHUNK_DEPTH);
+					for (int z = rangeZ.first; z <= rangeZ.second; ++z)
+					{
+						for (int y = rangeY.first; y <= rangeY.second; ++y)
+						{
+							for (int x = rangeX.first; x <= rangeX.second; ++x)
+							{
+								const std::size_t i =
+								    Chunk::getVectorIndex(x, y, z);
+								const int p =
+								    toPadded(x + dx * Chunk::CHUNK_WIDTH,
+								             y + dy * Chunk::CHUNK_HEIGHT,
+								             z + dz * Chunk::CHUNK_DEPTH);
+
+								occluders[p] =
+								    blockRegistry
+								        ->getRenderInfo(
+								            blocks[i]->uniqueIdentifier)
+								        .opaque;
+
+								if (lit && !source.empty())
+								{
+									light[p] = source[i];
+								}
+							}
+						}
+					}
+				}
+			}
 		}
+	}
+} // namespace
+
+ChunkMesher::Neighbourhood ChunkMesher::getNeighbourhood(
+    voxels::Map* map, const voxels::Chunk* chunk)
+{
+	Neighbourhood    neighbours {};
+	const math::vec3 chunkPos = chunk->getChunkPos();
 
-		for (int i = 0; i < NUM_VERTS_IN_FACE; ++i)
+	for (int dz = -1, n = 0; dz <= 1; ++dz)
+	{
+		for (int dy = -1; dy <= 1; ++dy)
 		{
-			math::vec3 blockVertices =
-			    CUBE_VERTS[(static_cast<int>(face) * NUM_FACES_IN_CUBE) + i];
-			blockVertices.x +=
-			    (pos.x * ACTUAL_CUBE_SIZE) + (chunkPos.x * ACTUAL_CUBE_SIZE);
-			blockVertices.y +=
-			    (pos.y * ACTUAL_CUBE_SIZE) + (chunkPos.y * ACTUAL_CUBE_SIZE);
-			blockVertices.z +=
-			    (pos.z * ACTUAL_CUBE_SIZE) + (chunkPos.z * ACTUAL_CUBE_SIZE);
+			for (int dx = -1; dx <= 1; ++dx, ++n)
+			{
+				neighbours[n] = map->findChunk(
+				    {chunkPos.x + static_cast<float>(dx * Chunk::CHUNK_WIDTH),
+				     chunkPos.y + static_cast<float>(dy * Chunk::CHUNK_HEIGHT),
+				     chunkPos.z + static_cast<float>(dz * Chunk::CHUNK_DEPTH)});
+			}
+		}
+	}
+
+	return neighbours;
+}
 
-			math::vec2 cubeUVs =
-			    CUBE_UV[(static_cast<int>(face) * NUM_FACES_IN_CUBE) + i];
+std::vector<float> ChunkMesher::mesh(voxels::Chunk*         chunk,
+                                     client::BlockRegistry* blockRegistry,
+                                     const Neighbourhood*   neighbours)
+{
+	PHX_TRACE_SCOPE(MESH, "ChunkMesher::mesh");
+	PHX_PROFILE_SCOPE("ChunkMesher::mesh");
 
-			mesh.push_back(blockVertices.x);
-			mesh.push_back(blockVertices.y);
-			mesh.push_back(blockVertices.z);
+	using namespace voxels;
 
-			mesh.push_back(cubeUVs.x);
-			mesh.push_back(cubeUVs.y);
+	constexpr int ROW   = Chunk::CHUNK_WIDTH;
+	constexpr int LAYER = Chunk::CHUNK_WIDTH * Chunk::CHUNK_HEIGHT;
 
-			mesh.push_back(static_cast<float>(texLayer));
+	auto&            blocks   = chunk->getBlocks();
+	const math::vec3 chunkPos = chunk->getChunkPos();
 
-			mesh.push_back(normals.x);
-			mesh.push_back(normals.y);
-			mesh.push_back(normals.z);
+	// resolve every block's render info once up front, so the neighbour
+	// checks below read flat tables rather than chasing block pointers.
+	std::array<const client::BlockRenderInfo*, Chunk::CHUNK_MAX_BLOCKS> info;
+	std::array<bool, Chunk::CHUNK_MAX_BLOCKS> opaque;
+	for (int i = 0; i < Chunk::CHUNK_MAX_BLOCKS; ++i)
+	{
+		info[i]   = &blockRegistry->getRenderInfo(blocks[i]->uniqueIdentifier);
+		opaque[i] = info[i]->opaque;
+	}
 
-			mesh.push_back(block->color);
+	// find which faces of each block are visible first, one bit per
+	// BlockFace, so the mesh can be allocated once and written straight
+	// into.
+	std::array<std::uint8_t, Chunk::CHUNK_MAX_BLOCKS> visible;
+	std::size_t                                       faceCount = 0;
+	for (int z = 0, i = 0; z < Chunk::CHUNK_DEPTH; ++z)
+	{
+		for (int y = 0; y < Chunk::CHUNK_HEIGHT; ++y)
+		{
+			for (int x = 0; x < Chunk::CHUNK_WIDTH; ++x, ++i)
+			{
+				visible[i] = 0;
+				if (!info[i]->solid)
+					continue;
+
+				std::uint8_t faces = 0;
+				if (x == 0 || !opaque[i - 1])
+					faces |= faceBit(BlockFace::LEFT);
+				if (x == Chunk::CHUNK_WIDTH - 1 || !opaque[i + 1])
+					faces |= faceBit(BlockFace::RIGHT);
+
+				if (y == 0 || !opaque[i - ROW])
+					faces |= faceBit(BlockFace::BOTTOM);
+				if (y == Chunk::CHUNK_HEIGHT - 1 || !opaque[i + ROW])
+					faces |= faceBit(BlockFace::TOP);
+
+				if (z == 0 || !opaque[i - LAYER])
+					faces |= faceBit(BlockFace::FRONT);
+				if (z == Chunk::CHUNK_DEPTH - 1 || !opaque[i + LAYER])
+					faces |= faceBit(BlockFace::BACK);
+
+				visible[i] = faces;
+				faceCount += std::bitset<NUM_FACES_IN_CUBE>(faces).count();
+			}
 		}
-	};
+	}
 
-	using namespace voxels;
-	for (std::size_t i = 0;
-	     i < Chunk::CHUNK_WIDTH * Chunk::CHUNK_HEIGHT * Chunk::CHUNK_DEPTH; ++i)
+	if (faceCount == 0)
 	{
-		BlockType* block = blocks[i];
-
-		if (block->category != BlockCategory::SOLID)
-			continue;
-
-		const std::size_t x = i % Chunk::CHUNK_WIDTH;
-		const std::size_t y = (i / Chunk::CHUNK_WIDTH) % Chunk::CHUNK_HEIGHT;
-		const std::size_t z = i / (Chunk::CHUNK_WIDTH * Chunk::CHUNK_HEIGHT);
-
-		if (x == 0 || blocks[Chunk::getVectorIndex(x - 1, y, z)]->category !=
-		                  BlockCategory::SOLID)
-			addBlockFace(block, BlockFace::LEFT, {x, y, z});
-		if (x == Chunk::CHUNK_WIDTH - 1 ||
-		    blocks[Chunk::getVectorIndex(x + 1, y, z)]->category !=
-		        BlockCategory::SOLID)
-			addBlockFace(block, BlockFace::RIGHT, {x, y, z});
-
-		if (y == 0 || blocks[Chunk::getVectorIndex(x, y - 1, z)]->category !=
-		                  BlockCategory::SOLID)
-			addBlockFace(block, BlockFace::BOTTOM, {x, y, z});
-		if (y == Chunk::CHUNK_WIDTH - 1 ||
-		    blocks[Chunk::getVectorIndex(x, y + 1, z)]->category !=
-		        BlockCategory::SOLID)
-			addBlockFace(block, BlockFace::TOP, {x, y, z});
-
-		if (z == 0 || blocks[Chunk::getVectorIndex(x, y, z - 1)]->category !=
-		                  BlockCategory::SOLID)
-			addBlockFace(block, BlockFace::FRONT, {x, y, z});
-		if (z == Chunk::CHUNK_DEPTH - 1 ||
-		    blocks[Chunk::getVectorIndex(x, y, z + 1)]->category !=
-		        BlockCategory::SOLID)
-			addBlockFace(block, BlockFace::BACK, {x, y, z});
+		return {};
+	}
+
+	// the padded copy of which blocks shade corners, and of the light, so
+	// every block reads its neighbours without checking for edges.
+	const Chunk::LightList& chunkLight = chunk->getLight();
+	const bool              lit        = !chunkLight.empty();
+
+	std::array<std::uint8_t, PADDED_SIZE> occluders;
+	std::array<std::uint8_t, PADDED_SIZE> light;
+	occluders.fill(0);
+	light.fill(lit ? SKY_LIGHT : FULL_LIGHT);
+
+	for (int z = 0; z < Chunk::CHUNK_DEPTH; ++z)
+	{
+		for (int y = 0; y < Chunk::CHUNK_HEIGHT; ++y)
+		{
+			const int p = toPadded(0, y, z);
+			const int i = static_cast<int>(Chunk::getVectorIndex(0, y, z));
+			for (int x = 0; x < Chunk::CHUNK_WIDTH; ++x)
+			{
+				occluders[p + x] = opaque[i + x];
+			}
+
+			if (lit)
+			{
+				std::copy_n(chunkLight.begin() + i, Chunk::CHUNK_WIDTH,
+				            light.begin() + p);
+			}
+		}
+	}
+
+	if (neighbours != nullptr)
+	{
+		copyBorder(*neighbours, blockRegistry, lit, occluders, light);
+	}
+
+	const OccluderTable& occluderTable = getOccluders();
+
+	std::vector<float> mesh(faceCount * NUM_VERTS_IN_FACE *
+	                        NUM_FLOATS_IN_VERT);
+	float*             out = mesh.data();
+
+	const int originX = static_cast<int>(chunkPos.x) * ACTUAL_CUBE_SIZE;
+	const int originY = static_cast<int>(chunkPos.y) * ACTUAL_CUBE_SIZE;
+	const int originZ = static_cast<int>(chunkPos.z) * ACTUAL_CUBE_SIZE;
+
+	for (int z = 0, i = 0; z < Chunk::CHUNK_DEPTH; ++z)
+	{
+		for (int y = 0; y < Chunk::CHUNK_HEIGHT; ++y)
+		{
+			for (int x = 0; x < Chunk::CHUNK_WIDTH; ++x, ++i)
+			{
+				const std::uint8_t faces = visible[i];
+				if (faces == 0)
+					continue;
+
+				const client::BlockRenderInfo* block = info[i];
+
+				const float posX =
+				    static_cast<float>(originX + x * ACTUAL_CUBE_SIZE);
+				const float posY =
+				    static_cast<float>(originY + y * ACTUAL_CUBE_SIZE);
+				const float posZ =
+				    static_cast<float>(originZ + z * ACTUAL_CUBE_SIZE);
+				const float color = static_cast<float>(block->color);
+
+				const int p = toPadded(x, y, z);
+
+				for (const BlockFace face : FACE_ORDER)
+				{
+					if ((faces & faceBit(face)) == 0)
+						continue;
+
+					const auto f = static_cast<std::size_t>(face);
+
+					Occlusion occlusion;
+					for (int corner = 0; corner < NUM_CORNERS_IN_FACE; ++corner)
+					{
+						const auto& offsets = occluderTable[f][corner];
+						occlusion[corner] =
+						    getOcclusion(occluders[p + offsets[0]],
+						                 occluders[p + offsets[1]],
+						                 occluders[p + offsets[2]]);
+					}
+
+					out = addBlockFace(out, face, posX, posY, posZ,
+					                   static_cast<float>(block->layers[f]),
+					                   color, light[p + FACE_STEP[f]],
+					                   occlusion);
+				}
+			}
+		}
 	}
 
 	return mesh;
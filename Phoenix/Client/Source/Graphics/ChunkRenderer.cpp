@@ -32,6 +32,7 @@
 
 #include <Common/Actor.hpp>
 #include <Common/PlayerView.hpp>
+#include <Common/Profiling/Profiler.hpp>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <glad/glad.h>
@@ -55,6 +56,7 @@ struct Vertex
 	float    normY;
 	float    normZ;
 	unsigned color;
+	float    light;
 	// float pos_x;
 	// float pos_y;
 	// float pos_z;
@@ -143,6 +145,19 @@ void ChunkRenderer::prep()
 	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+	// now every texture has a layer, the mesher can be given them directly.
+	m_blockRegistry->buildRenderInfo(m_textureTable);
+	m_renderInfoRevision = m_blockRegistry->revision;
+}
+
+void ChunkRenderer::refreshRenderInfo()
+{
+	if (m_renderInfoRevision != m_blockRegistry->revision)
+	{
+		m_blockRegistry->buildRenderInfo(m_textureTable);
+		m_renderInfoRevision = m_blockRegistry->revision;
+	}
 }
 
 void ChunkRenderer::attachCamera(FPSCamera* camera) { m_camera = camera; }
@@ -166,7 +181,8 @@ void ChunkRenderer::add(voxels::Chunk* chunk)
 		return;
 	}
 
-	auto mesh = ChunkMesher::mesh(chunk, m_textureTable, m_blockRegistry);
+	const auto neighbours = ChunkMesher::getNeighbourhood(m_map, chunk);
+	auto mesh = ChunkMesher::mesh(chunk, m_blockRegistry, &neighbours);
 	if (mesh.empty())
 	{
 		// the mesh is empty, don't bother with adding it or anything.
@@ -201,10 +217,15 @@ void ChunkRenderer::add(voxels::Chunk* chunk)
 	                      GL_FALSE, sizeof(Vertex),
 	                      reinterpret_cast<void*>(offsetof(Vertex, color)));
 
+	glVertexAttribPointer(m_lightAttributeLocation, 1, GL_FLOAT, GL_FALSE,
+	                      sizeof(Vertex),
+	                      reinterpret_cast<void*>(offsetof(Vertex, light)));
+
 	glEnableVertexAttribArray(m_vertexAttributeLocation);
 	glEnableVertexAttribArray(m_uvAttributeLocation);
 	glEnableVertexAttribArray(m_normalAttributeLocation);
 	glEnableVertexAttribArray(m_colorAttributeLocation);
+	glEnableVertexAttribArray(m_lightAttributeLocation);
 
 	m_buffers.insert({chunk->getChunkPos(), {vao, buf, mesh.size()}});
 }
@@ -219,7 +240,8 @@ void ChunkRenderer::update(voxels::Chunk* chunk)
 		return;
 	}
 
-	auto mesh = ChunkMesher::mesh(chunk, m_textureTable, m_blockRegistry);
+	const auto neighbours = ChunkMesher::getNeighbourhood(m_map, chunk);
+	auto mesh = ChunkMesher::mesh(chunk, m_blockRegistry, &neighbours);
 
 	// we can't just say return if the mesh is empty, since we might be emptying
 	// a mesh (breaking the final block in a chunk so only air is left or
@@ -262,10 +284,15 @@ void ChunkRenderer::update(voxels::Chunk* chunk)
 		                      GL_FALSE, sizeof(Vertex),
 		                      reinterpret_cast<void*>(offsetof(Vertex, color)));
 
+		glVertexAttribPointer(m_lightAttributeLocation, 1, GL_FLOAT, GL_FALSE,
+		                      sizeof(Vertex),
+		                      reinterpret_cast<void*>(offsetof(Vertex, light)));
+
 		glEnableVertexAttribArray(m_vertexAttributeLocation);
 		glEnableVertexAttribArray(m_uvAttributeLocation);
 		glEnableVertexAttribArray(m_normalAttributeLocation);
 		glEnableVertexAttribArray(m_colorAttributeLocation);
+		glEnableVertexAttribArray(m_lightAttributeLocation);
 
 		data.vertexCount = mesh.size();
 	}
@@ -329,20 +356,41 @@ void ChunkRenderer::onMapEvent(const voxels::MapEvent& mapEvent)
 
 void ChunkRenderer::tick(float dt)
 {
+	PHX_PROFILE_SCOPE("ChunkRenderer::tick");
+
+	refreshRenderInfo();
+
+	// an edit sends an event to each chunk around it too, so a chunk can
+	// be told more than once in a tick and should still be meshed once.
+	std::vector<voxels::Chunk*>        updated;
+	std::unordered_set<voxels::Chunk*> seen;
+
+	// chunks coming into view are meshed along with the rest once they
+	// have all arrived, so those next to each other see each other, and
+	// the events they send their neighbours don't mesh them twice.
 	for (auto& chunk : PlayerView::update(m_registry, m_entity))
 	{
-		add(chunk);
+		if (seen.insert(chunk).second)
+		{
+			updated.push_back(chunk);
+		}
 	}
 
 	voxels::MapEvent e;
 	while (m_mapEvents.try_pop(e))
 	{
-		if (e.type == voxels::MapEvent::CHUNK_UPDATE)
+		if (e.type == voxels::MapEvent::CHUNK_UPDATE &&
+		    seen.insert(e.chunk).second)
 		{
-			update(e.chunk);
+			updated.push_back(e.chunk);
 		}
 	}
 
+	for (voxels::Chunk* chunk : updated)
+	{
+		update(chunk);
+	}
+
 	glActiveTexture(GL_TEXTURE0);
 	glBindTexture(GL_TEXTURE_2D_ARRAY, m_textureArray);
 
@@ -29,17 +29,39 @@
 #include <Client/Network.hpp>
 
 #include <Common/Logger.hpp>
+#include <Common/Profiling/Profiler.hpp>
 #include <Common/Voxels/Chunk.hpp>
 
 using namespace phx::client;
 
-Network::Network(const phx::net::Address& address)
+Network::Network(const phx::net::Address& address) : Network(address, nullptr)
 {
-	m_client = new phx::net::Host();
+}
+
+Network::Network(const phx::net::Address&             address,
+                 std::unique_ptr<phx::net::Transport> transport)
+{
+	if (transport)
+	{
+		m_client = new phx::net::Host(std::move(transport));
+	}
+	else
+	{
+		m_client = new phx::net::Host();
+	}
+
+	m_client->enableBatching();
 
+	// messages are batched, so we dispatch on the message type rather than
+	// the channel they arrived on.
 	m_client->onReceive([this](phx::net::Peer& peer, phx::net::Packet&& packet,
-	                           enet_uint32 channelID) {
-		switch (channelID)
+	                           enet_uint32 type) {
+		// the peer is only safe to touch from the thread polling it.
+		m_roundTrip.store(peer.getRoundTripTime().count(),
+		                  std::memory_order_relaxed);
+		publishTotals();
+
+		switch (type)
 		{
 		case 0:
 			parseEvent(packet);
@@ -55,7 +77,7 @@ Network::Network(const phx::net::Address& address)
 			break;
 		default:
 			LOG_WARNING("NETWORK")
-			    << "Received Unexpected Packet on Channel " << channelID;
+			    << "Received Unexpected Message of Type " << type;
 		}
 	});
 
@@ -76,9 +98,14 @@ Network::~Network()
 
 void Network::run()
 {
+	profiling::Profiler::setThreadName("Network");
+
 	while (m_running)
 	{
 		m_client->poll(50_ms, 100);
+		publishTotals();
+
+		profiling::Profiler::endFrame();
 	}
 }
 
@@ -93,6 +120,20 @@ void Network::stop()
 {
 	m_running = false;
 	m_thread.join();
+
+	// anything sent during the last poll is counted too.
+	publishTotals();
+}
+
+void Network::publishTotals()
+{
+	// the host's totals are written while polling, so they're copied for
+	// other threads to read. a poll can handle many packets, so this is
+	// done for each packet received as well as after every poll.
+	m_sentData.store(m_client->getTotalSentData(),
+	                 std::memory_order_relaxed);
+	m_receivedData.store(m_client->getTotalReceievedData(),
+	                     std::memory_order_relaxed);
 }
 
 void Network::parseEvent(phx::net::Packet& packet)
@@ -102,13 +143,12 @@ void Network::parseEvent(phx::net::Packet& packet)
 
 void Network::parseState(phx::net::Packet& packet)
 {
-	auto data = packet.getData();
-
 	phx::Serializer ser;
-	ser.setBuffer(data.data(), packet.getSize());
+	ser.borrowBuffer(packet.getRawData(), packet.getSize());
 
-	std::size_t sequence;
-	ser >> sequence;
+	std::size_t   sequence;
+	std::uint32_t tickTime;
+	ser >> sequence >> varint(tickTime);
 	if (sequence < m_currentSequence && sequence > 10)
 	{
 		return;
@@ -118,17 +158,15 @@ void Network::parseState(phx::net::Packet& packet)
 	Position input;
 	ser >> input.position.x >> input.position.y >> input.position.z;
 
-	stateQueue.push(std::pair(input, sequence));
+	stateQueue.push({input, sequence, tickTime});
 }
 
 void Network::parseMessage(phx::net::Packet& packet)
 {
 	std::string input;
 
-	auto data = packet.getData();
-
 	phx::Serializer ser;
-	ser.setBuffer(reinterpret_cast<std::byte*>(data.data()), data.size());
+	ser.borrowBuffer(packet.getRawData(), packet.getSize());
 	ser >> input;
 
 	messageQueue.push(input);
@@ -136,35 +174,43 @@ void Network::parseMessage(phx::net::Packet& packet)
 
 void Network::parseData(phx::net::Packet& packet)
 {
-	auto data = packet.getData();
-
 	math::vec3 pos;
 	
 	phx::Serializer ser;
-	ser.setBuffer(reinterpret_cast<std::byte*>(data.data()), sizeof(float) * 3);
+	ser.borrowBuffer(packet.getRawData(), packet.getSize());
 	ser >> pos.x >> pos.y >> pos.z;
 
-	chunkQueue.push({pos, data});
+	// the chunk outlives the packet, so this is the one copy we have to make.
+	chunkQueue.push({pos, packet.getData()});
 }
 
 void Network::sendState(const phx::InputState& inputState)
 {
-	Serializer ser;
-	ser << inputState;
+	// every packet carries the last few states, so losing one doesn't lose
+	// any input.
+	m_inputHistory.push(inputState);
 
-	phx::net::Packet packet =
-	    phx::net::Packet(ser.getBuffer(), phx::net::PacketFlags::UNRELIABLE);
+	Serializer ser;
+	ser << m_inputHistory;
 
-	m_client->broadcast(packet, 1);
+	m_client->queueBroadcast(1, ser.getBuffer(),
+	                         phx::net::PacketFlags::UNRELIABLE, 1);
 }
 
 void Network::sendMessage(const std::string& message)
 {
 	Serializer ser;
 	ser << message;
-	phx::net::Packet packet =
-	    phx::net::Packet(ser.getBuffer(), phx::net::PacketFlags::RELIABLE);
-	m_client->broadcast(packet, 2);
+	m_client->queueBroadcast(2, ser.getBuffer(),
+	                         phx::net::PacketFlags::RELIABLE, 2);
 
 	messageQueue.push(message);
 }
+
+void Network::sendEvent(const std::string& event)
+{
+	Serializer ser;
+	ser << event;
+	m_client->queueBroadcast(0, ser.getBuffer(),
+	                         phx::net::PacketFlags::RELIABLE, 0);
+}
@@ -0,0 +1,172 @@
+// Copyright 2019-20 Genten Studios
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+// may be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <Common/CMS/LuaProfiler.hpp>
+#include <Common/CMS/ModManager.hpp>
+#include <Common/Math/Math.hpp>
+#include <Common/Voxels/Block.hpp>
+
+#include <sol/sol.hpp>
+
+#include <array>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace phx::cms
+{
+	/**
+	 * @brief The kinds of event mods can subscribe to.
+	 */
+	enum class EventType
+	{
+		BLOCK_CHANGED,
+		PLAYER_JOINED,
+		PLAYER_LEFT,
+		CHAT,
+
+		COUNT
+	};
+
+	/// @brief A player changed a block.
+	struct BlockChangedEvent
+	{
+		math::vec3               position;
+		const voxels::BlockType* previous;
+		const voxels::BlockType* block;
+	};
+
+	/// @brief A player joined or left the game.
+	struct PlayerEvent
+	{
+		std::size_t player;
+	};
+
+	/// @brief A player sent a chat message that isn't a command.
+	struct ChatEvent
+	{
+		std::size_t player;
+		std::string message;
+	};
+
+	/**
+	 * @brief Collects engine events during a tick and hands them to Lua in
+	 * one go at the end of it.
+	 *
+	 * Calling into Lua for every event means crossing into the VM and
+	 * building a table of arguments each time, in the middle of whatever
+	 * the engine was changing. Events are instead appended to a queue per
+	 * type as they happen, and dispatch() gives each subscribed handler an
+	 * array of everything of its type once per tick. Handlers run through
+	 * the LuaProfiler, so they count against their mod's budget.
+	 *
+	 * The onBreak and onPlace callbacks of blocks are run from here too, in
+	 * order, before the handlers of the tick's block changes.
+	 *
+	 * @paragraph Usage
+	 * @code
+	 * EventBus::get().push(BlockChangedEvent {pos, previous, block});
+	 *
+	 * // once per tick, after the world has been updated.
+	 * EventBus::get().dispatch();
+	 * @endcode
+	 */
+	class EventBus
+	{
+	public:
+		static EventBus& get();
+
+		/**
+		 * @brief Registers core.event.subscribe with a mod manager.
+		 * @param manager The manager to register the function with.
+		 */
+		void registerAPI(ModManager* manager);
+
+		/**
+		 * @brief Subscribes a handler to a type of event.
+		 * @param type The type of event to handle.
+		 * @param mod The mod the handler belongs to.
+		 * @param handler The function to call with each tick's events.
+		 */
+		void subscribe(EventType type, LuaProfiler::ModID mod,
+		               const sol::function& handler);
+
+		void push(const BlockChangedEvent& event);
+		void push(EventType type, const PlayerEvent& event);
+		void push(ChatEvent event);
+
+		/**
+		 * @brief Delivers every event queued since the last dispatch.
+		 *
+		 * Events queued by handlers while this runs are delivered on the
+		 * next dispatch.
+		 */
+		void dispatch();
+
+		/**
+		 * @brief Drops every handler and queued event, this must be called
+		 * before the Lua state the handlers belong to is destroyed.
+		 */
+		void clear();
+
+		/**
+		 * @brief Gets the type of event with a name, as used from Lua.
+		 * @param name The name of the event, such as "block_changed".
+		 * @param type Set to the type if the name is known.
+		 * @return Whether the name is known.
+		 */
+		static bool getEventType(const std::string& name, EventType& type);
+
+	private:
+		EventBus() = default;
+
+		struct Handler
+		{
+			LuaProfiler::ModID mod;
+			sol::function      function;
+		};
+
+		template <typename Event>
+		void deliver(EventType type, const std::vector<Event>& events);
+
+	private:
+		std::mutex m_mutex;
+
+		std::array<std::vector<Handler>,
+		           static_cast<std::size_t>(EventType::COUNT)>
+		    m_handlers;
+
+		std::vector<BlockChangedEvent> m_blockChanges;
+		std::vector<PlayerEvent>       m_joins;
+		std::vector<PlayerEvent>       m_leaves;
+		std::vector<ChatEvent>         m_chat;
+	};
+} // namespace phx::cms
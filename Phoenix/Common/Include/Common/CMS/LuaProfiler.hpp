@@ -0,0 +1,219 @@
+// Copyright 2019-20 Genten Studios
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+// may be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <sol/sol.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace phx::cms
+{
+	/**
+	 * @brief What happens to a mod's callbacks once it has used up its
+	 * budget for the tick.
+	 */
+	enum class BudgetPolicy
+	{
+		/// Callbacks still run, a warning is logged at the end of the tick.
+		WARN,
+		/// Callbacks are queued and run in later ticks as budget allows.
+		DEFER
+	};
+
+	/**
+	 * @brief The Lua usage of a single mod.
+	 */
+	struct ModStatistics
+	{
+		std::string name;
+
+		/// The number of callbacks run.
+		std::uint64_t calls = 0;
+
+		/// The Lua instructions run by those callbacks, counted in steps of
+		/// LuaProfiler::INSTRUCTION_STEP.
+		std::uint64_t instructions = 0;
+
+		/// The time spent in the mod's callbacks overall, the longest single
+		/// callback and the last full tick, in milliseconds.
+		double total    = 0.0;
+		double max      = 0.0;
+		double lastTick = 0.0;
+
+		/// The time the mod may use each tick in milliseconds, 0 for no
+		/// limit.
+		double budget = 0.0;
+
+		/// The number of ticks the mod went over its budget.
+		std::uint64_t overBudgetTicks = 0;
+
+		/// The number of callbacks deferred to a later tick.
+		std::uint64_t deferred = 0;
+	};
+
+	/**
+	 * @brief Accounts the time spent running Lua callbacks to the mods that
+	 * registered them, and keeps each mod to a budget per tick.
+	 *
+	 * Callbacks such as block events and commands run synchronously in the
+	 * game loop, so a single slow mod holds up the whole tick. Running them
+	 * through the profiler times each call and, when the Lua state is known,
+	 * counts the instructions it runs with a count hook. Callbacks that call
+	 * into other callbacks are accounted to the outermost one.
+	 *
+	 * At the end of each tick mods over their budget are warned about, or
+	 * with BudgetPolicy::DEFER have the rest of their callbacks queued until
+	 * a tick where they have budget left. Callbacks for the same mod always
+	 * run in the order they were requested.
+	 *
+	 * @paragraph Usage
+	 * @code
+	 * block.mod = LuaProfiler::get().getModID(manager->getCurrentModName());
+	 *
+	 * LuaProfiler::get().call(block.mod, block.onBreak, x, y, z);
+	 *
+	 * // once per tick.
+	 * LuaProfiler::get().endTick();
+	 *
+	 * std::cout << LuaProfiler::get().report();
+	 * @endcode
+	 */
+	class LuaProfiler
+	{
+	public:
+		using ModID = std::size_t;
+
+		/// @brief Callbacks not registered by a known mod.
+		static constexpr ModID UNKNOWN_MOD = 0;
+
+		/// @brief How many instructions are run between each count.
+		static constexpr int INSTRUCTION_STEP = 1000;
+
+	public:
+		static LuaProfiler& get();
+
+		/**
+		 * @brief Gets the id of a mod, registering it the first time.
+		 * @param name The name of the mod.
+		 */
+		ModID getModID(const std::string& name);
+
+		/**
+		 * @brief Sets the budget of every mod without one of its own.
+		 * @param milliseconds The time each mod may use per tick, 0 for no
+		 * limit.
+		 */
+		void setBudget(double milliseconds);
+
+		/**
+		 * @brief Sets the budget of a single mod.
+		 * @param mod The mod to set the budget of.
+		 * @param milliseconds The time the mod may use per tick, 0 for no
+		 * limit.
+		 */
+		void setBudget(ModID mod, double milliseconds);
+
+		void setPolicy(BudgetPolicy policy);
+
+		/**
+		 * @brief Calls a Lua function on behalf of a mod.
+		 * @param mod The mod the function belongs to.
+		 * @param function The function to call.
+		 * @param args The arguments, copied in case the call is deferred.
+		 */
+		template <typename... Args>
+		void call(ModID mod, const sol::function& function, Args... args)
+		{
+			run(mod, function.lua_state(),
+			    [function, args...]() { function(args...); });
+		}
+
+		/**
+		 * @brief Runs a callback on behalf of a mod.
+		 * @param mod The mod the callback belongs to.
+		 * @param state The Lua state the callback runs in, to count its
+		 * instructions, or nullptr.
+		 * @param callback The callback to run.
+		 */
+		void run(ModID mod, lua_State* state, std::function<void()> callback);
+
+		/**
+		 * @brief Closes the current tick, then runs deferred callbacks that
+		 * now fit in their mod's budget.
+		 */
+		void endTick();
+
+		std::vector<ModStatistics> getStatistics() const;
+
+		/**
+		 * @brief Formats the statistics of every mod as a text table.
+		 */
+		std::string report() const;
+
+	private:
+		LuaProfiler();
+
+		struct Deferred
+		{
+			ModID                 mod;
+			lua_State*            state;
+			std::function<void()> callback;
+		};
+
+		void invoke(ModID mod, lua_State* state,
+		            const std::function<void()>& callback);
+
+		// whether the mod has used up its budget this tick.
+		bool isExhausted(ModID mod) const;
+
+	private:
+		mutable std::mutex m_mutex;
+
+		std::vector<ModStatistics> m_mods;
+
+		// the time used by each mod so far this tick, and whether its
+		// budget was set for it rather than taken from the default.
+		std::vector<double> m_tickTime;
+		std::vector<bool>   m_ownBudget;
+
+		// the number of callbacks each mod has waiting.
+		std::vector<std::size_t> m_pending;
+
+		double       m_budget = 0.0;
+		BudgetPolicy m_policy = BudgetPolicy::WARN;
+
+		std::deque<Deferred> m_deferred;
+	};
+} // namespace phx::cms
@@ -28,12 +28,15 @@
 
 #pragma once
 
+#include <Common/CMS/Mod.hpp>
+#include <Common/CMS/ScriptCache.hpp>
 #include <Common/Logger.hpp>
 
 #include <sol/sol.hpp>
 
 #include <functional>
 #include <queue>
+#include <sstream>
 #include <vector>
 
 namespace phx::cms
@@ -135,10 +138,40 @@ namespace phx::cms
 		 */
 		const std::string& getCurrentModPath() const;
 
+		/**
+		 * @brief Gets the name of the currently loading mod.
+		 * @return The name of the mod being currently loaded.
+		 *
+		 * This lets functions registered with the manager remember which
+		 * mod called them, such as to account callbacks to their mod.
+		 */
+		const std::string& getCurrentModName() const;
+
+	private:
+		/**
+		 * @brief Runs the chunk on top of the stack.
+		 * @param state The Lua state to run it in.
+		 * @param error Set to the error if it fails.
+		 * @return Whether it ran without errors.
+		 */
+		static bool run(lua_State* state, std::string& error);
+
+		/**
+		 * @brief Orders mods so each one comes after its dependencies.
+		 * @param mods The mods to sort.
+		 * @param order Set to the indices of the mods in load order.
+		 * @return The status, failing for a missing dependency or one that
+		 * is circular, naming the mods involved.
+		 */
+		static Status sortByDependencies(const std::vector<Mod>&   mods,
+		                                 std::vector<std::size_t>& order);
+
 	private:
 		std::vector<std::string> m_modsRequired;
 		std::vector<std::string> m_modPaths;
 		std::string              m_currentModPath;
+		std::string              m_currentModName;
+		ScriptCache              m_scriptCache;
 
 		sol::state m_luaState;
 	};
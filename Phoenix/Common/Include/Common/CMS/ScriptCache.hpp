@@ -0,0 +1,103 @@
+// Copyright 2019-20 Genten Studios
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+// may be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <sol/sol.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace phx::cms
+{
+	/**
+	 * @brief Loads Lua scripts, keeping their compiled bytecode on disk so
+	 * they only have to be parsed again when they change.
+	 *
+	 * Each script gets a file in the cache directory named after its path.
+	 * It holds the bytecode from lua_dump, behind a header with the Lua
+	 * version it was compiled by and a hash of the source. A script whose
+	 * source or Lua version no longer matches, or whose cache can't be
+	 * loaded, is compiled from source and the cache is rewritten.
+	 *
+	 * The bytecode is loaded without being verified, so the directory must
+	 * be as trusted as the scripts themselves.
+	 *
+	 * @paragraph Usage
+	 * @code
+	 * ScriptCache cache(ScriptCache::DEFAULT_DIRECTORY);
+	 *
+	 * std::string error;
+	 * if (cache.load(state, "Modules/mod1/Init.lua", error))
+	 * {
+	 *     // the compiled chunk is on top of the stack.
+	 *     lua_pcall(state, 0, 0, 0);
+	 * }
+	 * @endcode
+	 */
+	class ScriptCache
+	{
+	public:
+		static constexpr const char* DEFAULT_DIRECTORY = "Cache/Lua";
+
+	public:
+		/**
+		 * @brief Creates a cache in a directory.
+		 * @param directory The directory to keep bytecode in, created when
+		 * first needed, or empty to always compile from source.
+		 */
+		explicit ScriptCache(std::string directory);
+
+		/**
+		 * @brief Loads a script and pushes it onto the stack as a function.
+		 * @param state The Lua state to load the script into.
+		 * @param path The path of the script.
+		 * @param error Set to the reason if the script can't be loaded.
+		 * @return Whether the script was loaded, nothing is pushed if not.
+		 */
+		bool load(lua_State* state, const std::string& path,
+		          std::string& error);
+
+		/// @brief The number of scripts loaded from bytecode.
+		std::size_t getHits() const { return m_hits; }
+
+		/// @brief The number of scripts compiled from source.
+		std::size_t getMisses() const { return m_misses; }
+
+	private:
+		// writes the function on top of the stack to the cache.
+		void store(lua_State* state, const std::string& cachePath,
+		           std::uint64_t hash) const;
+
+	private:
+		std::string m_directory;
+		std::size_t m_hits   = 0;
+		std::size_t m_misses = 0;
+	};
+} // namespace phx::cms
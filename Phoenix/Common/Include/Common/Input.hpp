@@ -30,12 +30,44 @@
 
 #include <Common/Math/Math.hpp>
 #include <Common/Utility/Serializer.hpp>
+
 #include <cstddef>
+#include <cstdint>
+#include <deque>
 
 namespace phx
 {
+	/**
+	 * @brief The input of a single player for a single tick.
+	 *
+	 * On the wire an InputState is packed into 9 bytes: the six movement
+	 * flags share a single byte, each rotation component is quantized to 16
+	 * bits of a full turn and only the low 16 bits of the sequence are sent.
+	 * The receiver is expected to rebuild the full sequence with
+	 * InputState::unwrapSequence using the last sequence it has seen.
+	 */
 	struct InputState : ISerializable
 	{
+		/**
+		 * @brief The bits each movement flag occupies in the packed flags.
+		 */
+		enum Flags : std::uint8_t
+		{
+			FORWARD  = 1 << 0,
+			BACKWARD = 1 << 1,
+			LEFT     = 1 << 2,
+			RIGHT    = 1 << 3,
+			UP       = 1 << 4,
+			DOWN     = 1 << 5
+		};
+
+		/**
+		 * @brief The number of rotation units in a full turn, rotations are
+		 * stored as radians multiplied by 360000.
+		 */
+		static constexpr double ROTATION_UNITS_PER_TURN =
+		    2.0 * 3.14159265358979323846 * 360000.0;
+
 		InputState()          = default;
 		virtual ~InputState() = default;
 
@@ -51,11 +83,119 @@ namespace phx
 		bool up       = false;
 		bool down     = false;
 
-		math::vec3i rotation; // in 1/1000 degrees
+		math::vec3i rotation; // in radians * 360000
 
 		std::size_t sequence = 0;
 
+		/**
+		 * @brief Packs the movement flags into a single byte.
+		 *
+		 * @return The movement flags as a combination of InputState::Flags.
+		 */
+		std::uint8_t getFlags() const;
+
+		/**
+		 * @brief Sets the movement flags from a single byte.
+		 *
+		 * @param flags A combination of InputState::Flags.
+		 */
+		void setFlags(std::uint8_t flags);
+
+		/**
+		 * @brief Quantizes a rotation component to 16 bits of a full turn.
+		 *
+		 * @param rotation The rotation component to quantize.
+		 * @return The quantized rotation, wrapped around a full turn.
+		 */
+		static std::uint16_t quantizeRotation(int rotation);
+
+		/**
+		 * @brief Restores a quantized rotation component.
+		 *
+		 * @param rotation The quantized rotation.
+		 * @return The rotation component, between minus and plus half a turn.
+		 */
+		static int dequantizeRotation(std::uint16_t rotation);
+
+		/**
+		 * @brief Rebuilds a full sequence from its wrapped 16 bit form.
+		 *
+		 * The sequence closest to the reference is picked, so this works as
+		 * long as the two are less than 32768 ticks apart.
+		 *
+		 * @param sequence The wrapped 16 bit sequence.
+		 * @param reference A recent full sequence, such as the last one
+		 * received from the same sender.
+		 * @return The full sequence.
+		 */
+		static std::size_t unwrapSequence(std::uint16_t sequence,
+		                                  std::size_t   reference);
+
 		Serializer& operator>>(Serializer& serializer) const override;
 		Serializer& operator<<(Serializer& serializer) override;
 	};
+
+	/**
+	 * @brief The most recent InputStates of a player, sent together.
+	 *
+	 * States are sent unreliably, so every packet carries the last few
+	 * states rather than only the newest one. A single lost packet then does
+	 * not lose any input, the receiver just discards the states it already
+	 * has.
+	 *
+	 * @paragraph Usage
+	 * @code
+	 * // sending
+	 * history.push(state);
+	 * ser << history;
+	 *
+	 * // receiving, newest state first
+	 * ser >> history;
+	 * for (auto& state : history.getStates())
+	 * {
+	 *     state.sequence =
+	 *         InputState::unwrapSequence(state.sequence, lastSequence);
+	 * }
+	 * @endcode
+	 */
+	class InputHistory : public ISerializable
+	{
+	public:
+		/**
+		 * @brief The number of states sent in each packet by default.
+		 */
+		static constexpr std::size_t DEFAULT_REDUNDANCY = 5;
+
+		/**
+		 * @brief Creates an empty history.
+		 *
+		 * @param redundancy The maximum number of states kept and sent.
+		 */
+		explicit InputHistory(std::size_t redundancy = DEFAULT_REDUNDANCY);
+
+		/**
+		 * @brief Adds a new state, dropping the oldest one if full.
+		 *
+		 * @param state The newest state.
+		 */
+		void push(const InputState& state);
+
+		/**
+		 * @brief Removes all states from the history.
+		 */
+		void clear();
+
+		/**
+		 * @brief Gets the states in the history, newest first.
+		 */
+		const std::deque<InputState>& getStates() const { return m_states; }
+		std::deque<InputState>&       getStates() { return m_states; }
+
+		Serializer& operator>>(Serializer& serializer) const override;
+		Serializer& operator<<(Serializer& serializer) override;
+
+	private:
+		std::size_t            m_redundancy;
+		std::deque<InputState> m_states;
+	};
 } // namespace phx
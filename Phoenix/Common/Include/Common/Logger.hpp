@@ -28,23 +28,37 @@
 
 #pragma once
 
-#include <deque>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
 #include <fstream>
-#include <sstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <streambuf>
 #include <string>
 #include <thread>
-#include <mutex>
-#include <condition_variable>
 #include <utility>
 
-#define LOGGER_INTERNAL(verbosity, component)           \
-	if (phx::Logger::get() == nullptr ||                \
-	    verbosity > phx::Logger::get()->getVerbosity()) \
-	{                                                   \
-		;                                               \
-	}                                                   \
-	else                                                \
-		(*phx::Logger::get()) +=                        \
+// PHX_LOG_LEVEL is the most verbose level compiled in, matching the values of
+// phx::LogVerbosity. Anything more verbose is removed entirely along with the
+// formatting of its arguments. It is set by CMake, release builds leave out
+// debug messages unless told otherwise.
+#ifndef PHX_LOG_LEVEL
+#	define PHX_LOG_LEVEL 3
+#endif
+
+// the level is checked before the message is built, so the stream arguments
+// are only evaluated if the message is actually going to be logged.
+#define LOGGER_INTERNAL(verbosity, component)                       \
+	if (static_cast<int>(verbosity) > PHX_LOG_LEVEL ||              \
+	    !phx::Logger::isEnabled(verbosity))                         \
+	{                                                               \
+		;                                                           \
+	}                                                               \
+	else                                                            \
+		(*phx::Logger::get()) +=                                    \
 		    phx::Log(verbosity, __FILE__, __LINE__, component).ref()
 
 #define LOG_DEBUG(component) \
@@ -65,45 +79,113 @@ namespace phx
 		DEBUG   = 3,
 	};
 
+	/**
+	 * @brief What a threaded logger does when its queue is full.
+	 */
+	enum class LogOverflow
+	{
+		/// The message is dropped and counted, the logging thread reports how
+		/// many were lost once it catches up.
+		DROP,
+
+		/// The logging thread waits until there is space, so nothing is lost
+		/// but a flood of messages slows the thread logging them down.
+		BLOCK
+	};
+
 	struct LoggerConfig
 	{
 		std::string  logFile;
 		LogVerbosity verbosity    = LogVerbosity::INFO;
 		bool         threaded     = false;
 		bool         logToConsole = true;
+
+		// only used by the threaded logger.
+		std::size_t queueSize = 1024;
+		LogOverflow overflow  = LogOverflow::DROP;
+	};
+
+	/**
+	 * @brief A single formatted log message.
+	 *
+	 * Records have a fixed size so the threaded logger can keep a
+	 * preallocated queue of them, messages longer than TEXT_SIZE are
+	 * truncated.
+	 */
+	struct LogRecord
+	{
+		static constexpr std::size_t COMPONENT_SIZE = 32;
+		static constexpr std::size_t TEXT_SIZE      = 448;
+
+		LogVerbosity  verbosity = LogVerbosity::INFO;
+		const char*   file      = "";
+		int           line      = 0;
+		std::uint16_t length    = 0;
+		char          component[COMPONENT_SIZE] = {};
+		char          text[TEXT_SIZE];
+
+		/**
+		 * @brief Copies a record without copying the unused part of the text.
+		 */
+		void assign(const LogRecord& other);
 	};
 
+	/**
+	 * @brief Builds a log message, formatting straight into a LogRecord.
+	 *
+	 * This is what the LOG_* macros create, the message is streamed into it
+	 * and handed to the logger once the statement ends. Nothing is allocated
+	 * on the heap along the way.
+	 */
 	class Log
 	{
 	public:
-		Log() = default;
-		Log(LogVerbosity       vb, const std::string& errFile, int errLineNo,
-		    const std::string& module);
-		Log(const Log& rhs);
-		Log& operator=(const Log& rhs);
+		Log(LogVerbosity vb, const char* errFile, int errLineNo,
+		    const char* module);
+
+		Log(const Log& rhs) = delete;
+		Log& operator=(const Log& rhs) = delete;
 
 		Log& ref() { return *this; }
 
 		template <typename T>
 		Log& operator<<(T& msg)
 		{
-			stream << msg;
+			m_stream << msg;
 			return *this;
 		}
 
 		template <typename T>
 		Log& operator<<(T&& msg)
 		{
-			stream << std::forward<T>(msg);
+			m_stream << std::forward<T>(msg);
 			return *this;
 		}
 
-		
-		std::stringstream stream;
-		LogVerbosity      verbosity = LogVerbosity::INFO;
-		std::string       errorFile;
-		int               errorLine = 0;
-		std::string       component;
+		/**
+		 * @brief Gets the record the message has been formatted into.
+		 */
+		const LogRecord& getRecord();
+
+	private:
+		/**
+		 * @brief A stream buffer writing into a fixed size array, anything
+		 * past the end is discarded.
+		 */
+		class Buffer : public std::streambuf
+		{
+		public:
+			Buffer(char* begin, char* end) { setp(begin, end); }
+
+			std::size_t size() const
+			{
+				return static_cast<std::size_t>(pptr() - pbase());
+			}
+		};
+
+		LogRecord    m_record;
+		Buffer       m_buffer;
+		std::ostream m_stream;
 	};
 
 	class Logger
@@ -114,33 +196,77 @@ namespace phx
 
 		static Logger* get() { return m_instance; }
 
-		LogVerbosity getVerbosity() const;
+		/**
+		 * @brief Checks whether a message would be logged, without building
+		 * it.
+		 *
+		 * @param verbosity The verbosity of the message.
+		 * @return Whether a logger exists and is logging messages this
+		 * verbose.
+		 */
+		static bool isEnabled(LogVerbosity verbosity)
+		{
+			return m_instance != nullptr && verbosity <= m_instance->m_verbosity;
+		}
+
+		LogVerbosity getVerbosity() const { return m_verbosity; }
 
-		void log(const Log& log);
-		void operator+=(const Log& stream);
+		void log(Log& log);
+		void operator+=(Log& stream);
 
 	private:
 		Logger(const LoggerConfig& config);
 		~Logger();
 
-		void loggerInternal(const Log& log);
+		void loggerInternal(const LogRecord& record);
+		void loggerThreadHandle();
+
+		bool enqueue(const LogRecord& record);
+		bool dequeue(LogRecord& record);
+
+		void write(const LogRecord& record);
+		void flush();
 
 		static Logger* m_instance;
 
 	private:
-		std::deque<Log> m_messages;
+		/**
+		 * @brief A slot in the message queue.
+		 *
+		 * The sequence tells producers and the consumer whose turn it is to
+		 * use the slot, so the queue needs no lock.
+		 */
+		struct Slot
+		{
+			std::atomic<std::size_t> sequence;
+			LogRecord                record;
+		};
 
 		LogVerbosity m_verbosity;
 
-		bool                    m_threaded;
-		bool                    m_threadRunning = false;
+		bool        m_threaded;
+		LogOverflow m_overflow;
+
+		// bounded multiple producer, single consumer queue.
+		std::unique_ptr<Slot[]>  m_slots;
+		std::size_t              m_capacity = 0;
+		std::atomic<std::size_t> m_head {0};
+		std::size_t              m_tail = 0;
+		std::atomic<std::size_t> m_dropped {0};
+
+		std::atomic<bool>       m_threadRunning {false};
+		std::atomic<bool>       m_waiting {false};
 		std::condition_variable m_cond;
-		std::mutex              m_mutex;
+		std::mutex              m_condMutex;
 		std::thread             m_worker;
-		void                    loggerThreadHandle();
+
+		// guards the console and file, only contended by fatal messages which
+		// are written straight away.
+		std::mutex  m_outputMutex;
+		std::string m_consoleBatch;
+		std::string m_fileBatch;
 
 		bool          m_logToConsole;
 		std::ofstream m_file;
 	};
 } // namespace phx
-
@@ -0,0 +1,107 @@
+// Copyright 2019-20 Genten Studios
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+// may be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace phx::math
+{
+	/**
+	 * @brief Seeded 3D gradient noise for procedural generation.
+	 *
+	 * This is Perlin's improved noise, except lattice points are hashed with
+	 * integer arithmetic rather than a permutation table, so every lane of a
+	 * SIMD register can be hashed at once without gathers. Values are
+	 * roughly between -1 and 1 and are 0 on every integer coordinate.
+	 *
+	 * The batch overloads are vectorized with AVX2 or SSE2 (using SSE4.1
+	 * where it is available), picked at compile time from the target the
+	 * build is for. Building with PHX_NATIVE_ARCH enables the widest set the
+	 * building machine supports. Results can differ in the last bits between
+	 * instruction sets, but are always the same for a given build.
+	 *
+	 * @paragraph Usage
+	 * @code
+	 * Noise noise(1234);
+	 * float height = noise.fractal(x * 0.01f, 0.f, z * 0.01f, 4);
+	 *
+	 * // much faster when many points are needed at once.
+	 * noise.perlin(xs, ys, zs, out, count);
+	 * @endcode
+	 */
+	class Noise
+	{
+	public:
+		explicit Noise(std::uint32_t seed = 0);
+
+		std::uint32_t getSeed() const { return m_seed; }
+
+		/**
+		 * @brief Samples the noise at a single point.
+		 * @return The noise value, roughly between -1 and 1.
+		 */
+		float perlin(float x, float y, float z) const;
+
+		/**
+		 * @brief Samples the noise at many points.
+		 * @param x The x coordinate of each point.
+		 * @param y The y coordinate of each point.
+		 * @param z The z coordinate of each point.
+		 * @param out Where to write the value of each point.
+		 * @param count The number of points.
+		 */
+		void perlin(const float* x, const float* y, const float* z, float* out,
+		            std::size_t count) const;
+
+		/**
+		 * @brief Samples several octaves of noise at a single point, each at
+		 * double the frequency and half the amplitude of the last.
+		 * @return The noise value, normalized to roughly between -1 and 1.
+		 */
+		float fractal(float x, float y, float z, int octaves) const;
+
+		/**
+		 * @brief Samples several octaves of noise at many points.
+		 * @see fractal(float, float, float, int)
+		 */
+		void fractal(const float* x, const float* y, const float* z,
+		             float* out, std::size_t count, int octaves) const;
+
+		/**
+		 * @brief Gets the instruction set the batch functions were built
+		 * with.
+		 * @return "AVX2", "SSE4.1", "SSE2" or "Scalar".
+		 */
+		static const char* getInstructionSet();
+
+	private:
+		std::uint32_t m_seed;
+	};
+} // namespace phx::math
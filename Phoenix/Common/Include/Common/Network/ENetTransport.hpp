@@ -0,0 +1,98 @@
+// Copyright 2019-20 Genten Studios
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+// may be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <Common/Network/Transport.hpp>
+
+#include <enet/enet.h>
+
+#include <atomic>
+
+namespace phx::net
+{
+	/**
+	 * @brief The default transport, sending packets over UDP with ENet.
+	 *
+	 * This is a thin wrapper around an ENetHost, every method maps directly to
+	 * its ENet counterpart. ENet itself is initialized when the first instance
+	 * is created and deinitialized once the last one is destroyed.
+	 */
+	class ENetTransport : public Transport
+	{
+	public:
+		/**
+		 * @brief Creates an ENet host.
+		 * @param address The address to bind to, listen on.
+		 * @param peers The maximum amount of peers that are allowed to connect.
+		 * @param channels The maximum number of channels that can be used.
+		 */
+		ENetTransport(const ENetAddress* address, std::size_t peers,
+		              std::size_t channels);
+		~ENetTransport() override;
+
+		ENetPeer* connect(const Address& address, enet_uint8 channels,
+		                  enet_uint32 data) override;
+
+		bool service(ENetEvent& event, time::ms timeout) override;
+		void flush() override;
+
+		void send(ENetPeer& peer, enet_uint8 channel,
+		          ENetPacket& packet) override;
+		void broadcast(enet_uint8 channel, ENetPacket& packet) override;
+
+		ENetPacket* receive(ENetPeer& peer, enet_uint8& channel) override;
+
+		void disconnect(ENetPeer& peer, enet_uint32 data,
+		                DisconnectMode mode) override;
+
+		void ping(ENetPeer& peer) override;
+		void setPingInterval(ENetPeer& peer, time::ms interval) override;
+		void setThrottle(ENetPeer& peer, const Throttle& throttle) override;
+		void setTimeout(ENetPeer& peer, const Timeout& timeout) override;
+
+		Bandwidth getBandwidthLimit() const override;
+		void      setBandwidthLimit(const Bandwidth& bandwidth) override;
+
+		std::size_t getChannelLimit() const override;
+		void        setChannelLimit(std::size_t limit) override;
+
+		std::size_t getPeerCount() const override;
+		std::size_t getPeerLimit() const override;
+
+		enet_uint32 getTotalReceivedData() const override;
+		enet_uint32 getTotalSentData() const override;
+
+		operator ENetHost*() const { return m_host; }
+
+	private:
+		ENetHost* m_host;
+
+		static std::atomic<std::size_t> m_activeInstances;
+	};
+} // namespace phx::net
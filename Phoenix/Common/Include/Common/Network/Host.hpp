@@ -29,14 +29,19 @@
 #pragma once
 
 #include <Common/Network/Address.hpp>
+#include <Common/Network/MessageBatcher.hpp>
 #include <Common/Network/Packet.hpp>
 #include <Common/Network/Peer.hpp>
+#include <Common/Network/Transport.hpp>
 #include <Common/Network/Types.hpp>
+#include <Common/Profiling/Metrics.hpp>
 
 #include <enet/enet.h>
 
-#include <atomic>
+#include <chrono>
 #include <functional>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <unordered_map>
 
@@ -55,6 +60,10 @@ namespace phx::net
 	 * A note to keep in mind is that the maximum number of peers possible is
 	 * 4096.
 	 *
+	 * Packets are moved by a Transport, which is ENet over UDP unless another
+	 * transport is provided. A LoopbackTransport can be used to connect hosts
+	 * living in the same process without any sockets, see LoopbackNetwork.
+	 *
 	 * @paragraph Usage
 	 * The constructor requiring only the amount of peers and address has been
 	 * setup so the defaults are correct for a client. The only requires a
@@ -134,7 +143,13 @@ namespace phx::net
 		Host(const Address& address, std::size_t peers,
 		     std::size_t channels = 0);
 
-		~Host();
+		/**
+		 * @brief Creates a Host on top of a specific transport.
+		 * @param transport The transport to send and receive packets with.
+		 */
+		explicit Host(std::unique_ptr<Transport> transport);
+
+		~Host() = default;
 
 		// check if value exists before using.
 		using OptionalPeer = std::optional<std::reference_wrapper<Peer>>;
@@ -218,9 +233,59 @@ namespace phx::net
 		void broadcast(Packet& packet, enet_uint8 channel = 0);
 		void broadcast(Packet&& packet, enet_uint8 channel = 0);
 
+		/**
+		 * @brief Enables coalescing of queued messages into batched packets.
+		 * @param enabled Whether batching should be enabled.
+		 *
+		 * While batching is enabled, every packet received is treated as a
+		 * batch and split back into the messages it contains, with the receive
+		 * callback being called once per message. Both ends of a connection
+		 * must agree on this, and packets should only be sent through the
+		 * queue methods below while it is enabled.
+		 */
+		void enableBatching(bool enabled = true);
+
+		/**
+		 * @brief Checks whether messages are being batched.
+		 * @return Whether batching is enabled.
+		 */
+		bool isBatching() const { return m_batching; }
+
+		/**
+		 * @brief Queues a message to be sent to a peer with the next batch.
+		 * @param peerID The ID of the peer to send the message to.
+		 * @param type The type of the message, passed to the receive callback
+		 * on the foreign host in place of the channel.
+		 * @param data The data to send.
+		 * @param flags The method with which the message should be sent.
+		 * @param channel The channel to send it on.
+		 *
+		 * This method is thread safe, the queued messages are sent the next
+		 * time the host is polled or flushed.
+		 */
+		void queue(std::size_t peerID, MessageBatcher::MessageType type,
+		           const Packet::Data& data, PacketFlags flags,
+		           enet_uint8 channel = 0);
+
+		/**
+		 * @brief Queues a message to be sent to all peers with the next batch.
+		 * @param type The type of the message, passed to the receive callback
+		 * on the foreign host in place of the channel.
+		 * @param data The data to send.
+		 * @param flags The method with which the message should be sent.
+		 * @param channel The channel to send it on.
+		 */
+		void queueBroadcast(MessageBatcher::MessageType type,
+		                    const Packet::Data& data, PacketFlags flags,
+		                    enet_uint8 channel = 0);
+
 		/**
 		 * @brief Sets a callback for when a packet is received.
 		 * @param callback The function to call when a packet is received.
+		 *
+		 * Note: If batching is enabled, this is called for every message
+		 * within a received batch and is given the message type rather than
+		 * the channel it arrived on.
 		 */
 		void onReceive(ReceiveCallback callback);
 
@@ -263,6 +328,8 @@ namespace phx::net
 		/**
 		 * @brief Flushes all events, sending them off to the respective foreign
 		 * hosts.
+		 *
+		 * This will also send any batches of queued messages.
 		 */
 		void flush();
 
@@ -310,10 +377,16 @@ namespace phx::net
 		 */
 		enet_uint32 getTotalSentData() const;
 
-		operator ENetHost*() const { return m_host; }
+		/**
+		 * @brief Gets the transport the host is using.
+		 * @return The transport packets are being sent with.
+		 */
+		Transport& getTransport() const { return *m_transport; }
 
 	private:
 		void handleEvent(ENetEvent& event);
+		void sendQueued();
+		void updateMetrics();
 
 		Peer* getPeer(ENetPeer& peer);
 		Peer& createPeer(ENetPeer& peer);
@@ -324,8 +397,8 @@ namespace phx::net
 		void removePeer(const Peer& peer);
 
 	private:
-		ENetHost* m_host;
-		Address   m_address;
+		std::unique_ptr<Transport> m_transport;
+		Address                    m_address;
 
 		ReceiveCallback    m_receiveCallback;
 		ConnectCallback    m_connectCallback;
@@ -334,6 +407,15 @@ namespace phx::net
 		std::size_t                           m_peerID = 0;
 		std::unordered_map<std::size_t, Peer> m_peers;
 
-		static std::atomic<std::size_t> m_activeInstances;
+		bool                                            m_batching = false;
+		std::mutex                                      m_batchMutex;
+		std::unordered_map<std::size_t, MessageBatcher> m_batches;
+		MessageBatcher                                  m_broadcastBatch;
+
+		// the totals from the transport are only polled every so often, so
+		// the metrics are fed the difference since the last time.
+		std::chrono::steady_clock::time_point m_lastMetricsUpdate;
+		enet_uint32                           m_lastSentData     = 0;
+		enet_uint32                           m_lastReceivedData = 0;
 	};
 } // namespace phx::net
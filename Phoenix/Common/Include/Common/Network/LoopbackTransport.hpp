@@ -0,0 +1,298 @@
+// Copyright 2019-20 Genten Studios
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+// may be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <Common/Network/Transport.hpp>
+
+#include <enet/enet.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+namespace phx::net
+{
+	/**
+	 * @brief The simulated conditions of every link in a LoopbackNetwork.
+	 *
+	 * All values apply to each direction of a connection separately, so the
+	 * round trip time of a connection is twice the latency.
+	 */
+	struct LinkConditions
+	{
+		/// @brief The one way delay of every packet.
+		time::ms latency = 0_ms;
+
+		/// @brief The maximum random delay added on top of the latency.
+		time::ms jitter = 0_ms;
+
+		/// @brief The chance of a packet being lost, between 0 and 1.
+		float loss = 0.f;
+
+		/// @brief The bandwidth of a link in bytes per second, 0 is unlimited.
+		speed bandwidth = 0;
+	};
+
+	class LoopbackTransport;
+
+	/**
+	 * @brief An in-memory network that loopback transports connect through.
+	 *
+	 * Every LoopbackTransport attached to a network can connect to any other
+	 * transport attached to the same network using its port, the IP of the
+	 * address is ignored. Packets are never copied or touched by a socket, they
+	 * are handed from one transport to the other after the simulated delay.
+	 *
+	 * Packet loss, jitter and bandwidth are simulated with a seeded random
+	 * number generator, so given the same seed and the same traffic the same
+	 * packets are delayed and lost. For fully deterministic tests, the manual
+	 * clock can be used so time only passes when advance is called.
+	 *
+	 * The network must outlive every transport attached to it.
+	 *
+	 * @paragraph Usage
+	 * @code
+	 * LoopbackNetwork network({50_ms, 10_ms, 0.01f, 0});
+	 *
+	 * Host server(std::make_unique<LoopbackTransport>(network, 7777, 32));
+	 * Host client(std::make_unique<LoopbackTransport>(network, 0, 1));
+	 *
+	 * client.connect(Address {"127.0.0.1", 7777}, 4);
+	 * @endcode
+	 */
+	class LoopbackNetwork
+	{
+	public:
+		using Clock = std::chrono::steady_clock;
+
+	public:
+		explicit LoopbackNetwork(const LinkConditions& conditions = {},
+		                         std::uint32_t         seed       = 0);
+
+		/**
+		 * @brief Gets the conditions applied to every link.
+		 * @return The current link conditions.
+		 */
+		LinkConditions getConditions() const;
+
+		/**
+		 * @brief Sets the conditions applied to every link.
+		 * @param conditions The new link conditions.
+		 *
+		 * Packets already in flight are not affected.
+		 */
+		void setConditions(const LinkConditions& conditions);
+
+		/**
+		 * @brief Switches between the real and a manual clock.
+		 * @param manual Whether time should only pass when advanced manually.
+		 *
+		 * While the manual clock is used, Transport::service never waits for
+		 * packets since nothing can arrive until the clock is advanced.
+		 */
+		void useManualClock(bool manual = true);
+
+		/**
+		 * @brief Moves the manual clock forward.
+		 * @param time How much time should pass.
+		 */
+		void advance(time::ms time);
+
+	private:
+		friend class LoopbackTransport;
+
+		Clock::time_point now() const;
+		time::ms          delay();
+		bool              lose();
+
+	private:
+		mutable std::mutex      m_mutex;
+		std::condition_variable m_condition;
+
+		LinkConditions m_conditions;
+		std::mt19937   m_random;
+
+		bool              m_manualClock = false;
+		Clock::time_point m_time;
+
+		enet_uint16                                         m_ephemeralPort;
+		std::unordered_map<enet_uint16, LoopbackTransport*> m_transports;
+	};
+
+	/**
+	 * @brief A transport passing packets through a LoopbackNetwork.
+	 *
+	 * This behaves like ENet as closely as is useful: connections produce
+	 * connect events on both ends, reliable packets are always delivered and
+	 * in order (losses only delay them by a retransmission), unreliable
+	 * packets may be lost and late ones are dropped rather than delivered out
+	 * of order, unless they are unsequenced.
+	 *
+	 * Packets are only ever delivered through service, receive always
+	 * returns nothing.
+	 */
+	class LoopbackTransport : public Transport
+	{
+	public:
+		/**
+		 * @brief Attaches a new transport to a network.
+		 * @param network The network to attach to.
+		 * @param port The port to listen on, 0 picks a free one like a client
+		 * would.
+		 * @param peers The maximum amount of peers that are allowed to connect.
+		 * @param channels The maximum number of channels that can be used.
+		 */
+		LoopbackTransport(LoopbackNetwork& network, enet_uint16 port,
+		                  std::size_t peers, std::size_t channels = 0);
+		~LoopbackTransport() override;
+
+		LoopbackTransport(const LoopbackTransport&) = delete;
+		LoopbackTransport& operator=(const LoopbackTransport&) = delete;
+
+		/**
+		 * @brief Gets the port this transport is attached with.
+		 * @return The port other transports can connect to.
+		 */
+		enet_uint16 getPort() const { return m_port; }
+
+		ENetPeer* connect(const Address& address, enet_uint8 channels,
+		                  enet_uint32 data) override;
+
+		bool service(ENetEvent& event, time::ms timeout) override;
+		void flush() override;
+
+		void send(ENetPeer& peer, enet_uint8 channel,
+		          ENetPacket& packet) override;
+		void broadcast(enet_uint8 channel, ENetPacket& packet) override;
+
+		ENetPacket* receive(ENetPeer& peer, enet_uint8& channel) override;
+
+		void disconnect(ENetPeer& peer, enet_uint32 data,
+		                DisconnectMode mode) override;
+
+		void ping(ENetPeer& peer) override;
+		void setPingInterval(ENetPeer& peer, time::ms interval) override;
+		void setThrottle(ENetPeer& peer, const Throttle& throttle) override;
+		void setTimeout(ENetPeer& peer, const Timeout& timeout) override;
+
+		Bandwidth getBandwidthLimit() const override;
+		void      setBandwidthLimit(const Bandwidth& bandwidth) override;
+
+		std::size_t getChannelLimit() const override;
+		void        setChannelLimit(std::size_t limit) override;
+
+		std::size_t getPeerCount() const override;
+		std::size_t getPeerLimit() const override;
+
+		enet_uint32 getTotalReceivedData() const override;
+		enet_uint32 getTotalSentData() const override;
+
+	private:
+		using Clock = LoopbackNetwork::Clock;
+
+		// the other end of a connection, along with the state needed to
+		// simulate the link towards it.
+		struct Link
+		{
+			bool inUse     = false;
+			bool releasing = false;
+
+			// bumped on every connection, so events for a previous connection
+			// using the same slot are ignored.
+			std::uint32_t generation = 0;
+
+			LoopbackTransport* remote           = nullptr;
+			std::size_t        remoteIndex      = 0;
+			std::uint32_t      remoteGeneration = 0;
+
+			// when the other end sees the connection, nothing sent is
+			// delivered before then.
+			Clock::time_point established;
+
+			Clock::time_point              nextFree;
+			std::vector<Clock::time_point> lastReliable;
+			std::vector<std::uint32_t>     sentSequence;
+			std::vector<std::uint32_t>     receivedSequence;
+		};
+
+		struct Delivery
+		{
+			Clock::time_point time;
+			std::uint64_t     order;
+			std::uint32_t     generation;
+			std::uint32_t     sequence;
+			ENetEvent         event;
+		};
+
+		struct Later
+		{
+			bool operator()(const Delivery& lhs, const Delivery& rhs) const
+			{
+				return lhs.time != rhs.time ? lhs.time > rhs.time
+				                            : lhs.order > rhs.order;
+			}
+		};
+
+		std::size_t indexOf(const ENetPeer& peer) const;
+		ENetPeer*   allocate(const Address& address, std::size_t channels);
+
+		void deliver(LoopbackTransport& target, std::size_t index,
+		             std::uint32_t generation, Clock::time_point time,
+		             ENetEventType type, enet_uint32 data,
+		             ENetPacket* packet = nullptr, enet_uint8 channel = 0,
+		             std::uint32_t sequence = 0);
+
+		void sendLocked(std::size_t index, enet_uint8 channel,
+		                ENetPacket& packet);
+		bool accept(Delivery& delivery);
+
+	private:
+		LoopbackNetwork& m_network;
+		enet_uint16      m_port;
+
+		// never resized after construction so pointers to peers stay valid.
+		std::vector<ENetPeer> m_peers;
+		std::vector<Link>     m_links;
+
+		std::priority_queue<Delivery, std::vector<Delivery>, Later> m_inbox;
+		std::uint64_t                                             m_order = 0;
+
+		std::size_t m_channelLimit;
+		std::size_t m_connectedPeers = 0;
+		Bandwidth   m_bandwidth      = {0, 0};
+
+		enet_uint32 m_totalReceivedData = 0;
+		enet_uint32 m_totalSentData     = 0;
+	};
+} // namespace phx::net
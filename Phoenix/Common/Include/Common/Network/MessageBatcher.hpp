@@ -0,0 +1,154 @@
+// Copyright 2019-20 Genten Studios
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+// may be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <Common/Network/Packet.hpp>
+
+#include <enet/enet.h>
+
+#include <cstddef>
+#include <vector>
+
+namespace phx::net
+{
+	/**
+	 * @brief Coalesces many small logical messages into as few packets as
+	 * possible.
+	 *
+	 * Every message appended to the batcher is prefixed with a small header
+	 * containing its type and its length. Messages are grouped by the channel
+	 * they are meant to be sent on, so a whole tick's worth of chat messages,
+	 * chunks and events for a peer can leave in a single ENet packet per
+	 * channel rather than one packet (and one allocation, and one header) per
+	 * message.
+	 *
+	 * If a message flagged as reliable is appended to a batch, the entire batch
+	 * is sent reliably. Batches that would grow past the size limits below are
+	 * sealed and a new batch is started, this stops unreliable batches from
+	 * being fragmented by ENet, where losing a single fragment would lose every
+	 * message in the batch.
+	 *
+	 * @paragraph Usage
+	 * @code
+	 * MessageBatcher batcher;
+	 * batcher.append(2, 2, messageData.data(), messageData.size(),
+	 *                PacketFlags::RELIABLE);
+	 * batcher.append(3, 3, chunkData.data(), chunkData.size(),
+	 *                PacketFlags::RELIABLE);
+	 *
+	 * for (auto& batch : batcher.take())
+	 * {
+	 *     peer.send(Packet(batch.data, batch.flags), batch.channel);
+	 * }
+	 *
+	 * // on the receiving end.
+	 * MessageBatcher::split(data, size, [](MessageBatcher::MessageType type,
+	 *                                      const std::byte* message,
+	 *                                      std::size_t size) { ... });
+	 * @endcode
+	 */
+	class MessageBatcher
+	{
+	public:
+		using MessageType = enet_uint8;
+		using MessageSize = enet_uint32;
+
+		/// @brief The amount of bytes prefixed onto every message.
+		static constexpr std::size_t HEADER_SIZE =
+		    sizeof(MessageType) + sizeof(MessageSize);
+
+		/// @brief Keeps unreliable batches within a single datagram.
+		static constexpr std::size_t MAX_UNRELIABLE_BATCH_SIZE = 1200;
+
+		/// @brief Caps reliable batches so one batch can't starve a channel.
+		static constexpr std::size_t MAX_RELIABLE_BATCH_SIZE = 64 * 1024;
+
+		/**
+		 * @brief A set of messages ready to be sent as a single packet.
+		 */
+		struct Batch
+		{
+			Packet::Data data;
+			PacketFlags  flags   = PacketFlags::UNRELIABLE;
+			enet_uint8   channel = 0;
+		};
+
+	public:
+		MessageBatcher() = default;
+
+		/**
+		 * @brief Appends a message to the batch for a channel.
+		 * @param channel The channel the message should be sent on.
+		 * @param type The type of the message, used to dispatch it on receipt.
+		 * @param data The message data.
+		 * @param size The size of the message data in bytes.
+		 * @param flags The method with which the message should be sent.
+		 */
+		void append(enet_uint8 channel, MessageType type, const std::byte* data,
+		            std::size_t size, PacketFlags flags);
+
+		/**
+		 * @brief Checks whether there is anything waiting to be sent.
+		 * @return Whether the batcher is empty.
+		 */
+		bool empty() const;
+
+		/**
+		 * @brief Takes every batch out of the batcher, leaving it empty.
+		 * @return The batches that are ready to be sent.
+		 */
+		std::vector<Batch> take();
+
+		/**
+		 * @brief Splits a received batch into the messages it contains.
+		 * @param data The data of the received packet.
+		 * @param size The size of the received packet.
+		 * @param callback Called with (type, data, size) for each message.
+		 * @return False if the batch was malformed, true otherwise.
+		 *
+		 * The data passed to the callback points into the provided buffer, it
+		 * is only valid for as long as that buffer is.
+		 */
+		template <typename F>
+		static bool split(const std::byte* data, std::size_t size,
+		                  F&& callback);
+
+	private:
+		void seal(enet_uint8 channel);
+
+	private:
+		// open batches, indexed by channel.
+		std::vector<Batch> m_open;
+
+		// batches that were filled up before being taken.
+		std::vector<Batch> m_sealed;
+	};
+} // namespace phx::net
+
+#include <Common/Network/MessageBatcher.inl>
@@ -0,0 +1,71 @@
+// Copyright 2019-20 Genten Studios
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+// may be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+// Header exists in MessageBatcher.hpp
+
+#include <Common/Utility/Internal/Endian.hpp>
+
+#include <cstring>
+
+namespace phx::net
+{
+	template <typename F>
+	bool MessageBatcher::split(const std::byte* data, std::size_t size,
+	                           F&& callback)
+	{
+		std::size_t offset = 0;
+		while (offset < size)
+		{
+			if (size - offset < HEADER_SIZE)
+			{
+				return false;
+			}
+
+			MessageType type;
+			std::memcpy(&type, data + offset, sizeof(MessageType));
+			offset += sizeof(MessageType);
+
+			MessageSize length;
+			std::memcpy(&length, data + offset, sizeof(MessageSize));
+			length = data::endian::swapForHost(length);
+			offset += sizeof(MessageSize);
+
+			if (size - offset < length)
+			{
+				return false;
+			}
+
+			callback(type, data + offset, static_cast<std::size_t>(length));
+			offset += length;
+		}
+
+		return true;
+	}
+} // namespace phx::net
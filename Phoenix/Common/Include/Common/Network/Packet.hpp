@@ -84,6 +84,18 @@ namespace phx::net
 		 */
 		Packet(const Data& data, PacketFlags flags);
 
+		/**
+		 * @brief Constructs a packet that takes ownership of some data.
+		 * @param data The data to send within the packet.
+		 * @param flags The method with which the packet should be sent.
+		 *
+		 * Unlike the copying constructor, the buffer is handed straight to
+		 * ENet and freed once ENet is done with the packet, so a buffer built
+		 * up by a Serializer can be sent without copying it again. A packet
+		 * created this way cannot grow past the size of the data given.
+		 */
+		Packet(Data&& data, PacketFlags flags);
+
 		/**
 		 * @brief Constructs a packet with a predetermined size.
 		 * @param size The size of the data which will be set later.
@@ -116,6 +128,17 @@ namespace phx::net
 		 */
 		Data getData() const;
 
+		/**
+		 * @brief Gets a pointer to the data the packet is storing.
+		 * @return A pointer to the first byte of the packet's data.
+		 *
+		 * No copy is made, the pointer is only valid for as long as the packet
+		 * is, which for received packets is the duration of the receive
+		 * callback. Use this with Serializer::borrowBuffer to read a packet
+		 * without copying it.
+		 */
+		const std::byte* getRawData() const;
+
 		/**
 		 * @brief Resizes the packet.
 		 * @param size The new size for the packet.
@@ -166,6 +166,18 @@ namespace phx::net
 		void send(Packet& packet, enet_uint8 channel = 0);
 		void send(Packet&& packet, enet_uint8 channel = 0);
 
+		/**
+		 * @brief Queues a message to be batched and sent to the peer.
+		 * @param type The type of the message.
+		 * @param data The data to send.
+		 * @param flags The method with which the message should be sent.
+		 * @param channel The channel to send it on.
+		 *
+		 * This is a shortcut to Host::queue, see that for more information.
+		 */
+		void queue(enet_uint8 type, const Packet::Data& data, PacketFlags flags,
+		           enet_uint8 channel = 0);
+
 		/**
 		 * @brief Gets the current throttle parameters. 
 		 * @return The current throttle parameters.
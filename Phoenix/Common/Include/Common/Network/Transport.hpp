@@ -0,0 +1,164 @@
+// Copyright 2019-20 Genten Studios
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+// may be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <Common/Network/Address.hpp>
+#include <Common/Network/Types.hpp>
+
+#include <enet/enet.h>
+
+#include <cstddef>
+
+namespace phx::net
+{
+	/**
+	 * @brief The ways a peer can be disconnected from a host.
+	 */
+	enum class DisconnectMode
+	{
+		/**
+		 * @brief Disconnects gracefully, producing an event on both hosts.
+		 */
+		GRACEFUL,
+
+		/**
+		 * @brief Disconnects immediately, the foreign host is notified but no
+		 * event is produced locally.
+		 */
+		IMMEDIATE,
+
+		/**
+		 * @brief Disconnects once all queued outgoing packets are sent.
+		 */
+		LATER,
+
+		/**
+		 * @brief Forcefully drops the peer without notifying anyone.
+		 */
+		RESET
+	};
+
+	/**
+	 * @brief Interface for whatever actually moves packets between hosts.
+	 *
+	 * The Host and Peer classes sit on top of a transport, by default an
+	 * ENetTransport using real UDP sockets. Other transports, such as the
+	 * LoopbackTransport, can be swapped in to run a server and client within a
+	 * single process.
+	 *
+	 * Transports speak in ENet's own types (ENetPeer, ENetPacket and
+	 * ENetEvent), so packets and peers behave identically regardless of the
+	 * transport used. A transport that isn't ENet is responsible for owning
+	 * the ENetPeer objects it hands out and keeping their public fields (state,
+	 * round trip time, etc...) up to date, since the Peer class reads them
+	 * directly.
+	 *
+	 * Packets handed to send and broadcast are owned by the transport from
+	 * then on, packets returned through events are destroyed by the caller.
+	 */
+	class Transport
+	{
+	public:
+		virtual ~Transport() = default;
+
+		/**
+		 * @brief Starts connecting to a foreign host.
+		 * @param address The address to connect to.
+		 * @param channels The amount of channels to enable on connect.
+		 * @param data User data to send with the connection request.
+		 * @return The peer being connected to, or nullptr if there are no free
+		 * peer slots or the connection is impossible.
+		 */
+		virtual ENetPeer* connect(const Address& address, enet_uint8 channels,
+		                          enet_uint32 data) = 0;
+
+		/**
+		 * @brief Sends queued packets and waits for the next event.
+		 * @param event The event to fill in.
+		 * @param timeout How long to wait for an event for.
+		 * @return Whether an event occurred.
+		 */
+		virtual bool service(ENetEvent& event, time::ms timeout) = 0;
+
+		/**
+		 * @brief Sends any queued packets without waiting for events.
+		 */
+		virtual void flush() = 0;
+
+		/**
+		 * @brief Queues a packet to be sent to a peer.
+		 * @param peer The peer to send the packet to.
+		 * @param channel The channel to send it on.
+		 * @param packet The packet to send, owned by the transport from now.
+		 */
+		virtual void send(ENetPeer& peer, enet_uint8 channel,
+		                  ENetPacket& packet) = 0;
+
+		/**
+		 * @brief Queues a packet to be sent to every connected peer.
+		 * @param channel The channel to send it on.
+		 * @param packet The packet to send, owned by the transport from now.
+		 */
+		virtual void broadcast(enet_uint8 channel, ENetPacket& packet) = 0;
+
+		/**
+		 * @brief Takes a received packet directly from a peer.
+		 * @param peer The peer to receive from.
+		 * @param channel Set to the channel the packet arrived on.
+		 * @return The packet, or nullptr if there isn't one.
+		 */
+		virtual ENetPacket* receive(ENetPeer& peer, enet_uint8& channel) = 0;
+
+		/**
+		 * @brief Disconnects a peer.
+		 * @param peer The peer to disconnect.
+		 * @param data Data to send to the foreign host.
+		 * @param mode How the disconnection should happen.
+		 */
+		virtual void disconnect(ENetPeer& peer, enet_uint32 data,
+		                        DisconnectMode mode) = 0;
+
+		virtual void ping(ENetPeer& peer)                                  = 0;
+		virtual void setPingInterval(ENetPeer& peer, time::ms interval)    = 0;
+		virtual void setThrottle(ENetPeer& peer, const Throttle& throttle) = 0;
+		virtual void setTimeout(ENetPeer& peer, const Timeout& timeout)    = 0;
+
+		virtual Bandwidth getBandwidthLimit() const                     = 0;
+		virtual void      setBandwidthLimit(const Bandwidth& bandwidth) = 0;
+
+		virtual std::size_t getChannelLimit() const            = 0;
+		virtual void        setChannelLimit(std::size_t limit) = 0;
+
+		virtual std::size_t getPeerCount() const = 0;
+		virtual std::size_t getPeerLimit() const = 0;
+
+		virtual enet_uint32 getTotalReceivedData() const = 0;
+		virtual enet_uint32 getTotalSentData() const     = 0;
+	};
+} // namespace phx::net
@@ -39,12 +39,16 @@ namespace phx
 {
 	struct PlayerView
 	{
+		/// How many chunks around the player are loaded in each direction.
+		static constexpr int DEFAULT_VIEW_DISTANCE = 3;
+
 		PlayerView(voxels::Map* map) : map(map) {}
 
 		std::vector<math::vec3> chunks;
 		voxels::Map*            map;
 
-		static std::vector<voxels::Chunk*> update(entt::registry* registry,
-		                                          entt::entity    entity);
+		static std::vector<voxels::Chunk*> update(
+		    entt::registry* registry, entt::entity entity,
+		    int viewDistance = DEFAULT_VIEW_DISTANCE);
 	};
 } // namespace phx
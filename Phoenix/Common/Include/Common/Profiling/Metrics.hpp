@@ -0,0 +1,281 @@
+// Copyright 2019-20 Genten Studios
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+// may be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace phx::profiling
+{
+	namespace detail
+	{
+		/// The number of copies of each counter and histogram, threads are
+		/// spread across them so they rarely write to the same cache line.
+		constexpr std::size_t METRIC_SHARDS = 16;
+
+		inline std::size_t getMetricShard()
+		{
+			static std::atomic<std::size_t> next {0};
+			thread_local const std::size_t  shard =
+			    next.fetch_add(1, std::memory_order_relaxed) % METRIC_SHARDS;
+			return shard;
+		}
+	} // namespace detail
+
+	/**
+	 * @brief A number that only ever goes up, such as bytes sent.
+	 */
+	class Counter
+	{
+	public:
+		void add(std::uint64_t value = 1)
+		{
+			m_shards[detail::getMetricShard()].value.fetch_add(
+			    value, std::memory_order_relaxed);
+		}
+
+		std::uint64_t get() const;
+
+	private:
+		struct alignas(64) Shard
+		{
+			std::atomic<std::uint64_t> value {0};
+		};
+
+		std::array<Shard, detail::METRIC_SHARDS> m_shards;
+	};
+
+	/**
+	 * @brief A number that goes up and down, such as a queue depth.
+	 *
+	 * Gauges are usually set from a single place, so they aren't sharded.
+	 */
+	class Gauge
+	{
+	public:
+		void set(double value)
+		{
+			m_value.store(value, std::memory_order_relaxed);
+		}
+
+		void add(double value);
+
+		double get() const { return m_value.load(std::memory_order_relaxed); }
+
+	private:
+		std::atomic<double> m_value {0.0};
+	};
+
+	/**
+	 * @brief Counts values into fixed buckets, such as tick durations.
+	 *
+	 * A value lands in the first bucket with an upper bound greater than or
+	 * equal to it, values above every bound land in an extra +Inf bucket.
+	 */
+	class Histogram
+	{
+	public:
+		struct Snapshot
+		{
+			/// The count of each bucket, not cumulative, with the +Inf bucket
+			/// last.
+			std::vector<std::uint64_t> buckets;
+			std::uint64_t              count = 0;
+			double                     sum   = 0.0;
+		};
+
+	public:
+		/**
+		 * @param bounds The upper bound of each bucket, in ascending order.
+		 */
+		explicit Histogram(std::vector<double> bounds);
+
+		void observe(double value);
+
+		Snapshot                   get() const;
+		const std::vector<double>& getBounds() const { return m_bounds; }
+
+		/**
+		 * @brief Gets bucket bounds suited to durations in seconds, from a
+		 * millisecond to a second.
+		 */
+		static std::vector<double> latencyBuckets();
+
+	private:
+		struct alignas(64) Shard
+		{
+			std::unique_ptr<std::atomic<std::uint64_t>[]> buckets;
+			std::atomic<double>                           sum {0.0};
+		};
+
+		std::vector<double>                      m_bounds;
+		std::array<Shard, detail::METRIC_SHARDS> m_shards;
+	};
+
+	/// Labels telling apart metrics of the same name, such as the peer a
+	/// round trip time is for.
+	using MetricLabels = std::vector<std::pair<std::string, std::string>>;
+
+	/**
+	 * @brief Keeps every metric in the process, so they can be exposed
+	 * together.
+	 *
+	 * Looking a metric up takes a lock, so callers keep a reference to it
+	 * rather than looking it up each time they update it. Metrics are never
+	 * destroyed unless removed, references to them stay valid for as long as
+	 * the process runs. Updating a metric is a relaxed atomic operation on a
+	 * shard picked by the calling thread, cheap enough to leave on all the
+	 * time.
+	 *
+	 * Names follow Prometheus conventions, phoenix_ followed by what is
+	 * measured and its unit, counters ending in _total.
+	 *
+	 * @paragraph Usage
+	 * @code
+	 * static profiling::Counter& sent = profiling::Metrics::get().counter(
+	 *     "phoenix_network_sent_bytes_total", "Bytes sent by the host.");
+	 * sent.add(packet.getSize());
+	 *
+	 * std::cout << profiling::Metrics::get().expose();
+	 * @endcode
+	 */
+	class Metrics
+	{
+	public:
+		static Metrics& get();
+
+		/**
+		 * @brief Gets a metric, registering it the first time it is asked
+		 * for.
+		 *
+		 * @param name The name of the metric.
+		 * @param help A sentence describing it, used the first time the name
+		 * is registered.
+		 * @param labels The labels of this particular metric.
+		 */
+		Counter& counter(const std::string& name, const std::string& help,
+		                 const MetricLabels& labels = {});
+		Gauge&   gauge(const std::string& name, const std::string& help,
+		               const MetricLabels& labels = {});
+		Histogram& histogram(const std::string& name, const std::string& help,
+		                     const std::vector<double>& bounds,
+		                     const MetricLabels& labels = {});
+
+		/**
+		 * @brief Removes a metric, such as one labelled with a peer that
+		 * disconnected. References to it must not be used afterwards.
+		 */
+		void remove(const std::string& name, const MetricLabels& labels);
+
+		/**
+		 * @brief Formats every metric in the Prometheus text format.
+		 */
+		std::string expose() const;
+
+	private:
+		enum class Type
+		{
+			COUNTER,
+			GAUGE,
+			HISTOGRAM
+		};
+
+		// every metric sharing a name, keyed by their formatted labels.
+		struct Family
+		{
+			Type        type;
+			std::string help;
+
+			std::map<std::string, std::unique_ptr<Counter>>   counters;
+			std::map<std::string, std::unique_ptr<Gauge>>     gauges;
+			std::map<std::string, std::unique_ptr<Histogram>> histograms;
+		};
+
+		Metrics() = default;
+
+		Family& getFamily(const std::string& name, const std::string& help,
+		                  Type type);
+
+	private:
+		mutable std::mutex            m_mutex;
+		std::map<std::string, Family> m_families;
+	};
+
+	struct MetricsConfig
+	{
+		/// Node exporter's textfile collector only reads files ending in
+		/// .prom.
+		std::string file = "Metrics.prom";
+
+		/// How often the file is rewritten.
+		std::chrono::milliseconds writeInterval {15000};
+	};
+
+	/**
+	 * @brief Periodically writes every metric to a file for a local node
+	 * exporter to scrape.
+	 *
+	 * The file is written next to its destination and renamed over it, so
+	 * the exporter never reads half a file.
+	 */
+	class MetricsWriter
+	{
+	public:
+		explicit MetricsWriter(const MetricsConfig& config);
+		~MetricsWriter();
+
+		MetricsWriter(const MetricsWriter&) = delete;
+		MetricsWriter& operator=(const MetricsWriter&) = delete;
+
+		void write();
+
+	private:
+		void writeThreadHandle();
+
+	private:
+		std::string               m_file;
+		std::chrono::milliseconds m_writeInterval;
+
+		bool                    m_running = true;
+		std::mutex              m_mutex;
+		std::condition_variable m_cond;
+		std::thread             m_worker;
+	};
+} // namespace phx::profiling
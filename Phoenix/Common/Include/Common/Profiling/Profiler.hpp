@@ -0,0 +1,184 @@
+// Copyright 2019-20 Genten Studios
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+// may be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#define PHX_PROFILE_CONCAT_INTERNAL(a, b) a##b
+#define PHX_PROFILE_CONCAT(a, b) PHX_PROFILE_CONCAT_INTERNAL(a, b)
+
+/**
+ * @brief Times the rest of the current scope as a zone in the profiler.
+ *
+ * @param name A string literal naming the zone.
+ */
+#define PHX_PROFILE_SCOPE(name)                                       \
+	phx::profiling::ProfileScope PHX_PROFILE_CONCAT(phxProfileScope, \
+	                                                __LINE__)(name)
+
+namespace phx::profiling
+{
+	/**
+	 * @brief The statistics of a single zone on a single thread.
+	 *
+	 * Zones are identified by their name and the zone they were entered
+	 * from, so the same name can show up in several places of the tree.
+	 */
+	struct ZoneStatistics
+	{
+		const char* name;
+
+		/// How deep the zone is nested, zones entered outside of any other
+		/// zone have a depth of 0.
+		std::size_t depth;
+
+		/// The number of times the zone was entered in the last frame.
+		std::size_t calls;
+
+		/// The time spent in the zone in the last frame, in milliseconds.
+		double total;
+
+		/// The average time spent in the zone per frame over recent frames,
+		/// in milliseconds.
+		double average;
+
+		/// The longest and 99th percentile single call to the zone over
+		/// recent calls, in milliseconds.
+		double max;
+		double p99;
+	};
+
+	/**
+	 * @brief The zones of a single thread, in depth first order.
+	 */
+	struct ThreadStatistics
+	{
+		std::string                 name;
+		std::size_t                 frames;
+		std::vector<ZoneStatistics> zones;
+	};
+
+	/**
+	 * @brief Aggregates the time spent in named zones, per thread.
+	 *
+	 * Each thread keeps its own stack and tree of zones, so entering and
+	 * leaving a zone never takes a lock. Every thread doing regular work
+	 * calls endFrame once per frame, tick or poll, which publishes its
+	 * statistics for that frame to be read from other threads.
+	 *
+	 * @paragraph Usage
+	 * @code
+	 * Profiler::setThreadName("Game");
+	 * while (running)
+	 * {
+	 *     {
+	 *         PHX_PROFILE_SCOPE("Game::tick");
+	 *         // ...
+	 *     }
+	 *
+	 *     Profiler::endFrame();
+	 * }
+	 *
+	 * // from any thread.
+	 * std::cout << Profiler::report();
+	 * @endcode
+	 */
+	class Profiler
+	{
+	public:
+		/// The number of frames averaged over.
+		static constexpr std::size_t FRAME_WINDOW = 120;
+
+		/// The number of calls to each zone the max and p99 come from.
+		static constexpr std::size_t CALL_WINDOW = 256;
+
+	public:
+		/**
+		 * @brief Turns profiling on or off for every thread, it is on by
+		 * default.
+		 */
+		static void setEnabled(bool enabled);
+		static bool isEnabled();
+
+		/**
+		 * @brief Names the calling thread in the statistics.
+		 */
+		static void setThreadName(const std::string& name);
+
+		/**
+		 * @brief Enters a zone on the calling thread.
+		 * @param name The name of the zone, this must be a string literal.
+		 */
+		static void beginZone(const char* name);
+
+		/**
+		 * @brief Leaves the zone entered last on the calling thread.
+		 * @param nanoseconds How long was spent in the zone.
+		 */
+		static void endZone(std::uint64_t nanoseconds);
+
+		/**
+		 * @brief Finishes a frame on the calling thread and publishes its
+		 * statistics.
+		 */
+		static void endFrame();
+
+		/**
+		 * @brief Gets the statistics of the last finished frame on every
+		 * thread.
+		 */
+		static std::vector<ThreadStatistics> getStatistics();
+
+		/**
+		 * @brief Formats the statistics of every thread as a text table.
+		 */
+		static std::string report();
+	};
+
+	/**
+	 * @brief Times a zone for its own lifetime, use PHX_PROFILE_SCOPE rather
+	 * than creating these by hand.
+	 */
+	class ProfileScope
+	{
+	public:
+		explicit ProfileScope(const char* name);
+		~ProfileScope();
+
+		ProfileScope(const ProfileScope&) = delete;
+		ProfileScope& operator=(const ProfileScope&) = delete;
+
+	private:
+		bool          m_active;
+		std::uint64_t m_start = 0;
+	};
+} // namespace phx::profiling
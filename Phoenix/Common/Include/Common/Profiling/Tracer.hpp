@@ -0,0 +1,310 @@
+// Copyright 2019-20 Genten Studios
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+// may be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#define PHX_TRACE_CONCAT_INTERNAL(a, b) a##b
+#define PHX_TRACE_CONCAT(a, b) PHX_TRACE_CONCAT_INTERNAL(a, b)
+
+/**
+ * @brief Records the time spent in the rest of the current scope.
+ *
+ * @param category The phx::profiling::TraceCategory of the event.
+ * @param name A string literal naming the event.
+ */
+#define PHX_TRACE_SCOPE(category, name)                                  \
+	phx::profiling::TraceScope PHX_TRACE_CONCAT(phxTraceScope, __LINE__)( \
+	    phx::profiling::TraceCategory::category, name)
+
+/**
+ * @brief Records a single point in time, with a value attached.
+ *
+ * @param category The phx::profiling::TraceCategory of the event.
+ * @param name A string literal naming the event.
+ * @param value A number to attach to the event, such as a packet size.
+ */
+#define PHX_TRACE_EVENT(category, name, value)             \
+	if (phx::profiling::Tracer::get() == nullptr)          \
+	{                                                      \
+		;                                                  \
+	}                                                      \
+	else                                                   \
+		phx::profiling::Tracer::get()->instant(            \
+		    phx::profiling::TraceCategory::category, name, \
+		    static_cast<std::int64_t>(value))
+
+namespace phx::profiling
+{
+	/**
+	 * @brief What a trace event is about, used to filter and color them.
+	 */
+	enum class TraceCategory : std::uint8_t
+	{
+		TICK,
+		PACKET,
+		CHUNK,
+		MESH,
+		LUA,
+		OTHER
+	};
+
+	/**
+	 * @brief What kind of trace event it is.
+	 */
+	enum class TracePhase : std::uint8_t
+	{
+		/// Something that took time, the event has a duration.
+		COMPLETE,
+
+		/// A single point in time.
+		INSTANT,
+
+		/// A value changing over time, such as a queue depth.
+		COUNTER
+	};
+
+	/**
+	 * @brief A single recorded event.
+	 *
+	 * Names are stored as pointers, so they must be string literals or
+	 * otherwise outlive the tracer.
+	 */
+	struct TraceEvent
+	{
+		std::uint64_t timestamp; // nanoseconds since the tracer started.
+		std::uint64_t duration;  // nanoseconds, only for COMPLETE events.
+		std::int64_t  value;
+		const char*   name;
+		TraceCategory category;
+		TracePhase    phase;
+	};
+
+	struct TracerConfig
+	{
+		std::string file = "Trace.phxtrace";
+
+		/// The number of events each thread buffers before handing them to
+		/// the tracer to be written.
+		std::size_t bufferSize = 16384;
+
+		/// How often buffered events are written to the file.
+		std::chrono::milliseconds flushInterval {1000};
+	};
+
+	/**
+	 * @brief Records timestamped events from any thread into a binary file.
+	 *
+	 * Every thread records into its own buffer without locking, full buffers
+	 * are written out by a background thread. The file can be turned into
+	 * Chrome trace-event JSON (chrome://tracing, Perfetto or Speedscope)
+	 * with PhoenixTraceConverter.
+	 *
+	 * @paragraph Usage
+	 * @code
+	 * profiling::Tracer::initialize({"Lag.phxtrace"});
+	 * profiling::Tracer::get()->setThreadName("Game");
+	 *
+	 * {
+	 *     PHX_TRACE_SCOPE(TICK, "Game::tick");
+	 *     PHX_TRACE_EVENT(PACKET, "Received", packet.getSize());
+	 * }
+	 *
+	 * profiling::Tracer::teardown();
+	 * @endcode
+	 *
+	 * @paragraph Format
+	 * The file starts with the 8 bytes "PHXTRACE" and a 32 bit version,
+	 * followed by records written with the Serializer. Each record starts
+	 * with a byte giving its type: a string (32 bit id, string), a thread
+	 * name (32 bit thread, string) or an event (category byte, phase byte, 32
+	 * bit thread, 32 bit string id, 64 bit timestamp, duration and value).
+	 * Strings are always written before the first event using them.
+	 */
+	class Tracer
+	{
+	public:
+		static constexpr std::uint32_t VERSION = 1;
+
+		enum class Record : std::uint8_t
+		{
+			STRING = 0,
+			THREAD = 1,
+			EVENT  = 2
+		};
+
+	public:
+		static void initialize(const TracerConfig& config);
+		static void teardown();
+
+		static Tracer* get() { return m_instance; }
+
+		/**
+		 * @brief Gets the time used to timestamp events.
+		 * @return Nanoseconds since the tracer started.
+		 */
+		std::uint64_t now() const;
+
+		/**
+		 * @brief Names the calling thread in the trace.
+		 * @param name The name to show for the thread.
+		 */
+		void setThreadName(const std::string& name);
+
+		/**
+		 * @brief Records an event on the calling thread.
+		 */
+		void record(TraceCategory category, TracePhase phase, const char* name,
+		            std::uint64_t timestamp, std::uint64_t duration,
+		            std::int64_t value);
+
+		void instant(TraceCategory category, const char* name,
+		             std::int64_t value = 0);
+		void counter(TraceCategory category, const char* name,
+		             std::int64_t value);
+
+		/**
+		 * @brief Writes every event recorded so far to the file.
+		 */
+		void flush();
+
+	private:
+		/**
+		 * @brief The events recorded by a single thread.
+		 *
+		 * Only the owning thread writes events, it publishes them through
+		 * size. The tracer reads them under its mutex and the owning thread
+		 * only takes that mutex when the buffer is full.
+		 */
+		struct ThreadBuffer
+		{
+			std::uint32_t                 thread;
+			std::string                   name;
+			bool                          nameWritten = false;
+			std::unique_ptr<TraceEvent[]> events;
+			std::atomic<std::size_t>      size {0};
+			std::size_t                   flushed = 0;
+		};
+
+		explicit Tracer(const TracerConfig& config);
+		~Tracer();
+
+		ThreadBuffer& getThreadBuffer();
+		void          retire(ThreadBuffer& buffer);
+
+		void write(std::uint32_t thread, const TraceEvent* events,
+		           std::size_t count);
+		void writeThreadName(ThreadBuffer& buffer);
+
+		void flushThreadHandle();
+
+		static Tracer* m_instance;
+
+	private:
+		std::size_t                           m_bufferSize;
+		std::chrono::milliseconds             m_flushInterval;
+		std::chrono::steady_clock::time_point m_start;
+
+		// a unique id for each tracer, so buffers cached by a thread for a
+		// previous tracer aren't reused.
+		std::uint64_t                     m_id;
+		static std::atomic<std::uint64_t> m_nextID;
+
+		std::mutex                                 m_mutex;
+		std::vector<std::unique_ptr<ThreadBuffer>> m_threads;
+
+		// full buffers waiting to be written.
+		struct RetiredBuffer
+		{
+			std::uint32_t                 thread;
+			std::unique_ptr<TraceEvent[]> events;
+			std::size_t                   begin;
+			std::size_t                   end;
+		};
+
+		std::vector<RetiredBuffer> m_retired;
+
+		std::unordered_map<const char*, std::uint32_t> m_strings;
+		std::ofstream                                  m_file;
+
+		bool                    m_running = true;
+		std::condition_variable m_cond;
+		std::thread             m_worker;
+	};
+
+	/**
+	 * @brief Records a COMPLETE event covering its own lifetime.
+	 *
+	 * This does nothing if no tracer is running, use PHX_TRACE_SCOPE rather
+	 * than creating these by hand. Threads must stop recording before the
+	 * tracer is torn down.
+	 */
+	class TraceScope
+	{
+	public:
+		TraceScope(TraceCategory category, const char* name)
+		    : m_tracer(Tracer::get()), m_name(name), m_category(category)
+		{
+			if (m_tracer != nullptr)
+			{
+				m_start = m_tracer->now();
+			}
+		}
+
+		~TraceScope()
+		{
+			if (m_tracer != nullptr)
+			{
+				const std::uint64_t end = m_tracer->now();
+				m_tracer->record(m_category, TracePhase::COMPLETE, m_name,
+				                 m_start, end - m_start, 0);
+			}
+		}
+
+		TraceScope(const TraceScope&) = delete;
+		TraceScope& operator=(const TraceScope&) = delete;
+
+	private:
+		Tracer*       m_tracer;
+		const char*   m_name;
+		TraceCategory m_category;
+		std::uint64_t m_start = 0;
+	};
+} // namespace phx::profiling
@@ -28,7 +28,11 @@
 
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <limits>
 #include <unordered_map>
+#include <vector>
 
 namespace phx
 {
@@ -92,4 +96,109 @@ namespace phx
 
 		Value* m_unknownValueReturnVal = nullptr;
 	};
+
+	/**
+	 * @brief A registry for small, densely packed integer keys.
+	 *
+	 * Values are stored contiguously and indexed directly by their key, so a
+	 * lookup is a bounds check and an array read rather than a hash. This
+	 * suits IDs handed out in order, such as block IDs, where there are few
+	 * or no gaps between keys.
+	 *
+	 * Like any vector, adding a value past the end may move the others, so
+	 * pointers returned by get are only stable once everything has been
+	 * added. The unknown value is therefore stored as a key rather than a
+	 * pointer.
+	 *
+	 * @paragraph Usage
+	 * @code
+	 * DenseRegistry<BlockType> blocks;
+	 * blocks.add(BlockType::UNKNOWN_BLOCK, unknown);
+	 * blocks.setUnknownReturnKey(BlockType::UNKNOWN_BLOCK);
+	 *
+	 * // returns the unknown block, since 1000 was never added.
+	 * BlockType* block = blocks.get(1000);
+	 * @endcode
+	 */
+	template <typename Value>
+	class DenseRegistry
+	{
+	public:
+		using Key = std::size_t;
+
+		static constexpr Key INVALID_KEY = std::numeric_limits<Key>::max();
+
+	public:
+		DenseRegistry()  = default;
+		~DenseRegistry() = default;
+
+		void add(Key key, const Value& value)
+		{
+			if (key >= m_values.size())
+			{
+				m_values.resize(key + 1);
+				m_present.resize(key + 1, 0);
+			}
+
+			m_size += m_present[key] == 0 ? 1 : 0;
+
+			m_values[key]  = value;
+			m_present[key] = 1;
+		}
+
+		const Value* get(Key key) const
+		{
+			if (key < m_values.size() && m_present[key] != 0)
+			{
+				return &m_values[key];
+			}
+
+			return getUnknown();
+		}
+
+		Value* get(Key key)
+		{
+			return const_cast<Value*>(
+			    static_cast<const DenseRegistry*>(this)->get(key));
+		}
+
+		bool contains(Key key) const
+		{
+			return key < m_values.size() && m_present[key] != 0;
+		}
+
+		// use this to return the value at a specific key if not found in the
+		// registry. will otherwise return nullptr.
+		void setUnknownReturnKey(Key key) { m_unknownKey = key; }
+
+		void reserve(std::size_t size)
+		{
+			m_values.reserve(size);
+			m_present.reserve(size);
+		}
+
+		/// @brief The largest key added plus one, keys below this can be
+		/// iterated over with contains and get.
+		std::size_t capacity() const { return m_values.size(); }
+		std::size_t size() const { return m_size; }
+		bool        empty() const { return m_size == 0; }
+
+	private:
+		const Value* getUnknown() const
+		{
+			if (m_unknownKey < m_values.size() && m_present[m_unknownKey] != 0)
+			{
+				return &m_values[m_unknownKey];
+			}
+
+			return nullptr;
+		}
+
+	private:
+		std::vector<Value>        m_values;
+		std::vector<std::uint8_t> m_present;
+		std::size_t               m_size = 0;
+
+		Key m_unknownKey = INVALID_KEY;
+	};
 } // namespace phx
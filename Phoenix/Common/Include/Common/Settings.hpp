@@ -168,6 +168,22 @@ namespace phx
 		Setting* add(const std::string& name, const std::string& key,
 		             int defaultValue);
 
+		/**
+		 * @brief Adds a new setting with its own limits.
+		 *
+		 * @param name Human readable name for setting.
+		 * @param key Unique Name for key ex: core:volume.
+		 * @param defaultValue The value the setting will be initially set to.
+		 * @param minValue The minimum value the setting can be.
+		 * @param maxValue The maximum value the setting can be.
+		 * @return Setting* A pointer to the setting object.
+		 *
+		 * @note The limits are in place before a loaded value is applied, so
+		 * values outside the default short range can be read from file.
+		 */
+		Setting* add(const std::string& name, const std::string& key,
+		             int defaultValue, int minValue, int maxValue);
+
 		/**
 		 * @brief Get the Setting object.
 		 *
@@ -28,6 +28,7 @@
 
 #pragma once
 
+#include <Common/Profiling/Metrics.hpp>
 #include <Common/Utility/Internal/Front.hpp>
 
 #include <atomic>
@@ -72,6 +73,7 @@ namespace phx
 		{
 			std::lock_guard<std::mutex> lock(m_mutex);
 			Container::c.clear();
+			updateDepth();
 		}
 
 		/**
@@ -129,6 +131,7 @@ namespace phx
 				T value =
 				    phx::front<Container>(*this); // for std::priority_queue
 				Container::pop();
+				updateDepth();
 				if (validator(value))
 				{
 					return value;
@@ -149,6 +152,7 @@ namespace phx
 			}
 			_value = std::move(phx::front<Container>(*this));
 			Container::pop();
+			updateDepth();
 			return true;
 		}
 
@@ -170,6 +174,7 @@ namespace phx
 				unlock = true;
 			}
 			Container::push(value);
+			updateDepth();
 			if (unlock)
 			{
 				m_cond.notify_one();
@@ -188,6 +193,7 @@ namespace phx
 				unlock = true;
 			}
 			Container::push(std::move(value));
+			updateDepth();
 			if (unlock)
 			{
 				m_cond.notify_one();
@@ -208,6 +214,7 @@ namespace phx
 				unlock = true;
 			}
 			Container::emplace(std::forward(args)...);
+			updateDepth();
 			if (unlock)
 			{
 				m_cond.notify_one();
@@ -268,6 +275,18 @@ namespace phx
 			return *this;
 		}
 
+		/**
+		 * @brief Keeps a gauge set to the number of elements in the queue.
+		 *
+		 * @param gauge The gauge to set, or nullptr to stop.
+		 */
+		void trackDepth(profiling::Gauge* gauge)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_depthGauge = gauge;
+			updateDepth();
+		}
+
 		void lock() const { m_mutex.lock(); }
 
 		void unlock() const { m_mutex.unlock(); }
@@ -275,10 +294,21 @@ namespace phx
 	protected:
 		mutable std::mutex m_mutex;
 
+	private:
+		// must be called with the mutex held.
+		void updateDepth()
+		{
+			if (m_depthGauge != nullptr)
+			{
+				m_depthGauge->set(static_cast<double>(Container::size()));
+			}
+		}
+
 	private:
 		std::condition_variable m_cond;
 		std::atomic<bool>       m_done = false;
 		Validator               validator;
+		profiling::Gauge*       m_depthGauge = nullptr;
 	};
 	template <typename T, typename Validator, class Compare,
 	          typename Container = std::vector<T>>
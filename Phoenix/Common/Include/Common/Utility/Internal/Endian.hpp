@@ -33,6 +33,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 
 // for potential GCC defines.
 #include <limits.h>
@@ -221,6 +222,31 @@ namespace phx::data::endian
 			}
 		};
 
+		// unsigned integers of each size, so arrays of anything can be swapped
+		// without caring whether it's a float or not.
+		template <std::size_t N>
+		struct UnsignedOfSize
+		{
+		};
+
+		template <>
+		struct UnsignedOfSize<2>
+		{
+			using type = std::uint16_t;
+		};
+
+		template <>
+		struct UnsignedOfSize<4>
+		{
+			using type = std::uint32_t;
+		};
+
+		template <>
+		struct UnsignedOfSize<8>
+		{
+			using type = std::uint64_t;
+		};
+
 		// anything bigger than 8 is bigger than 64bits and if we're there we've
 		// fucked up already.
 		template <>
@@ -281,4 +307,34 @@ namespace phx::data::endian
 
 		return t;
 	}
+
+	/**
+	 * @brief Swaps the endianness of a packed array in place, between host
+	 * and network order.
+	 * @tparam T The type of the elements. (must be integral or floating point)
+	 * @param data The first byte of the array, this does not need to be
+	 * aligned.
+	 * @param count The number of elements in the array.
+	 *
+	 * This does nothing if the host already uses network order. The loop is
+	 * kept simple enough for the compiler to vectorize it.
+	 */
+	template <typename T,
+	          typename U =
+	              std::enable_if_t<detail::IsEndianChangable<T>::value, void>>
+	void swapArray(std::byte* data, std::size_t count)
+	{
+		if constexpr (Endian::NATIVE != Endian::NET && sizeof(T) > 1)
+		{
+			using Unsigned = typename detail::UnsignedOfSize<sizeof(T)>::type;
+
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				Unsigned value;
+				std::memcpy(&value, data + i * sizeof(T), sizeof(T));
+				value = detail::ByteSwapper<sizeof(T)>()(value);
+				std::memcpy(data + i * sizeof(T), &value, sizeof(T));
+			}
+		}
+	}
 } // namespace phx::data::endian
@@ -31,10 +31,13 @@
 #include <Common/Utility/Internal/Endian.hpp>
 #include <Common/Utility/Internal/SharedTypes.hpp>
 
+#include <algorithm>
 #include <cstddef>
+#include <cstdint>
 #include <vector>
 #include <string>
 #include <cstring>
+#include <type_traits>
 
 #if defined(__APPLE__)
 #	define PHX_INT32_EQUAL_LONG
@@ -62,6 +65,33 @@ namespace phx
 		virtual Serializer& operator<<(Serializer& serializer) = 0;
 	};
 
+	/**
+	 * @brief Marks an integer to be serialized as a variable length integer.
+	 *
+	 * Unsigned integers are written as LEB128, 7 bits per byte with the top
+	 * bit set while there are more bytes to come. Signed integers are zigzag
+	 * encoded first so small negative numbers stay small. Use the varint
+	 * helper to create one:
+	 * @code
+	 * ser << varint(count) << varint(offset);
+	 * ser >> varint(count) >> varint(offset);
+	 * @endcode
+	 */
+	template <typename T>
+	struct Varint
+	{
+		static_assert(std::is_integral_v<std::remove_const_t<T>>,
+		              "Only integers can be written as varints.");
+
+		T& value;
+	};
+
+	template <typename T>
+	Varint<T> varint(T& value)
+	{
+		return {value};
+	}
+
 	/**
 	 * @brief Serializes data with Endianness correction for network transfer.
 	 *
@@ -115,7 +145,7 @@ namespace phx
 	 * Packet packet = receive_packet();
 	 *
 	 * Serializer ser(Serializer::Mode::READ)
-	 * ser.setBuffer(packet.getData());
+	 * ser.borrowBuffer(packet.getRawData(), packet.getSize());
 	 * ser & status & moving & wowee & sequence;
 	 *
 	 * // status, moving, wowee and sequence will be equal to their client
@@ -135,9 +165,20 @@ namespace phx
 		Serializer() = default;
 
 		data::Data& getBuffer() { return m_buffer; }
-		void  setBuffer(std::byte* data, std::size_t dataLength);
-		void  setBuffer(const data::Data& data) { m_buffer = data; }
-		void  setBuffer(data::Data&& data) { m_buffer = std::move(data); }
+		void  setBuffer(const std::byte* data, std::size_t dataLength);
+		void  setBuffer(const data::Data& data);
+		void  setBuffer(data::Data&& data);
+
+		/**
+		 * @brief Reads from a buffer the serializer doesn't own.
+		 * @param data The data to read from.
+		 * @param dataLength The size of the data.
+		 *
+		 * No copy is made, so the data must outlive any reads done with this
+		 * serializer. This is intended for reading straight out of a received
+		 * packet, see Packet::getRawData.
+		 */
+		void borrowBuffer(const std::byte* data, std::size_t dataLength);
 
 		Serializer& operator<<(bool val);
 		Serializer& operator<<(char val);
@@ -182,7 +223,60 @@ namespace phx
 		
 		template <typename T>
 		Serializer& operator>>(std::basic_string<T>& val);
-		
+
+		template <typename T>
+		Serializer& operator<<(Varint<T> val);
+
+		template <typename T>
+		Serializer& operator>>(Varint<T> val);
+
+		/**
+		 * @brief Reserves space in the buffer ahead of writing.
+		 * @param bytes The number of bytes about to be written.
+		 *
+		 * This is only a hint, writing more than this is fine. Use it when
+		 * the size of what is being written is known up front to avoid the
+		 * buffer growing several times.
+		 */
+		void reserve(std::size_t bytes);
+
+		/**
+		 * @brief Writes an integer as a variable length integer.
+		 * @param value The value to write.
+		 */
+		template <typename T>
+		void writeVarint(T value);
+
+		/**
+		 * @brief Reads a variable length integer.
+		 * @param value The value to read into, left untouched if the buffer
+		 * runs out.
+		 */
+		template <typename T>
+		void readVarint(T& value);
+
+		/**
+		 * @brief Writes a contiguous array of integers or floating points.
+		 * @param data The first element of the array.
+		 * @param count The number of elements to write.
+		 *
+		 * The array is copied in one go and only byte swapped if the host
+		 * doesn't use network order. The count isn't written, so either write
+		 * it first or make sure the reader knows it.
+		 */
+		template <typename T>
+		void writeArray(const T* data, std::size_t count);
+
+		/**
+		 * @brief Reads a contiguous array of integers or floating points.
+		 * @param data The array to read into.
+		 * @param count The number of elements to read.
+		 * @return The number of elements read, less than count if the buffer
+		 * runs out.
+		 */
+		template <typename T>
+		std::size_t readArray(T* data, std::size_t count);
+
 	private:
 		template <typename T>
 		void push(const T& data);
@@ -196,11 +290,20 @@ namespace phx
 		template <typename T>
 		void pop(std::basic_string<T>& data);
 
+		const std::byte* readData() const;
+		std::size_t      readSize() const;
+
 	public:
 		Mode m_mode;
 
 	private:
 		data::Data m_buffer;
+
+		// reads work through a cursor rather than erasing the front of the
+		// buffer, the borrowed pointer is used instead of m_buffer if set.
+		const std::byte* m_borrowed     = nullptr;
+		std::size_t      m_borrowedSize = 0;
+		std::size_t      m_readPos      = 0;
 	};
 } // namespace phx::data
 
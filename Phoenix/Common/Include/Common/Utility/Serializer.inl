@@ -28,10 +28,45 @@
 
 namespace phx
 {
-	inline void Serializer::setBuffer(std::byte* data, std::size_t dataLength)
+	inline void Serializer::setBuffer(const std::byte* data,
+	                                  std::size_t      dataLength)
+	{
+		m_buffer.assign(data, data + dataLength);
+		m_borrowed = nullptr;
+		m_readPos  = 0;
+	}
+
+	inline void Serializer::setBuffer(const data::Data& data)
+	{
+		m_buffer   = data;
+		m_borrowed = nullptr;
+		m_readPos  = 0;
+	}
+
+	inline void Serializer::setBuffer(data::Data&& data)
+	{
+		m_buffer   = std::move(data);
+		m_borrowed = nullptr;
+		m_readPos  = 0;
+	}
+
+	inline void Serializer::borrowBuffer(const std::byte* data,
+	                                     std::size_t      dataLength)
 	{
 		m_buffer.clear();
-		m_buffer.insert(m_buffer.begin(), data, data + dataLength);
+		m_borrowed     = data;
+		m_borrowedSize = dataLength;
+		m_readPos      = 0;
+	}
+
+	inline const std::byte* Serializer::readData() const
+	{
+		return m_borrowed != nullptr ? m_borrowed : m_buffer.data();
+	}
+
+	inline std::size_t Serializer::readSize() const
+	{
+		return m_borrowed != nullptr ? m_borrowedSize : m_buffer.size();
 	}
 
 	inline Serializer& Serializer::operator<<(bool val)
@@ -221,29 +256,160 @@ namespace phx
 	}
 
 	template <typename T>
-	void Serializer::push(const T& data)
+	Serializer& Serializer::operator<<(Varint<T> val)
 	{
-		union
+		writeVarint(val.value);
+		return *this;
+	}
+
+	template <typename T>
+	Serializer& Serializer::operator>>(Varint<T> val)
+	{
+		readVarint(val.value);
+		return *this;
+	}
+
+	inline void Serializer::reserve(std::size_t bytes)
+	{
+		m_buffer.reserve(m_buffer.size() + bytes);
+	}
+
+	template <typename T>
+	void Serializer::writeVarint(T value)
+	{
+		static_assert(std::is_integral_v<T>,
+		              "Only integers can be written as varints.");
+
+		using Unsigned = std::make_unsigned_t<T>;
+
+		Unsigned bits = static_cast<Unsigned>(value);
+		if constexpr (std::is_signed_v<T>)
 		{
-			std::byte bytes[sizeof(T)];
-			T         value;
-		} value;
+			// zigzag: 0, -1, 1, -2, 2... become 0, 1, 2, 3, 4...
+			bits = static_cast<Unsigned>(static_cast<Unsigned>(bits << 1) ^
+			                             static_cast<Unsigned>(value < 0 ? -1 : 0));
+		}
 
-		value.value = data::endian::swapForNetwork(data);
+		std::byte bytes[(sizeof(T) * 8 + 6) / 7];
+		std::size_t size = 0;
+		do
+		{
+			auto byte = static_cast<std::uint8_t>(bits & 0x7F);
+			bits      = static_cast<Unsigned>(bits >> 7);
+			if (bits != 0)
+			{
+				byte |= 0x80;
+			}
 
-		for (std::size_t i = 0; i < sizeof(T); ++i)
+			bytes[size++] = std::byte(byte);
+		} while (bits != 0);
+
+		m_buffer.insert(m_buffer.end(), bytes, bytes + size);
+	}
+
+	template <typename T>
+	void Serializer::readVarint(T& value)
+	{
+		static_assert(std::is_integral_v<T>,
+		              "Only integers can be read as varints.");
+
+		using Unsigned = std::make_unsigned_t<T>;
+
+		const std::byte*  data  = readData();
+		const std::size_t size  = readSize();
+		Unsigned          bits  = 0;
+		unsigned int      shift = 0;
+
+		while (true)
 		{
-			m_buffer.push_back(value.bytes[i]);
+			if (m_readPos >= size)
+			{
+				// ran out of data halfway through, leave the value untouched.
+				return;
+			}
+
+			const auto byte = std::to_integer<std::uint8_t>(data[m_readPos++]);
+			if (shift < sizeof(T) * 8)
+			{
+				bits |= static_cast<Unsigned>(static_cast<Unsigned>(byte & 0x7F)
+				                              << shift);
+			}
+
+			shift += 7;
+			if ((byte & 0x80) == 0)
+			{
+				break;
+			}
+		}
+
+		if constexpr (std::is_signed_v<T>)
+		{
+			value = static_cast<T>(static_cast<Unsigned>(bits >> 1) ^
+			                       static_cast<Unsigned>(-(bits & 1)));
+		}
+		else
+		{
+			value = bits;
+		}
+	}
+
+	template <typename T>
+	void Serializer::writeArray(const T* data, std::size_t count)
+	{
+		static_assert(data::endian::detail::IsEndianChangable<T>::value,
+		              "Only integers and floating points can be written as "
+		              "arrays.");
+
+		if (count == 0)
+		{
+			return;
+		}
+
+		const std::size_t prevEnd = m_buffer.size();
+		m_buffer.resize(prevEnd + count * sizeof(T));
+
+		std::memcpy(m_buffer.data() + prevEnd, data, count * sizeof(T));
+		data::endian::swapArray<T>(m_buffer.data() + prevEnd, count);
+	}
+
+	template <typename T>
+	std::size_t Serializer::readArray(T* data, std::size_t count)
+	{
+		static_assert(data::endian::detail::IsEndianChangable<T>::value,
+		              "Only integers and floating points can be read as "
+		              "arrays.");
+
+		count = std::min(count, (readSize() - m_readPos) / sizeof(T));
+		if (count == 0)
+		{
+			return 0;
 		}
+
+		std::memcpy(data, readData() + m_readPos, count * sizeof(T));
+		m_readPos += count * sizeof(T);
+
+		data::endian::swapArray<T>(reinterpret_cast<std::byte*>(data), count);
+
+		return count;
+	}
+
+	template <typename T>
+	void Serializer::push(const T& data)
+	{
+		const T value = data::endian::swapForNetwork(data);
+
+		const std::size_t prevEnd = m_buffer.size();
+		m_buffer.resize(prevEnd + sizeof(T));
+		std::memcpy(m_buffer.data() + prevEnd, &value, sizeof(T));
 	}
 
 	template <typename T>
 	void Serializer::push(const std::basic_string<T>& data)
 	{
-		// if T is the same as the number of bits in a char, it's a normal
-		// std::string. This means that there is only 1 byte per character and
-		// so you don't need to factor in any endianness changes.
-		if constexpr (sizeof(T) == CHAR_BIT)
+		// if T is a single byte, it's a normal std::string. This means that
+		// there is only 1 byte per character and so you don't need to factor
+		// in any endianness changes.
+		if constexpr (sizeof(T) == 1)
 		{
 			// this is faster than iterating through every character and
 			// swapping endianness and essentially doing an unnecessary
@@ -258,12 +424,16 @@ namespace phx
 			// than the new end.
 			const std::size_t prevEnd = m_buffer.size();
 
-			// +1 for null terminator.
-			m_buffer.resize(m_buffer.size() + data.length() + 1);
+			// no null terminator, the length is already written and the
+			// reader doesn't expect one.
+			m_buffer.resize(m_buffer.size() + data.length());
 
-			// convert string to array of std::byte and append to data array.
-			std::transform(data.begin(), data.end(), m_buffer.begin() + prevEnd,
-			               [](char c) { return std::byte(c); });
+			// copy the characters straight into the data array.
+			if (!data.empty())
+			{
+				std::memcpy(m_buffer.data() + prevEnd, data.data(),
+				            data.length());
+			}
 		}
 		else
 		{
@@ -272,10 +442,7 @@ namespace phx
 			// the standard library, them being 16bit and 32bit character
 			// strings.
 			push(static_cast<unsigned int>(data.length()));
-			for (auto c : data)
-			{
-				push(c);
-			}
+			writeArray(data.data(), data.length());
 		}
 	}
 
@@ -288,10 +455,15 @@ namespace phx
 			T         value;
 		} value;
 
-		std::memcpy(value.bytes, m_buffer.data(), sizeof(T));
+		if (m_readPos + sizeof(T) > readSize())
+		{
+			// not enough data left, leave the value untouched.
+			m_readPos = readSize();
+			return;
+		}
 
-		// basically pop front for the amount of bytes of data we're taking.
-		m_buffer.erase(m_buffer.begin(), m_buffer.begin() + sizeof(T));
+		std::memcpy(value.bytes, readData() + m_readPos, sizeof(T));
+		m_readPos += sizeof(T);
 
 		data = data::endian::swapForHost(value.value);
 	}
@@ -299,38 +471,31 @@ namespace phx
 	template <typename T>
 	void Serializer::pop(std::basic_string<T>& data)
 	{
-		if constexpr (sizeof(T) == CHAR_BIT)
+		if constexpr (sizeof(T) == 1)
 		{
-			unsigned int size;
+			unsigned int size = 0;
 			pop(size);
 
-			data.resize(size);
+			size = static_cast<unsigned int>(
+			    std::min<std::size_t>(size, readSize() - m_readPos));
 
-			std::transform(m_buffer.begin(), m_buffer.begin() + size,
-			               data.begin(),
-			               [](std::byte byte) { return char(byte); });
+			data.resize(size);
+			if (size != 0)
+			{
+				std::memcpy(data.data(), readData() + m_readPos, size);
+			}
 
-			// basically pop front for the amount of bytes of data we're taking.
-			m_buffer.erase(m_buffer.begin(), m_buffer.begin() + size);
+			m_readPos += size;
 		}
 		else
 		{
-			union
-			{
-				std::byte bytes[sizeof(T)];
-				T         c;
-			} values;
-
-			unsigned int size;
+			unsigned int size = 0;
 			pop(size);
 
-			data.reserve(size);
-
-			for (unsigned int i = 0; i < size; ++i)
-			{
-				pop(values.c);
-				data.push_back(values.c);
-			}
+			// never trust the size more than the data that's actually left.
+			data.resize(std::min<std::size_t>(
+			    size, (readSize() - m_readPos) / sizeof(T)));
+			readArray(data.data(), data.size());
 		}
 	}
 } // namespace phx
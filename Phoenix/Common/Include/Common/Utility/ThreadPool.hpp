@@ -0,0 +1,121 @@
+// Copyright 2019-20 Genten Studios
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+// may be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace phx
+{
+	/**
+	 * @brief A fixed set of worker threads that split loops between them.
+	 *
+	 * Work is handed out one index at a time, so items that take different
+	 * amounts of time still balance out. The thread calling parallelFor works
+	 * through indices too rather than sitting idle, so a pool with no workers
+	 * just runs the loop on the calling thread.
+	 *
+	 * Only one loop runs at a time, further calls to parallelFor from other
+	 * threads wait for it to finish.
+	 *
+	 * @paragraph Usage
+	 * @code
+	 * ThreadPool pool(4, "Worldgen");
+	 *
+	 * pool.parallelFor(columns.size(), [&](std::size_t i) {
+	 *     generate(columns[i]);
+	 * });
+	 * @endcode
+	 */
+	class ThreadPool
+	{
+	public:
+		using Task = std::function<void(std::size_t)>;
+
+	public:
+		/**
+		 * @brief Starts the worker threads.
+		 * @param threads The number of workers, 0 uses one less than the
+		 * number of cores since the caller works too.
+		 * @param name The name of the workers in traces and the profiler,
+		 * each is suffixed with its index.
+		 */
+		explicit ThreadPool(std::size_t        threads = 0,
+		                    const std::string& name    = "Worker");
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		/**
+		 * @brief Gets the number of worker threads.
+		 * @return The number of workers, not counting callers.
+		 */
+		std::size_t getThreadCount() const { return m_workers.size(); }
+
+		/**
+		 * @brief Runs a task once for every index from 0 to count, spread
+		 * across the pool, and waits for all of them to finish.
+		 * @param count The number of indices.
+		 * @param task The task to run, it must be safe to run from several
+		 * threads at once.
+		 */
+		void parallelFor(std::size_t count, const Task& task);
+
+	private:
+		void workerThreadHandle(std::size_t index, const std::string& name);
+
+		// runs indices of the current task until there are none left.
+		void work();
+
+	private:
+		std::vector<std::thread> m_workers;
+
+		// held for the whole of a parallelFor.
+		std::mutex m_submitMutex;
+
+		std::mutex              m_mutex;
+		std::condition_variable m_wake;
+		std::condition_variable m_finished;
+
+		const Task*              m_task  = nullptr;
+		std::size_t              m_count = 0;
+		std::atomic<std::size_t> m_next {0};
+		std::size_t              m_active     = 0;
+		std::uint64_t            m_generation = 0;
+		bool                     m_stopping   = false;
+	};
+} // namespace phx
@@ -36,11 +36,13 @@
 
 #pragma once
 
+#include <Common/CMS/LuaProfiler.hpp>
 #include <Common/Math/Math.hpp>
 
 #include <sol/sol.hpp>
 
 #include <array>
+#include <cstdint>
 #include <functional>
 #include <string>
 
@@ -104,6 +106,9 @@ namespace phx::voxels
 		/// @brief The material state of the block.
 		BlockCategory category = BlockCategory::AIR;
 
+		/// @brief The light the block gives off, from 0 to 15.
+		std::uint8_t lightLevel = 0;
+
 		/// @brief Callback for when the block is placed.
 		BlockCallback onPlace;
 
@@ -113,6 +118,19 @@ namespace phx::voxels
 		/// @brief Callback for when the block is interacted with.
 		BlockCallback onInteract;
 
+		/// @brief Callback for when an update scheduled for the block runs.
+		BlockCallback onTick;
+
+		/// @brief Callback for when the block is picked for a random tick.
+		BlockCallback onRandomTick;
+
+		/// @brief Whether the block gets random ticks, set with onRandomTick.
+		bool ticksRandomly = false;
+
+		/// @brief The mod that registered the block, its callbacks are
+		/// accounted to it.
+		cms::LuaProfiler::ModID mod = cms::LuaProfiler::UNKNOWN_MOD;
+
 		/// @brief (temporary) a bitpacked color: rrrrggggbbbbaaaa (a letter = 1 bit)
 		unsigned color = 0b1111111111111111;
 
@@ -92,13 +92,13 @@ namespace phx::voxels
 			// a tiny bit hacky but solves a lot of problems without writing a
 			// bunch of unnecessary code.
 			referrer.setUnknownReturnVal(referrer.get("core.unknown"));
-			blocks.setUnknownReturnVal(
-			    blocks.get(voxels::BlockType::UNKNOWN_BLOCK));
+			blocks.setUnknownReturnKey(voxels::BlockType::UNKNOWN_BLOCK);
 		}
 
 		// referrer refers a string to int, which in turn is used to get the
-		// blocktype.
+		// blocktype. IDs are handed out in order, so blocks are stored
+		// densely and a lookup is just an index.
 		Registry<std::string, std::size_t> referrer;
-		Registry<std::size_t, BlockType>   blocks;
+		DenseRegistry<BlockType>           blocks;
 	};
 } // namespace phx::voxels
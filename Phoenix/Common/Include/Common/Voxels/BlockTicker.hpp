@@ -0,0 +1,243 @@
+// Copyright 2019-20 Genten Studios
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+// may be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <Common/Math/Math.hpp>
+#include <Common/Voxels/Block.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <queue>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace phx::voxels
+{
+	class Chunk;
+	class Map;
+
+	/**
+	 * @brief Runs blocks that change over time, such as crops growing or
+	 * grass spreading.
+	 *
+	 * Blocks can be scheduled to update a number of ticks from now. Updates
+	 * sit in a timing wheel with a slot for each of the next WHEEL_SIZE
+	 * ticks. Updates further out wait in a second wheel with a slot for
+	 * every WHEEL_SIZE ticks, and are moved down as their slot comes up.
+	 * Only updates more than WHEEL_SIZE squared ticks out go in a queue, so
+	 * a tick only ever looks at the updates due in it. Each
+	 * chunk keeps its own list of pending updates, which is saved with the
+	 * chunk, and a block scheduled again before its update keeps the
+	 * earlier one.
+	 *
+	 * Every tick, a few random blocks of each chunk holding a block that
+	 * ticks randomly are picked too. Chunks are remembered as those blocks
+	 * are loaded or placed, so the rest of the map is never looked at.
+	 *
+	 * No more than the budget of updates run each tick, scheduled ones
+	 * first. Anything left over runs the next tick, in order.
+	 *
+	 * @paragraph Usage
+	 * @code
+	 * map.getTicker().setHandler([](const math::vec3& position,
+	 *                               BlockType* block,
+	 *                               BlockTicker::TickType type) {
+	 *     // grow, spread, fall...
+	 * });
+	 *
+	 * map.scheduleTick({4, 40, 4}, 20);
+	 *
+	 * // once per game tick.
+	 * map.tick();
+	 * @endcode
+	 */
+	class BlockTicker
+	{
+	public:
+		enum class TickType
+		{
+			SCHEDULED,
+			RANDOM
+		};
+
+		using Handler = std::function<void(const math::vec3& position,
+		                                   BlockType* block, TickType type)>;
+
+		/// @brief The number of ticks ahead the wheel has slots for, a
+		/// power of two.
+		static constexpr std::size_t WHEEL_SIZE = 256;
+
+		static constexpr std::size_t DEFAULT_BUDGET       = 65536;
+		static constexpr std::size_t DEFAULT_RANDOM_TICKS = 3;
+
+	public:
+		BlockTicker() = default;
+
+		/**
+		 * @brief Sets the function run for every block update.
+		 */
+		void setHandler(Handler handler);
+
+		/**
+		 * @brief Sets the most updates run in a tick, 0 for no limit.
+		 */
+		void setBudget(std::size_t updates);
+
+		/**
+		 * @brief Sets how many blocks of each chunk are picked for a random
+		 * tick every tick, 0 to turn random ticks off.
+		 */
+		void setRandomTicks(std::size_t perChunk);
+
+		/**
+		 * @brief Schedules a block to update.
+		 * @param chunkPos The position of the chunk the block is in.
+		 * @param index The index of the block in the chunk.
+		 * @param delay The number of ticks from now, at least one.
+		 */
+		void schedule(const math::vec3& chunkPos, std::size_t index,
+		              std::uint64_t delay);
+
+		/**
+		 * @brief Advances a tick, running the updates due and random ticks.
+		 * @param map The map the blocks are in.
+		 */
+		void tick(Map& map);
+
+		/**
+		 * @brief Looks through a chunk for blocks that tick randomly.
+		 */
+		void track(Chunk* chunk);
+
+		/**
+		 * @brief Notes a block placed in a chunk, in case it ticks randomly.
+		 */
+		void track(Chunk* chunk, const BlockType* block);
+
+		/**
+		 * @brief Writes the updates pending in a chunk as text, for saving.
+		 * @return "index:delay;" for each update, empty if there are none.
+		 */
+		std::string write(const math::vec3& chunkPos) const;
+
+		/**
+		 * @brief Schedules the updates of a chunk written by write.
+		 */
+		void read(const math::vec3& chunkPos, const std::string& data);
+
+		/// @brief The number of updates waiting to run.
+		std::size_t getPending() const { return m_pendingCount; }
+
+		/// @brief The number of ticks run so far.
+		std::uint64_t getTick() const { return m_now; }
+
+	private:
+		struct Entry
+		{
+			std::uint64_t chunk;
+			std::uint64_t due;
+			std::uint16_t index;
+		};
+
+		struct Later
+		{
+			bool operator()(const Entry& lhs, const Entry& rhs) const
+			{
+				return lhs.due > rhs.due;
+			}
+		};
+
+		/**
+		 * @brief The updates pending in a chunk, by the tick each block is
+		 * due. Entries in the wheel that don't match are stale and skipped.
+		 *
+		 * A few updates are kept in a list, once there are more than
+		 * SPARSE_LIMIT every block of the chunk gets a slot instead. A
+		 * chunk's entry is dropped once nothing in it is pending.
+		 */
+		struct ChunkTicks
+		{
+			static constexpr std::size_t SPARSE_LIMIT = 64;
+
+			/// @brief Gets the tick a block is due, 0 if it isn't pending.
+			std::uint64_t get(std::uint16_t index) const;
+
+			/// @brief Sets the tick a block is due, 0 to remove it.
+			void set(std::uint16_t index, std::uint64_t due);
+
+			/// @brief Calls func(index, due) for every pending block.
+			template <typename F>
+			void forEach(const F& func) const;
+
+			math::vec3 position;
+
+			/// @brief The number of blocks pending.
+			std::size_t count = 0;
+
+			// looked up the first time an update of the chunk runs.
+			Chunk* chunk = nullptr;
+
+			std::vector<std::pair<std::uint16_t, std::uint64_t>> sparse;
+			std::vector<std::uint64_t>                           dense;
+		};
+
+		// puts an entry in the wheel or queue for how far out it is.
+		void place(const Entry& entry);
+
+		// runs the entry if it is still pending, returns whether it ran.
+		bool run(Map& map, const Entry& entry);
+
+	private:
+		Handler       m_handler;
+		std::size_t   m_budget      = DEFAULT_BUDGET;
+		std::size_t   m_randomTicks = DEFAULT_RANDOM_TICKS;
+		std::uint64_t m_now         = 0;
+
+		std::array<std::vector<Entry>, WHEEL_SIZE> m_wheel;
+		std::array<std::vector<Entry>, WHEEL_SIZE> m_outerWheel;
+		std::priority_queue<Entry, std::vector<Entry>, Later> m_overflow;
+
+		// due updates that didn't fit in the budget of their tick.
+		std::deque<Entry> m_due;
+
+		std::unordered_map<std::uint64_t, ChunkTicks> m_pending;
+		std::size_t                                   m_pendingCount = 0;
+
+		std::vector<Chunk*>        m_randomChunks;
+		std::unordered_set<Chunk*> m_randomTracked;
+		std::size_t                m_randomCursor = 0;
+		std::minstd_rand           m_random;
+	};
+} // namespace phx::voxels
@@ -35,6 +35,8 @@
 #include <Common/Registry.hpp>
 
 #include <Common/Utility/Serializer.hpp>
+
+#include <cstdint>
 #include <vector>
 
 namespace phx::voxels
@@ -81,6 +83,8 @@ namespace phx::voxels
 	{
 	public:
 		using BlockList = std::vector<BlockType*>;
+		using LightList = std::vector<std::uint8_t>;
+		using LevelList = std::vector<std::uint8_t>;
 		
 	public:
 		Chunk() = delete;
@@ -103,7 +107,32 @@ namespace phx::voxels
 		 * @return std::vector<BlockType*>& Vector of pointers to all the
 		 * blocks in the chunk.
 		 */
-		BlockList& getBlocks();
+		BlockList&       getBlocks();
+		const BlockList& getBlocks() const;
+
+		/**
+		 * @brief Get the light of every block in the chunk.
+		 *
+		 * Each block has a byte, its block light in the low four bits and
+		 * its sky light in the high four. This is empty until the chunk is
+		 * lit by a LightEngine.
+		 *
+		 * @return std::vector<std::uint8_t>& The light of every block.
+		 */
+		LightList&       getLight();
+		const LightList& getLight() const;
+
+		/**
+		 * @brief Get the level of the liquid in every block of the chunk.
+		 *
+		 * Sources and blocks that aren't liquid are 0, liquid that has
+		 * flowed is set by a LiquidEngine. This is empty until liquid flows
+		 * in the chunk, see LiquidEngine::getLevel to read it.
+		 *
+		 * @return std::vector<std::uint8_t>& The level of every block.
+		 */
+		LevelList&       getLevels();
+		const LevelList& getLevels() const;
 
 		/**
 		 * @brief Gets the Block at the supplied position.
@@ -163,6 +192,75 @@ namespace phx::voxels
 			                      static_cast<std::size_t>(pos.z));
 		}
 
+		/// @brief The amount of sides a chunk has, one for each BlockFace.
+		static constexpr std::size_t FACE_COUNT = 6;
+
+		/**
+		 * @brief Gets the side facing the other way.
+		 *
+		 * Front and back, left and right, then top and bottom are pairs.
+		 *
+		 * @param face The index of the BlockFace.
+		 * @return The index of the BlockFace opposite it.
+		 */
+		static constexpr std::size_t getOppositeFace(std::size_t face)
+		{
+			return face < static_cast<std::size_t>(BlockFace::TOP)
+			           ? (face + 2) % 4
+			           : face ^ 1;
+		}
+
+		/**
+		 * @brief Gets the position of the chunk across one side of another.
+		 * @param chunkPos The position of the chunk.
+		 * @param face The index of the BlockFace to look across.
+		 * @return The position of the neighbouring chunk.
+		 */
+		static math::vec3 getNeighbourPos(const math::vec3& chunkPos,
+		                                  std::size_t       face);
+
+		/**
+		 * @brief Packs a chunk position into a key for a hash map.
+		 *
+		 * Hashing the float vector directly puts most chunks in a handful
+		 * of buckets, so this should be used to look chunks up instead.
+		 *
+		 * @param chunkPos The position of the chunk.
+		 * @return The key of the chunk.
+		 */
+		static std::uint64_t getKey(const math::vec3& chunkPos);
+
+		/**
+		 * @brief Finds the block next to another across one of its sides.
+		 *
+		 * The block is in the same chunk unless it's over an edge, where
+		 * it's on the far side of the neighbouring chunk.
+		 *
+		 * @param index The index of the block.
+		 * @param face The index of the BlockFace to step across.
+		 * @param nextIndex Set to the index of the next block.
+		 * @return Whether the next block is in the same chunk.
+		 */
+		ENGINE_FORCE_INLINE static bool stepIndex(std::size_t  index,
+		                                          std::size_t  face,
+		                                          std::size_t& nextIndex);
+
+		/**
+		 * @brief Gets which sides of the chunk a block is on.
+		 * @param index The index of the block.
+		 * @return A bit for each side, shifted by the index of its BlockFace.
+		 */
+		static std::uint8_t getBorders(std::size_t index);
+
+		/**
+		 * @brief Calls a function with the index of every block on one side
+		 * of the chunk.
+		 * @param face The index of the BlockFace.
+		 * @param func The function, taking a std::size_t.
+		 */
+		template <typename F>
+		static void forEachOnFace(std::size_t face, const F& func);
+
 		// serialize.
 		Serializer& operator>>(Serializer& ser) const override;
 
@@ -172,7 +270,11 @@ namespace phx::voxels
 	private:
 		math::vec3 m_pos;
 		BlockList m_blocks;
+		LightList m_light;
+		LevelList m_levels;
 
 		BlockReferrer* m_referrer;
 	};
 } // namespace phx::voxels
+
+#include <Common/Voxels/Chunk.inl>
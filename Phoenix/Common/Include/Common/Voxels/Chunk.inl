@@ -0,0 +1,137 @@
+// Copyright 2019-20 Genten Studios
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+// may be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+// Header exists in Chunk.hpp
+
+namespace phx::voxels
+{
+	static_assert(Chunk::CHUNK_WIDTH == Chunk::CHUNK_HEIGHT &&
+	                  Chunk::CHUNK_WIDTH == Chunk::CHUNK_DEPTH,
+	              "Chunk sides are walked as squares.");
+
+	inline bool Chunk::stepIndex(std::size_t index, std::size_t face,
+	                             std::size_t& nextIndex)
+	{
+		constexpr std::size_t width  = CHUNK_WIDTH;
+		constexpr std::size_t height = CHUNK_HEIGHT;
+		constexpr std::size_t depth  = CHUNK_DEPTH;
+		constexpr std::size_t layer  = width * height;
+
+		const std::size_t x = index % width;
+		const std::size_t y = (index / width) % height;
+		const std::size_t z = index / layer;
+
+		bool inside = false;
+		switch (static_cast<BlockFace>(face))
+		{
+		case BlockFace::FRONT:
+			inside    = z > 0;
+			nextIndex = inside ? index - layer : index + layer * (depth - 1);
+			break;
+		case BlockFace::LEFT:
+			inside    = x > 0;
+			nextIndex = inside ? index - 1 : index + (width - 1);
+			break;
+		case BlockFace::BACK:
+			inside    = z < depth - 1;
+			nextIndex = inside ? index + layer : index - layer * (depth - 1);
+			break;
+		case BlockFace::RIGHT:
+			inside    = x < width - 1;
+			nextIndex = inside ? index + 1 : index - (width - 1);
+			break;
+		case BlockFace::TOP:
+			inside    = y < height - 1;
+			nextIndex = inside ? index + width : index - width * (height - 1);
+			break;
+		case BlockFace::BOTTOM:
+			inside    = y > 0;
+			nextIndex = inside ? index - width : index + width * (height - 1);
+			break;
+		}
+
+		return inside;
+	}
+
+	inline std::uint8_t Chunk::getBorders(std::size_t index)
+	{
+		constexpr std::size_t width  = CHUNK_WIDTH;
+		constexpr std::size_t height = CHUNK_HEIGHT;
+		constexpr std::size_t depth  = CHUNK_DEPTH;
+
+		const std::size_t x = index % width;
+		const std::size_t y = (index / width) % height;
+		const std::size_t z = index / (width * height);
+
+		const auto bit = [](BlockFace face) { return static_cast<int>(face); };
+
+		return static_cast<std::uint8_t>(
+		    (z == 0) << bit(BlockFace::FRONT) |
+		    (x == 0) << bit(BlockFace::LEFT) |
+		    (z == depth - 1) << bit(BlockFace::BACK) |
+		    (x == width - 1) << bit(BlockFace::RIGHT) |
+		    (y == height - 1) << bit(BlockFace::TOP) |
+		    (y == 0) << bit(BlockFace::BOTTOM));
+	}
+
+	template <typename F>
+	void Chunk::forEachOnFace(std::size_t face, const F& func)
+	{
+		constexpr std::size_t side = CHUNK_WIDTH;
+
+		for (std::size_t a = 0; a < side; ++a)
+		{
+			for (std::size_t b = 0; b < side; ++b)
+			{
+				switch (static_cast<BlockFace>(face))
+				{
+				case BlockFace::FRONT:
+					func(getVectorIndex(a, b, 0));
+					break;
+				case BlockFace::LEFT:
+					func(getVectorIndex(0, a, b));
+					break;
+				case BlockFace::BACK:
+					func(getVectorIndex(a, b, side - 1));
+					break;
+				case BlockFace::RIGHT:
+					func(getVectorIndex(side - 1, a, b));
+					break;
+				case BlockFace::TOP:
+					func(getVectorIndex(a, side - 1, b));
+					break;
+				case BlockFace::BOTTOM:
+					func(getVectorIndex(a, 0, b));
+					break;
+				}
+			}
+		}
+	}
+} // namespace phx::voxels
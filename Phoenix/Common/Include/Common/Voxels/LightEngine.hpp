@@ -0,0 +1,231 @@
+// Copyright 2019-20 Genten Studios
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+// may be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <Common/Math/Math.hpp>
+#include <Common/Voxels/Block.hpp>
+#include <Common/Voxels/Chunk.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace phx::voxels
+{
+	/**
+	 * @brief Works out how brightly every block of a map is lit.
+	 *
+	 * There are two kinds of light, each from 0 to MAX_LIGHT. Block light
+	 * comes from blocks that give off light and drops by one each block it
+	 * travels. Sky light comes down from above at full strength until it
+	 * hits a solid block, then spreads sideways like block light. A chunk
+	 * with nothing loaded above it is taken to be open to the sky. Both
+	 * are kept in the chunk, a nibble each, see Chunk::getLight.
+	 *
+	 * Light spreads breadth first through queues of blocks to visit, and
+	 * is taken away the same way when a light is removed or blocked, with
+	 * any light still reaching the darkened blocks spread back in after.
+	 * Queues cross into neighbouring chunks, so one light can reach a few
+	 * chunks. Changing a block only visits the blocks its light reached,
+	 * at most a diamond of 15 blocks around it for block light.
+	 *
+	 * Nothing is spread until propagate is called, which visits no more
+	 * than the budget of blocks and leaves the rest for the next call.
+	 *
+	 * @paragraph Usage
+	 * @code
+	 * // the map does all of this itself once lighting is enabled.
+	 * map.enableLighting();
+	 *
+	 * light.add(chunk);
+	 * light.update(chunk, index, previous, block);
+	 * for (Chunk* changed : light.propagate())
+	 * {
+	 *     // remesh the chunk.
+	 * }
+	 * @endcode
+	 */
+	class LightEngine
+	{
+	public:
+		static constexpr std::uint8_t MAX_LIGHT = 15;
+
+		/// @brief The most blocks visited by a call to propagate, enough
+		/// to light a few dozen chunks as they load.
+		static constexpr std::size_t DEFAULT_BUDGET = 1 << 18;
+
+		/// @brief The block light of a light value from Chunk::getLight.
+		static std::uint8_t getBlockLight(std::uint8_t light)
+		{
+			return light & 0xF;
+		}
+
+		/// @brief The sky light of a light value from Chunk::getLight.
+		static std::uint8_t getSkyLight(std::uint8_t light)
+		{
+			return light >> 4;
+		}
+
+	public:
+		LightEngine() = default;
+
+		/**
+		 * @brief Turns lighting on or off, nothing is lit while it is off.
+		 */
+		void setEnabled(bool enabled);
+		bool isEnabled() const { return m_enabled; }
+
+		/**
+		 * @brief Sets the most blocks visited per call to propagate, 0 for
+		 * no limit.
+		 */
+		void setBudget(std::size_t blocks);
+
+		/**
+		 * @brief Lights a chunk that has just been loaded, along with the
+		 * chunks around it it lets light into.
+		 */
+		void add(Chunk* chunk);
+
+		/**
+		 * @brief Lights a chunk again from scratch, for when many of its
+		 * blocks have changed.
+		 */
+		void reset(Chunk* chunk);
+
+		/**
+		 * @brief Lights a block that has changed.
+		 * @param chunk The chunk the block is in.
+		 * @param index The index of the block in the chunk.
+		 * @param previous The block that was there.
+		 * @param block The block there now.
+		 */
+		void update(Chunk* chunk, std::size_t index, const BlockType* previous,
+		            const BlockType* block);
+
+		/**
+		 * @brief Spreads light queued since the last call, up to the budget.
+		 * @return The chunks whose light changed since the last call, and
+		 * those next to a side of them that changed, valid until the next
+		 * one.
+		 */
+		const std::vector<Chunk*>& propagate();
+
+		/// @brief The number of blocks waiting to be visited.
+		std::size_t getPending() const;
+
+	private:
+		enum Channel
+		{
+			BLOCK,
+			SKY,
+			CHANNEL_COUNT
+		};
+
+		static constexpr std::size_t   FACE_COUNT = Chunk::FACE_COUNT;
+		static constexpr std::uint32_t NONE       = 0xFFFFFFFF;
+
+		/// @brief A lit chunk and the lit chunks around it, by BlockFace.
+		/// Borders has a bit for each side whose blocks changed light, the
+		/// chunks across them are meshed against that light too.
+		struct Record
+		{
+			Chunk*                                chunk;
+			std::uint8_t*                         light;
+			std::array<std::uint32_t, FACE_COUNT> neighbours;
+			bool                                  changed = false;
+			std::uint8_t                          borders = 0;
+		};
+
+		/// @brief A block to visit. For removals the level is the light the
+		/// block had, for additions it is non-zero if the block is a source
+		/// of light.
+		struct Node
+		{
+			std::uint32_t record;
+			std::uint16_t index;
+			std::uint8_t  level;
+		};
+
+		/// @brief A queue of nodes, reusing its memory once it empties.
+		struct Queue
+		{
+			void        push(const Node& node) { nodes.push_back(node); }
+			Node        pop();
+			bool        empty() const { return head == nodes.size(); }
+			std::size_t size() const { return nodes.size() - head; }
+
+			std::vector<Node> nodes;
+			std::size_t       head = 0;
+		};
+
+		std::uint32_t find(const Chunk* chunk) const;
+
+		std::uint8_t get(Channel channel, std::uint32_t record,
+		                 std::size_t index) const;
+		void set(Channel channel, std::uint32_t record, std::size_t index,
+		         std::uint8_t level);
+
+		bool isOpaque(std::uint32_t record, std::size_t index) const;
+
+		// the light a block gives off, or lets in from the sky.
+		std::uint8_t getSource(Channel channel, std::uint32_t record,
+		                       std::size_t index) const;
+
+		// finds the block next to another, returns false if its chunk isn't
+		// lit.
+		bool step(std::uint32_t record, std::size_t index, std::size_t face,
+		          std::uint32_t& nextRecord, std::size_t& nextIndex) const;
+
+		// queues the light of a chunk's own blocks and of the sky above.
+		void seed(std::uint32_t record);
+
+		// queues the blocks around one to spread their light into it.
+		void gather(Channel channel, std::uint32_t record, std::size_t index);
+
+		void spread(Channel channel, const Node& node);
+		void remove(Channel channel, const Node& node);
+
+	private:
+		bool        m_enabled = false;
+		std::size_t m_budget  = DEFAULT_BUDGET;
+
+		std::vector<Record>                              m_records;
+		std::unordered_map<std::uint64_t, std::uint32_t> m_lookup;
+
+		std::array<Queue, CHANNEL_COUNT> m_additions;
+		std::array<Queue, CHANNEL_COUNT> m_removals;
+
+		// records whose light changed since propagate was last called.
+		std::vector<std::uint32_t> m_changed;
+		std::vector<Chunk*>        m_result;
+	};
+} // namespace phx::voxels
@@ -0,0 +1,220 @@
+// Copyright 2019-20 Genten Studios
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+// may be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <Common/Math/Math.hpp>
+#include <Common/Voxels/Block.hpp>
+#include <Common/Voxels/Chunk.hpp>
+
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace phx::voxels
+{
+	/**
+	 * @brief Flows blocks of the LIQUID category through a map.
+	 *
+	 * Every liquid block has a level from 1 to MAX_LEVEL, kept in the chunk,
+	 * see Chunk::getLevels. Liquid placed by anything else is a source at
+	 * MAX_LEVEL and never moves. Liquid falls into the air below it, and
+	 * liquid resting on something spreads sideways into air a level lower
+	 * each block, so it reaches MAX_LEVEL - 1 blocks from where it landed.
+	 * Liquid with nothing left feeding it drains away the same way.
+	 *
+	 * Only active blocks are looked at, those that changed or were next to
+	 * a change the tick before. A block that flows or drains wakes the
+	 * blocks around it for the next tick and one with nothing to do goes
+	 * back to sleep, so a flooded cave that has settled costs nothing.
+	 * Active blocks cross into neighbouring chunks. A block next to a chunk
+	 * that isn't loaded waits, and is woken again when the chunk loads.
+	 *
+	 * No more than the budget of blocks are looked at in a tick, anything
+	 * left over goes first the next tick. Every block changed in a tick is
+	 * handed back at once, so the map saves and dispatches an event for
+	 * each chunk once rather than for each block.
+	 *
+	 * @paragraph Usage
+	 * @code
+	 * // the map does all of this itself once liquids are enabled.
+	 * map.enableLiquids();
+	 *
+	 * liquids.add(chunk);
+	 * liquids.update(chunk, index, previous, block);
+	 * for (const LiquidEngine::Change& change : liquids.tick(air))
+	 * {
+	 *     // save, relight and remesh the block's chunk.
+	 * }
+	 * @endcode
+	 */
+	class LiquidEngine
+	{
+	public:
+		/// @brief The level of a source, flowing liquid is below it.
+		static constexpr std::uint8_t MAX_LEVEL = 8;
+
+		/// @brief The most blocks looked at in a tick.
+		static constexpr std::size_t DEFAULT_BUDGET = 16384;
+
+		/// @brief A block changed by the liquid in a tick, and the block
+		/// there before the tick.
+		struct Change
+		{
+			Chunk*        chunk;
+			std::uint16_t index;
+			BlockType*    previous;
+		};
+
+		/**
+		 * @brief Gets the level of the liquid in a block.
+		 * @return The level, 0 if the block isn't a liquid.
+		 */
+		static std::uint8_t getLevel(const Chunk& chunk, std::size_t index);
+
+		/**
+		 * @brief Writes the levels of a chunk's flowing liquid as text, for
+		 * saving.
+		 * @return "index:level;" for each block, empty if there are none.
+		 */
+		static std::string write(const Chunk& chunk);
+
+		/**
+		 * @brief Sets the levels of a chunk written by write, before the
+		 * chunk is added.
+		 */
+		static void read(Chunk& chunk, const std::string& data);
+
+	public:
+		LiquidEngine() = default;
+
+		/**
+		 * @brief Turns liquids on or off, nothing flows while it is off.
+		 */
+		void setEnabled(bool enabled);
+		bool isEnabled() const { return m_enabled; }
+
+		/**
+		 * @brief Sets the most blocks looked at per tick, 0 for no limit.
+		 */
+		void setBudget(std::size_t blocks);
+
+		/**
+		 * @brief Wakes the liquid of a chunk that has just been loaded, and
+		 * the liquid around it that was waiting for it.
+		 */
+		void add(Chunk* chunk);
+
+		/**
+		 * @brief Wakes the liquid around a block changed by anything other
+		 * than the engine.
+		 * @param chunk The chunk the block is in.
+		 * @param index The index of the block in the chunk.
+		 * @param previous The block that was there.
+		 * @param block The block there now.
+		 */
+		void update(Chunk* chunk, std::size_t index, const BlockType* previous,
+		            const BlockType* block);
+
+		/**
+		 * @brief Flows the blocks woken since the last tick, up to the
+		 * budget.
+		 * @param air The block drained liquid leaves behind.
+		 * @return The blocks changed, valid until the next tick.
+		 */
+		const std::vector<Change>& tick(BlockType* air);
+
+		/// @brief The number of blocks waiting to be looked at.
+		std::size_t getActive() const { return m_active.size(); }
+
+	private:
+		static constexpr std::size_t   FACE_COUNT = Chunk::FACE_COUNT;
+		static constexpr std::uint32_t NONE       = 0xFFFFFFFF;
+
+		/// @brief A chunk, the chunks around it by BlockFace, which of its
+		/// blocks are active and which have changed this tick.
+		struct Record
+		{
+			Chunk*                                chunk;
+			std::array<std::uint32_t, FACE_COUNT> neighbours;
+			std::bitset<Chunk::CHUNK_MAX_BLOCKS>  active;
+			std::bitset<Chunk::CHUNK_MAX_BLOCKS>  changed;
+		};
+
+		struct Node
+		{
+			std::uint32_t record;
+			std::uint16_t index;
+		};
+
+		std::uint32_t find(const Chunk* chunk) const;
+
+		BlockType* getBlock(std::uint32_t record, std::size_t index) const;
+
+		// the level as it is kept in the chunk, 0 for sources and with a
+		// bit set for liquid falling from the block above.
+		std::uint8_t getFlow(std::uint32_t record, std::size_t index) const;
+
+		// whether liquid flowing with a level would replace a block.
+		bool canFlowInto(std::uint32_t record, std::size_t index,
+		                 const BlockType* liquid, std::uint8_t flow) const;
+
+		// whether liquid in a block can spread sideways rather than fall.
+		bool isSupported(std::uint32_t record, std::size_t index,
+		                 const BlockType* liquid) const;
+
+		// finds the block next to another, returns false if its chunk isn't
+		// loaded.
+		bool step(std::uint32_t record, std::size_t index, std::size_t face,
+		          std::uint32_t& nextRecord, std::size_t& nextIndex) const;
+
+		void wake(std::uint32_t record, std::size_t index);
+		void wakeAround(std::uint32_t record, std::size_t index);
+
+		// changes a block and wakes the blocks around it.
+		void place(std::uint32_t record, std::size_t index, BlockType* block,
+		           std::uint8_t flow);
+
+		void flow(const Node& node, BlockType* air);
+
+	private:
+		bool        m_enabled = false;
+		std::size_t m_budget  = DEFAULT_BUDGET;
+
+		std::vector<Record>                              m_records;
+		std::unordered_map<std::uint64_t, std::uint32_t> m_lookup;
+
+		std::deque<Node>    m_active;
+		std::vector<Change> m_changes;
+	};
+} // namespace phx::voxels
@@ -30,10 +30,17 @@
 
 #include <Common/Save.hpp>
 #include <Common/Utility/BlockingQueue.hpp>
+#include <Common/Utility/ThreadPool.hpp>
 #include <Common/Voxels/BlockReferrer.hpp>
+#include <Common/Voxels/BlockTicker.hpp>
 #include <Common/Voxels/Chunk.hpp>
+#include <Common/Voxels/LightEngine.hpp>
+#include <Common/Voxels/LiquidEngine.hpp>
+#include <Common/Voxels/WorldGenerator.hpp>
 
+#include <memory>
 #include <unordered_map>
+#include <unordered_set>
 
 namespace phx::voxels
 {
@@ -59,23 +66,249 @@ namespace phx::voxels
 
 	class Map
 	{
+	public:
+		/**
+		 * @brief Changes many blocks at once, saving and telling subscribers
+		 * about each chunk once rather than once per block.
+		 *
+		 * Blocks are changed straight away, so the map can be read in the
+		 * middle of an edit. The chunks changed are saved and a CHUNK_UPDATE
+		 * is dispatched for each of them and the chunks around them when the
+		 * edit is committed, which happens when it is destroyed if commit
+		 * isn't called first.
+		 *
+		 * Positions are block positions in the world, boxes include both of
+		 * their corners. Chunks that aren't loaded are loaded or generated,
+		 * except on networked maps where blocks in missing chunks are
+		 * skipped.
+		 *
+		 * @paragraph Usage
+		 * @code
+		 * Map::Edit edit = map.beginEdit();
+		 * edit.fill({0, 0, 0}, {31, 31, 31}, stone);
+		 * edit.replace({0, 0, 0}, {31, 31, 31}, stone, dirt);
+		 * edit.set({4, 40, 4}, grass);
+		 * edit.commit();
+		 * @endcode
+		 */
+		class Edit
+		{
+		public:
+			explicit Edit(Map* map);
+			~Edit();
+
+			Edit(const Edit&) = delete;
+			Edit& operator=(const Edit&) = delete;
+			Edit(Edit&& other) noexcept;
+			Edit& operator=(Edit&& other) = delete;
+
+			/**
+			 * @brief Sets a single block.
+			 * @return Whether the block changed.
+			 */
+			bool set(const math::vec3& position, BlockType* block);
+
+			/**
+			 * @brief Sets every block in a box.
+			 * @return The number of blocks that changed.
+			 */
+			std::size_t fill(const math::vec3& from, const math::vec3& to,
+			                 BlockType* block);
+
+			/**
+			 * @brief Swaps one type of block for another in a box.
+			 * @return The number of blocks that changed.
+			 */
+			std::size_t replace(const math::vec3& from, const math::vec3& to,
+			                    BlockType* target, BlockType* block);
+
+			/**
+			 * @brief Saves and dispatches an event for every chunk changed
+			 * since the edit began or was last committed.
+			 */
+			void commit();
+
+		private:
+			Chunk* getChunk(const math::vec3& chunkPos);
+
+			// calls func(blocks, index) for every block of the box, a chunk
+			// at a time, and marks chunks dirty if func returns true.
+			template <typename F>
+			std::size_t forEachInBox(const math::vec3& from,
+			                         const math::vec3& to, const F& func);
+
+			// marks a box of blocks in a chunk as changed.
+			void markDirty(const math::vec3& chunkPos, Chunk* chunk,
+			               const math::vec3& from, const math::vec3& to);
+
+			/// @brief A changed chunk and the box of it that changed.
+			struct Dirty
+			{
+				Chunk*     chunk;
+				math::vec3 from;
+				math::vec3 to;
+			};
+
+			Map*       m_map;
+			math::vec3 m_lastPos;
+			Chunk*     m_lastChunk = nullptr;
+
+			std::unordered_map<math::vec3, Dirty, math::Vector3Hasher,
+			                   math::Vector3KeyComparator>
+			    m_dirty;
+		};
+
+	public:
+		/// @brief How often, in ticks, Map::tick saves the chunks marked
+		/// unsaved, a minute at the server's tick rate.
+		static constexpr std::uint64_t SAVE_INTERVAL = 1200;
+
 	public:
 		Map(Save* save, const std::string& name,
 		    voxels::BlockReferrer* referrer);
 		Map(BlockingQueue<std::pair<math::vec3, std::vector<std::byte>>>* queue,
 		    voxels::BlockReferrer* referrer);
+		~Map();
 
 		Chunk* getChunk(const math::vec3& pos);
+
+		/**
+		 * @brief Gets a chunk only if it is already in memory, without
+		 * loading, generating or waiting for it.
+		 * @param pos The position of the chunk.
+		 * @return The chunk, nullptr if it isn't in memory.
+		 */
+		Chunk* findChunk(const math::vec3& pos);
+
+		/**
+		 * @brief Makes sure a set of chunks are in memory, generating any
+		 * that have never existed in parallel.
+		 *
+		 * This does nothing for networked maps, whose chunks arrive from
+		 * the server.
+		 *
+		 * @param positions The positions of the chunks to load.
+		 */
+		void loadChunks(const std::vector<math::vec3>& positions);
+
+		/**
+		 * @brief Sets the generator used for chunks that have never existed.
+		 * @param generator The generator, maps start with a FlatGenerator.
+		 */
+		void setGenerator(std::unique_ptr<WorldGenerator> generator);
+
+		/**
+		 * @brief Sets the pool loadChunks generates chunks on.
+		 * @param pool The pool to use, nullptr to generate on the calling
+		 * thread. It must outlive the map or be unset first.
+		 */
+		void setThreadPool(ThreadPool* pool);
+
+		/**
+		 * @brief Splits a position in the world into the position of its
+		 * chunk and the position of the block in that chunk.
+		 *
+		 * Positions round down, the same as edits, so any position inside
+		 * a block finds it.
+		 */
 		static std::pair<math::vec3, math::vec3> getBlockPos(
 		    math::vec3 position);
 		BlockType* getBlockAt(math::vec3 position);
 		void       setBlockAt(math::vec3 pos, BlockType* block);
 		void       save(const math::vec3& pos);
 
+		/**
+		 * @brief Notes that a chunk needs saving without saving it yet.
+		 *
+		 * For changes that come too often to save each time, such as
+		 * pending block updates and flowing liquid. Networked maps ignore
+		 * this.
+		 *
+		 * @param chunkPos The position of the chunk.
+		 */
+		void markUnsaved(const math::vec3& chunkPos);
+
+		/**
+		 * @brief Saves every chunk marked unsaved since it was last saved.
+		 *
+		 * Map::tick does this every SAVE_INTERVAL ticks, and the map does
+		 * it once more when it is destroyed.
+		 */
+		void saveChanged();
+
+		/**
+		 * @brief Starts an edit, use this over setBlockAt to change more
+		 * than a handful of blocks.
+		 */
+		Edit beginEdit();
+
+		/**
+		 * @brief Schedules the block at a position to update.
+		 * @param position The position of the block in the world.
+		 * @param delay The number of ticks from now, at least one.
+		 */
+		void scheduleTick(const math::vec3& position, std::uint64_t delay);
+
+		/**
+		 * @brief Runs a tick of block updates and flows liquid, see
+		 * BlockTicker and LiquidEngine, and saves the chunks marked unsaved
+		 * every SAVE_INTERVAL ticks.
+		 */
+		void tick();
+
+		BlockTicker& getTicker();
+
+		/**
+		 * @brief Lights the map from now on, see LightEngine.
+		 *
+		 * Chunks are lit as they load and relit as blocks change, and a
+		 * CHUNK_UPDATE is dispatched for every chunk whose light changes.
+		 */
+		void enableLighting();
+
+		/**
+		 * @brief Spreads light still waiting from earlier changes, as much
+		 * as the light engine's budget allows. Map::tick does this too.
+		 */
+		void updateLight();
+
+		LightEngine& getLightEngine();
+
+		/**
+		 * @brief Flows liquid from now on, see LiquidEngine.
+		 *
+		 * Liquid moves a block each tick. The blocks it changes in a tick
+		 * are dispatched together, a CHUNK_UPDATE for each chunk, and the
+		 * chunks are marked unsaved rather than saved straight away.
+		 */
+		void enableLiquids();
+
+		LiquidEngine& getLiquidEngine();
+
 		void registerEventSubscriber(MapEventSubscriber* subscriber);
 
 	private:
 		void dispatchToSubscriber(const MapEvent& mapEvent) const;
+		void addChunk(const math::vec3& pos, Chunk&& chunk);
+
+		/// @brief Loads a chunk from the save, false if it was never saved.
+		bool loadChunk(const math::vec3& pos);
+
+		/// @brief Spreads light and dispatches an event for each chunk it
+		/// changed, other than those skip returns true for.
+		template <typename F>
+		void propagateLight(const F& skip);
+
+		/// @brief Runs a tick of the liquid engine and relights, dispatches
+		/// and marks unsaved the chunks it changed.
+		void flowLiquids();
+
+		/// @brief Dispatches an event for each loaded chunk next to a box
+		/// of blocks in a chunk, since meshes look across their borders.
+		/// Chunks skip returns true for are left out.
+		template <typename F>
+		void dispatchAround(const math::vec3& chunkPos, const math::vec3& from,
+		                    const math::vec3& to, const F& skip);
 		
 	private:
 		std::unordered_map<math::vec3, Chunk, math::Vector3Hasher,
@@ -87,9 +320,20 @@ namespace phx::voxels
 		Save*       m_save = nullptr;
 		std::string m_mapName;
 
+		std::unique_ptr<WorldGenerator> m_generator;
+		ThreadPool*                     m_pool = nullptr;
+
+		BlockTicker  m_ticker;
+		LightEngine  m_light;
+		LiquidEngine m_liquids;
+
 		BlockingQueue<std::pair<math::vec3, std::vector<std::byte>>>* m_queue =
 		    nullptr;
 
+		std::unordered_set<math::vec3, math::Vector3Hasher,
+		                   math::Vector3KeyComparator>
+		    m_unsaved;
+
 		std::vector<MapEventSubscriber*> m_subscribers;
 	};
 } // namespace phx::voxels
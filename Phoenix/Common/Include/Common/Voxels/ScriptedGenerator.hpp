@@ -0,0 +1,159 @@
+// Copyright 2019-20 Genten Studios
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+// may be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <Common/CMS/ModManager.hpp>
+#include <Common/Math/Noise.hpp>
+#include <Common/Voxels/WorldGenerator.hpp>
+
+#include <sol/sol.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace phx::voxels
+{
+	/**
+	 * @brief Runs generation passes registered by mods over chunks made by
+	 * another generator.
+	 *
+	 * Mods register passes with voxel.worldgen.register while loading, each
+	 * naming a stage, a generation script in the mod's folder and the
+	 * function in that script to call. Passes run terrain first, then ores,
+	 * then decorations, in the order they were registered within a stage.
+	 *
+	 * Generation scripts don't run in the mod manager's Lua state. Every
+	 * thread generating chunks gets its own state with each script loaded
+	 * into a separate environment, so passes run in parallel and can't see
+	 * the rest of the game. A pass is called with a table holding the
+	 * chunk's position and seed, and its blocks as a flat array of ids, so
+	 * a whole chunk is read and written without calling back into C++.
+	 *
+	 * @paragraph Usage
+	 * @code
+	 * auto generator = std::make_unique<ScriptedGenerator>(
+	 *     &referrer, seed, std::make_unique<NoiseGenerator>(&referrer, seed));
+	 * generator->registerAPI(modManager);
+	 *
+	 * // once the mods have loaded.
+	 * map.setGenerator(std::move(generator));
+	 * @endcode
+	 *
+	 * @code{.lua}
+	 * -- Init.lua
+	 * voxel.worldgen.register({stage = "ores", script = "Worldgen.lua",
+	 *                          func = "placeOres"})
+	 *
+	 * -- Worldgen.lua
+	 * local stone = worldgen.id("core.stone")
+	 * function placeOres(chunk)
+	 *     for i = 1, #chunk.blocks do
+	 *         if chunk.blocks[i] == stone then ... end
+	 *     end
+	 * end
+	 * @endcode
+	 */
+	class ScriptedGenerator : public WorldGenerator
+	{
+	public:
+		/// @brief When a pass runs, earlier stages run first.
+		enum class Stage
+		{
+			TERRAIN,
+			ORES,
+			DECORATION
+		};
+
+		struct Pass
+		{
+			/// @brief The path of the script defining the pass.
+			std::string script;
+			/// @brief The name of the function to call in the script.
+			std::string function;
+			Stage       stage;
+		};
+
+	public:
+		/**
+		 * @brief Creates a generator with no passes.
+		 * @param referrer The blocks the passes can use.
+		 * @param seed The seed given to passes and their noise.
+		 * @param base The generator that makes each chunk before any pass.
+		 */
+		ScriptedGenerator(BlockReferrer* referrer, std::uint32_t seed,
+		                  std::unique_ptr<WorldGenerator> base);
+		~ScriptedGenerator() override;
+
+		/**
+		 * @brief Registers voxel.worldgen.register, passes must all be
+		 * registered before the first chunk is generated.
+		 * @param manager The mod manager to register the function with.
+		 */
+		void registerAPI(cms::ModManager* manager);
+
+		/**
+		 * @brief Adds a pass after every other pass in its stage.
+		 * @param pass The pass to add.
+		 */
+		void addPass(Pass pass);
+
+		const std::vector<Pass>& getPasses() const { return m_passes; }
+
+		void generate(Chunk& chunk) override;
+
+	private:
+		// the Lua state and loaded passes of one generating thread.
+		struct Worker
+		{
+			sol::state                           lua;
+			std::vector<sol::protected_function> passes;
+			std::vector<bool>                    failed;
+			sol::table                           chunk;
+			sol::table                           blocks;
+		};
+
+		Worker& getWorker();
+		void    loadWorker(Worker& worker) const;
+
+	private:
+		BlockReferrer*                  m_referrer;
+		std::unique_ptr<WorldGenerator> m_base;
+		math::Noise                     m_noise;
+		std::vector<Pass>               m_passes;
+
+		std::mutex m_workerMutex;
+		std::unordered_map<std::thread::id, std::unique_ptr<Worker>>
+		    m_workers;
+	};
+} // namespace phx::voxels
@@ -0,0 +1,116 @@
+// Copyright 2019-20 Genten Studios
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+// may be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <Common/Math/Noise.hpp>
+#include <Common/Voxels/BlockReferrer.hpp>
+#include <Common/Voxels/Chunk.hpp>
+
+#include <cstdint>
+
+namespace phx::voxels
+{
+	/**
+	 * @brief Fills in the blocks of chunks that have never been generated.
+	 *
+	 * A map asks its generator for every chunk that isn't in memory or
+	 * saved. Chunks may be generated on several threads at once, so
+	 * generate must not change anything shared between calls. Chunks in the
+	 * same column are generated one after the other on the same thread, so
+	 * anything worked out per column can be kept in thread local storage.
+	 *
+	 * @paragraph Usage
+	 * @code
+	 * map.setGenerator(std::make_unique<NoiseGenerator>(&referrer, seed));
+	 * @endcode
+	 */
+	class WorldGenerator
+	{
+	public:
+		virtual ~WorldGenerator() = default;
+
+		/**
+		 * @brief Generates the blocks of a chunk.
+		 * @param chunk The chunk to fill, its block list is empty.
+		 */
+		virtual void generate(Chunk& chunk) = 0;
+	};
+
+	/**
+	 * @brief Generates air at and above y = 0 and grass below it.
+	 */
+	class FlatGenerator : public WorldGenerator
+	{
+	public:
+		explicit FlatGenerator(BlockReferrer* referrer);
+
+		void generate(Chunk& chunk) override;
+
+	private:
+		BlockReferrer* m_referrer;
+	};
+
+	/**
+	 * @brief Generates rolling terrain from a heightmap, with caves carved
+	 * out below the surface.
+	 *
+	 * The heightmap is worked out once per column of chunks, then the caves
+	 * are sampled for every block below the surface in one batch so the
+	 * noise is vectorized. Chunks entirely above the terrain are filled with
+	 * air without sampling anything.
+	 *
+	 * The surface is core.grass with core.dirt under it and core.stone below
+	 * that, blocks which aren't registered fall back to the one above.
+	 */
+	class NoiseGenerator : public WorldGenerator
+	{
+	public:
+		/// @brief The height terrain varies around.
+		static constexpr int BASE_HEIGHT = 0;
+
+		/// @brief How far above and below the base height terrain can go.
+		static constexpr float HEIGHT_RANGE = 24.f;
+
+		/// @brief The depth of dirt under the surface.
+		static constexpr int SOIL_DEPTH = 3;
+
+		/// @brief Caves only break through the surface this far down.
+		static constexpr int CAVE_DEPTH = 4;
+
+	public:
+		NoiseGenerator(BlockReferrer* referrer, std::uint32_t seed);
+
+		void generate(Chunk& chunk) override;
+
+	private:
+		BlockReferrer* m_referrer;
+		math::Noise    m_terrain;
+		math::Noise    m_caves;
+	};
+} // namespace phx::voxels
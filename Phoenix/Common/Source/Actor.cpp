@@ -28,6 +28,7 @@
 
 #include <Common/Game/Actor.hpp>
 
+#include <Common/CMS/EventBus.hpp>
 #include <Common/Game/Movement.hpp>
 #include <Common/Game/PlayerView.hpp>
 #include <Common/Game/Components/Position.hpp>
@@ -126,13 +127,13 @@ bool ActorSystem::action1(entt::registry* registry, entt::entity entity)
 		const auto* currentBlock = map->getBlockAt(pos);
 		if (currentBlock->category == voxels::BlockCategory::SOLID)
 		{
-			map->setBlockAt(
-			    pos, m_blockReferrer->blocks.get(voxels::BlockType::AIR_BLOCK));
+			voxels::BlockType* air =
+			    m_blockReferrer->blocks.get(voxels::BlockType::AIR_BLOCK);
+			map->setBlockAt(pos, air);
 
-			if (currentBlock->onBreak)
-			{
-				currentBlock->onBreak(pos.x, pos.y, pos.z);
-			}
+			// Lua hears about it once the tick is over.
+			cms::EventBus::get().push(
+			    cms::BlockChangedEvent {pos, currentBlock, air});
 
 			return true;
 		}
@@ -160,13 +161,12 @@ bool ActorSystem::action2(entt::registry* registry, entt::entity entity)
 			math::vec3 back = ray.backtrace(RAY_INCREMENT);
 			back.floor();
 
-			map->setBlockAt(back, registry->get<Hand>(entity).hand);
+			const voxels::BlockType* previous = map->getBlockAt(back);
+			voxels::BlockType*       hand = registry->get<Hand>(entity).hand;
+			map->setBlockAt(back, hand);
 
-			if (registry->get<Hand>(entity).hand->onPlace)
-			{
-				registry->get<Hand>(entity).hand->onPlace(back.x, back.y,
-				                                          back.z);
-			}
+			cms::EventBus::get().push(
+			    cms::BlockChangedEvent {back, previous, hand});
 
 			return true;
 		}
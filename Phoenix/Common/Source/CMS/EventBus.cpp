@@ -0,0 +1,295 @@
+// Copyright 2019-20 Genten Studios
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+// may be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <Common/CMS/EventBus.hpp>
+#include <Common/Logger.hpp>
+#include <Common/Profiling/Profiler.hpp>
+#include <Common/Profiling/Tracer.hpp>
+
+using namespace phx::cms;
+
+namespace
+{
+	constexpr const char* EVENT_NAMES[] = {"block_changed", "player_joined",
+	                                       "player_left", "chat"};
+
+	void setField(lua_State* state, const char* key, lua_Integer value)
+	{
+		lua_pushinteger(state, value);
+		lua_setfield(state, -2, key);
+	}
+
+	void setField(lua_State* state, const char* key, const std::string& value)
+	{
+		lua_pushlstring(state, value.data(), value.size());
+		lua_setfield(state, -2, key);
+	}
+
+	void pushEvent(lua_State* state, const BlockChangedEvent& event)
+	{
+		lua_createtable(state, 0, 5);
+		setField(state, "x", static_cast<lua_Integer>(event.position.x));
+		setField(state, "y", static_cast<lua_Integer>(event.position.y));
+		setField(state, "z", static_cast<lua_Integer>(event.position.z));
+		setField(state, "previous", event.previous->id);
+		setField(state, "block", event.block->id);
+	}
+
+	void pushEvent(lua_State* state, const PlayerEvent& event)
+	{
+		lua_createtable(state, 0, 1);
+		setField(state, "player", static_cast<lua_Integer>(event.player));
+	}
+
+	void pushEvent(lua_State* state, const ChatEvent& event)
+	{
+		lua_createtable(state, 0, 2);
+		setField(state, "player", static_cast<lua_Integer>(event.player));
+		setField(state, "message", event.message);
+	}
+
+	/**
+	 * @brief Builds the Lua array of a tick's events of one type.
+	 */
+	template <typename Event>
+	sol::table toTable(lua_State* state, const std::vector<Event>& events)
+	{
+		lua_createtable(state, static_cast<int>(events.size()), 0);
+		for (std::size_t i = 0; i < events.size(); ++i)
+		{
+			pushEvent(state, events[i]);
+			lua_rawseti(state, -2, static_cast<lua_Integer>(i + 1));
+		}
+
+		sol::table table(state, -1);
+		lua_pop(state, 1);
+		return table;
+	}
+
+	/**
+	 * @brief Takes everything out of a queue, keeping its storage for the
+	 * next tick if nothing was queued in the meantime.
+	 */
+	template <typename Event>
+	void recycle(std::vector<Event>& queue, std::vector<Event>& drained)
+	{
+		if (queue.empty())
+		{
+			drained.clear();
+			queue.swap(drained);
+		}
+	}
+} // namespace
+
+EventBus& EventBus::get()
+{
+	static EventBus bus;
+	return bus;
+}
+
+void EventBus::registerAPI(ModManager* manager)
+{
+	/**
+	 * @addtogroup luaapi
+	 *
+	 * @subsubsection coreeventsubscribe core.event.subscribe
+	 * @brief Calls a function once a tick with every event of a type.
+	 *
+	 * The function is given an array of the events since the last tick,
+	 * and isn't called on ticks without any. The same array is passed to
+	 * every handler, so it shouldn't be changed.
+	 *
+	 * The events are:
+	 * - block_changed: {x, y, z, previous, block} for a block a player
+	 *   broke or placed, with the ids of the blocks before and after.
+	 * - player_joined, player_left: {player}
+	 * - chat: {player, message} for a chat message that isn't a command.
+	 *
+	 * @b Example:
+	 * @code {.lua}
+	 * core.event.subscribe("block_changed", function(events)
+	 *     for _, event in ipairs(events) do
+	 *         if event.block == "core.air" then
+	 *             broken = broken + 1
+	 *         end
+	 *     end
+	 * end)
+	 * @endcode
+	 */
+	manager->registerFunction(
+	    "core.event.subscribe",
+	    [manager, this](const std::string& name, sol::function handler) {
+		    EventType type;
+		    if (!getEventType(name, type))
+		    {
+			    LOG_WARNING("MODDING")
+			        << "Can't subscribe to the unknown event " << name << ".";
+			    return;
+		    }
+
+		    subscribe(
+		        type,
+		        LuaProfiler::get().getModID(manager->getCurrentModName()),
+		        handler);
+	    });
+}
+
+void EventBus::subscribe(EventType type, LuaProfiler::ModID mod,
+                         const sol::function& handler)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_handlers[static_cast<std::size_t>(type)].push_back({mod, handler});
+}
+
+void EventBus::push(const BlockChangedEvent& event)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_blockChanges.push_back(event);
+}
+
+void EventBus::push(EventType type, const PlayerEvent& event)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	(type == EventType::PLAYER_JOINED ? m_joins : m_leaves).push_back(event);
+}
+
+void EventBus::push(ChatEvent event)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_chat.push_back(std::move(event));
+}
+
+void EventBus::dispatch()
+{
+	PHX_TRACE_SCOPE(LUA, "EventBus::dispatch");
+	PHX_PROFILE_SCOPE("EventBus::dispatch");
+
+	// handlers can queue more events, those wait for the next dispatch.
+	std::vector<BlockChangedEvent> blockChanges;
+	std::vector<PlayerEvent>       joins;
+	std::vector<PlayerEvent>       leaves;
+	std::vector<ChatEvent>         chat;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		blockChanges.swap(m_blockChanges);
+		joins.swap(m_joins);
+		leaves.swap(m_leaves);
+		chat.swap(m_chat);
+	}
+
+	for (const auto& event : blockChanges)
+	{
+		if (event.previous->onBreak)
+		{
+			PHX_TRACE_SCOPE(LUA, "onBreak");
+			LuaProfiler::get().call(
+			    event.previous->mod, event.previous->onBreak, event.position.x,
+			    event.position.y, event.position.z);
+		}
+
+		if (event.block->onPlace)
+		{
+			PHX_TRACE_SCOPE(LUA, "onPlace");
+			LuaProfiler::get().call(event.block->mod, event.block->onPlace,
+			                        event.position.x, event.position.y,
+			                        event.position.z);
+		}
+	}
+
+	deliver(EventType::BLOCK_CHANGED, blockChanges);
+	deliver(EventType::PLAYER_JOINED, joins);
+	deliver(EventType::PLAYER_LEFT, leaves);
+	deliver(EventType::CHAT, chat);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	recycle(m_blockChanges, blockChanges);
+	recycle(m_joins, joins);
+	recycle(m_leaves, leaves);
+	recycle(m_chat, chat);
+}
+
+void EventBus::clear()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	for (auto& handlers : m_handlers)
+	{
+		handlers.clear();
+	}
+
+	m_blockChanges.clear();
+	m_joins.clear();
+	m_leaves.clear();
+	m_chat.clear();
+}
+
+bool EventBus::getEventType(const std::string& name, EventType& type)
+{
+	for (std::size_t i = 0; i < static_cast<std::size_t>(EventType::COUNT);
+	     ++i)
+	{
+		if (name == EVENT_NAMES[i])
+		{
+			type = static_cast<EventType>(i);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+template <typename Event>
+void EventBus::deliver(EventType type, const std::vector<Event>& events)
+{
+	if (events.empty())
+	{
+		return;
+	}
+
+	// copied so handlers can subscribe more handlers while this runs.
+	std::vector<Handler> handlers;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		handlers = m_handlers[static_cast<std::size_t>(type)];
+	}
+
+	// the array is built once for each Lua state, which is usually one.
+	lua_State* built = nullptr;
+	sol::table array;
+	for (const auto& handler : handlers)
+	{
+		lua_State* state = handler.function.lua_state();
+		if (state != built)
+		{
+			array = toTable(state, events);
+			built = state;
+		}
+
+		LuaProfiler::get().call(handler.mod, handler.function, array);
+	}
+}
@@ -0,0 +1,312 @@
+// Copyright 2019-20 Genten Studios
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+// may be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <Common/CMS/LuaProfiler.hpp>
+#include <Common/Logger.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+using namespace phx::cms;
+
+namespace
+{
+	// warns about a mod going over budget once every this many ticks over,
+	// a mod that is always slow would fill the log otherwise.
+	constexpr std::uint64_t WARNING_INTERVAL = 20;
+
+	// nesting of callbacks on this thread, only the outermost is hooked.
+	thread_local std::size_t   t_depth        = 0;
+	thread_local std::uint64_t t_instructions = 0;
+
+	void countInstructions(lua_State*, lua_Debug*)
+	{
+		t_instructions += LuaProfiler::INSTRUCTION_STEP;
+	}
+
+	/**
+	 * @brief Installs the count hook for the outermost callback, and puts
+	 * back whatever hook was there before even if the callback throws.
+	 */
+	class HookScope
+	{
+	public:
+		explicit HookScope(lua_State* state) : m_outermost(t_depth++ == 0)
+		{
+			if (m_outermost && state != nullptr)
+			{
+				m_state     = state;
+				m_hook      = lua_gethook(state);
+				m_hookMask  = lua_gethookmask(state);
+				m_hookCount = lua_gethookcount(state);
+
+				t_instructions = 0;
+				lua_sethook(state, &countInstructions, LUA_MASKCOUNT,
+				            LuaProfiler::INSTRUCTION_STEP);
+			}
+		}
+
+		~HookScope()
+		{
+			if (m_state != nullptr)
+			{
+				lua_sethook(m_state, m_hook, m_hookMask, m_hookCount);
+			}
+
+			--t_depth;
+		}
+
+		bool isOutermost() const { return m_outermost; }
+
+	private:
+		bool       m_outermost;
+		lua_State* m_state     = nullptr;
+		lua_Hook   m_hook      = nullptr;
+		int        m_hookMask  = 0;
+		int        m_hookCount = 0;
+	};
+} // namespace
+
+LuaProfiler& LuaProfiler::get()
+{
+	static LuaProfiler profiler;
+	return profiler;
+}
+
+LuaProfiler::LuaProfiler() { getModID("unknown"); }
+
+LuaProfiler::ModID LuaProfiler::getModID(const std::string& name)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	for (ModID mod = 0; mod < m_mods.size(); ++mod)
+	{
+		if (m_mods[mod].name == name)
+		{
+			return mod;
+		}
+	}
+
+	ModStatistics statistics;
+	statistics.name   = name;
+	statistics.budget = m_budget;
+
+	m_mods.push_back(statistics);
+	m_tickTime.push_back(0.0);
+	m_ownBudget.push_back(false);
+	m_pending.push_back(0);
+
+	return m_mods.size() - 1;
+}
+
+void LuaProfiler::setBudget(double milliseconds)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_budget = milliseconds;
+	for (ModID mod = 0; mod < m_mods.size(); ++mod)
+	{
+		if (!m_ownBudget[mod])
+		{
+			m_mods[mod].budget = milliseconds;
+		}
+	}
+}
+
+void LuaProfiler::setBudget(ModID mod, double milliseconds)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (mod < m_mods.size())
+	{
+		m_mods[mod].budget = milliseconds;
+		m_ownBudget[mod]   = true;
+	}
+}
+
+void LuaProfiler::setPolicy(BudgetPolicy policy)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_policy = policy;
+}
+
+void LuaProfiler::run(ModID mod, lua_State* state,
+                      std::function<void()> callback)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		if (mod >= m_mods.size())
+		{
+			mod = UNKNOWN_MOD;
+		}
+
+		// anything already waiting for this mod has to run first.
+		if (m_policy == BudgetPolicy::DEFER &&
+		    (m_pending[mod] > 0 || isExhausted(mod)))
+		{
+			++m_pending[mod];
+			++m_mods[mod].deferred;
+			m_deferred.push_back({mod, state, std::move(callback)});
+			return;
+		}
+	}
+
+	invoke(mod, state, callback);
+}
+
+void LuaProfiler::endTick()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	for (ModID mod = 0; mod < m_mods.size(); ++mod)
+	{
+		ModStatistics& statistics = m_mods[mod];
+		statistics.lastTick       = m_tickTime[mod];
+		m_tickTime[mod]           = 0.0;
+
+		if (statistics.budget > 0.0 &&
+		    statistics.lastTick > statistics.budget)
+		{
+			if (statistics.overBudgetTicks % WARNING_INTERVAL == 0)
+			{
+				LOG_WARNING("LUA")
+				    << "The mod " << statistics.name << " took "
+				    << statistics.lastTick << "ms of Lua this tick, over its "
+				    << "budget of " << statistics.budget << "ms.";
+			}
+
+			++statistics.overBudgetTicks;
+		}
+	}
+
+	// everything deferred gets one chance per tick, callbacks of mods that
+	// run out of budget again go back to the end of the queue in order.
+	for (std::size_t i = m_deferred.size(); i > 0; --i)
+	{
+		Deferred deferred = std::move(m_deferred.front());
+		m_deferred.pop_front();
+
+		if (isExhausted(deferred.mod))
+		{
+			m_deferred.push_back(std::move(deferred));
+			continue;
+		}
+
+		--m_pending[deferred.mod];
+
+		lock.unlock();
+		invoke(deferred.mod, deferred.state, deferred.callback);
+		lock.lock();
+	}
+}
+
+std::vector<ModStatistics> LuaProfiler::getStatistics() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_mods;
+}
+
+std::string LuaProfiler::report() const
+{
+	std::vector<ModStatistics> mods = getStatistics();
+
+	// the slowest mods are the interesting ones.
+	std::sort(mods.begin(), mods.end(),
+	          [](const ModStatistics& lhs, const ModStatistics& rhs) {
+		          return lhs.total > rhs.total;
+	          });
+
+	std::string report;
+	char        line[160];
+
+	std::snprintf(line, sizeof(line),
+	              "%-24s %9s %12s %10s %8s %8s %8s %6s %8s\n", "Mod", "Calls",
+	              "Instructions", "Total ms", "Max ms", "Tick ms", "Budget",
+	              "Over", "Deferred");
+	report += line;
+
+	for (const auto& mod : mods)
+	{
+		std::snprintf(line, sizeof(line),
+		              "%-24s %9llu %12llu %10.3f %8.3f %8.3f %8.3f %6llu "
+		              "%8llu\n",
+		              mod.name.c_str(),
+		              static_cast<unsigned long long>(mod.calls),
+		              static_cast<unsigned long long>(mod.instructions),
+		              mod.total, mod.max, mod.lastTick, mod.budget,
+		              static_cast<unsigned long long>(mod.overBudgetTicks),
+		              static_cast<unsigned long long>(mod.deferred));
+		report += line;
+	}
+
+	return report;
+}
+
+void LuaProfiler::invoke(ModID mod, lua_State* state,
+                         const std::function<void()>& callback)
+{
+	using Clock = std::chrono::steady_clock;
+
+	bool          outermost    = false;
+	std::uint64_t instructions = 0;
+
+	const auto start = Clock::now();
+	{
+		HookScope hook(state);
+		outermost = hook.isOutermost();
+
+		callback();
+
+		instructions = t_instructions;
+	}
+	const double elapsed =
+	    std::chrono::duration<double, std::milli>(Clock::now() - start)
+	        .count();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	ModStatistics& statistics = m_mods[mod];
+	++statistics.calls;
+	statistics.max = std::max(statistics.max, elapsed);
+
+	// nested callbacks are already included in the outermost one.
+	if (outermost)
+	{
+		statistics.total += elapsed;
+		statistics.instructions += state != nullptr ? instructions : 0;
+		m_tickTime[mod] += elapsed;
+	}
+}
+
+bool LuaProfiler::isExhausted(ModID mod) const
+{
+	const double budget = m_mods[mod].budget;
+	return budget > 0.0 && m_tickTime[mod] >= budget;
+}
@@ -32,6 +32,11 @@
 
 #include <Common/Math/Math.hpp>
 
+#include <fstream>
+#include <functional>
+#include <queue>
+#include <unordered_map>
+
 using namespace phx::cms;
 
 static void CustomPanicHandler(sol::optional<std::string> maybe_msg)
@@ -50,7 +55,8 @@ static void CustomPanicHandler(sol::optional<std::string> maybe_msg)
 }
 
 ModManager::ModManager(const ModList& toLoad, const ModList& paths)
-    : m_modsRequired(toLoad), m_modPaths(paths)
+    : m_modsRequired(toLoad), m_modPaths(paths),
+      m_scriptCache(ScriptCache::DEFAULT_DIRECTORY)
 {
 	m_luaState.open_libraries(sol::lib::base);
 	m_luaState.set_panic(
@@ -59,7 +65,7 @@ ModManager::ModManager(const ModList& toLoad, const ModList& paths)
 
 ModManager::Status ModManager::load(float* progress)
 {
-	std::queue<Mod> toLoad;
+	std::vector<Mod> mods;
 
 	for (auto& require : m_modsRequired)
 	{
@@ -71,7 +77,7 @@ ModManager::Status ModManager::load(float* progress)
 			if (file.is_open())
 			{
 				found = true;
-				toLoad.emplace(require, path);
+				mods.emplace_back(require, path);
 				break;
 			}
 		}
@@ -94,72 +100,162 @@ ModManager::Status ModManager::load(float* progress)
 		}
 	}
 
-	std::vector<std::string> loadedMods;
-	while (!toLoad.empty())
+	std::vector<std::size_t> order;
+	Status                   status = sortByDependencies(mods, order);
+	if (!status.ok)
+	{
+		LOG_FATAL("MODDING") << status.what;
+		return status;
+	}
+
+	lua_State* state = m_luaState.lua_state();
+	for (std::size_t i = 0; i < order.size(); ++i)
 	{
-		std::size_t lastPass = toLoad.size();
+		const Mod& mod = mods[order[i]];
 
-		for (std::size_t i = 0; i < toLoad.size(); ++i)
+		m_currentModPath = mod.getPath() + "/" + mod.getName() + "/";
+		m_currentModName = mod.getName();
+
+		std::string error;
+		if (!m_scriptCache.load(state, m_currentModPath + "Init.lua", error) ||
+		    !run(state, error))
 		{
-			Mod& mod       = toLoad.front();
-			bool satisfied = true;
+			std::string errString = "An error occured loading ";
+			errString += mod.getName();
+			errString += ": ";
+			errString += error;
 
-			for (auto& dependency : mod.getDependencies())
-			{
-				if (std::find(loadedMods.begin(), loadedMods.end(),
-				              dependency) == loadedMods.end())
-				{
-					satisfied = false;
-				}
-			}
+			LOG_FATAL("MODDING") << errString;
 
-			if (satisfied)
-			{
-				m_currentModPath = mod.getPath() + "/" + mod.getName() + "/";
-				sol::protected_function_result pfr =
-				    m_luaState.safe_script_file(m_currentModPath + "Init.lua",
-				                                &sol::script_pass_on_error);
+			return {false, errString};
+		}
 
-				loadedMods.push_back(mod.getName());
+		if (progress != nullptr)
+		{
+			*progress = static_cast<float>(i + 1) / order.size();
+		}
+	}
 
-				// error occured if return is not valid.
-				if (!pfr.valid())
-				{
-					sol::error err = pfr;
+	LOG_INFO("MODDING") << "Loaded " << order.size() << " mods, "
+	                    << m_scriptCache.getHits()
+	                    << " from the bytecode cache.";
 
-					std::string errString = "An error occured loading ";
-					errString += mod.getName();
-					errString += ": ";
-					errString += err.what();
+	// no need to put in something for "what", since nothing went wrong.
+	return {true};
+}
 
-					LOG_FATAL("MODDING") << errString;
+bool ModManager::run(lua_State* state, std::string& error)
+{
+	if (lua_pcall(state, 0, 0, 0) != LUA_OK)
+	{
+		const char* message = lua_tostring(state, -1);
+		error = message != nullptr ? message : "unknown error";
+		lua_pop(state, 1);
+		return false;
+	}
 
-					return {false, errString};
-				}
-			}
-			else
+	return true;
+}
+
+ModManager::Status ModManager::sortByDependencies(
+    const std::vector<Mod>& mods, std::vector<std::size_t>& order)
+{
+	std::unordered_map<std::string, std::size_t> index;
+	for (std::size_t i = 0; i < mods.size(); ++i)
+	{
+		index.emplace(mods[i].getName(), i);
+	}
+
+	// the number of dependencies each mod is still waiting on, and the
+	// mods waiting on each mod.
+	std::vector<std::size_t>              waiting(mods.size(), 0);
+	std::vector<std::vector<std::size_t>> dependents(mods.size());
+	for (std::size_t i = 0; i < mods.size(); ++i)
+	{
+		for (const auto& dependency : mods[i].getDependencies())
+		{
+			auto it = index.find(dependency);
+			if (it == index.end())
 			{
-				toLoad.push(toLoad.front());
+				return {false, "The mod: " + mods[i].getName() +
+				                   " depends on " + dependency +
+				                   ", which is not in the mod list."};
 			}
 
-			toLoad.pop();
+			++waiting[i];
+			dependents[it->second].push_back(i);
+		}
+	}
+
+	// the lowest index first, so mods that don't depend on each other load
+	// in the order they were listed.
+	std::priority_queue<std::size_t, std::vector<std::size_t>,
+	                    std::greater<std::size_t>>
+	    ready;
+	for (std::size_t i = 0; i < mods.size(); ++i)
+	{
+		if (waiting[i] == 0)
+		{
+			ready.push(i);
 		}
+	}
 
-		if (lastPass == toLoad.size())
+	order.clear();
+	while (!ready.empty())
+	{
+		const std::size_t mod = ready.top();
+		ready.pop();
+		order.push_back(mod);
+
+		for (const std::size_t dependent : dependents[mod])
 		{
-			std::string err = "The mod: ";
-			err += toLoad.front().getName();
-			err += " is missing one or more dependencies, please resolve this "
-			       "issue before continuing.";
+			if (--waiting[dependent] == 0)
+			{
+				ready.push(dependent);
+			}
+		}
+	}
 
-			LOG_FATAL("MODDING") << err;
+	if (order.size() == mods.size())
+	{
+		return {true};
+	}
+
+	// every mod left waits on another mod left, so following those from
+	// any of them has to come back around.
+	std::size_t mod = 0;
+	while (waiting[mod] == 0)
+	{
+		++mod;
+	}
 
-			return {false, err};
+	std::vector<std::size_t> path;
+	std::vector<std::size_t> visited(mods.size(), mods.size());
+	while (visited[mod] == mods.size())
+	{
+		visited[mod] = path.size();
+		path.push_back(mod);
+
+		for (const auto& dependency : mods[mod].getDependencies())
+		{
+			const std::size_t next = index[dependency];
+			if (waiting[next] != 0)
+			{
+				mod = next;
+				break;
+			}
 		}
 	}
 
-	// no need to put in something for "what", since nothing went wrong.
-	return {true};
+	std::string cycle;
+	for (std::size_t i = visited[mod]; i < path.size(); ++i)
+	{
+		cycle += mods[path[i]].getName() + " -> ";
+	}
+	cycle += mods[mod].getName();
+
+	return {false, "The mods have a circular dependency: " + cycle +
+	                   ", please resolve this issue before continuing."};
 }
 
 void ModManager::cleanup() {}
@@ -173,3 +269,8 @@ const std::string& ModManager::getCurrentModPath() const
 {
 	return m_currentModPath;
 }
+
+const std::string& ModManager::getCurrentModName() const
+{
+	return m_currentModName;
+}
@@ -0,0 +1,207 @@
+// Copyright 2019-20 Genten Studios
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+// may be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <Common/CMS/ScriptCache.hpp>
+#include <Common/Logger.hpp>
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+using namespace phx::cms;
+
+namespace
+{
+	// "PHXL", so anything else in the directory is never taken for a cache.
+	constexpr std::uint32_t MAGIC = 0x4C584850;
+
+	struct Header
+	{
+		std::uint32_t magic;
+		std::uint32_t version;
+		std::uint64_t hash;
+	};
+
+	// FNV-1a, it only has to notice a script changing.
+	std::uint64_t hashOf(const std::string& data)
+	{
+		std::uint64_t hash = 14695981039346656037ull;
+		for (const char c : data)
+		{
+			hash ^= static_cast<unsigned char>(c);
+			hash *= 1099511628211ull;
+		}
+
+		return hash;
+	}
+
+	bool readFile(const std::string& path, std::string& contents)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file.is_open())
+		{
+			return false;
+		}
+
+		std::ostringstream stream;
+		stream << file.rdbuf();
+		contents = stream.str();
+		return true;
+	}
+
+	int writeChunk(lua_State*, const void* data, std::size_t size,
+	               void* buffer)
+	{
+		static_cast<std::string*>(buffer)->append(
+		    static_cast<const char*>(data), size);
+		return 0;
+	}
+} // namespace
+
+ScriptCache::ScriptCache(std::string directory)
+    : m_directory(std::move(directory))
+{
+}
+
+bool ScriptCache::load(lua_State* state, const std::string& path,
+                       std::string& error)
+{
+	std::string source;
+	if (!readFile(path, source))
+	{
+		error = "Couldn't open " + path;
+		return false;
+	}
+
+	// the same as luaL_loadfile, a byte order mark and a first line
+	// starting with # are skipped, the newline is kept for line numbers.
+	if (source.compare(0, 3, "\xEF\xBB\xBF") == 0)
+	{
+		source.erase(0, 3);
+	}
+	if (!source.empty() && source[0] == '#')
+	{
+		source.erase(0, source.find('\n'));
+	}
+
+	const std::uint64_t hash      = hashOf(source);
+	const std::string   chunkName = "@" + path;
+
+	std::string cachePath;
+	if (!m_directory.empty())
+	{
+		char name[32];
+		std::snprintf(name, sizeof(name), "%016llx.luac",
+		              static_cast<unsigned long long>(hashOf(path)));
+		cachePath = m_directory + "/" + name;
+
+		std::string cached;
+		if (readFile(cachePath, cached) && cached.size() > sizeof(Header))
+		{
+			Header header;
+			std::memcpy(&header, cached.data(), sizeof(Header));
+
+			if (header.magic == MAGIC && header.version == LUA_VERSION_NUM &&
+			    header.hash == hash)
+			{
+				// Lua checks the rest of its own header, so bytecode from
+				// a build with different number types fails here too.
+				if (luaL_loadbufferx(state, cached.data() + sizeof(Header),
+				                     cached.size() - sizeof(Header),
+				                     chunkName.c_str(), "b") == LUA_OK)
+				{
+					++m_hits;
+					return true;
+				}
+
+				lua_pop(state, 1);
+			}
+		}
+	}
+
+	if (luaL_loadbufferx(state, source.data(), source.size(),
+	                     chunkName.c_str(), nullptr) != LUA_OK)
+	{
+		error = lua_tostring(state, -1);
+		lua_pop(state, 1);
+		return false;
+	}
+
+	++m_misses;
+
+	if (!cachePath.empty())
+	{
+		store(state, cachePath, hash);
+	}
+
+	return true;
+}
+
+void ScriptCache::store(lua_State* state, const std::string& cachePath,
+                        std::uint64_t hash) const
+{
+	namespace fs = std::filesystem;
+
+	Header header = {MAGIC, LUA_VERSION_NUM, hash};
+
+	std::string data(reinterpret_cast<const char*>(&header), sizeof(Header));
+
+	// debug information is kept so errors still have line numbers.
+	if (lua_dump(state, &writeChunk, &data, 0) != 0)
+	{
+		return;
+	}
+
+	std::error_code ec;
+	fs::create_directories(m_directory, ec);
+
+	// the client and server can share a directory, so the file is written
+	// aside and renamed over the old one to never leave half of it.
+	const std::string temporary =
+	    cachePath + "." + std::to_string(std::random_device {}()) + ".tmp";
+	{
+		std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			LOG_WARNING("MODDING")
+			    << "Couldn't write the bytecode cache " << cachePath << ".";
+			return;
+		}
+
+		file.write(data.data(), static_cast<std::streamsize>(data.size()));
+	}
+
+	fs::rename(temporary, cachePath, ec);
+	if (ec)
+	{
+		fs::remove(temporary, ec);
+	}
+}
@@ -28,14 +28,129 @@
 
 #include <Common/Input.hpp>
 
-phx::Serializer& phx::InputState::operator>>(Serializer& serializer) const
+#include <cmath>
+
+using namespace phx;
+
+std::uint8_t InputState::getFlags() const
+{
+	return static_cast<std::uint8_t>(
+	    (forward ? FORWARD : 0) | (backward ? BACKWARD : 0) |
+	    (left ? LEFT : 0) | (right ? RIGHT : 0) | (up ? UP : 0) |
+	    (down ? DOWN : 0));
+}
+
+void InputState::setFlags(std::uint8_t flags)
 {
-	return serializer << forward << backward << left << right << up << down
-	                  << rotation.x << rotation.y << sequence;
+	forward  = (flags & FORWARD) != 0;
+	backward = (flags & BACKWARD) != 0;
+	left     = (flags & LEFT) != 0;
+	right    = (flags & RIGHT) != 0;
+	up       = (flags & UP) != 0;
+	down     = (flags & DOWN) != 0;
 }
 
-phx::Serializer& phx::InputState::operator<<(Serializer& serializer)
+std::uint16_t InputState::quantizeRotation(int rotation)
 {
-	return serializer >> forward >> backward >> left >> right >> up >> down >>
-	       rotation.x >> rotation.y >> sequence;
+	const double turns = static_cast<double>(rotation) / ROTATION_UNITS_PER_TURN;
+
+	// wrapping through a signed 64 bit integer keeps negative rotations and
+	// rotations of more than one turn in range.
+	return static_cast<std::uint16_t>(
+	    static_cast<std::int64_t>(std::llround(turns * 65536.0)) & 0xFFFF);
+}
+
+int InputState::dequantizeRotation(std::uint16_t rotation)
+{
+	const auto turns = static_cast<double>(static_cast<std::int16_t>(rotation));
+	return static_cast<int>(
+	    std::lround(turns / 65536.0 * ROTATION_UNITS_PER_TURN));
+}
+
+std::size_t InputState::unwrapSequence(std::uint16_t sequence,
+                                       std::size_t   reference)
+{
+	const auto difference = static_cast<std::int16_t>(
+	    static_cast<std::uint16_t>(sequence - (reference & 0xFFFF)));
+
+	if (difference < 0 &&
+	    reference < static_cast<std::size_t>(-difference))
+	{
+		return sequence;
+	}
+
+	return reference + static_cast<std::size_t>(
+	                       static_cast<std::ptrdiff_t>(difference));
+}
+
+Serializer& InputState::operator>>(Serializer& serializer) const
+{
+	return serializer << getFlags() << quantizeRotation(rotation.x)
+	                  << quantizeRotation(rotation.y)
+	                  << quantizeRotation(rotation.z)
+	                  << static_cast<std::uint16_t>(sequence & 0xFFFF);
+}
+
+Serializer& InputState::operator<<(Serializer& serializer)
+{
+	std::uint8_t  flags;
+	std::uint16_t x;
+	std::uint16_t y;
+	std::uint16_t z;
+	std::uint16_t wrapped;
+
+	serializer >> flags >> x >> y >> z >> wrapped;
+
+	setFlags(flags);
+	rotation.x = dequantizeRotation(x);
+	rotation.y = dequantizeRotation(y);
+	rotation.z = dequantizeRotation(z);
+	sequence   = wrapped;
+
+	return serializer;
+}
+
+InputHistory::InputHistory(std::size_t redundancy)
+    : m_redundancy(redundancy == 0 ? 1 : redundancy)
+{
+}
+
+void InputHistory::push(const InputState& state)
+{
+	m_states.push_front(state);
+
+	while (m_states.size() > m_redundancy)
+	{
+		m_states.pop_back();
+	}
+}
+
+void InputHistory::clear() { m_states.clear(); }
+
+Serializer& InputHistory::operator>>(Serializer& serializer) const
+{
+	serializer << static_cast<std::uint8_t>(m_states.size());
+
+	for (const auto& state : m_states)
+	{
+		serializer << state;
+	}
+
+	return serializer;
+}
+
+Serializer& InputHistory::operator<<(Serializer& serializer)
+{
+	std::uint8_t count = 0;
+	serializer >> count;
+
+	m_states.clear();
+	for (std::uint8_t i = 0; i < count; ++i)
+	{
+		InputState state;
+		serializer >> state;
+		m_states.push_back(state);
+	}
+
+	return serializer;
 }
@@ -33,7 +33,9 @@
 #	include <Windows.h>
 #endif
 
+#include <chrono>
 #include <cstdio>
+#include <cstring>
 
 using namespace phx;
 
@@ -69,74 +71,119 @@ enum class TextColor
 	WHITE  = 4,
 };
 
+#ifdef ENGINE_PLATFORM_WINDOWS
 static void setTerminalTextColor(TextColor color)
 {
-#ifdef ENGINE_PLATFORM_WINDOWS
 	HANDLE console = GetStdHandle(STD_OUTPUT_HANDLE);
 	SetConsoleTextAttribute(console,
 	                        s_windowsTermCol[static_cast<std::size_t>(color)]);
-#endif
-
-#if defined(ENGINE_PLATFORM_LINUX) || defined(ENGINE_PLATFORM_APPLE)
-	printf("%s", s_linuxTermCol[static_cast<std::size_t>(color)]);
-#endif
 }
+#endif
 
-static void setTerminalTextColor(LogVerbosity vb)
+static TextColor getTextColor(LogVerbosity vb)
 {
-	TextColor color;
-
 	switch (vb)
 	{
 	case LogVerbosity::FATAL:
-		color = TextColor::RED;
-		break;
+		return TextColor::RED;
 	case LogVerbosity::WARNING:
-		color = TextColor::YELLOW;
-		break;
+		return TextColor::YELLOW;
 	case LogVerbosity::INFO:
-		color = TextColor::WHITE;
-		break;
+		return TextColor::WHITE;
 	case LogVerbosity::DEBUG:
-		color = TextColor::GREEN;
-		break;
+		return TextColor::GREEN;
 	default:
-		color = TextColor::WHITE;
-		break;
+		return TextColor::WHITE;
 	}
+}
 
+static void writeConsole(std::string& batch)
+{
+	std::fwrite(batch.data(), 1, batch.size(), stdout);
+	std::fflush(stdout);
+	batch.clear();
+}
+
+// appends a color change to a batch of console output.
+static void appendTerminalTextColor(std::string& batch, TextColor color)
+{
+#ifdef ENGINE_PLATFORM_WINDOWS
+	// the color belongs to the console rather than the text, so everything
+	// batched so far has to be written before it can change.
+	writeConsole(batch);
 	setTerminalTextColor(color);
+#endif
+
+#if defined(ENGINE_PLATFORM_LINUX) || defined(ENGINE_PLATFORM_APPLE)
+	batch += s_linuxTermCol[static_cast<std::size_t>(color)];
+#endif
 }
 
-Logger* Logger::m_instance = nullptr;
+static void appendRecord(std::string& batch, const LogRecord& record)
+{
+	batch += '[';
+	batch += g_logVerbToText[static_cast<int>(record.verbosity)];
+	batch += ']';
+
+#ifdef ENGINE_DEBUG
+	if (record.verbosity != LogVerbosity::INFO)
+	{
+		batch += ' ';
+		batch += record.file;
+		batch += ':';
+		batch += std::to_string(record.line);
+		batch += ' ';
+	}
+#endif
 
-Log::Log(LogVerbosity vb, const std::string& errFile, int errLineNo,
-         const std::string& module)
+	batch += '[';
+	batch += record.component;
+	batch += "] ";
+	batch.append(record.text, record.length);
+	batch += '\n';
+}
+
+// rounds the queue size up to a power of two so slots can be found with a
+// mask.
+static std::size_t queueCapacity(std::size_t size)
 {
-	verbosity = vb;
-	errorFile = errFile;
-	errorLine = errLineNo;
-	component = module;
+	std::size_t capacity = 2;
+	while (capacity < size)
+	{
+		capacity <<= 1;
+	}
+
+	return capacity;
 }
 
-Log::Log(const Log& rhs)
+Logger* Logger::m_instance = nullptr;
+
+void LogRecord::assign(const LogRecord& other)
 {
-	stream    = std::stringstream(rhs.stream.str());
-	verbosity = rhs.verbosity;
-	errorFile = rhs.errorFile;
-	errorLine = rhs.errorLine;
-	component = rhs.component;
+	verbosity = other.verbosity;
+	file      = other.file;
+	line      = other.line;
+	length    = other.length;
+	std::memcpy(component, other.component, COMPONENT_SIZE);
+	std::memcpy(text, other.text, length);
 }
 
-Log& Log::operator=(const Log& rhs)
+Log::Log(LogVerbosity vb, const char* errFile, int errLineNo,
+         const char* module)
+    : m_buffer(m_record.text, m_record.text + LogRecord::TEXT_SIZE),
+      m_stream(&m_buffer)
 {
-	stream    = std::stringstream(rhs.stream.str());
-	verbosity = rhs.verbosity;
-	errorFile = rhs.errorFile;
-	errorLine = rhs.errorLine;
-	component = rhs.component;
+	m_record.verbosity = vb;
+	m_record.file      = errFile;
+	m_record.line      = errLineNo;
 
-	return *this;
+	std::strncpy(m_record.component, module, LogRecord::COMPONENT_SIZE - 1);
+}
+
+const LogRecord& Log::getRecord()
+{
+	m_record.length = static_cast<std::uint16_t>(m_buffer.size());
+	return m_record;
 }
 
 void Logger::initialize(const LoggerConfig& config)
@@ -144,46 +191,76 @@ void Logger::initialize(const LoggerConfig& config)
 	m_instance = new Logger(config);
 }
 
-void Logger::teardown() { delete m_instance; }
-
-LogVerbosity Logger::getVerbosity() const { return m_verbosity; }
+void Logger::teardown()
+{
+	delete m_instance;
+	m_instance = nullptr;
+}
 
-void Logger::log(const Log& log)
+void Logger::log(Log& log)
 {
-	if (log.verbosity > m_verbosity)
+	const LogRecord& record = log.getRecord();
+
+	if (record.verbosity > m_verbosity)
 	{
 		return;
 	}
 
-	if (!m_threaded || log.verbosity == LogVerbosity::FATAL)
+	if (!m_threaded || record.verbosity == LogVerbosity::FATAL)
 	{
-		loggerInternal(log);
+		loggerInternal(record);
 		return;
 	}
 
-	std::lock_guard<std::mutex> lock(m_mutex);
-	m_messages.push_back(log);
+	while (!enqueue(record))
+	{
+		if (m_overflow == LogOverflow::DROP || !m_threadRunning)
+		{
+			m_dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		// the queue is full, wait for the logging thread to catch up.
+		m_cond.notify_one();
+		std::this_thread::yield();
+	}
+
+	// only wake the logging thread if it's actually asleep, otherwise it'll
+	// pick the message up with the rest of its batch.
+	if (m_waiting.load(std::memory_order_acquire))
+	{
+		m_cond.notify_one();
+	}
 }
 
-void Logger::operator+=(const Log& stream) { log(stream); }
+void Logger::operator+=(Log& stream) { log(stream); }
 
 Logger::Logger(const LoggerConfig& config)
 {
 	m_threaded     = config.threaded;
+	m_overflow     = config.overflow;
 	m_verbosity    = config.verbosity;
 	m_logToConsole = config.logToConsole;
 
+	m_file.open(config.logFile, std::ios_base::app);
+
 	if (m_threaded)
 	{
+		m_capacity = queueCapacity(config.queueSize);
+		m_slots    = std::make_unique<Slot[]>(m_capacity);
+		for (std::size_t i = 0; i < m_capacity; ++i)
+		{
+			m_slots[i].sequence.store(i, std::memory_order_relaxed);
+		}
+
 		m_threadRunning    = true;
 		std::thread thread = std::thread(&Logger::loggerThreadHandle, this);
 		m_worker.swap(thread);
 	}
 
-	m_file.open(config.logFile, std::ios_base::app);
 	if (!m_file.is_open())
 	{
-		Log message = {LogVerbosity::INFO, "", 0, "LOGGING"};
+		Log message(LogVerbosity::INFO, "", 0, "LOGGING");
 		message << "A log file was not specified, logging only to console.";
 		log(message);
 	}
@@ -191,74 +268,169 @@ Logger::Logger(const LoggerConfig& config)
 
 Logger::~Logger()
 {
-	printf("\n");
-
 	if (m_threaded)
 	{
-		m_threadRunning = false;
+		{
+			std::lock_guard<std::mutex> lock(m_condMutex);
+			m_threadRunning = false;
+		}
 		m_cond.notify_all();
 
 		if (m_worker.joinable())
 			m_worker.join();
 	}
 
+	printf("\n");
+
 	m_file.close();
 }
 
-void Logger::loggerInternal(const Log& log)
+bool Logger::enqueue(const LogRecord& record)
 {
-	if (m_logToConsole)
+	std::size_t pos = m_head.load(std::memory_order_relaxed);
+
+	while (true)
 	{
-		if (log.verbosity == LogVerbosity::INFO)
+		Slot&             slot = m_slots[pos & (m_capacity - 1)];
+		const std::size_t sequence =
+		    slot.sequence.load(std::memory_order_acquire);
+
+		const auto difference = static_cast<std::ptrdiff_t>(sequence) -
+		                        static_cast<std::ptrdiff_t>(pos);
+
+		if (difference == 0)
 		{
-			setTerminalTextColor(LogVerbosity::INFO);
-			printf("[%s][%s] %s\n",
-			       g_logVerbToText[static_cast<int>(log.verbosity)],
-			       log.component.c_str(), log.stream.str().c_str());
-			setTerminalTextColor(TextColor::WHITE);
+			// the slot is free, try to claim it.
+			if (m_head.compare_exchange_weak(pos, pos + 1,
+			                                 std::memory_order_relaxed))
+			{
+				slot.record.assign(record);
+				slot.sequence.store(pos + 1, std::memory_order_release);
+				return true;
+			}
+		}
+		else if (difference < 0)
+		{
+			// the logging thread hasn't read this slot yet, we're full.
+			return false;
 		}
 		else
 		{
-			setTerminalTextColor(log.verbosity);
-#ifdef ENGINE_DEBUG
-			printf("[%s] %s:%i [%s] %s\n",
-			       g_logVerbToText[static_cast<int>(log.verbosity)],
-			       log.errorFile.c_str(), log.errorLine, log.component.c_str(),
-			       log.stream.str().c_str());
-			setTerminalTextColor(TextColor::WHITE);
-#else
-			printf("[%s][%s] %s\n",
-			       g_logVerbToText[static_cast<int>(log.verbosity)],
-			       log.component.c_str(), log.stream.str().c_str());
-			setTerminalTextColor(TextColor::WHITE);
-#endif
+			// another thread claimed the slot first.
+			pos = m_head.load(std::memory_order_relaxed);
 		}
 	}
 }
 
+bool Logger::dequeue(LogRecord& record)
+{
+	Slot& slot = m_slots[m_tail & (m_capacity - 1)];
+	if (slot.sequence.load(std::memory_order_acquire) != m_tail + 1)
+	{
+		return false;
+	}
+
+	record.assign(slot.record);
+	slot.sequence.store(m_tail + m_capacity, std::memory_order_release);
+	++m_tail;
+
+	return true;
+}
+
+void Logger::write(const LogRecord& record)
+{
+	if (m_logToConsole)
+	{
+		appendTerminalTextColor(m_consoleBatch, getTextColor(record.verbosity));
+		appendRecord(m_consoleBatch, record);
+		appendTerminalTextColor(m_consoleBatch, TextColor::WHITE);
+	}
+
+	if (m_file.is_open())
+	{
+		appendRecord(m_fileBatch, record);
+	}
+}
+
+void Logger::flush()
+{
+	if (!m_consoleBatch.empty())
+	{
+		writeConsole(m_consoleBatch);
+	}
+
+	if (!m_fileBatch.empty())
+	{
+		m_file.write(m_fileBatch.data(),
+		             static_cast<std::streamsize>(m_fileBatch.size()));
+		m_file.flush();
+		m_fileBatch.clear();
+	}
+}
+
+void Logger::loggerInternal(const LogRecord& record)
+{
+	std::lock_guard<std::mutex> lock(m_outputMutex);
+	write(record);
+	flush();
+}
+
 void Logger::loggerThreadHandle()
 {
+	// messages are written out in batches, this bounds how long the console
+	// and log file go without an update under heavy logging.
+	static const std::size_t MAX_BATCH = 256;
+
+	LogRecord record;
+
 	while (true)
 	{
-		Log log;
-
+		std::size_t count = 0;
 		{
-			std::unique_lock<std::mutex> lock(m_mutex);
+			std::lock_guard<std::mutex> lock(m_outputMutex);
 
-			m_cond.wait(lock, [this] {
-				return !m_threadRunning || !m_messages.empty();
-			});
+			while (count < MAX_BATCH && dequeue(record))
+			{
+				write(record);
+				++count;
+			}
 
-			if (!m_threadRunning && m_messages.empty())
+			const std::size_t dropped =
+			    m_dropped.exchange(0, std::memory_order_relaxed);
+			if (dropped > 0)
 			{
-				return;
+				Log message(LogVerbosity::WARNING, "", 0, "LOGGING");
+				message << dropped
+				        << " messages were dropped, the log queue was full.";
+				write(message.getRecord());
 			}
 
-			log = m_messages.front();
-			m_messages.pop_front();
+			flush();
+		}
+
+		if (count == MAX_BATCH)
+		{
+			continue;
 		}
 
-		loggerInternal(log);
+		std::unique_lock<std::mutex> lock(m_condMutex);
+		if (!m_threadRunning)
+		{
+			// producers may still have been finishing off messages while
+			// we were writing the last batch.
+			std::lock_guard<std::mutex> output(m_outputMutex);
+			while (dequeue(record))
+			{
+				write(record);
+			}
+			flush();
+			return;
+		}
+
+		// sleep until a producer wakes us, the timeout covers a message that
+		// was queued just before we said we were waiting.
+		m_waiting.store(true, std::memory_order_release);
+		m_cond.wait_for(lock, std::chrono::milliseconds(10));
+		m_waiting.store(false, std::memory_order_release);
 	}
 }
-
@@ -0,0 +1,494 @@
+// Copyright 2019-20 Genten Studios
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+// may be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <Common/Math/Noise.hpp>
+
+#include <cmath>
+#include <cstring>
+
+#if defined(__AVX2__)
+#	include <immintrin.h>
+#	define PHX_NOISE_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	if defined(__SSE4_1__)
+#		include <smmintrin.h>
+#	else
+#		include <emmintrin.h>
+#	endif
+#	define PHX_NOISE_SSE
+#endif
+
+using namespace phx::math;
+
+namespace
+{
+	// lattice coordinates are multiplied by these before being mixed, so
+	// neighbouring points hash to unrelated gradients.
+	constexpr std::uint32_t PRIME_X = 0x9E3779B1u;
+	constexpr std::uint32_t PRIME_Y = 0x85EBCA77u;
+	constexpr std::uint32_t PRIME_Z = 0xC2B2AE3Du;
+	constexpr std::uint32_t MIX     = 0x27D4EB2Du;
+
+	/*
+	 * The noise is written once against these "ops" structs, which wrap the
+	 * handful of operations it needs for a plain float, 4 floats in an SSE
+	 * register or 8 in an AVX register. Masks are whatever comparisons give
+	 * back, select(mask, a, b) picks a where the mask is set.
+	 */
+
+	struct ScalarOps
+	{
+		using Float = float;
+		using Int   = std::uint32_t;
+		using Mask  = bool;
+
+		static constexpr std::size_t WIDTH = 1;
+
+		static Float load(const float* in) { return *in; }
+		static void  store(float* out, Float value) { *out = value; }
+
+		static Float set(float value) { return value; }
+		static Int   seti(std::uint32_t value) { return value; }
+
+		static Float add(Float a, Float b) { return a + b; }
+		static Float sub(Float a, Float b) { return a - b; }
+		static Float mul(Float a, Float b) { return a * b; }
+		static Float floor(Float a) { return std::floor(a); }
+
+		// only ever given whole numbers, so nothing is truncated.
+		static Int toInt(Float a)
+		{
+			return static_cast<Int>(static_cast<std::int32_t>(a));
+		}
+
+		static Int addi(Int a, Int b) { return a + b; }
+		static Int muli(Int a, Int b) { return a * b; }
+		static Int xori(Int a, Int b) { return a ^ b; }
+		static Int andi(Int a, Int b) { return a & b; }
+
+		template <int N>
+		static Int srli(Int a)
+		{
+			return a >> N;
+		}
+
+		template <int N>
+		static Int slli(Int a)
+		{
+			return a << N;
+		}
+
+		static Mask eqi(Int a, Int b) { return a == b; }
+		static Mask lti(Int a, Int b) { return a < b; }
+		static Mask orMask(Mask a, Mask b) { return a || b; }
+
+		static Float select(Mask mask, Float a, Float b)
+		{
+			return mask ? a : b;
+		}
+
+		// flips the sign of a wherever bit 31 of sign is set.
+		static Float flipSign(Float a, Int sign)
+		{
+			std::uint32_t bits;
+			std::memcpy(&bits, &a, sizeof(bits));
+			bits ^= sign;
+			std::memcpy(&a, &bits, sizeof(bits));
+			return a;
+		}
+	};
+
+#if defined(PHX_NOISE_SSE)
+	struct SseOps
+	{
+		using Float = __m128;
+		using Int   = __m128i;
+		using Mask  = __m128;
+
+		static constexpr std::size_t WIDTH = 4;
+
+		static Float load(const float* in) { return _mm_loadu_ps(in); }
+		static void  store(float* out, Float value)
+		{
+			_mm_storeu_ps(out, value);
+		}
+
+		static Float set(float value) { return _mm_set1_ps(value); }
+		static Int   seti(std::uint32_t value)
+		{
+			return _mm_set1_epi32(static_cast<int>(value));
+		}
+
+		static Float add(Float a, Float b) { return _mm_add_ps(a, b); }
+		static Float sub(Float a, Float b) { return _mm_sub_ps(a, b); }
+		static Float mul(Float a, Float b) { return _mm_mul_ps(a, b); }
+
+		static Float floor(Float a)
+		{
+#	if defined(__SSE4_1__)
+			return _mm_floor_ps(a);
+#	else
+			// truncating rounds negative numbers up, so take one off those.
+			const Float truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(a));
+			return _mm_sub_ps(truncated,
+			                  _mm_and_ps(_mm_cmpgt_ps(truncated, a),
+			                             _mm_set1_ps(1.f)));
+#	endif
+		}
+
+		static Int toInt(Float a) { return _mm_cvttps_epi32(a); }
+
+		static Int addi(Int a, Int b) { return _mm_add_epi32(a, b); }
+
+		static Int muli(Int a, Int b)
+		{
+#	if defined(__SSE4_1__)
+			return _mm_mullo_epi32(a, b);
+#	else
+			// SSE2 can only multiply the even lanes, so do it twice.
+			const Int even = _mm_mul_epu32(a, b);
+			const Int odd =
+			    _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+			return _mm_unpacklo_epi32(
+			    _mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+			    _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+#	endif
+		}
+
+		static Int xori(Int a, Int b) { return _mm_xor_si128(a, b); }
+		static Int andi(Int a, Int b) { return _mm_and_si128(a, b); }
+
+		template <int N>
+		static Int srli(Int a)
+		{
+			return _mm_srli_epi32(a, N);
+		}
+
+		template <int N>
+		static Int slli(Int a)
+		{
+			return _mm_slli_epi32(a, N);
+		}
+
+		static Mask eqi(Int a, Int b)
+		{
+			return _mm_castsi128_ps(_mm_cmpeq_epi32(a, b));
+		}
+
+		// only used on small positive numbers, so a signed compare is fine.
+		static Mask lti(Int a, Int b)
+		{
+			return _mm_castsi128_ps(_mm_cmplt_epi32(a, b));
+		}
+
+		static Mask orMask(Mask a, Mask b) { return _mm_or_ps(a, b); }
+
+		static Float select(Mask mask, Float a, Float b)
+		{
+#	if defined(__SSE4_1__)
+			return _mm_blendv_ps(b, a, mask);
+#	else
+			return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+#	endif
+		}
+
+		static Float flipSign(Float a, Int sign)
+		{
+			return _mm_xor_ps(a, _mm_castsi128_ps(sign));
+		}
+	};
+#endif
+
+#if defined(PHX_NOISE_AVX2)
+	struct AvxOps
+	{
+		using Float = __m256;
+		using Int   = __m256i;
+		using Mask  = __m256;
+
+		static constexpr std::size_t WIDTH = 8;
+
+		static Float load(const float* in) { return _mm256_loadu_ps(in); }
+		static void  store(float* out, Float value)
+		{
+			_mm256_storeu_ps(out, value);
+		}
+
+		static Float set(float value) { return _mm256_set1_ps(value); }
+		static Int   seti(std::uint32_t value)
+		{
+			return _mm256_set1_epi32(static_cast<int>(value));
+		}
+
+		static Float add(Float a, Float b) { return _mm256_add_ps(a, b); }
+		static Float sub(Float a, Float b) { return _mm256_sub_ps(a, b); }
+		static Float mul(Float a, Float b) { return _mm256_mul_ps(a, b); }
+		static Float floor(Float a) { return _mm256_floor_ps(a); }
+
+		static Int toInt(Float a) { return _mm256_cvttps_epi32(a); }
+
+		static Int addi(Int a, Int b) { return _mm256_add_epi32(a, b); }
+		static Int muli(Int a, Int b) { return _mm256_mullo_epi32(a, b); }
+		static Int xori(Int a, Int b) { return _mm256_xor_si256(a, b); }
+		static Int andi(Int a, Int b) { return _mm256_and_si256(a, b); }
+
+		template <int N>
+		static Int srli(Int a)
+		{
+			return _mm256_srli_epi32(a, N);
+		}
+
+		template <int N>
+		static Int slli(Int a)
+		{
+			return _mm256_slli_epi32(a, N);
+		}
+
+		static Mask eqi(Int a, Int b)
+		{
+			return _mm256_castsi256_ps(_mm256_cmpeq_epi32(a, b));
+		}
+
+		static Mask lti(Int a, Int b)
+		{
+			return _mm256_castsi256_ps(_mm256_cmpgt_epi32(b, a));
+		}
+
+		static Mask orMask(Mask a, Mask b) { return _mm256_or_ps(a, b); }
+
+		static Float select(Mask mask, Float a, Float b)
+		{
+			return _mm256_blendv_ps(b, a, mask);
+		}
+
+		static Float flipSign(Float a, Int sign)
+		{
+			return _mm256_xor_ps(a, _mm256_castsi256_ps(sign));
+		}
+	};
+
+	using BatchOps = AvxOps;
+#elif defined(PHX_NOISE_SSE)
+	using BatchOps = SseOps;
+#else
+	using BatchOps = ScalarOps;
+#endif
+
+	template <typename Ops>
+	typename Ops::Int hash(typename Ops::Int x, typename Ops::Int y,
+	                       typename Ops::Int z, typename Ops::Int seed)
+	{
+		typename Ops::Int h = Ops::xori(Ops::xori(x, y), Ops::xori(z, seed));
+		h                   = Ops::muli(h, Ops::seti(MIX));
+		return Ops::xori(h, Ops::template srli<15>(h));
+	}
+
+	// picks one of Perlin's 12 gradients (and 4 repeats) from the hash and
+	// dots it with the offset from the lattice point.
+	template <typename Ops>
+	typename Ops::Float grad(typename Ops::Int hash, typename Ops::Float x,
+	                         typename Ops::Float y, typename Ops::Float z)
+	{
+		const typename Ops::Int h = Ops::andi(hash, Ops::seti(15));
+
+		const typename Ops::Mask below8 = Ops::lti(h, Ops::seti(8));
+		const typename Ops::Mask below4 = Ops::lti(h, Ops::seti(4));
+		const typename Ops::Mask useX   = Ops::orMask(
+		    Ops::eqi(h, Ops::seti(12)), Ops::eqi(h, Ops::seti(14)));
+
+		typename Ops::Float u = Ops::select(below8, x, y);
+		typename Ops::Float v =
+		    Ops::select(below4, y, Ops::select(useX, x, z));
+
+		const typename Ops::Int one = Ops::seti(1);
+		const typename Ops::Int two = Ops::seti(2);
+		u = Ops::flipSign(u, Ops::template slli<31>(Ops::andi(h, one)));
+		v = Ops::flipSign(v, Ops::template slli<30>(Ops::andi(h, two)));
+		return Ops::add(u, v);
+	}
+
+	template <typename Ops>
+	typename Ops::Float fade(typename Ops::Float t)
+	{
+		// 6t^5 - 15t^4 + 10t^3
+		typename Ops::Float f = Ops::sub(Ops::mul(t, Ops::set(6.f)),
+		                                 Ops::set(15.f));
+		f = Ops::add(Ops::mul(t, f), Ops::set(10.f));
+		return Ops::mul(Ops::mul(Ops::mul(t, t), t), f);
+	}
+
+	template <typename Ops>
+	typename Ops::Float lerp(typename Ops::Float t, typename Ops::Float a,
+	                         typename Ops::Float b)
+	{
+		return Ops::add(a, Ops::mul(t, Ops::sub(b, a)));
+	}
+
+	template <typename Ops>
+	typename Ops::Float perlin(typename Ops::Float x, typename Ops::Float y,
+	                           typename Ops::Float z, typename Ops::Int seed)
+	{
+		using Float = typename Ops::Float;
+		using Int   = typename Ops::Int;
+
+		const Float fx = Ops::floor(x);
+		const Float fy = Ops::floor(y);
+		const Float fz = Ops::floor(z);
+
+		const Int x0 = Ops::muli(Ops::toInt(fx), Ops::seti(PRIME_X));
+		const Int y0 = Ops::muli(Ops::toInt(fy), Ops::seti(PRIME_Y));
+		const Int z0 = Ops::muli(Ops::toInt(fz), Ops::seti(PRIME_Z));
+		const Int x1 = Ops::addi(x0, Ops::seti(PRIME_X));
+		const Int y1 = Ops::addi(y0, Ops::seti(PRIME_Y));
+		const Int z1 = Ops::addi(z0, Ops::seti(PRIME_Z));
+
+		// the offsets from the lower and upper corners of the cell.
+		const Float dx0 = Ops::sub(x, fx);
+		const Float dy0 = Ops::sub(y, fy);
+		const Float dz0 = Ops::sub(z, fz);
+		const Float dx1 = Ops::sub(dx0, Ops::set(1.f));
+		const Float dy1 = Ops::sub(dy0, Ops::set(1.f));
+		const Float dz1 = Ops::sub(dz0, Ops::set(1.f));
+
+		const Float u = fade<Ops>(dx0);
+		const Float v = fade<Ops>(dy0);
+		const Float w = fade<Ops>(dz0);
+
+		const Float n000 =
+		    grad<Ops>(hash<Ops>(x0, y0, z0, seed), dx0, dy0, dz0);
+		const Float n100 =
+		    grad<Ops>(hash<Ops>(x1, y0, z0, seed), dx1, dy0, dz0);
+		const Float n010 =
+		    grad<Ops>(hash<Ops>(x0, y1, z0, seed), dx0, dy1, dz0);
+		const Float n110 =
+		    grad<Ops>(hash<Ops>(x1, y1, z0, seed), dx1, dy1, dz0);
+		const Float n001 =
+		    grad<Ops>(hash<Ops>(x0, y0, z1, seed), dx0, dy0, dz1);
+		const Float n101 =
+		    grad<Ops>(hash<Ops>(x1, y0, z1, seed), dx1, dy0, dz1);
+		const Float n011 =
+		    grad<Ops>(hash<Ops>(x0, y1, z1, seed), dx0, dy1, dz1);
+		const Float n111 =
+		    grad<Ops>(hash<Ops>(x1, y1, z1, seed), dx1, dy1, dz1);
+
+		return lerp<Ops>(
+		    w,
+		    lerp<Ops>(v, lerp<Ops>(u, n000, n100), lerp<Ops>(u, n010, n110)),
+		    lerp<Ops>(v, lerp<Ops>(u, n001, n101), lerp<Ops>(u, n011, n111)));
+	}
+
+	template <typename Ops>
+	typename Ops::Float fractal(typename Ops::Float x, typename Ops::Float y,
+	                            typename Ops::Float z, std::uint32_t seed,
+	                            int octaves)
+	{
+		typename Ops::Float sum = Ops::set(0.f);
+
+		float amplitude = 1.f;
+		float total     = 0.f;
+		for (int octave = 0; octave < octaves; ++octave)
+		{
+			// each octave gets its own seed so they don't line up at the
+			// origin.
+			const typename Ops::Float value = perlin<Ops>(
+			    x, y, z, Ops::seti(seed + static_cast<std::uint32_t>(octave)));
+			sum = Ops::add(sum, Ops::mul(value, Ops::set(amplitude)));
+
+			total += amplitude;
+			amplitude *= 0.5f;
+			x = Ops::mul(x, Ops::set(2.f));
+			y = Ops::mul(y, Ops::set(2.f));
+			z = Ops::mul(z, Ops::set(2.f));
+		}
+
+		return total > 0.f ? Ops::mul(sum, Ops::set(1.f / total)) : sum;
+	}
+} // namespace
+
+Noise::Noise(std::uint32_t seed) : m_seed(seed) {}
+
+float Noise::perlin(float x, float y, float z) const
+{
+	return ::perlin<ScalarOps>(x, y, z, m_seed);
+}
+
+void Noise::perlin(const float* x, const float* y, const float* z, float* out,
+                   std::size_t count) const
+{
+	using Ops = BatchOps;
+
+	std::size_t i = 0;
+	for (; i + Ops::WIDTH <= count; i += Ops::WIDTH)
+	{
+		Ops::store(out + i, ::perlin<Ops>(Ops::load(x + i), Ops::load(y + i),
+		                                  Ops::load(z + i), Ops::seti(m_seed)));
+	}
+
+	for (; i < count; ++i)
+	{
+		out[i] = ::perlin<ScalarOps>(x[i], y[i], z[i], m_seed);
+	}
+}
+
+float Noise::fractal(float x, float y, float z, int octaves) const
+{
+	return ::fractal<ScalarOps>(x, y, z, m_seed, octaves);
+}
+
+void Noise::fractal(const float* x, const float* y, const float* z, float* out,
+                    std::size_t count, int octaves) const
+{
+	using Ops = BatchOps;
+
+	std::size_t i = 0;
+	for (; i + Ops::WIDTH <= count; i += Ops::WIDTH)
+	{
+		Ops::store(out + i,
+		           ::fractal<Ops>(Ops::load(x + i), Ops::load(y + i),
+		                          Ops::load(z + i), m_seed, octaves));
+	}
+
+	for (; i < count; ++i)
+	{
+		out[i] = ::fractal<ScalarOps>(x[i], y[i], z[i], m_seed, octaves);
+	}
+}
+
+const char* Noise::getInstructionSet()
+{
+#if defined(PHX_NOISE_AVX2)
+	return "AVX2";
+#elif defined(PHX_NOISE_SSE) && defined(__SSE4_1__)
+	return "SSE4.1";
+#elif defined(PHX_NOISE_SSE)
+	return "SSE2";
+#else
+	return "Scalar";
+#endif
+}
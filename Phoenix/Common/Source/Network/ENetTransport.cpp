@@ -0,0 +1,173 @@
+// Copyright 2019-20 Genten Studios
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+// may be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <Common/Logger.hpp>
+#include <Common/Network/ENetTransport.hpp>
+
+using namespace phx::net;
+
+std::atomic<std::size_t> ENetTransport::m_activeInstances = 0;
+
+ENetTransport::ENetTransport(const ENetAddress* address, std::size_t peers,
+                             std::size_t channels)
+{
+	if (m_activeInstances == 0)
+	{
+		if (enet_initialize())
+		{
+			LOG_FATAL("NETCODE") << "Failed to initialize ENet networking.";
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	++m_activeInstances;
+
+	m_host = enet_host_create(address, peers, channels, 0, 0);
+}
+
+ENetTransport::~ENetTransport()
+{
+	--m_activeInstances;
+
+	enet_host_destroy(m_host);
+
+	if (m_activeInstances == 0)
+	{
+		enet_deinitialize();
+	}
+}
+
+ENetPeer* ENetTransport::connect(const Address& address, enet_uint8 channels,
+                                 enet_uint32 data)
+{
+	return enet_host_connect(m_host, address, channels, data);
+}
+
+bool ENetTransport::service(ENetEvent& event, time::ms timeout)
+{
+	return enet_host_service(m_host, &event, timeout.count()) > 0;
+}
+
+void ENetTransport::flush() { enet_host_flush(m_host); }
+
+void ENetTransport::send(ENetPeer& peer, enet_uint8 channel,
+                         ENetPacket& packet)
+{
+	if (enet_peer_send(&peer, channel, &packet) < 0 &&
+	    packet.referenceCount == 0)
+	{
+		// enet only takes ownership of packets it managed to queue.
+		enet_packet_destroy(&packet);
+	}
+}
+
+void ENetTransport::broadcast(enet_uint8 channel, ENetPacket& packet)
+{
+	enet_host_broadcast(m_host, channel, &packet);
+}
+
+ENetPacket* ENetTransport::receive(ENetPeer& peer, enet_uint8& channel)
+{
+	return enet_peer_receive(&peer, &channel);
+}
+
+void ENetTransport::disconnect(ENetPeer& peer, enet_uint32 data,
+                               DisconnectMode mode)
+{
+	switch (mode)
+	{
+	case DisconnectMode::GRACEFUL:
+		enet_peer_disconnect(&peer, data);
+		break;
+	case DisconnectMode::IMMEDIATE:
+		enet_peer_disconnect_now(&peer, data);
+		break;
+	case DisconnectMode::LATER:
+		enet_peer_disconnect_later(&peer, data);
+		break;
+	case DisconnectMode::RESET:
+		enet_peer_reset(&peer);
+		break;
+	}
+}
+
+void ENetTransport::ping(ENetPeer& peer) { enet_peer_ping(&peer); }
+
+void ENetTransport::setPingInterval(ENetPeer& peer, time::ms interval)
+{
+	enet_peer_ping_interval(&peer, interval.count());
+}
+
+void ENetTransport::setThrottle(ENetPeer& peer, const Throttle& throttle)
+{
+	enet_peer_throttle_configure(&peer, throttle.interval.count(),
+	                             throttle.acceleration, throttle.deceleration);
+}
+
+void ENetTransport::setTimeout(ENetPeer& peer, const Timeout& timeout)
+{
+	enet_peer_timeout(&peer, timeout.limit.count(), timeout.minimum.count(),
+	                  timeout.maximum.count());
+}
+
+Bandwidth ENetTransport::getBandwidthLimit() const
+{
+	return {m_host->incomingBandwidth, m_host->outgoingBandwidth};
+}
+
+void ENetTransport::setBandwidthLimit(const Bandwidth& bandwidth)
+{
+	enet_host_bandwidth_limit(m_host, bandwidth.incoming, bandwidth.outgoing);
+}
+
+std::size_t ENetTransport::getChannelLimit() const
+{
+	return m_host->channelLimit;
+}
+
+void ENetTransport::setChannelLimit(std::size_t limit)
+{
+	enet_host_channel_limit(m_host, limit);
+}
+
+std::size_t ENetTransport::getPeerCount() const
+{
+	return m_host->connectedPeers;
+}
+
+std::size_t ENetTransport::getPeerLimit() const { return m_host->peerCount; }
+
+enet_uint32 ENetTransport::getTotalReceivedData() const
+{
+	return m_host->totalReceivedData;
+}
+
+enet_uint32 ENetTransport::getTotalSentData() const
+{
+	return m_host->totalSentData;
+}
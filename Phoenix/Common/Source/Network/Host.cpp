@@ -27,45 +27,45 @@
 // POSSIBILITY OF SUCH DAMAGE.
 
 #include <Common/Logger.hpp>
+#include <Common/Network/ENetTransport.hpp>
 #include <Common/Network/Host.hpp>
+#include <Common/Profiling/Metrics.hpp>
+#include <Common/Profiling/Profiler.hpp>
+#include <Common/Profiling/Tracer.hpp>
 
 #include <utility>
 
 using namespace phx::net;
 
-std::atomic<std::size_t> Host::m_activeInstances = 0;
+namespace
+{
+	// how often the transport totals and peer statistics are read.
+	constexpr std::chrono::seconds METRICS_INTERVAL {1};
+
+	phx::profiling::MetricLabels peerLabels(std::size_t id)
+	{
+		return {{"peer", std::to_string(id)}};
+	}
+} // namespace
 
 Host::Host(std::size_t peers, const ENetAddress* address)
-    : Host(address ? Address {*address} : Address {}, peers)
+    : m_transport(std::make_unique<ENetTransport>(address, peers, 0))
 {
+	if (address != nullptr)
+	{
+		m_address = *address;
+	}
 }
 
 Host::Host(const Address& address, std::size_t peers, std::size_t channels)
+    : m_transport(std::make_unique<ENetTransport>(address, peers, channels)),
+      m_address(address)
 {
-	if (m_activeInstances == 0)
-	{
-		if (enet_initialize())
-		{
-			LOG_FATAL("NETCODE") << "Failed to initialize ENet networking.";
-			exit(EXIT_FAILURE);
-		}
-	}
-
-	++m_activeInstances;
-
-	m_host = enet_host_create(address, peers, channels, 0, 0);
 }
 
-Host::~Host()
+Host::Host(std::unique_ptr<Transport> transport)
+    : m_transport(std::move(transport))
 {
-	--m_activeInstances;
-
-	enet_host_destroy(m_host);
-
-	if (m_activeInstances == 0)
-	{
-		enet_deinitialize();
-	}
 }
 
 Host::OptionalPeer Host::connect(const Address& address)
@@ -76,7 +76,7 @@ Host::OptionalPeer Host::connect(const Address& address)
 Host::OptionalPeer Host::connect(const Address& address, enet_uint8 channels,
                                  enet_uint32 data)
 {
-	ENetPeer* peer = enet_host_connect(m_host, address, channels, data);
+	ENetPeer* peer = m_transport->connect(address, channels, data);
 
 	if (!peer)
 	{
@@ -89,31 +89,52 @@ Host::OptionalPeer Host::connect(const Address& address, enet_uint8 channels,
 
 Bandwidth Host::getBandwidthLimit() const
 {
-	return {m_host->incomingBandwidth, m_host->outgoingBandwidth};
+	return m_transport->getBandwidthLimit();
 }
 
 void Host::setBandwidthLimit(const Bandwidth& bandwidth)
 {
-	enet_host_bandwidth_limit(m_host, bandwidth.incoming, bandwidth.outgoing);
+	m_transport->setBandwidthLimit(bandwidth);
 }
 
-std::size_t Host::getChannelLimit() const { return m_host->channelLimit; }
+std::size_t Host::getChannelLimit() const
+{
+	return m_transport->getChannelLimit();
+}
 
 void Host::setChannelLimit(std::size_t limit)
 {
-	enet_host_channel_limit(m_host, limit);
+	m_transport->setChannelLimit(limit);
 }
 
 void Host::broadcast(Packet& packet, enet_uint8 channel)
 {
 	packet.prepareForSend();
-	enet_host_broadcast(m_host, channel, packet);
+	m_transport->broadcast(channel, *static_cast<ENetPacket*>(packet));
 }
 
 void Host::broadcast(Packet&& packet, enet_uint8 channel)
 {
 	packet.prepareForSend();
-	enet_host_broadcast(m_host, channel, packet);
+	m_transport->broadcast(channel, *static_cast<ENetPacket*>(packet));
+}
+
+void Host::enableBatching(bool enabled) { m_batching = enabled; }
+
+void Host::queue(std::size_t peerID, MessageBatcher::MessageType type,
+                 const Packet::Data& data, PacketFlags flags,
+                 enet_uint8 channel)
+{
+	std::lock_guard<std::mutex> lock(m_batchMutex);
+	m_batches[peerID].append(channel, type, data.data(), data.size(), flags);
+}
+
+void Host::queueBroadcast(MessageBatcher::MessageType type,
+                          const Packet::Data& data, PacketFlags flags,
+                          enet_uint8 channel)
+{
+	std::lock_guard<std::mutex> lock(m_batchMutex);
+	m_broadcastBatch.append(channel, type, data.data(), data.size(), flags);
 }
 
 void Host::onReceive(ReceiveCallback callback)
@@ -139,18 +160,36 @@ void Host::poll(phx::time::ms timeout, int limit)
 
 	do
 	{
-		if (enet_host_service(m_host, &event, timeout.count()))
 		{
+			PHX_PROFILE_SCOPE("Host::sendQueued");
+			sendQueued();
+		}
+
+		// the wait for an event is left out on purpose, otherwise an idle
+		// network would look like a busy one.
+		if (m_transport->service(event, timeout))
+		{
+			PHX_PROFILE_SCOPE("Host::handleEvent");
 			handleEvent(event);
 		}
+
+		if (std::chrono::steady_clock::now() - m_lastMetricsUpdate >=
+		    METRICS_INTERVAL)
+		{
+			updateMetrics();
+		}
 	} while (--limit);
 }
 
-void Host::flush() { enet_host_flush(m_host); }
+void Host::flush()
+{
+	sendQueued();
+	m_transport->flush();
+}
 
-std::size_t Host::getPeerCount() const { return m_host->connectedPeers; }
+std::size_t Host::getPeerCount() const { return m_transport->getPeerCount(); }
 
-std::size_t Host::getPeerLimit() const { return m_host->peerCount; }
+std::size_t Host::getPeerLimit() const { return m_transport->getPeerLimit(); }
 
 const Address& Host::getAddress() const { return m_address; }
 
@@ -165,10 +204,13 @@ Peer* Host::getPeer(std::size_t id)
 
 enet_uint32 Host::getTotalReceievedData() const
 {
-	return m_host->totalReceivedData;
+	return m_transport->getTotalReceivedData();
 }
 
-enet_uint32 Host::getTotalSentData() const { return m_host->totalSentData; }
+enet_uint32 Host::getTotalSentData() const
+{
+	return m_transport->getTotalSentData();
+}
 
 void Host::removePeer(const Peer& peer)
 {
@@ -182,14 +224,44 @@ void Host::handleEvent(ENetEvent& event)
 	switch (event.type)
 	{
 	case ENET_EVENT_TYPE_CONNECT:
+	{
+		// the peer must exist even if nobody is listening for connections,
+		// otherwise packets from it can't be attributed to anyone.
+		Peer& connected = createPeer(*peer);
 		if (m_connectCallback)
 		{
-			m_connectCallback(createPeer(*peer), event.data);
+			m_connectCallback(connected, event.data);
 		}
 		break;
+	}
 
 	case ENET_EVENT_TYPE_RECEIVE:
-		if (m_receiveCallback)
+		PHX_TRACE_EVENT(PACKET, "Host::receive", event.packet->dataLength);
+
+		if (m_receiveCallback && m_batching)
+		{
+			Peer* sender = getPeer(*peer);
+
+			const bool valid = MessageBatcher::split(
+			    reinterpret_cast<const std::byte*>(event.packet->data),
+			    event.packet->dataLength,
+			    [this, sender](MessageBatcher::MessageType type,
+			                   const std::byte* data, std::size_t size) {
+				    // the message points straight into the batch, so the only
+				    // thing allocated here is the packet header.
+				    ENetPacket* message = enet_packet_create(
+				        data, size, ENET_PACKET_FLAG_NO_ALLOCATE);
+				    m_receiveCallback(*sender, Packet(*message, false), type);
+			    });
+
+			if (!valid)
+			{
+				LOG_WARNING("NETCODE")
+				    << "Received a malformed batch from peer "
+				    << sender->getID() << ".";
+			}
+		}
+		else if (m_receiveCallback)
 		{
 			m_receiveCallback(*getPeer(*peer), Packet(*event.packet, true),
 			                  event.channelID);
@@ -234,6 +306,15 @@ void Host::removePeer(ENetPeer& peer)
 	auto id = std::size_t(peer.data);
 	m_peers.erase(id);
 
+	auto& metrics = profiling::Metrics::get();
+	metrics.remove("phoenix_peer_round_trip_milliseconds", peerLabels(id));
+	metrics.remove("phoenix_peer_packet_loss_ratio", peerLabels(id));
+
+	{
+		std::lock_guard<std::mutex> lock(m_batchMutex);
+		m_batches.erase(id);
+	}
+
 	peer.data = nullptr;
 }
 
@@ -246,3 +327,94 @@ void Host::disconnectPeer(std::size_t id)
 
 	removePeer(m_peers.at(id));
 }
+
+void Host::sendQueued()
+{
+	using Batches = std::vector<MessageBatcher::Batch>;
+
+	Batches                                      broadcasts;
+	std::vector<std::pair<std::size_t, Batches>> batches;
+
+	{
+		// only hold the lock long enough to take the batches, so queueing
+		// from other threads isn't held up by the actual sending.
+		std::lock_guard<std::mutex> lock(m_batchMutex);
+
+		if (!m_broadcastBatch.empty())
+		{
+			broadcasts = m_broadcastBatch.take();
+		}
+
+		for (auto& batcher : m_batches)
+		{
+			if (!batcher.second.empty())
+			{
+				batches.emplace_back(batcher.first, batcher.second.take());
+			}
+		}
+	}
+
+	for (auto& batch : broadcasts)
+	{
+		PHX_TRACE_EVENT(PACKET, "Host::broadcast", batch.data.size());
+
+		// the batch buffer is handed to enet rather than copied.
+		broadcast(Packet(std::move(batch.data), batch.flags),
+		          batch.channel);
+	}
+
+	for (auto& peerBatches : batches)
+	{
+		Peer* peer = getPeer(peerBatches.first);
+		if (peer == nullptr)
+		{
+			// the peer disconnected before we could send to it.
+			continue;
+		}
+
+		for (auto& batch : peerBatches.second)
+		{
+			PHX_TRACE_EVENT(PACKET, "Host::send", batch.data.size());
+			peer->send(Packet(std::move(batch.data), batch.flags),
+			           batch.channel);
+		}
+	}
+}
+
+void Host::updateMetrics()
+{
+	m_lastMetricsUpdate = std::chrono::steady_clock::now();
+
+	auto& metrics = profiling::Metrics::get();
+
+	static profiling::Counter& sent = metrics.counter(
+	    "phoenix_network_sent_bytes_total", "Bytes sent by every host.");
+	static profiling::Counter& received =
+	    metrics.counter("phoenix_network_received_bytes_total",
+	                    "Bytes received by every host.");
+
+	// unsigned subtraction copes with the totals wrapping around.
+	const enet_uint32 sentData     = getTotalSentData();
+	const enet_uint32 receivedData = getTotalReceievedData();
+	sent.add(sentData - m_lastSentData);
+	received.add(receivedData - m_lastReceivedData);
+	m_lastSentData     = sentData;
+	m_lastReceivedData = receivedData;
+
+	for (const auto& peer : m_peers)
+	{
+		metrics
+		    .gauge("phoenix_peer_round_trip_milliseconds",
+		           "Round trip time to a peer.", peerLabels(peer.first))
+		    .set(static_cast<double>(
+		        peer.second.getRoundTripTime().count()));
+
+		// enet scales packet loss so that ENET_PEER_PACKET_LOSS_SCALE is
+		// every packet lost.
+		metrics
+		    .gauge("phoenix_peer_packet_loss_ratio",
+		           "Ratio of packets lost to a peer.", peerLabels(peer.first))
+		    .set(static_cast<double>(peer.second.getPacketLoss()) /
+		         ENET_PEER_PACKET_LOSS_SCALE);
+	}
+}
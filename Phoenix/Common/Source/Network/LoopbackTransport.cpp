@@ -0,0 +1,712 @@
+// Copyright 2019-20 Genten Studios
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+// may be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <Common/Logger.hpp>
+#include <Common/Network/LoopbackTransport.hpp>
+
+#include <algorithm>
+
+using namespace phx::net;
+
+// reliable packets are never actually lost, but each "loss" delays them by a
+// retransmission. this caps the delay if the loss is set absurdly high.
+static const int MAX_RETRANSMISSIONS = 16;
+
+static std::size_t clampChannels(std::size_t channels)
+{
+	const std::size_t maximum = ENET_PROTOCOL_MAXIMUM_CHANNEL_COUNT;
+	return channels == 0 || channels > maximum ? maximum : channels;
+}
+
+static void destroyPacket(ENetPacket* packet)
+{
+	if (packet != nullptr && packet->referenceCount == 0)
+	{
+		enet_packet_destroy(packet);
+	}
+}
+
+LoopbackNetwork::LoopbackNetwork(const LinkConditions& conditions,
+                                 std::uint32_t         seed)
+    : m_conditions(conditions), m_random(seed), m_time(Clock::now()),
+      m_ephemeralPort(49152)
+{
+}
+
+LinkConditions LoopbackNetwork::getConditions() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_conditions;
+}
+
+void LoopbackNetwork::setConditions(const LinkConditions& conditions)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_conditions = conditions;
+}
+
+void LoopbackNetwork::useManualClock(bool manual)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (manual && !m_manualClock)
+		{
+			m_time = Clock::now();
+		}
+		m_manualClock = manual;
+	}
+
+	m_condition.notify_all();
+}
+
+void LoopbackNetwork::advance(time::ms time)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_time += time;
+	}
+
+	m_condition.notify_all();
+}
+
+LoopbackNetwork::Clock::time_point LoopbackNetwork::now() const
+{
+	return m_manualClock ? m_time : Clock::now();
+}
+
+phx::time::ms LoopbackNetwork::delay()
+{
+	if (m_conditions.jitter.count() == 0)
+	{
+		return m_conditions.latency;
+	}
+
+	std::uniform_int_distribution<unsigned int> jitter(
+	    0, m_conditions.jitter.count());
+	return m_conditions.latency + time::ms {jitter(m_random)};
+}
+
+bool LoopbackNetwork::lose()
+{
+	if (m_conditions.loss <= 0.f)
+	{
+		return false;
+	}
+
+	std::uniform_real_distribution<float> chance(0.f, 1.f);
+	return chance(m_random) < m_conditions.loss;
+}
+
+LoopbackTransport::LoopbackTransport(LoopbackNetwork& network,
+                                     enet_uint16 port, std::size_t peers,
+                                     std::size_t channels)
+    : m_network(network), m_port(port), m_peers(peers), m_links(peers),
+      m_channelLimit(clampChannels(channels))
+{
+	std::lock_guard<std::mutex> lock(m_network.m_mutex);
+
+	auto& transports = m_network.m_transports;
+	if (m_port == 0)
+	{
+		// pick a free port like the OS would for a client socket.
+		do
+		{
+			m_port = m_network.m_ephemeralPort++;
+		} while (m_port == 0 || transports.find(m_port) != transports.end());
+	}
+	else if (transports.find(m_port) != transports.end())
+	{
+		LOG_WARNING("NETCODE") << "Loopback port " << m_port
+		                       << " is already in use, nothing will be able "
+		                          "to connect to this host.";
+		return;
+	}
+
+	transports[m_port] = this;
+}
+
+LoopbackTransport::~LoopbackTransport()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_network.m_mutex);
+
+		const auto now = m_network.now();
+		for (std::size_t i = 0; i < m_links.size(); ++i)
+		{
+			Link& link = m_links[i];
+			if (link.inUse && link.remote != nullptr)
+			{
+				// looks like a timeout to the other end.
+				deliver(*link.remote, link.remoteIndex, link.remoteGeneration,
+				        now + m_network.delay(), ENET_EVENT_TYPE_DISCONNECT, 0);
+			}
+		}
+
+		// nothing can be allowed to send to this transport anymore.
+		for (auto& transport : m_network.m_transports)
+		{
+			for (Link& link : transport.second->m_links)
+			{
+				if (link.remote == this)
+				{
+					link.remote = nullptr;
+				}
+			}
+		}
+
+		auto it = m_network.m_transports.find(m_port);
+		if (it != m_network.m_transports.end() && it->second == this)
+		{
+			m_network.m_transports.erase(it);
+		}
+
+		while (!m_inbox.empty())
+		{
+			destroyPacket(m_inbox.top().event.packet);
+			m_inbox.pop();
+		}
+	}
+
+	m_network.m_condition.notify_all();
+}
+
+ENetPeer* LoopbackTransport::connect(const Address& address,
+                                     enet_uint8 channels, enet_uint32 data)
+{
+	std::lock_guard<std::mutex> lock(m_network.m_mutex);
+
+	ENetPeer* peer = allocate(address, channels);
+	if (peer == nullptr)
+	{
+		return nullptr;
+	}
+
+	const std::size_t index = indexOf(*peer);
+	Link&             link  = m_links[index];
+
+	const auto now = m_network.now();
+
+	LoopbackTransport* remote     = nullptr;
+	ENetPeer*          remotePeer = nullptr;
+
+	auto it = m_network.m_transports.find(address.getPort());
+	if (it != m_network.m_transports.end() && it->second != this)
+	{
+		remote     = it->second;
+		remotePeer = remote->allocate(Address {"127.0.0.1", m_port},
+		                              peer->channelCount);
+	}
+
+	if (remotePeer == nullptr)
+	{
+		// nobody is listening, or they're full. the connection fails after
+		// a round trip.
+		deliver(*this, index, link.generation,
+		        now + m_network.delay() + m_network.delay(),
+		        ENET_EVENT_TYPE_DISCONNECT, 0);
+		return peer;
+	}
+
+	const std::size_t remoteIndex = remote->indexOf(*remotePeer);
+	Link&             remoteLink  = remote->m_links[remoteIndex];
+
+	link.remote           = remote;
+	link.remoteIndex      = remoteIndex;
+	link.remoteGeneration = remoteLink.generation;
+
+	remoteLink.remote           = this;
+	remoteLink.remoteIndex      = index;
+	remoteLink.remoteGeneration = link.generation;
+
+	// the foreign host sees the connection after one trip, we see it once it
+	// has been acknowledged.
+	const auto accepted    = now + m_network.delay();
+	const auto established = accepted + m_network.delay();
+
+	link.established       = accepted;
+	remoteLink.established = established;
+
+	deliver(*remote, remoteIndex, remoteLink.generation, accepted,
+	        ENET_EVENT_TYPE_CONNECT, data);
+	deliver(*this, index, link.generation, established,
+	        ENET_EVENT_TYPE_CONNECT, data);
+
+	return peer;
+}
+
+bool LoopbackTransport::service(ENetEvent& event, time::ms timeout)
+{
+	std::unique_lock<std::mutex> lock(m_network.m_mutex);
+
+	// slots that produced a disconnect event last time are free to reuse now
+	// the host has had a chance to deal with them.
+	for (Link& link : m_links)
+	{
+		if (link.releasing)
+		{
+			link.releasing = false;
+			link.inUse     = false;
+			link.remote    = nullptr;
+		}
+	}
+
+	const auto deadline = m_network.now() + timeout;
+
+	while (true)
+	{
+		while (!m_inbox.empty() && m_inbox.top().time <= m_network.now())
+		{
+			Delivery delivery = m_inbox.top();
+			m_inbox.pop();
+
+			if (accept(delivery))
+			{
+				event = delivery.event;
+				return true;
+			}
+		}
+
+		const auto now = m_network.now();
+		if (m_network.m_manualClock || now >= deadline)
+		{
+			return false;
+		}
+
+		auto wake = deadline;
+		if (!m_inbox.empty())
+		{
+			wake = std::min(wake, m_inbox.top().time);
+		}
+
+		m_network.m_condition.wait_until(lock, wake);
+	}
+}
+
+void LoopbackTransport::flush()
+{
+	// packets are in flight the moment they're sent, there's nothing to do.
+}
+
+void LoopbackTransport::send(ENetPeer& peer, enet_uint8 channel,
+                             ENetPacket& packet)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_network.m_mutex);
+		sendLocked(indexOf(peer), channel, packet);
+	}
+
+	m_network.m_condition.notify_all();
+}
+
+void LoopbackTransport::broadcast(enet_uint8 channel, ENetPacket& packet)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_network.m_mutex);
+
+		std::vector<std::size_t> targets;
+		for (std::size_t i = 0; i < m_links.size(); ++i)
+		{
+			if (m_links[i].inUse && m_links[i].remote != nullptr &&
+			    m_peers[i].state == ENET_PEER_STATE_CONNECTED)
+			{
+				targets.push_back(i);
+			}
+		}
+
+		if (targets.empty())
+		{
+			destroyPacket(&packet);
+			return;
+		}
+
+		// every receiver destroys the packet it gets, so all but the last get
+		// their own copy.
+		for (std::size_t i = 0; i + 1 < targets.size(); ++i)
+		{
+			ENetPacket* copy = enet_packet_create(
+			    packet.data, packet.dataLength,
+			    packet.flags & ~ENET_PACKET_FLAG_NO_ALLOCATE);
+			sendLocked(targets[i], channel, *copy);
+		}
+
+		sendLocked(targets.back(), channel, packet);
+	}
+
+	m_network.m_condition.notify_all();
+}
+
+ENetPacket* LoopbackTransport::receive(ENetPeer&, enet_uint8&)
+{
+	return nullptr;
+}
+
+void LoopbackTransport::disconnect(ENetPeer& peer, enet_uint32 data,
+                                   DisconnectMode mode)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_network.m_mutex);
+
+		const std::size_t index = indexOf(peer);
+		Link&             link  = m_links[index];
+
+		if (!link.inUse || peer.state == ENET_PEER_STATE_DISCONNECTED)
+		{
+			return;
+		}
+
+		if (peer.state == ENET_PEER_STATE_CONNECTED)
+		{
+			--m_connectedPeers;
+		}
+
+		const auto now = m_network.now();
+
+		if (mode == DisconnectMode::GRACEFUL || mode == DisconnectMode::LATER)
+		{
+			auto time = now + m_network.delay();
+			if (mode == DisconnectMode::LATER)
+			{
+				// wait for everything already sent to arrive.
+				time = std::max(time, link.nextFree);
+				for (auto reliable : link.lastReliable)
+				{
+					time = std::max(time, reliable);
+				}
+			}
+
+			if (link.remote != nullptr)
+			{
+				deliver(*link.remote, link.remoteIndex, link.remoteGeneration,
+				        time, ENET_EVENT_TYPE_DISCONNECT, data);
+				time += m_network.delay();
+			}
+
+			deliver(*this, index, link.generation, time,
+			        ENET_EVENT_TYPE_DISCONNECT, data);
+
+			peer.state = ENET_PEER_STATE_DISCONNECTING;
+		}
+		else
+		{
+			if (link.remote != nullptr)
+			{
+				deliver(*link.remote, link.remoteIndex, link.remoteGeneration,
+				        now + m_network.delay(), ENET_EVENT_TYPE_DISCONNECT,
+				        mode == DisconnectMode::RESET ? 0 : data);
+			}
+
+			// no local event is produced for these, so the slot is free as
+			// soon as the host has forgotten about it.
+			peer.state     = ENET_PEER_STATE_DISCONNECTED;
+			link.remote    = nullptr;
+			link.releasing = true;
+		}
+	}
+
+	m_network.m_condition.notify_all();
+}
+
+void LoopbackTransport::ping(ENetPeer&)
+{
+	// the round trip time is fixed by the link conditions.
+}
+
+void LoopbackTransport::setPingInterval(ENetPeer& peer, time::ms interval)
+{
+	std::lock_guard<std::mutex> lock(m_network.m_mutex);
+	peer.pingInterval = interval.count();
+}
+
+void LoopbackTransport::setThrottle(ENetPeer& peer, const Throttle& throttle)
+{
+	std::lock_guard<std::mutex> lock(m_network.m_mutex);
+	peer.packetThrottleInterval     = throttle.interval.count();
+	peer.packetThrottleAcceleration = throttle.acceleration;
+	peer.packetThrottleDeceleration = throttle.deceleration;
+}
+
+void LoopbackTransport::setTimeout(ENetPeer& peer, const Timeout& timeout)
+{
+	std::lock_guard<std::mutex> lock(m_network.m_mutex);
+	peer.timeoutLimit   = timeout.limit.count();
+	peer.timeoutMinimum = timeout.minimum.count();
+	peer.timeoutMaximum = timeout.maximum.count();
+}
+
+Bandwidth LoopbackTransport::getBandwidthLimit() const
+{
+	std::lock_guard<std::mutex> lock(m_network.m_mutex);
+	return m_bandwidth;
+}
+
+void LoopbackTransport::setBandwidthLimit(const Bandwidth& bandwidth)
+{
+	std::lock_guard<std::mutex> lock(m_network.m_mutex);
+	m_bandwidth = bandwidth;
+}
+
+std::size_t LoopbackTransport::getChannelLimit() const
+{
+	std::lock_guard<std::mutex> lock(m_network.m_mutex);
+	return m_channelLimit;
+}
+
+void LoopbackTransport::setChannelLimit(std::size_t limit)
+{
+	std::lock_guard<std::mutex> lock(m_network.m_mutex);
+	m_channelLimit = clampChannels(limit);
+}
+
+std::size_t LoopbackTransport::getPeerCount() const
+{
+	std::lock_guard<std::mutex> lock(m_network.m_mutex);
+	return m_connectedPeers;
+}
+
+std::size_t LoopbackTransport::getPeerLimit() const { return m_peers.size(); }
+
+enet_uint32 LoopbackTransport::getTotalReceivedData() const
+{
+	std::lock_guard<std::mutex> lock(m_network.m_mutex);
+	return m_totalReceivedData;
+}
+
+enet_uint32 LoopbackTransport::getTotalSentData() const
+{
+	std::lock_guard<std::mutex> lock(m_network.m_mutex);
+	return m_totalSentData;
+}
+
+std::size_t LoopbackTransport::indexOf(const ENetPeer& peer) const
+{
+	return static_cast<std::size_t>(&peer - m_peers.data());
+}
+
+ENetPeer* LoopbackTransport::allocate(const Address& address,
+                                      std::size_t    channels)
+{
+	for (std::size_t i = 0; i < m_links.size(); ++i)
+	{
+		if (m_links[i].inUse)
+		{
+			continue;
+		}
+
+		channels = std::clamp<std::size_t>(channels, 1, m_channelLimit);
+
+		Link& link = m_links[i];
+
+		const std::uint32_t generation = link.generation + 1;
+		link                           = Link {};
+		link.inUse                     = true;
+		link.generation                = generation;
+		link.lastReliable.assign(channels, Clock::time_point {});
+		link.sentSequence.assign(channels, 0);
+		link.receivedSequence.assign(channels, 0);
+
+		const LinkConditions& conditions = m_network.m_conditions;
+
+		ENetPeer& peer = m_peers[i];
+		peer           = ENetPeer {};
+
+		peer.address      = *static_cast<const ENetAddress*>(address);
+		peer.state        = ENET_PEER_STATE_CONNECTING;
+		peer.channelCount = channels;
+
+		// the link conditions are fixed, so these never change.
+		peer.roundTripTime = conditions.latency.count() * 2;
+		peer.packetLoss    = static_cast<enet_uint32>(
+		    conditions.loss * ENET_PEER_PACKET_LOSS_SCALE);
+
+		peer.pingInterval   = ENET_PEER_PING_INTERVAL;
+		peer.timeoutLimit   = ENET_PEER_TIMEOUT_LIMIT;
+		peer.timeoutMinimum = ENET_PEER_TIMEOUT_MINIMUM;
+		peer.timeoutMaximum = ENET_PEER_TIMEOUT_MAXIMUM;
+
+		peer.packetThrottleInterval = ENET_PEER_PACKET_THROTTLE_INTERVAL;
+		peer.packetThrottleAcceleration =
+		    ENET_PEER_PACKET_THROTTLE_ACCELERATION;
+		peer.packetThrottleDeceleration =
+		    ENET_PEER_PACKET_THROTTLE_DECELERATION;
+
+		return &peer;
+	}
+
+	return nullptr;
+}
+
+void LoopbackTransport::deliver(LoopbackTransport& target, std::size_t index,
+                                std::uint32_t     generation,
+                                Clock::time_point time, ENetEventType type,
+                                enet_uint32 data, ENetPacket* packet,
+                                enet_uint8 channel, std::uint32_t sequence)
+{
+	ENetEvent event;
+	event.type      = type;
+	event.peer      = &target.m_peers[index];
+	event.channelID = channel;
+	event.data      = data;
+	event.packet    = packet;
+
+	target.m_inbox.push({time, target.m_order++, generation, sequence, event});
+}
+
+void LoopbackTransport::sendLocked(std::size_t index, enet_uint8 channel,
+                                   ENetPacket& packet)
+{
+	Link&     link = m_links[index];
+	ENetPeer& peer = m_peers[index];
+
+	if (!link.inUse || link.remote == nullptr ||
+	    peer.state != ENET_PEER_STATE_CONNECTED || channel >= peer.channelCount)
+	{
+		destroyPacket(&packet);
+		return;
+	}
+
+	m_totalSentData += static_cast<enet_uint32>(packet.dataLength);
+
+	const LinkConditions& conditions = m_network.m_conditions;
+
+	// the slowest of the simulated link and our own limit wins.
+	speed bandwidth = conditions.bandwidth;
+	if (m_bandwidth.outgoing != 0 &&
+	    (bandwidth == 0 || m_bandwidth.outgoing < bandwidth))
+	{
+		bandwidth = m_bandwidth.outgoing;
+	}
+
+	auto time = m_network.now();
+	if (bandwidth != 0)
+	{
+		// packets queue up behind each other on the wire.
+		const auto start = std::max(time, link.nextFree);
+		link.nextFree    = start + std::chrono::microseconds(
+		                            packet.dataLength * 1000000 / bandwidth);
+		time = link.nextFree;
+	}
+
+	const bool reliable = packet.flags & ENET_PACKET_FLAG_RELIABLE;
+	if (!reliable && m_network.lose())
+	{
+		destroyPacket(&packet);
+		return;
+	}
+
+	time += m_network.delay();
+
+	if (reliable)
+	{
+		// a lost reliable packet is resent once the sender notices the
+		// missing acknowledgement, roughly a round trip later.
+		for (int i = 0; i < MAX_RETRANSMISSIONS && m_network.lose(); ++i)
+		{
+			time += m_network.delay() + m_network.delay();
+		}
+
+		// reliable packets are delivered in order.
+		time = std::max(time, link.lastReliable[channel]);
+		link.lastReliable[channel] = time;
+	}
+
+	time = std::max(time, link.established);
+
+	deliver(*link.remote, link.remoteIndex, link.remoteGeneration, time,
+	        ENET_EVENT_TYPE_RECEIVE, 0, &packet, channel,
+	        ++link.sentSequence[channel]);
+}
+
+bool LoopbackTransport::accept(Delivery& delivery)
+{
+	ENetEvent&        event = delivery.event;
+	const std::size_t index = indexOf(*event.peer);
+	Link&             link  = m_links[index];
+	ENetPeer&         peer  = m_peers[index];
+
+	bool accepted = false;
+	if (link.inUse && link.generation == delivery.generation)
+	{
+		switch (event.type)
+		{
+		case ENET_EVENT_TYPE_CONNECT:
+			if (peer.state == ENET_PEER_STATE_CONNECTING)
+			{
+				peer.state = ENET_PEER_STATE_CONNECTED;
+				++m_connectedPeers;
+				accepted = true;
+			}
+			break;
+
+		case ENET_EVENT_TYPE_RECEIVE:
+			accepted = peer.state == ENET_PEER_STATE_CONNECTED;
+
+			// sequenced unreliable packets that arrive late are dropped,
+			// just like ENet does.
+			if (accepted && !(event.packet->flags &
+			                  (ENET_PACKET_FLAG_RELIABLE |
+			                   ENET_PACKET_FLAG_UNSEQUENCED)))
+			{
+				std::uint32_t& last = link.receivedSequence[event.channelID];
+				accepted            = delivery.sequence > last;
+				last                = std::max(last, delivery.sequence);
+			}
+
+			if (accepted)
+			{
+				m_totalReceivedData +=
+				    static_cast<enet_uint32>(event.packet->dataLength);
+			}
+			break;
+
+		case ENET_EVENT_TYPE_DISCONNECT:
+			if (peer.state != ENET_PEER_STATE_DISCONNECTED)
+			{
+				if (peer.state == ENET_PEER_STATE_CONNECTED)
+				{
+					--m_connectedPeers;
+				}
+
+				peer.state     = ENET_PEER_STATE_DISCONNECTED;
+				link.remote    = nullptr;
+				link.releasing = true;
+				accepted       = true;
+			}
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	if (!accepted)
+	{
+		destroyPacket(event.packet);
+	}
+
+	return accepted;
+}
@@ -0,0 +1,132 @@
+// Copyright 2019-20 Genten Studios
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+// may be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <Common/Network/MessageBatcher.hpp>
+
+#include <Common/Utility/Internal/Endian.hpp>
+
+#include <cstring>
+
+using namespace phx::net;
+
+static std::size_t maxBatchSize(PacketFlags flags)
+{
+	return phx::ENUMhasFlag(flags, PacketFlags::RELIABLE)
+	           ? MessageBatcher::MAX_RELIABLE_BATCH_SIZE
+	           : MessageBatcher::MAX_UNRELIABLE_BATCH_SIZE;
+}
+
+void MessageBatcher::append(enet_uint8 channel, MessageType type,
+                            const std::byte* data, std::size_t size,
+                            PacketFlags flags)
+{
+	if (m_open.size() <= channel)
+	{
+		m_open.resize(static_cast<std::size_t>(channel) + 1);
+	}
+
+	Batch& batch = m_open[channel];
+
+	// if this message would push the batch past its limit, send what we have
+	// on its own and start afresh. a message bigger than the limit will just
+	// get a batch to itself.
+	if (!batch.data.empty() &&
+	    batch.data.size() + HEADER_SIZE + size >
+	        maxBatchSize(batch.flags | flags))
+	{
+		seal(channel);
+	}
+
+	if (batch.data.empty())
+	{
+		batch.flags   = flags;
+		batch.channel = channel;
+	}
+	else
+	{
+		// a single reliable message makes the whole batch reliable.
+		batch.flags |= flags & PacketFlags::RELIABLE;
+	}
+
+	const MessageSize length =
+	    data::endian::swapForNetwork(static_cast<MessageSize>(size));
+
+	const std::size_t prevEnd = batch.data.size();
+	batch.data.resize(prevEnd + HEADER_SIZE + size);
+
+	std::byte* out = batch.data.data() + prevEnd;
+	std::memcpy(out, &type, sizeof(MessageType));
+	std::memcpy(out + sizeof(MessageType), &length, sizeof(MessageSize));
+
+	if (size != 0)
+	{
+		std::memcpy(out + HEADER_SIZE, data, size);
+	}
+}
+
+bool MessageBatcher::empty() const
+{
+	if (!m_sealed.empty())
+	{
+		return false;
+	}
+
+	for (const Batch& batch : m_open)
+	{
+		if (!batch.data.empty())
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+std::vector<MessageBatcher::Batch> MessageBatcher::take()
+{
+	std::vector<Batch> batches = std::move(m_sealed);
+	m_sealed.clear();
+
+	for (Batch& batch : m_open)
+	{
+		if (!batch.data.empty())
+		{
+			batches.push_back(std::move(batch));
+			batch.data.clear();
+		}
+	}
+
+	return batches;
+}
+
+void MessageBatcher::seal(enet_uint8 channel)
+{
+	Batch& batch = m_open[channel];
+	m_sealed.push_back(std::move(batch));
+	batch.data.clear();
+}
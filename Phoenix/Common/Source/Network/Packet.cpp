@@ -29,6 +29,9 @@
 #include <Common/Logger.hpp>
 #include <Common/Network/Packet.hpp>
 
+#include <algorithm>
+#include <cstring>
+
 using namespace phx::net;
 
 Packet::Packet(const Data& data, PacketFlags flags)
@@ -37,6 +40,24 @@ Packet::Packet(const Data& data, PacketFlags flags)
 	create(data, flags & ~PacketFlags::UNRELIABLE);
 }
 
+Packet::Packet(Data&& data, PacketFlags flags)
+{
+	// the vector is moved onto the heap and enet is told not to allocate, so
+	// the packet points directly at the serialized buffer. enet calls the free
+	// callback once the packet has been sent (or acknowledged) and destroyed.
+	auto* buffer = new Data(std::move(data));
+
+	m_packet = enet_packet_create(
+	    buffer->data(), buffer->size(),
+	    static_cast<enet_uint32>(flags & ~PacketFlags::UNRELIABLE) |
+	        ENET_PACKET_FLAG_NO_ALLOCATE);
+
+	m_packet->userData     = buffer;
+	m_packet->freeCallback = [](ENetPacket* packet) {
+		delete static_cast<Data*>(packet->userData);
+	};
+}
+
 Packet::Packet(std::size_t size, PacketFlags flags)
     : Packet(*enet_packet_create(
           nullptr, size,
@@ -67,14 +88,11 @@ void Packet::setData(const Data& data)
 
 	if (data.size() != m_packet->dataLength)
 	{
-		enet_packet_resize(m_packet, data.size());
+		resize(data.size());
 	}
 
-	for (std::size_t i = 0; i < data.size(); ++i)
-	{
-		enet_uint8* ptr = m_packet->data + i;
-		*ptr            = static_cast<enet_uint8>(data[i]);
-	}
+	std::memcpy(m_packet->data, data.data(),
+	            std::min(data.size(), m_packet->dataLength));
 }
 
 Packet& Packet::operator=(const Data& data)
@@ -98,6 +116,11 @@ Packet::Data Packet::getData() const
 	    reinterpret_cast<std::byte*>(m_packet->data + m_packet->dataLength)};
 }
 
+const std::byte* Packet::getRawData() const
+{
+	return reinterpret_cast<const std::byte*>(m_packet->data);
+}
+
 void Packet::resize(std::size_t size)
 {
 	if (m_sent)
@@ -107,6 +130,15 @@ void Packet::resize(std::size_t size)
 		return;
 	}
 
+	if ((m_packet->flags & ENET_PACKET_FLAG_NO_ALLOCATE) &&
+	    size > m_packet->dataLength)
+	{
+		// enet doesn't own the buffer so it can't reallocate it.
+		LOG_WARNING("NETCODE") << "Cannot grow a packet that doesn't own its "
+		                          "data.";
+		return;
+	}
+
 	enet_packet_resize(m_packet, size);
 }
 
@@ -32,7 +32,10 @@
 
 using namespace phx::net;
 
-Peer::Peer(Host& host, ENetPeer& peer) : m_peer(&peer), m_host(&host) {}
+Peer::Peer(Host& host, ENetPeer& peer)
+    : m_peer(&peer), m_host(&host), m_address(peer.address)
+{
+}
 
 Peer& Peer::operator=(ENetPeer& peer)
 {
@@ -42,20 +45,24 @@ Peer& Peer::operator=(ENetPeer& peer)
 	return *this;
 }
 
-void Peer::disconnect(enet_uint32 data) { enet_peer_disconnect(m_peer, data); }
+void Peer::disconnect(enet_uint32 data)
+{
+	m_host->getTransport().disconnect(*m_peer, data, DisconnectMode::GRACEFUL);
+}
 
 void Peer::disconnectImmediately(enet_uint32 data)
 {
 	// doing this doesn't produce a disconnect event on the host, so we manually
 	// trigger the disconnection callback.
 	std::size_t id = getID();
-	enet_peer_disconnect_now(m_peer, data);
+	m_host->getTransport().disconnect(*m_peer, data,
+	                                  DisconnectMode::IMMEDIATE);
 	m_host->disconnectPeer(id);
 }
 
 void Peer::disconnectOncePacketsAreSent(enet_uint32 data)
 {
-	enet_peer_disconnect_later(m_peer, data);
+	m_host->getTransport().disconnect(*m_peer, data, DisconnectMode::LATER);
 }
 
 void Peer::drop()
@@ -63,11 +70,11 @@ void Peer::drop()
 	// doing this doesn't produce a disconnect event on the host, so we manually
 	// trigger the disconnection callback.
 	std::size_t id = getID();
-	enet_peer_reset(m_peer);
+	m_host->getTransport().disconnect(*m_peer, 0, DisconnectMode::RESET);
 	m_host->disconnectPeer(id);
 }
 
-void Peer::ping() const { enet_peer_ping(m_peer); }
+void Peer::ping() const { m_host->getTransport().ping(*m_peer); }
 
 phx::time::ms Peer::getPingInterval() const
 {
@@ -76,7 +83,7 @@ phx::time::ms Peer::getPingInterval() const
 
 void Peer::setPingInterval(phx::time::ms interval)
 {
-	enet_peer_ping_interval(m_peer, interval.count());
+	m_host->getTransport().setPingInterval(*m_peer, interval);
 }
 
 phx::time::ms Peer::getRoundTripTime() const
@@ -88,21 +95,32 @@ enet_uint32 Peer::getPacketLoss() const { return m_peer->packetLoss; }
 
 void Peer::receive(Callback callback) const
 {
-	enet_uint8 channel;
-	auto       packet = enet_peer_receive(m_peer, &channel);
-	callback(Packet {*packet, true}, channel);
+	enet_uint8  channel = 0;
+	ENetPacket* packet  = m_host->getTransport().receive(*m_peer, channel);
+	if (packet != nullptr)
+	{
+		callback(Packet {*packet, false}, channel);
+	}
 }
 
 void Peer::send(Packet& packet, enet_uint8 channel)
 {
 	packet.prepareForSend();
-	enet_peer_send(m_peer, channel, packet);
+	m_host->getTransport().send(*m_peer, channel,
+	                            *static_cast<ENetPacket*>(packet));
 }
 
 void Peer::send(Packet&& packet, enet_uint8 channel)
 {
 	packet.prepareForSend();
-	enet_peer_send(m_peer, channel, packet);
+	m_host->getTransport().send(*m_peer, channel,
+	                            *static_cast<ENetPacket*>(packet));
+}
+
+void Peer::queue(enet_uint8 type, const Packet::Data& data, PacketFlags flags,
+                 enet_uint8 channel)
+{
+	m_host->queue(getID(), type, data, flags, channel);
 }
 
 Throttle Peer::getThrottle() const
@@ -114,8 +132,7 @@ Throttle Peer::getThrottle() const
 
 void Peer::setThrottle(const Throttle& throttle)
 {
-	enet_peer_throttle_configure(m_peer, throttle.interval.count(),
-	                             throttle.acceleration, throttle.deceleration);
+	m_host->getTransport().setThrottle(*m_peer, throttle);
 }
 
 Timeout Peer::getTimeout() const
@@ -129,8 +146,7 @@ Timeout Peer::getTimeout() const
 
 void Peer::setTimeout(const Timeout& timeout)
 {
-	enet_peer_timeout(m_peer, timeout.limit.count(), timeout.minimum.count(),
-	                  timeout.maximum.count());
+	m_host->getTransport().setTimeout(*m_peer, timeout);
 }
 
 const Address& Peer::getAddress() const { return m_address; }
@@ -32,7 +32,8 @@
 using namespace phx;
 
 std::vector<voxels::Chunk*> PlayerView::update(entt::registry* registry,
-                                               entt::entity    entity)
+                                               entt::entity    entity,
+                                               int             viewDistance)
 {
 	std::vector<voxels::Chunk*> newChunks;
 
@@ -46,11 +47,10 @@ std::vector<voxels::Chunk*> PlayerView::update(entt::registry* registry,
 	    static_cast<int>(playerPos.y) / voxels::Chunk::CHUNK_HEIGHT;
 	const int posZ = static_cast<int>(playerPos.z) / voxels::Chunk::CHUNK_DEPTH;
 
-	// TODO move this to a config or add as a parameter
-	const int viewDistance = 3;
-
 	// TODO remove chunks that are out of view
 
+	std::vector<math::vec3> missing;
+
 	for (int x = -viewDistance; x <= viewDistance; x++)
 	{
 		for (int y = -viewDistance; y <= viewDistance; y++)
@@ -79,17 +79,25 @@ std::vector<voxels::Chunk*> PlayerView::update(entt::registry* registry,
 
 				if (!hasChunk)
 				{
-					voxels::Chunk* chunk = view.map->getChunk(chunkToCheck);
-					if (chunk != nullptr)
-					{
-						view.chunks.emplace_back(chunkToCheck);
-						newChunks.emplace_back(
-						    view.map->getChunk(chunkToCheck));
-					}
+					missing.emplace_back(chunkToCheck);
 				}
 			}
 		}
 	}
 
+	// load or generate everything we need in one go, so the map can spread
+	// generation across its worker pool.
+	view.map->loadChunks(missing);
+
+	for (const auto& chunkPos : missing)
+	{
+		voxels::Chunk* chunk = view.map->getChunk(chunkPos);
+		if (chunk != nullptr)
+		{
+			view.chunks.emplace_back(chunkPos);
+			newChunks.emplace_back(chunk);
+		}
+	}
+
 	return newChunks;
 }
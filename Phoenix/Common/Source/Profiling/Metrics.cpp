@@ -0,0 +1,407 @@
+// Copyright 2019-20 Genten Studios
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+// may be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <Common/Profiling/Metrics.hpp>
+
+#include <Common/Logger.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+using namespace phx::profiling;
+
+namespace
+{
+	std::string formatLabels(const MetricLabels& labels)
+	{
+		std::string formatted;
+		for (const auto& label : labels)
+		{
+			if (!formatted.empty())
+			{
+				formatted += ',';
+			}
+
+			formatted += label.first;
+			formatted += "=\"";
+			for (const char c : label.second)
+			{
+				switch (c)
+				{
+				case '\\':
+					formatted += "\\\\";
+					break;
+				case '"':
+					formatted += "\\\"";
+					break;
+				case '\n':
+					formatted += "\\n";
+					break;
+				default:
+					formatted += c;
+					break;
+				}
+			}
+			formatted += '"';
+		}
+
+		return formatted;
+	}
+
+	std::string formatValue(double value)
+	{
+		// 15 digits keeps bucket bounds like 0.0025 readable, 17 are only
+		// needed when those don't give back the same value.
+		char buffer[32];
+		std::snprintf(buffer, sizeof(buffer), "%.15g", value);
+		if (std::strtod(buffer, nullptr) != value)
+		{
+			std::snprintf(buffer, sizeof(buffer), "%.17g", value);
+		}
+
+		return buffer;
+	}
+
+	void addAtomic(std::atomic<double>& atomic, double value)
+	{
+		double current = atomic.load(std::memory_order_relaxed);
+		while (!atomic.compare_exchange_weak(current, current + value,
+		                                     std::memory_order_relaxed))
+		{
+		}
+	}
+
+	// writes "name{labels} value", merging in an extra label if there is one.
+	void writeSample(std::string& out, const std::string& name,
+	                 const std::string& labels, const std::string& extra,
+	                 const std::string& value)
+	{
+		out += name;
+		if (!labels.empty() || !extra.empty())
+		{
+			out += '{';
+			out += labels;
+			if (!labels.empty() && !extra.empty())
+			{
+				out += ',';
+			}
+			out += extra;
+			out += '}';
+		}
+		out += ' ';
+		out += value;
+		out += '\n';
+	}
+} // namespace
+
+std::uint64_t Counter::get() const
+{
+	std::uint64_t total = 0;
+	for (const auto& shard : m_shards)
+	{
+		total += shard.value.load(std::memory_order_relaxed);
+	}
+
+	return total;
+}
+
+void Gauge::add(double value) { addAtomic(m_value, value); }
+
+Histogram::Histogram(std::vector<double> bounds) : m_bounds(std::move(bounds))
+{
+	std::sort(m_bounds.begin(), m_bounds.end());
+
+	for (auto& shard : m_shards)
+	{
+		shard.buckets = std::make_unique<std::atomic<std::uint64_t>[]>(
+		    m_bounds.size() + 1);
+		for (std::size_t i = 0; i <= m_bounds.size(); ++i)
+		{
+			shard.buckets[i].store(0, std::memory_order_relaxed);
+		}
+	}
+}
+
+void Histogram::observe(double value)
+{
+	const std::size_t bucket = static_cast<std::size_t>(
+	    std::lower_bound(m_bounds.begin(), m_bounds.end(), value) -
+	    m_bounds.begin());
+
+	Shard& shard = m_shards[detail::getMetricShard()];
+	shard.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+	addAtomic(shard.sum, value);
+}
+
+Histogram::Snapshot Histogram::get() const
+{
+	Snapshot snapshot;
+	snapshot.buckets.resize(m_bounds.size() + 1, 0);
+
+	for (const auto& shard : m_shards)
+	{
+		for (std::size_t i = 0; i <= m_bounds.size(); ++i)
+		{
+			snapshot.buckets[i] +=
+			    shard.buckets[i].load(std::memory_order_relaxed);
+		}
+
+		snapshot.sum += shard.sum.load(std::memory_order_relaxed);
+	}
+
+	for (const std::uint64_t bucket : snapshot.buckets)
+	{
+		snapshot.count += bucket;
+	}
+
+	return snapshot;
+}
+
+std::vector<double> Histogram::latencyBuckets()
+{
+	return {0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0};
+}
+
+Metrics& Metrics::get()
+{
+	static Metrics metrics;
+	return metrics;
+}
+
+Metrics::Family& Metrics::getFamily(const std::string& name,
+                                    const std::string& help, Type type)
+{
+	auto family = m_families.find(name);
+	if (family == m_families.end())
+	{
+		family =
+		    m_families.emplace(name, Family {type, help, {}, {}, {}}).first;
+	}
+	else if (family->second.type != type)
+	{
+		LOG_WARNING("METRICS")
+		    << "The metric " << name
+		    << " was registered as two different types, only the first will "
+		       "be exposed.";
+	}
+
+	return family->second;
+}
+
+Counter& Metrics::counter(const std::string& name, const std::string& help,
+                          const MetricLabels& labels)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	auto& metric =
+	    getFamily(name, help, Type::COUNTER).counters[formatLabels(labels)];
+	if (metric == nullptr)
+	{
+		metric = std::make_unique<Counter>();
+	}
+
+	return *metric;
+}
+
+Gauge& Metrics::gauge(const std::string& name, const std::string& help,
+                      const MetricLabels& labels)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	auto& metric =
+	    getFamily(name, help, Type::GAUGE).gauges[formatLabels(labels)];
+	if (metric == nullptr)
+	{
+		metric = std::make_unique<Gauge>();
+	}
+
+	return *metric;
+}
+
+Histogram& Metrics::histogram(const std::string&         name,
+                              const std::string&         help,
+                              const std::vector<double>& bounds,
+                              const MetricLabels&        labels)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	auto& metric = getFamily(name, help, Type::HISTOGRAM)
+	                   .histograms[formatLabels(labels)];
+	if (metric == nullptr)
+	{
+		metric = std::make_unique<Histogram>(bounds);
+	}
+
+	return *metric;
+}
+
+void Metrics::remove(const std::string& name, const MetricLabels& labels)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	auto family = m_families.find(name);
+	if (family == m_families.end())
+	{
+		return;
+	}
+
+	const std::string formatted = formatLabels(labels);
+	family->second.counters.erase(formatted);
+	family->second.gauges.erase(formatted);
+	family->second.histograms.erase(formatted);
+}
+
+std::string Metrics::expose() const
+{
+	std::string out;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (const auto& entry : m_families)
+	{
+		const std::string& name   = entry.first;
+		const Family&      family = entry.second;
+
+		out += "# HELP " + name + ' ' + family.help + '\n';
+
+		switch (family.type)
+		{
+		case Type::COUNTER:
+			out += "# TYPE " + name + " counter\n";
+			for (const auto& metric : family.counters)
+			{
+				writeSample(out, name, metric.first, "",
+				            std::to_string(metric.second->get()));
+			}
+			break;
+
+		case Type::GAUGE:
+			out += "# TYPE " + name + " gauge\n";
+			for (const auto& metric : family.gauges)
+			{
+				writeSample(out, name, metric.first, "",
+				            formatValue(metric.second->get()));
+			}
+			break;
+
+		case Type::HISTOGRAM:
+			out += "# TYPE " + name + " histogram\n";
+			for (const auto& metric : family.histograms)
+			{
+				const auto  snapshot = metric.second->get();
+				const auto& bounds   = metric.second->getBounds();
+
+				// buckets are exposed cumulatively.
+				std::uint64_t cumulative = 0;
+				for (std::size_t i = 0; i < bounds.size(); ++i)
+				{
+					cumulative += snapshot.buckets[i];
+					writeSample(out, name + "_bucket", metric.first,
+					            "le=\"" + formatValue(bounds[i]) + '"',
+					            std::to_string(cumulative));
+				}
+
+				writeSample(out, name + "_bucket", metric.first, "le=\"+Inf\"",
+				            std::to_string(snapshot.count));
+				writeSample(out, name + "_sum", metric.first, "",
+				            formatValue(snapshot.sum));
+				writeSample(out, name + "_count", metric.first, "",
+				            std::to_string(snapshot.count));
+			}
+			break;
+		}
+	}
+
+	return out;
+}
+
+MetricsWriter::MetricsWriter(const MetricsConfig& config)
+    : m_file(config.file), m_writeInterval(config.writeInterval)
+{
+	std::thread thread = std::thread(&MetricsWriter::writeThreadHandle, this);
+	m_worker.swap(thread);
+}
+
+MetricsWriter::~MetricsWriter()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_running = false;
+	}
+	m_cond.notify_all();
+
+	if (m_worker.joinable())
+		m_worker.join();
+
+	write();
+}
+
+void MetricsWriter::write()
+{
+	const std::string temporary = m_file + ".tmp";
+
+	{
+		std::ofstream file(temporary, std::ios_base::trunc);
+		if (!file.is_open())
+		{
+			LOG_WARNING("METRICS") << "Could not open " << temporary << ".";
+			return;
+		}
+
+		file << Metrics::get().expose();
+	}
+
+	if (std::rename(temporary.c_str(), m_file.c_str()) != 0)
+	{
+		// renaming over an existing file fails on Windows.
+		std::remove(m_file.c_str());
+		if (std::rename(temporary.c_str(), m_file.c_str()) != 0)
+		{
+			LOG_WARNING("METRICS") << "Could not write " << m_file << ".";
+		}
+	}
+}
+
+void MetricsWriter::writeThreadHandle()
+{
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_cond.wait_for(lock, m_writeInterval);
+
+			if (!m_running)
+			{
+				return;
+			}
+		}
+
+		write();
+	}
+}
@@ -0,0 +1,306 @@
+// Copyright 2019-20 Genten Studios
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+// may be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <Common/Profiling/Profiler.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+
+using namespace phx::profiling;
+
+namespace
+{
+	std::uint64_t now()
+	{
+		return static_cast<std::uint64_t>(
+		    std::chrono::duration_cast<std::chrono::nanoseconds>(
+		        std::chrono::steady_clock::now().time_since_epoch())
+		        .count());
+	}
+
+	double toMilliseconds(std::uint64_t nanoseconds)
+	{
+		return static_cast<double>(nanoseconds) / 1000000.0;
+	}
+
+	struct Zone
+	{
+		const char*                name;
+		std::size_t                parent;
+		std::vector<std::size_t>   children;
+
+		// this frame.
+		std::size_t   calls = 0;
+		std::uint64_t total = 0;
+
+		// totals of recent frames, and durations of recent calls.
+		std::array<std::uint64_t, Profiler::FRAME_WINDOW> frames {};
+		std::array<std::uint64_t, Profiler::CALL_WINDOW>  samples {};
+		std::size_t                                       frameCount  = 0;
+		std::size_t                                       sampleCount = 0;
+	};
+
+	struct ThreadProfile
+	{
+		// only touched by the owning thread.
+		std::vector<Zone>        zones;
+		std::vector<std::size_t> stack;
+		std::size_t              frames = 0;
+
+		// what other threads read, guarded by the mutex.
+		std::mutex                  mutex;
+		std::string                 name;
+		std::size_t                 publishedFrames = 0;
+		std::vector<ZoneStatistics> published;
+	};
+
+	std::atomic<bool> g_enabled {true};
+
+	std::mutex                                  g_threadsMutex;
+	std::vector<std::unique_ptr<ThreadProfile>> g_threads;
+
+	// profiles are kept after their thread exits so its statistics are
+	// still around, they are only a few KB each.
+	thread_local ThreadProfile* t_profile = nullptr;
+
+	ThreadProfile& getProfile()
+	{
+		if (t_profile == nullptr)
+		{
+			auto profile = std::make_unique<ThreadProfile>();
+
+			// the root zone stands for the thread itself and isn't reported.
+			profile->zones.push_back({"", 0, {}});
+			profile->stack.push_back(0);
+
+			std::lock_guard<std::mutex> lock(g_threadsMutex);
+			profile->name = "Thread " + std::to_string(g_threads.size());
+			t_profile     = profile.get();
+			g_threads.push_back(std::move(profile));
+		}
+
+		return *t_profile;
+	}
+
+	void publish(const ThreadProfile& profile, const Zone& zone,
+	             std::size_t depth, std::vector<ZoneStatistics>& out)
+	{
+		const std::size_t frames =
+		    std::min(zone.frameCount, Profiler::FRAME_WINDOW);
+		const std::size_t samples =
+		    std::min(zone.sampleCount, Profiler::CALL_WINDOW);
+
+		std::uint64_t windowTotal = 0;
+		for (std::size_t i = 0; i < frames; ++i)
+		{
+			windowTotal += zone.frames[i];
+		}
+
+		std::array<std::uint64_t, Profiler::CALL_WINDOW> sorted;
+		std::copy_n(zone.samples.begin(), samples, sorted.begin());
+
+		std::uint64_t max = 0;
+		std::uint64_t p99 = 0;
+		if (samples > 0)
+		{
+			max = *std::max_element(sorted.begin(), sorted.begin() + samples);
+
+			const std::size_t rank = (samples * 99 + 99) / 100 - 1;
+			std::nth_element(sorted.begin(), sorted.begin() + rank,
+			                 sorted.begin() + samples);
+			p99 = sorted[rank];
+		}
+
+		out.push_back(
+		    {zone.name, depth, zone.calls, toMilliseconds(zone.total),
+		     frames == 0 ? 0.0 : toMilliseconds(windowTotal) / frames,
+		     toMilliseconds(max), toMilliseconds(p99)});
+
+		for (const std::size_t child : zone.children)
+		{
+			publish(profile, profile.zones[child], depth + 1, out);
+		}
+	}
+} // namespace
+
+void Profiler::setEnabled(bool enabled)
+{
+	g_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool Profiler::isEnabled() { return g_enabled.load(std::memory_order_relaxed); }
+
+void Profiler::setThreadName(const std::string& name)
+{
+	ThreadProfile& profile = getProfile();
+
+	std::lock_guard<std::mutex> lock(profile.mutex);
+	profile.name = name;
+}
+
+void Profiler::beginZone(const char* name)
+{
+	ThreadProfile& profile = getProfile();
+	const std::size_t parent = profile.stack.back();
+
+	// zones only have a handful of children, so a linear search comparing
+	// pointers is as quick as it gets.
+	for (const std::size_t child : profile.zones[parent].children)
+	{
+		if (profile.zones[child].name == name)
+		{
+			profile.stack.push_back(child);
+			return;
+		}
+	}
+
+	const std::size_t zone = profile.zones.size();
+	profile.zones.push_back({name, parent, {}});
+	profile.zones[parent].children.push_back(zone);
+	profile.stack.push_back(zone);
+}
+
+void Profiler::endZone(std::uint64_t nanoseconds)
+{
+	ThreadProfile& profile = getProfile();
+	if (profile.stack.size() <= 1)
+	{
+		return;
+	}
+
+	Zone& zone = profile.zones[profile.stack.back()];
+	profile.stack.pop_back();
+
+	++zone.calls;
+	zone.total += nanoseconds;
+	zone.samples[zone.sampleCount++ % CALL_WINDOW] = nanoseconds;
+}
+
+void Profiler::endFrame()
+{
+	ThreadProfile& profile = getProfile();
+	++profile.frames;
+
+	for (auto& zone : profile.zones)
+	{
+		zone.frames[zone.frameCount++ % FRAME_WINDOW] = zone.total;
+	}
+
+	std::vector<ZoneStatistics> statistics;
+	statistics.reserve(profile.zones.size());
+	for (const std::size_t child : profile.zones[0].children)
+	{
+		publish(profile, profile.zones[child], 0, statistics);
+	}
+
+	for (auto& zone : profile.zones)
+	{
+		zone.calls = 0;
+		zone.total = 0;
+	}
+
+	std::lock_guard<std::mutex> lock(profile.mutex);
+	profile.published.swap(statistics);
+	profile.publishedFrames = profile.frames;
+}
+
+std::vector<ThreadStatistics> Profiler::getStatistics()
+{
+	std::vector<ThreadStatistics> statistics;
+
+	std::lock_guard<std::mutex> lock(g_threadsMutex);
+	for (const auto& profile : g_threads)
+	{
+		std::lock_guard<std::mutex> profileLock(profile->mutex);
+		if (profile->publishedFrames == 0)
+		{
+			continue;
+		}
+
+		statistics.push_back(
+		    {profile->name, profile->publishedFrames, profile->published});
+	}
+
+	return statistics;
+}
+
+std::string Profiler::report()
+{
+	std::string report;
+	char        line[160];
+
+	for (const auto& thread : getStatistics())
+	{
+		std::snprintf(line, sizeof(line), "[%s] %zu frames\n",
+		              thread.name.c_str(), thread.frames);
+		report += line;
+
+		std::snprintf(line, sizeof(line), "%-40s %7s %10s %10s %10s %10s\n",
+		              "Zone", "Calls", "Total ms", "Avg ms", "Max ms",
+		              "p99 ms");
+		report += line;
+
+		for (const auto& zone : thread.zones)
+		{
+			const std::string name =
+			    std::string(zone.depth * 2, ' ') + zone.name;
+
+			std::snprintf(line, sizeof(line),
+			              "%-40s %7zu %10.3f %10.3f %10.3f %10.3f\n",
+			              name.c_str(), zone.calls, zone.total, zone.average,
+			              zone.max, zone.p99);
+			report += line;
+		}
+
+		report += '\n';
+	}
+
+	return report;
+}
+
+ProfileScope::ProfileScope(const char* name) : m_active(Profiler::isEnabled())
+{
+	if (m_active)
+	{
+		Profiler::beginZone(name);
+		m_start = now();
+	}
+}
+
+ProfileScope::~ProfileScope()
+{
+	if (m_active)
+	{
+		Profiler::endZone(now() - m_start);
+	}
+}
@@ -0,0 +1,294 @@
+// Copyright 2019-20 Genten Studios
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+// may be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <Common/Profiling/Tracer.hpp>
+
+#include <Common/Logger.hpp>
+#include <Common/Utility/Serializer.hpp>
+
+using namespace phx::profiling;
+
+Tracer*                    Tracer::m_instance = nullptr;
+std::atomic<std::uint64_t> Tracer::m_nextID {1};
+
+namespace
+{
+	// each thread remembers its buffer so recording never has to look it up.
+	struct CachedBuffer
+	{
+		std::uint64_t tracer = 0;
+		void*         buffer = nullptr;
+	};
+
+	thread_local CachedBuffer t_cachedBuffer;
+} // namespace
+
+void Tracer::initialize(const TracerConfig& config)
+{
+	m_instance = new Tracer(config);
+}
+
+void Tracer::teardown()
+{
+	delete m_instance;
+	m_instance = nullptr;
+}
+
+Tracer::Tracer(const TracerConfig& config)
+    : m_bufferSize(config.bufferSize == 0 ? 1 : config.bufferSize),
+      m_flushInterval(config.flushInterval),
+      m_start(std::chrono::steady_clock::now()), m_id(m_nextID++)
+{
+	m_file.open(config.file, std::ios_base::binary | std::ios_base::trunc);
+	if (!m_file.is_open())
+	{
+		LOG_WARNING("TRACE")
+		    << "Could not open " << config.file << ", nothing will be traced.";
+	}
+
+	const char magic[] = {'P', 'H', 'X', 'T', 'R', 'A', 'C', 'E'};
+	m_file.write(magic, sizeof(magic));
+
+	Serializer ser;
+	ser << VERSION;
+	m_file.write(reinterpret_cast<const char*>(ser.getBuffer().data()),
+	             static_cast<std::streamsize>(ser.getBuffer().size()));
+
+	std::thread thread = std::thread(&Tracer::flushThreadHandle, this);
+	m_worker.swap(thread);
+}
+
+Tracer::~Tracer()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_running = false;
+	}
+	m_cond.notify_all();
+
+	if (m_worker.joinable())
+		m_worker.join();
+
+	flush();
+	m_file.close();
+}
+
+std::uint64_t Tracer::now() const
+{
+	return static_cast<std::uint64_t>(
+	    std::chrono::duration_cast<std::chrono::nanoseconds>(
+	        std::chrono::steady_clock::now() - m_start)
+	        .count());
+}
+
+void Tracer::setThreadName(const std::string& name)
+{
+	ThreadBuffer& buffer = getThreadBuffer();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	buffer.name        = name;
+	buffer.nameWritten = false;
+}
+
+void Tracer::record(TraceCategory category, TracePhase phase,
+                    const char* name, std::uint64_t timestamp,
+                    std::uint64_t duration, std::int64_t value)
+{
+	ThreadBuffer& buffer = getThreadBuffer();
+
+	std::size_t size = buffer.size.load(std::memory_order_relaxed);
+	if (size == m_bufferSize)
+	{
+		retire(buffer);
+		size = 0;
+	}
+
+	buffer.events[size] = {timestamp, duration, value, name, category, phase};
+	buffer.size.store(size + 1, std::memory_order_release);
+}
+
+void Tracer::instant(TraceCategory category, const char* name,
+                     std::int64_t value)
+{
+	record(category, TracePhase::INSTANT, name, now(), 0, value);
+}
+
+void Tracer::counter(TraceCategory category, const char* name,
+                     std::int64_t value)
+{
+	record(category, TracePhase::COUNTER, name, now(), 0, value);
+}
+
+Tracer::ThreadBuffer& Tracer::getThreadBuffer()
+{
+	if (t_cachedBuffer.tracer == m_id)
+	{
+		return *static_cast<ThreadBuffer*>(t_cachedBuffer.buffer);
+	}
+
+	auto buffer    = std::make_unique<ThreadBuffer>();
+	buffer->events = std::make_unique<TraceEvent[]>(m_bufferSize);
+
+	ThreadBuffer* pointer = buffer.get();
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		buffer->thread = static_cast<std::uint32_t>(m_threads.size());
+		m_threads.push_back(std::move(buffer));
+	}
+
+	t_cachedBuffer = {m_id, pointer};
+	return *pointer;
+}
+
+void Tracer::retire(ThreadBuffer& buffer)
+{
+	// allocated outside the lock, the flushing thread may be holding it.
+	auto events = std::make_unique<TraceEvent[]>(m_bufferSize);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	const std::size_t size = buffer.size.load(std::memory_order_relaxed);
+	if (buffer.flushed < size)
+	{
+		m_retired.push_back(
+		    {buffer.thread, std::move(buffer.events), buffer.flushed, size});
+	}
+
+	buffer.events  = std::move(events);
+	buffer.flushed = 0;
+	buffer.size.store(0, std::memory_order_relaxed);
+
+	m_cond.notify_one();
+}
+
+void Tracer::flush()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (!m_file.is_open())
+	{
+		m_retired.clear();
+		for (auto& buffer : m_threads)
+		{
+			buffer->flushed = buffer->size.load(std::memory_order_acquire);
+		}
+
+		return;
+	}
+
+	for (auto& buffer : m_threads)
+	{
+		if (!buffer->nameWritten && !buffer->name.empty())
+		{
+			writeThreadName(*buffer);
+		}
+	}
+
+	for (const auto& retired : m_retired)
+	{
+		write(retired.thread, retired.events.get() + retired.begin,
+		      retired.end - retired.begin);
+	}
+	m_retired.clear();
+
+	for (auto& buffer : m_threads)
+	{
+		const std::size_t size = buffer->size.load(std::memory_order_acquire);
+		write(buffer->thread, buffer->events.get() + buffer->flushed,
+		      size - buffer->flushed);
+		buffer->flushed = size;
+	}
+
+	m_file.flush();
+}
+
+void Tracer::write(std::uint32_t thread, const TraceEvent* events,
+                   std::size_t count)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	Serializer ser;
+	ser.reserve(count * 30);
+
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		const TraceEvent& event = events[i];
+
+		auto string = m_strings.find(event.name);
+		if (string == m_strings.end())
+		{
+			const auto id = static_cast<std::uint32_t>(m_strings.size());
+			string        = m_strings.emplace(event.name, id).first;
+
+			ser << static_cast<std::uint8_t>(Record::STRING) << id
+			    << std::string(event.name);
+		}
+
+		ser << static_cast<std::uint8_t>(Record::EVENT)
+		    << static_cast<std::uint8_t>(event.category)
+		    << static_cast<std::uint8_t>(event.phase) << thread
+		    << string->second << event.timestamp << event.duration
+		    << event.value;
+	}
+
+	m_file.write(reinterpret_cast<const char*>(ser.getBuffer().data()),
+	             static_cast<std::streamsize>(ser.getBuffer().size()));
+}
+
+void Tracer::writeThreadName(ThreadBuffer& buffer)
+{
+	Serializer ser;
+	ser << static_cast<std::uint8_t>(Record::THREAD) << buffer.thread
+	    << buffer.name;
+
+	m_file.write(reinterpret_cast<const char*>(ser.getBuffer().data()),
+	             static_cast<std::streamsize>(ser.getBuffer().size()));
+
+	buffer.nameWritten = true;
+}
+
+void Tracer::flushThreadHandle()
+{
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_cond.wait_for(lock, m_flushInterval);
+
+			if (!m_running)
+			{
+				return;
+			}
+		}
+
+		flush();
+	}
+}
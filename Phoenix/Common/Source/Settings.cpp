@@ -88,8 +88,24 @@ void Settings::registerAPI(cms::ModManager* manager)
 
 Setting* Settings::add(const std::string& name, const std::string& key,
                        int defaultValue)
+{
+	return add(name, key, defaultValue, SHRT_MIN, SHRT_MAX);
+}
+
+Setting* Settings::add(const std::string& name, const std::string& key,
+                       int defaultValue, int minValue, int maxValue)
 {
 	m_settings[key] = Setting(name, key, defaultValue, &m_data);
+	m_settings[key].setMin(minValue);
+	m_settings[key].setMax(maxValue);
+
+	// a value loaded before the setting was added replaces the default.
+	auto it = m_data.find(key);
+	if (it != m_data.end() && it->is_number_integer())
+	{
+		m_settings[key].set(it->get<int>());
+	}
+
 	return &m_settings[key];
 }
 
@@ -119,6 +135,16 @@ void Settings::load(const std::string& saveFile)
 		file >> m_data;
 	}
 	file.close();
+
+	// settings added before loading take on the loaded values.
+	for (auto& setting : m_settings)
+	{
+		auto it = m_data.find(setting.first);
+		if (it != m_data.end() && it->is_number_integer())
+		{
+			setting.second.set(it->get<int>());
+		}
+	}
 }
 
 void Settings::save(const std::string& saveFile)
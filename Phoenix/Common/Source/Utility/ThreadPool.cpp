@@ -0,0 +1,140 @@
+// Copyright 2019-20 Genten Studios
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+// may be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <Common/Utility/ThreadPool.hpp>
+
+#include <Common/Profiling/Profiler.hpp>
+#include <Common/Profiling/Tracer.hpp>
+
+using namespace phx;
+
+ThreadPool::ThreadPool(std::size_t threads, const std::string& name)
+{
+	if (threads == 0)
+	{
+		const std::size_t cores = std::thread::hardware_concurrency();
+		threads                 = cores > 1 ? cores - 1 : 1;
+	}
+
+	m_workers.reserve(threads);
+	for (std::size_t i = 0; i < threads; ++i)
+	{
+		m_workers.emplace_back(&ThreadPool::workerThreadHandle, this, i, name);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_wake.notify_all();
+
+	for (auto& worker : m_workers)
+	{
+		worker.join();
+	}
+}
+
+void ThreadPool::parallelFor(std::size_t count, const Task& task)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> submit(m_submitMutex);
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_task  = &task;
+		m_count = count;
+		m_next.store(0, std::memory_order_relaxed);
+		++m_generation;
+	}
+	m_wake.notify_all();
+
+	work();
+
+	// every index has been taken by now, wait for the workers still running
+	// theirs. workers can't join once the task is cleared.
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_finished.wait(lock, [this] { return m_active == 0; });
+	m_task = nullptr;
+}
+
+void ThreadPool::workerThreadHandle(std::size_t index, const std::string& name)
+{
+	const std::string threadName = name + " " + std::to_string(index);
+	if (profiling::Tracer::get() != nullptr)
+	{
+		profiling::Tracer::get()->setThreadName(threadName);
+	}
+	profiling::Profiler::setThreadName(threadName);
+
+	std::uint64_t generation = 0;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_wake.wait(lock, [this, generation] {
+				return m_stopping ||
+				       (m_task != nullptr && m_generation != generation);
+			});
+
+			if (m_stopping)
+			{
+				return;
+			}
+
+			generation = m_generation;
+			++m_active;
+		}
+
+		work();
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			--m_active;
+		}
+		m_finished.notify_one();
+
+		// a loop is a frame as far as the profiler is concerned.
+		profiling::Profiler::endFrame();
+	}
+}
+
+void ThreadPool::work()
+{
+	std::size_t i;
+	while ((i = m_next.fetch_add(1, std::memory_order_relaxed)) < m_count)
+	{
+		(*m_task)(i);
+	}
+}
@@ -0,0 +1,412 @@
+// Copyright 2019-20 Genten Studios
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+// may be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <Common/Logger.hpp>
+#include <Common/Profiling/Profiler.hpp>
+#include <Common/Profiling/Tracer.hpp>
+#include <Common/Voxels/BlockTicker.hpp>
+#include <Common/Voxels/Map.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+
+using namespace phx::voxels;
+
+namespace
+{
+	constexpr std::size_t WHEEL_MASK = BlockTicker::WHEEL_SIZE - 1;
+
+	static_assert((BlockTicker::WHEEL_SIZE & WHEEL_MASK) == 0,
+	              "The wheel size must be a power of two.");
+
+	phx::math::vec3 toWorld(const phx::math::vec3& chunkPos,
+	                        std::size_t         index)
+	{
+		const std::size_t x = index % Chunk::CHUNK_WIDTH;
+		const std::size_t y =
+		    (index / Chunk::CHUNK_WIDTH) % Chunk::CHUNK_HEIGHT;
+		const std::size_t z =
+		    index / (Chunk::CHUNK_WIDTH * Chunk::CHUNK_HEIGHT);
+
+		return {chunkPos.x + static_cast<float>(x),
+		        chunkPos.y + static_cast<float>(y),
+		        chunkPos.z + static_cast<float>(z)};
+	}
+} // namespace
+
+std::uint64_t BlockTicker::ChunkTicks::get(std::uint16_t index) const
+{
+	if (!dense.empty())
+	{
+		return dense[index];
+	}
+
+	for (const auto& pending : sparse)
+	{
+		if (pending.first == index)
+		{
+			return pending.second;
+		}
+	}
+
+	return 0;
+}
+
+void BlockTicker::ChunkTicks::set(std::uint16_t index, std::uint64_t due)
+{
+	if (!dense.empty())
+	{
+		count += (due != 0 ? 1 : 0) - (dense[index] != 0 ? 1 : 0);
+		dense[index] = due;
+		return;
+	}
+
+	for (auto it = sparse.begin(); it != sparse.end(); ++it)
+	{
+		if (it->first == index)
+		{
+			if (due == 0)
+			{
+				*it = sparse.back();
+				sparse.pop_back();
+				--count;
+			}
+			else
+			{
+				it->second = due;
+			}
+
+			return;
+		}
+	}
+
+	if (due == 0)
+	{
+		return;
+	}
+
+	++count;
+	if (sparse.size() < SPARSE_LIMIT)
+	{
+		sparse.emplace_back(index, due);
+		return;
+	}
+
+	dense.assign(Chunk::CHUNK_MAX_BLOCKS, 0);
+	for (const auto& pending : sparse)
+	{
+		dense[pending.first] = pending.second;
+	}
+	dense[index] = due;
+
+	sparse.clear();
+	sparse.shrink_to_fit();
+}
+
+template <typename F>
+void BlockTicker::ChunkTicks::forEach(const F& func) const
+{
+	if (dense.empty())
+	{
+		for (const auto& pending : sparse)
+		{
+			func(pending.first, pending.second);
+		}
+
+		return;
+	}
+
+	for (std::size_t i = 0; i < dense.size(); ++i)
+	{
+		if (dense[i] != 0)
+		{
+			func(static_cast<std::uint16_t>(i), dense[i]);
+		}
+	}
+}
+
+void BlockTicker::setHandler(Handler handler)
+{
+	m_handler = std::move(handler);
+}
+
+void BlockTicker::setBudget(std::size_t updates) { m_budget = updates; }
+
+void BlockTicker::setRandomTicks(std::size_t perChunk)
+{
+	m_randomTicks = perChunk;
+}
+
+void BlockTicker::schedule(const math::vec3& chunkPos, std::size_t index,
+                           std::uint64_t delay)
+{
+	if (index >= static_cast<std::size_t>(Chunk::CHUNK_MAX_BLOCKS))
+	{
+		return;
+	}
+
+	delay                   = std::max<std::uint64_t>(delay, 1);
+	const std::uint64_t due = m_now + delay;
+	const std::uint64_t key = Chunk::getKey(chunkPos);
+
+	ChunkTicks& ticks = m_pending[key];
+	ticks.position    = chunkPos;
+
+	const std::uint64_t current = ticks.get(static_cast<std::uint16_t>(index));
+
+	// the earlier update wins, the later one would find nothing to do.
+	if (current != 0 && current <= due)
+	{
+		return;
+	}
+
+	if (current == 0)
+	{
+		++m_pendingCount;
+	}
+
+	ticks.set(static_cast<std::uint16_t>(index), due);
+
+	place({key, due, static_cast<std::uint16_t>(index)});
+}
+
+void BlockTicker::place(const Entry& entry)
+{
+	if (entry.due < m_now + WHEEL_SIZE)
+	{
+		m_wheel[entry.due & WHEEL_MASK].push_back(entry);
+	}
+	else if (entry.due < m_now + WHEEL_SIZE * WHEEL_SIZE)
+	{
+		m_outerWheel[(entry.due / WHEEL_SIZE) & WHEEL_MASK].push_back(entry);
+	}
+	else
+	{
+		m_overflow.push(entry);
+	}
+}
+
+void BlockTicker::tick(Map& map)
+{
+	PHX_TRACE_SCOPE(TICK, "BlockTicker::tick");
+	PHX_PROFILE_SCOPE("BlockTicker::tick");
+
+	++m_now;
+
+	// updates too far out for either wheel move in once it reaches them.
+	while (!m_overflow.empty() &&
+	       m_overflow.top().due < m_now + WHEEL_SIZE * WHEEL_SIZE)
+	{
+		place(m_overflow.top());
+		m_overflow.pop();
+	}
+
+	// every WHEEL_SIZE ticks the next slot of the outer wheel comes due,
+	// and its updates are spread over the inner wheel.
+	if ((m_now & WHEEL_MASK) == 0)
+	{
+		std::vector<Entry> outer;
+		outer.swap(m_outerWheel[(m_now / WHEEL_SIZE) & WHEEL_MASK]);
+
+		for (const Entry& entry : outer)
+		{
+			place(entry);
+		}
+	}
+
+	std::vector<Entry>& slot = m_wheel[m_now & WHEEL_MASK];
+	m_due.insert(m_due.end(), slot.begin(), slot.end());
+	slot.clear();
+
+	const std::size_t budget =
+	    m_budget == 0 ? std::numeric_limits<std::size_t>::max() : m_budget;
+	std::size_t ran = 0;
+
+	while (!m_due.empty() && ran < budget)
+	{
+		const Entry entry = m_due.front();
+		m_due.pop_front();
+
+		if (run(map, entry))
+		{
+			++ran;
+		}
+	}
+
+	if (m_randomTicks == 0 || m_randomChunks.empty())
+	{
+		return;
+	}
+
+	// chunks carry on from where the last tick's budget ran out, so all of
+	// them get their turn.
+	const std::size_t chunks = m_randomChunks.size();
+	for (std::size_t i = 0; i < chunks && ran < budget; ++i)
+	{
+		if (m_randomCursor >= m_randomChunks.size())
+		{
+			m_randomCursor = 0;
+		}
+
+		Chunk* chunk = m_randomChunks[m_randomCursor++];
+		for (std::size_t j = 0; j < m_randomTicks; ++j)
+		{
+			const std::size_t index = m_random() % Chunk::CHUNK_MAX_BLOCKS;
+			BlockType*        block = chunk->getBlocks()[index];
+			if (block->ticksRandomly && m_handler)
+			{
+				m_handler(toWorld(chunk->getChunkPos(), index), block,
+				          TickType::RANDOM);
+				++ran;
+			}
+		}
+	}
+}
+
+bool BlockTicker::run(Map& map, const Entry& entry)
+{
+	auto chunkIt = m_pending.find(entry.chunk);
+	if (chunkIt == m_pending.end())
+	{
+		return false;
+	}
+
+	ChunkTicks& ticks = chunkIt->second;
+
+	if (ticks.get(entry.index) != entry.due)
+	{
+		return false;
+	}
+
+	ticks.set(entry.index, 0);
+	--m_pendingCount;
+
+	// chunks are never dropped from the map, so the pointer stays good.
+	if (ticks.chunk == nullptr)
+	{
+		ticks.chunk = map.getChunk(ticks.position);
+	}
+
+	const math::vec3 position = ticks.position;
+	Chunk*           chunk    = ticks.chunk;
+
+	// a chunk with nothing left pending is forgotten, scheduling it again
+	// starts a new entry.
+	if (ticks.count == 0)
+	{
+		m_pending.erase(chunkIt);
+	}
+
+	// the save still lists the update that just ran.
+	map.markUnsaved(position);
+
+	// the handler may schedule more, so nothing above is used after this.
+	if (chunk != nullptr && m_handler)
+	{
+		m_handler(toWorld(position, entry.index),
+		          chunk->getBlocks()[entry.index], TickType::SCHEDULED);
+	}
+
+	return true;
+}
+
+void BlockTicker::track(Chunk* chunk)
+{
+	if (m_randomTracked.find(chunk) != m_randomTracked.end())
+	{
+		return;
+	}
+
+	for (const BlockType* block : chunk->getBlocks())
+	{
+		if (block->ticksRandomly)
+		{
+			m_randomTracked.insert(chunk);
+			m_randomChunks.push_back(chunk);
+			return;
+		}
+	}
+}
+
+void BlockTicker::track(Chunk* chunk, const BlockType* block)
+{
+	if (block->ticksRandomly && m_randomTracked.insert(chunk).second)
+	{
+		m_randomChunks.push_back(chunk);
+	}
+}
+
+std::string BlockTicker::write(const math::vec3& chunkPos) const
+{
+	auto chunkIt = m_pending.find(Chunk::getKey(chunkPos));
+	if (chunkIt == m_pending.end())
+	{
+		return {};
+	}
+
+	// delays rather than ticks, the tick count starts over with the server.
+	std::string data;
+	chunkIt->second.forEach([this, &data](std::uint16_t index,
+	                                      std::uint64_t due) {
+		data += std::to_string(index) + ":" +
+		        std::to_string(due > m_now ? due - m_now : 0) + ";";
+	});
+
+	return data;
+}
+
+void BlockTicker::read(const math::vec3& chunkPos, const std::string& data)
+{
+	const char* cursor = data.c_str();
+	while (*cursor != '\0')
+	{
+		char*                    end   = nullptr;
+		const unsigned long long index = std::strtoull(cursor, &end, 10);
+		if (end == cursor || *end != ':')
+		{
+			break;
+		}
+
+		cursor                         = end + 1;
+		const unsigned long long delay = std::strtoull(cursor, &end, 10);
+		if (end == cursor || *end != ';')
+		{
+			break;
+		}
+
+		cursor = end + 1;
+		schedule(chunkPos, static_cast<std::size_t>(index), delay);
+	}
+
+	if (*cursor != '\0')
+	{
+		LOG_WARNING("MAP") << "Skipping invalid block updates saved for the "
+		                   << "chunk at " << chunkPos << ".";
+	}
+}
@@ -28,6 +28,8 @@
 
 #include <Common/Voxels/Chunk.hpp>
 
+#include <algorithm>
+
 using namespace phx::voxels;
 
 Chunk::Chunk(const phx::math::vec3& chunkPos, BlockReferrer* referrer)
@@ -36,8 +38,45 @@ Chunk::Chunk(const phx::math::vec3& chunkPos, BlockReferrer* referrer)
 	m_blocks.reserve(CHUNK_WIDTH * CHUNK_HEIGHT * CHUNK_DEPTH);
 }
 
-phx::math::vec3   Chunk::getChunkPos() const { return m_pos; }
-Chunk::BlockList& Chunk::getBlocks() { return m_blocks; }
+phx::math::vec3         Chunk::getChunkPos() const { return m_pos; }
+Chunk::BlockList&       Chunk::getBlocks() { return m_blocks; }
+const Chunk::BlockList& Chunk::getBlocks() const { return m_blocks; }
+Chunk::LightList&       Chunk::getLight() { return m_light; }
+const Chunk::LightList& Chunk::getLight() const { return m_light; }
+Chunk::LevelList&       Chunk::getLevels() { return m_levels; }
+const Chunk::LevelList& Chunk::getLevels() const { return m_levels; }
+
+phx::math::vec3 Chunk::getNeighbourPos(const phx::math::vec3& chunkPos,
+                                       std::size_t            face)
+{
+	static const math::vec3 offsets[] = {
+	    {0.f, 0.f, -static_cast<float>(CHUNK_DEPTH)}, // front
+	    {-static_cast<float>(CHUNK_WIDTH), 0.f, 0.f}, // left
+	    {0.f, 0.f, static_cast<float>(CHUNK_DEPTH)},  // back
+	    {static_cast<float>(CHUNK_WIDTH), 0.f, 0.f},  // right
+	    {0.f, static_cast<float>(CHUNK_HEIGHT), 0.f}, // top
+	    {0.f, -static_cast<float>(CHUNK_HEIGHT), 0.f} // bottom
+	};
+
+	return chunkPos + offsets[face];
+}
+
+std::uint64_t Chunk::getKey(const phx::math::vec3& chunkPos)
+{
+	// 21 bits an axis is far more chunks than a map will ever reach.
+	const auto pack = [](float value, int size) {
+		return static_cast<std::uint64_t>(static_cast<int>(value) / size) &
+		       0x1FFFFF;
+	};
+
+	const std::uint64_t key = pack(chunkPos.x, CHUNK_WIDTH) |
+	                          pack(chunkPos.y, CHUNK_HEIGHT) << 21 |
+	                          pack(chunkPos.z, CHUNK_DEPTH) << 42;
+
+	// std::hash of an integer is the integer itself in most standard
+	// libraries, so the bits are mixed to spread neighbours over buckets.
+	return key * 0x9E3779B97F4A7C15ull;
+}
 
 BlockType* Chunk::getBlockAt(phx::math::vec3 position) const
 {
@@ -61,10 +100,40 @@ void Chunk::setBlockAt(phx::math::vec3 position, BlockType* newBlock)
 
 phx::Serializer& Chunk::operator>>(phx::Serializer& ser) const
 {
-	ser << m_pos.x << m_pos.y << m_pos.z;
+	constexpr std::size_t size = CHUNK_WIDTH * CHUNK_HEIGHT * CHUNK_DEPTH;
+
+	// ids are written in one go at the smallest width that fits all of them,
+	// which is 16 bits unless an awful lot of blocks are registered.
+	std::size_t maxID = 0;
 	for (const BlockType* block : m_blocks)
 	{
-		ser << block->uniqueIdentifier;
+		maxID = std::max(maxID, block->uniqueIdentifier);
+	}
+
+	const std::uint8_t width = maxID <= 0xFFFF ? 2 : 4;
+
+	ser.reserve(sizeof(float) * 3 + sizeof(width) + m_blocks.size() * width);
+	ser << m_pos.x << m_pos.y << m_pos.z << width;
+
+	if (width == 2)
+	{
+		std::uint16_t ids[size];
+		for (std::size_t i = 0; i < m_blocks.size(); ++i)
+		{
+			ids[i] = static_cast<std::uint16_t>(m_blocks[i]->uniqueIdentifier);
+		}
+
+		ser.writeArray(ids, m_blocks.size());
+	}
+	else
+	{
+		std::vector<std::uint32_t> ids(m_blocks.size());
+		for (std::size_t i = 0; i < m_blocks.size(); ++i)
+		{
+			ids[i] = static_cast<std::uint32_t>(m_blocks[i]->uniqueIdentifier);
+		}
+
+		ser.writeArray(ids.data(), ids.size());
 	}
 
 	return ser;
@@ -72,14 +141,28 @@ phx::Serializer& Chunk::operator>>(phx::Serializer& ser) const
 
 phx::Serializer& Chunk::operator<<(phx::Serializer& ser)
 {
+	constexpr std::size_t size = CHUNK_WIDTH * CHUNK_HEIGHT * CHUNK_DEPTH;
+
 	m_blocks.clear();
-	m_blocks.reserve(4096);
+	m_blocks.reserve(size);
+
+	std::uint8_t width = 0;
+	ser >> m_pos.x >> m_pos.y >> m_pos.z >> width;
+
+	std::vector<std::uint32_t> ids(size, BlockType::UNKNOWN_BLOCK);
+	if (width == 2)
+	{
+		std::uint16_t narrow[size];
+		const std::size_t read = ser.readArray(narrow, size);
+		std::copy(narrow, narrow + read, ids.begin());
+	}
+	else
+	{
+		ser.readArray(ids.data(), size);
+	}
 
-	ser >> m_pos.x >> m_pos.y >> m_pos.z;
-	for (int i = 0; i < CHUNK_DEPTH * CHUNK_WIDTH * CHUNK_HEIGHT; i++)
+	for (const std::uint32_t id : ids)
 	{
-		std::size_t id = 0;
-		ser >> id;
 		m_blocks.push_back(m_referrer->blocks.get(id));
 	}
 
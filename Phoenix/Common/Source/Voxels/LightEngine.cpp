@@ -0,0 +1,540 @@
+// Copyright 2019-20 Genten Studios
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+// may be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <Common/Profiling/Profiler.hpp>
+#include <Common/Profiling/Tracer.hpp>
+#include <Common/Voxels/LightEngine.hpp>
+
+#include <algorithm>
+
+using namespace phx::voxels;
+
+namespace
+{
+	constexpr std::size_t WIDTH  = Chunk::CHUNK_WIDTH;
+	constexpr std::size_t HEIGHT = Chunk::CHUNK_HEIGHT;
+	constexpr std::size_t DEPTH  = Chunk::CHUNK_DEPTH;
+
+	constexpr std::size_t toIndex(BlockFace face)
+	{
+		return static_cast<std::size_t>(face);
+	}
+
+	std::uint8_t getEmission(const BlockType* block)
+	{
+		return std::min(block->lightLevel, LightEngine::MAX_LIGHT);
+	}
+} // namespace
+
+LightEngine::Node LightEngine::Queue::pop()
+{
+	const Node node = nodes[head++];
+	if (head == nodes.size())
+	{
+		nodes.clear();
+		head = 0;
+	}
+
+	return node;
+}
+
+void LightEngine::setEnabled(bool enabled) { m_enabled = enabled; }
+
+void LightEngine::setBudget(std::size_t blocks) { m_budget = blocks; }
+
+std::uint32_t LightEngine::find(const Chunk* chunk) const
+{
+	const auto it = m_lookup.find(Chunk::getKey(chunk->getChunkPos()));
+	return it == m_lookup.end() ? NONE : it->second;
+}
+
+std::uint8_t LightEngine::get(Channel channel, std::uint32_t record,
+                              std::size_t index) const
+{
+	const std::uint8_t light = m_records[record].light[index];
+	return channel == SKY ? getSkyLight(light) : getBlockLight(light);
+}
+
+void LightEngine::set(Channel channel, std::uint32_t record,
+                      std::size_t index, std::uint8_t level)
+{
+	Record&       entry = m_records[record];
+	std::uint8_t& light = entry.light[index];
+
+	light = channel == SKY
+	            ? static_cast<std::uint8_t>((light & 0x0F) | (level << 4))
+	            : static_cast<std::uint8_t>((light & 0xF0) | level);
+
+	if (!entry.changed)
+	{
+		entry.changed = true;
+		m_changed.push_back(record);
+	}
+
+	entry.borders |= Chunk::getBorders(index);
+}
+
+bool LightEngine::isOpaque(std::uint32_t record, std::size_t index) const
+{
+	return m_records[record].chunk->getBlocks()[index]->category ==
+	       BlockCategory::SOLID;
+}
+
+std::uint8_t LightEngine::getSource(Channel channel, std::uint32_t record,
+                                    std::size_t index) const
+{
+	if (channel == BLOCK)
+	{
+		return getEmission(m_records[record].chunk->getBlocks()[index]);
+	}
+
+	if (isOpaque(record, index))
+	{
+		return 0;
+	}
+
+	// a block with nothing loaded above it is out in the open.
+	std::uint32_t above;
+	std::size_t   aboveIndex;
+	if (!step(record, index, toIndex(BlockFace::TOP), above, aboveIndex) ||
+	    get(SKY, above, aboveIndex) == MAX_LIGHT)
+	{
+		return MAX_LIGHT;
+	}
+
+	return 0;
+}
+
+bool LightEngine::step(std::uint32_t record, std::size_t index,
+                       std::size_t face, std::uint32_t& nextRecord,
+                       std::size_t& nextIndex) const
+{
+	const bool inside = Chunk::stepIndex(index, face, nextIndex);
+
+	nextRecord = inside ? record : m_records[record].neighbours[face];
+	return nextRecord != NONE;
+}
+
+void LightEngine::add(Chunk* chunk)
+{
+	if (!m_enabled)
+	{
+		return;
+	}
+
+	PHX_PROFILE_SCOPE("LightEngine::add");
+
+	const math::vec3    position = chunk->getChunkPos();
+	const std::uint64_t key      = Chunk::getKey(position);
+	if (m_lookup.find(key) != m_lookup.end())
+	{
+		return;
+	}
+
+	const auto record = static_cast<std::uint32_t>(m_records.size());
+	// the light is never resized again, so it can be held onto.
+	chunk->getLight().assign(Chunk::CHUNK_MAX_BLOCKS, 0);
+
+	m_records.push_back({chunk, chunk->getLight().data(), {}, false});
+	m_records[record].neighbours.fill(NONE);
+	m_lookup.emplace(key, record);
+	m_records[record].changed = true;
+	m_changed.push_back(record);
+
+	for (std::size_t face = 0; face < FACE_COUNT; ++face)
+	{
+		const auto it = m_lookup.find(
+		    Chunk::getKey(Chunk::getNeighbourPos(position, face)));
+		if (it != m_lookup.end())
+		{
+			const std::size_t opposite = Chunk::getOppositeFace(face);
+
+			m_records[record].neighbours[face]         = it->second;
+			m_records[it->second].neighbours[opposite] = record;
+		}
+	}
+
+	seed(record);
+
+	// the chunk below took this one to be open sky, so any of its columns
+	// this chunk blocks go dark.
+	const std::uint32_t below =
+	    m_records[record].neighbours[toIndex(BlockFace::BOTTOM)];
+	if (below != NONE)
+	{
+		const auto darken = [this, record, below](std::size_t index) {
+			const std::size_t bottom = index - WIDTH * (HEIGHT - 1);
+			if (get(SKY, below, index) == MAX_LIGHT &&
+			    get(SKY, record, bottom) != MAX_LIGHT)
+			{
+				set(SKY, below, index, 0);
+				m_removals[SKY].push(
+				    {below, static_cast<std::uint16_t>(index), MAX_LIGHT});
+			}
+		};
+
+		Chunk::forEachOnFace(toIndex(BlockFace::TOP), darken);
+	}
+}
+
+void LightEngine::reset(Chunk* chunk)
+{
+	if (!m_enabled)
+	{
+		return;
+	}
+
+	const std::uint32_t record = find(chunk);
+	if (record == NONE)
+	{
+		add(chunk);
+		return;
+	}
+
+	PHX_PROFILE_SCOPE("LightEngine::reset");
+
+	// everything the chunk lit is taken away, then its light is worked out
+	// again as if it had just loaded.
+	for (std::size_t index = 0; index < Chunk::CHUNK_MAX_BLOCKS; ++index)
+	{
+		for (const Channel channel : {BLOCK, SKY})
+		{
+			const std::uint8_t level = get(channel, record, index);
+			if (level > 0)
+			{
+				set(channel, record, index, 0);
+				m_removals[channel].push(
+				    {record, static_cast<std::uint16_t>(index), level});
+			}
+		}
+	}
+
+	seed(record);
+}
+
+void LightEngine::seed(std::uint32_t record)
+{
+	const Record&       entry  = m_records[record];
+	const auto&         blocks = entry.chunk->getBlocks();
+	const std::uint32_t above  = entry.neighbours[toIndex(BlockFace::TOP)];
+
+	// sky light comes straight down each column until something stops it.
+	for (std::size_t z = 0; z < DEPTH; ++z)
+	{
+		for (std::size_t x = 0; x < WIDTH; ++x)
+		{
+			if (above != NONE &&
+			    get(SKY, above, Chunk::getVectorIndex(x, 0, z)) != MAX_LIGHT)
+			{
+				continue;
+			}
+
+			for (std::size_t y = HEIGHT; y-- > 0;)
+			{
+				const std::size_t index = Chunk::getVectorIndex(x, y, z);
+				if (isOpaque(record, index))
+				{
+					break;
+				}
+
+				set(SKY, record, index, MAX_LIGHT);
+				m_additions[SKY].push(
+				    {record, static_cast<std::uint16_t>(index), MAX_LIGHT});
+			}
+		}
+	}
+
+	for (std::size_t index = 0; index < blocks.size(); ++index)
+	{
+		const std::uint8_t emission = getEmission(blocks[index]);
+		if (emission > 0)
+		{
+			m_additions[BLOCK].push(
+			    {record, static_cast<std::uint16_t>(index), emission});
+		}
+	}
+
+	// and light already in the chunks around spreads in.
+	for (std::size_t face = 0; face < FACE_COUNT; ++face)
+	{
+		const std::uint32_t neighbour = entry.neighbours[face];
+		if (neighbour == NONE)
+		{
+			continue;
+		}
+
+		const std::size_t opposite = Chunk::getOppositeFace(face);
+		Chunk::forEachOnFace(opposite, [this, neighbour](std::size_t index) {
+			for (const Channel channel : {BLOCK, SKY})
+			{
+				if (get(channel, neighbour, index) > 1)
+				{
+					m_additions[channel].push(
+					    {neighbour, static_cast<std::uint16_t>(index), 0});
+				}
+			}
+		});
+	}
+}
+
+void LightEngine::update(Chunk* chunk, std::size_t index,
+                         const BlockType* previous, const BlockType* block)
+{
+	if (!m_enabled || previous == block)
+	{
+		return;
+	}
+
+	const bool wasOpaque = previous->category == BlockCategory::SOLID;
+	const bool isOpaque  = block->category == BlockCategory::SOLID;
+
+	const std::uint8_t emitted  = getEmission(previous);
+	const std::uint8_t emission = getEmission(block);
+
+	// most changes, like dirt to stone, don't change the light at all.
+	if (wasOpaque == isOpaque && emitted == emission)
+	{
+		return;
+	}
+
+	const std::uint32_t record = find(chunk);
+	if (record == NONE)
+	{
+		return;
+	}
+
+	const auto node = static_cast<std::uint16_t>(index);
+
+	const std::uint8_t blockLight = get(BLOCK, record, index);
+	if (blockLight > 0)
+	{
+		set(BLOCK, record, index, 0);
+		m_removals[BLOCK].push({record, node, blockLight});
+	}
+
+	if (emission > 0)
+	{
+		m_additions[BLOCK].push({record, node, emission});
+	}
+
+	if (isOpaque && !wasOpaque)
+	{
+		const std::uint8_t skyLight = get(SKY, record, index);
+		if (skyLight > 0)
+		{
+			set(SKY, record, index, 0);
+			m_removals[SKY].push({record, node, skyLight});
+		}
+	}
+	else if (wasOpaque && !isOpaque)
+	{
+		m_additions[SKY].push({record, node, MAX_LIGHT});
+
+		gather(BLOCK, record, index);
+		gather(SKY, record, index);
+	}
+}
+
+void LightEngine::gather(Channel channel, std::uint32_t record,
+                         std::size_t index)
+{
+	for (std::size_t face = 0; face < FACE_COUNT; ++face)
+	{
+		std::uint32_t next;
+		std::size_t   nextIndex;
+		if (step(record, index, face, next, nextIndex) &&
+		    get(channel, next, nextIndex) > 1)
+		{
+			m_additions[channel].push(
+			    {next, static_cast<std::uint16_t>(nextIndex), 0});
+		}
+	}
+}
+
+void LightEngine::spread(Channel channel, const Node& node)
+{
+	// sources are checked again, since a change queued after them might
+	// have put out or covered them.
+	std::uint8_t level = get(channel, node.record, node.index);
+	if (node.level > 0)
+	{
+		const std::uint8_t source =
+		    getSource(channel, node.record, node.index);
+		if (source > level)
+		{
+			level = source;
+			set(channel, node.record, node.index, level);
+		}
+	}
+
+	if (level <= 1)
+	{
+		return;
+	}
+
+	for (std::size_t face = 0; face < FACE_COUNT; ++face)
+	{
+		std::uint32_t next;
+		std::size_t   nextIndex;
+		if (!step(node.record, node.index, face, next, nextIndex) ||
+		    isOpaque(next, nextIndex))
+		{
+			continue;
+		}
+
+		// full sky light goes straight down without dimming.
+		const std::uint8_t light =
+		    channel == SKY && level == MAX_LIGHT &&
+		            face == toIndex(BlockFace::BOTTOM)
+		        ? MAX_LIGHT
+		        : static_cast<std::uint8_t>(level - 1);
+
+		if (get(channel, next, nextIndex) < light)
+		{
+			set(channel, next, nextIndex, light);
+			m_additions[channel].push(
+			    {next, static_cast<std::uint16_t>(nextIndex), 0});
+		}
+	}
+}
+
+void LightEngine::remove(Channel channel, const Node& node)
+{
+	for (std::size_t face = 0; face < FACE_COUNT; ++face)
+	{
+		std::uint32_t next;
+		std::size_t   nextIndex;
+		if (!step(node.record, node.index, face, next, nextIndex))
+		{
+			continue;
+		}
+
+		const std::uint8_t light = get(channel, next, nextIndex);
+		if (light == 0)
+		{
+			continue;
+		}
+
+		// dimmer light must have come from the removed block, anything as
+		// bright or brighter has its own source and spreads back in.
+		const bool fromRemoved = light < node.level ||
+		                         (channel == SKY && node.level == MAX_LIGHT &&
+		                          face == toIndex(BlockFace::BOTTOM));
+
+		const auto nextNode = static_cast<std::uint16_t>(nextIndex);
+		if (!fromRemoved)
+		{
+			m_additions[channel].push({next, nextNode, 0});
+			continue;
+		}
+
+		set(channel, next, nextIndex, 0);
+		m_removals[channel].push({next, nextNode, light});
+
+		const std::uint8_t emission =
+		    getEmission(m_records[next].chunk->getBlocks()[nextIndex]);
+		if (channel == BLOCK && emission > 0)
+		{
+			m_additions[BLOCK].push({next, nextNode, emission});
+		}
+	}
+}
+
+const std::vector<Chunk*>& LightEngine::propagate()
+{
+	PHX_PROFILE_SCOPE("LightEngine::propagate");
+
+	std::size_t visited = 0;
+	const auto  within  = [this, &visited]() {
+		return m_budget == 0 || visited < m_budget;
+	};
+
+	if (getPending() > 0)
+	{
+		PHX_TRACE_SCOPE(CHUNK, "LightEngine::propagate");
+
+		// light is only spread once everything it might replace has been
+		// taken away, or the removal would eat into it.
+		for (const Channel channel : {BLOCK, SKY})
+		{
+			while (!m_removals[channel].empty() && within())
+			{
+				remove(channel, m_removals[channel].pop());
+				++visited;
+			}
+
+			while (m_removals[channel].empty() &&
+			       !m_additions[channel].empty() && within())
+			{
+				spread(channel, m_additions[channel].pop());
+				++visited;
+			}
+		}
+	}
+
+	// a chunk's mesh looks at the light just across its sides, so the
+	// chunks next to light changing on a border change too.
+	const std::size_t changed = m_changed.size();
+	for (std::size_t i = 0; i < changed; ++i)
+	{
+		Record& entry = m_records[m_changed[i]];
+		for (std::size_t face = 0; face < FACE_COUNT; ++face)
+		{
+			const std::uint32_t neighbour = entry.neighbours[face];
+			if ((entry.borders >> face & 1) != 0 && neighbour != NONE &&
+			    !m_records[neighbour].changed)
+			{
+				m_records[neighbour].changed = true;
+				m_changed.push_back(neighbour);
+			}
+		}
+
+		entry.borders = 0;
+	}
+
+	m_result.clear();
+	for (const std::uint32_t record : m_changed)
+	{
+		m_records[record].changed = false;
+		m_result.push_back(m_records[record].chunk);
+	}
+	m_changed.clear();
+
+	return m_result;
+}
+
+std::size_t LightEngine::getPending() const
+{
+	std::size_t pending = 0;
+	for (const Channel channel : {BLOCK, SKY})
+	{
+		pending += m_additions[channel].size() + m_removals[channel].size();
+	}
+
+	return pending;
+}
@@ -0,0 +1,516 @@
+// Copyright 2019-20 Genten Studios
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+// may be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <Common/Logger.hpp>
+#include <Common/Profiling/Profiler.hpp>
+#include <Common/Profiling/Tracer.hpp>
+#include <Common/Voxels/LiquidEngine.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+
+using namespace phx::voxels;
+
+namespace
+{
+	// the level kept in a chunk is the level in the low bits, with FALLING
+	// set for liquid that came down from the block above.
+	constexpr std::uint8_t LEVEL_MASK = 0x0F;
+	constexpr std::uint8_t FALLING    = 0x10;
+
+	constexpr std::uint8_t FALLING_FLOW =
+	    FALLING | (LiquidEngine::MAX_LEVEL - 1);
+
+	constexpr std::size_t toIndex(BlockFace face)
+	{
+		return static_cast<std::size_t>(face);
+	}
+
+	// the faces liquid spreads out of once it rests on something.
+	const BlockFace SIDES[] = {BlockFace::FRONT, BlockFace::LEFT,
+	                           BlockFace::BACK, BlockFace::RIGHT};
+
+	bool isLiquid(const BlockType* block)
+	{
+		return block->category == BlockCategory::LIQUID;
+	}
+
+	std::uint8_t toLevel(std::uint8_t flow)
+	{
+		return flow == 0 ? LiquidEngine::MAX_LEVEL : flow & LEVEL_MASK;
+	}
+
+	// falling liquid outranks anything spreading sideways.
+	std::uint8_t toRank(std::uint8_t flow)
+	{
+		return static_cast<std::uint8_t>(
+		    toLevel(flow) + ((flow & FALLING) != 0 ? LEVEL_MASK : 0));
+	}
+
+	bool isValidFlow(unsigned long long flow)
+	{
+		const unsigned long long level = flow & LEVEL_MASK;
+		return flow == (level | (flow & FALLING)) && level > 0 &&
+		       level < LiquidEngine::MAX_LEVEL;
+	}
+} // namespace
+
+std::uint8_t LiquidEngine::getLevel(const Chunk& chunk, std::size_t index)
+{
+	if (!isLiquid(chunk.getBlocks()[index]))
+	{
+		return 0;
+	}
+
+	const Chunk::LevelList& levels = chunk.getLevels();
+	return toLevel(levels.empty() ? 0 : levels[index]);
+}
+
+std::string LiquidEngine::write(const Chunk& chunk)
+{
+	const Chunk::LevelList& levels = chunk.getLevels();
+	const Chunk::BlockList& blocks = chunk.getBlocks();
+
+	std::string data;
+	for (std::size_t i = 0; i < levels.size(); ++i)
+	{
+		if (levels[i] != 0 && isLiquid(blocks[i]))
+		{
+			data += std::to_string(i) + ":" +
+			        std::to_string(static_cast<unsigned>(levels[i])) + ";";
+		}
+	}
+
+	return data;
+}
+
+void LiquidEngine::read(Chunk& chunk, const std::string& data)
+{
+	Chunk::LevelList& levels = chunk.getLevels();
+
+	const char* cursor = data.c_str();
+	while (*cursor != '\0')
+	{
+		char*                    end   = nullptr;
+		const unsigned long long index = std::strtoull(cursor, &end, 10);
+		if (end == cursor || *end != ':' ||
+		    index >= static_cast<unsigned long long>(Chunk::CHUNK_MAX_BLOCKS))
+		{
+			break;
+		}
+
+		cursor                        = end + 1;
+		const unsigned long long flow = std::strtoull(cursor, &end, 10);
+		if (end == cursor || *end != ';' || !isValidFlow(flow))
+		{
+			break;
+		}
+
+		cursor = end + 1;
+		if (levels.empty())
+		{
+			levels.assign(Chunk::CHUNK_MAX_BLOCKS, 0);
+		}
+
+		levels[static_cast<std::size_t>(index)] =
+		    static_cast<std::uint8_t>(flow);
+	}
+
+	if (*cursor != '\0')
+	{
+		LOG_WARNING("MAP") << "Skipping invalid liquid levels saved for the "
+		                   << "chunk at " << chunk.getChunkPos() << ".";
+	}
+}
+
+void LiquidEngine::setEnabled(bool enabled) { m_enabled = enabled; }
+
+void LiquidEngine::setBudget(std::size_t blocks) { m_budget = blocks; }
+
+std::uint32_t LiquidEngine::find(const Chunk* chunk) const
+{
+	const auto it = m_lookup.find(Chunk::getKey(chunk->getChunkPos()));
+	return it == m_lookup.end() ? NONE : it->second;
+}
+
+BlockType* LiquidEngine::getBlock(std::uint32_t record,
+                                  std::size_t   index) const
+{
+	return m_records[record].chunk->getBlocks()[index];
+}
+
+std::uint8_t LiquidEngine::getFlow(std::uint32_t record,
+                                   std::size_t   index) const
+{
+	const Chunk::LevelList& levels = m_records[record].chunk->getLevels();
+	return levels.empty() ? 0 : levels[index];
+}
+
+bool LiquidEngine::canFlowInto(std::uint32_t record, std::size_t index,
+                               const BlockType* liquid,
+                               std::uint8_t     flow) const
+{
+	const BlockType* block = getBlock(record, index);
+	if (block->category == BlockCategory::AIR)
+	{
+		return true;
+	}
+
+	if (block != liquid)
+	{
+		return false;
+	}
+
+	// sources are already full.
+	const std::uint8_t current = getFlow(record, index);
+	return current != 0 && toRank(flow) > toRank(current);
+}
+
+bool LiquidEngine::isSupported(std::uint32_t record, std::size_t index,
+                               const BlockType* liquid) const
+{
+	std::uint32_t below;
+	std::size_t   belowIndex;
+	if (!step(record, index, toIndex(BlockFace::BOTTOM), below, belowIndex))
+	{
+		return false;
+	}
+
+	const BlockType* block = getBlock(below, belowIndex);
+	if (block->category == BlockCategory::AIR)
+	{
+		return false;
+	}
+
+	// liquid of the same kind only holds it up once it is full.
+	return block != liquid || getFlow(below, belowIndex) == 0;
+}
+
+bool LiquidEngine::step(std::uint32_t record, std::size_t index,
+                        std::size_t face, std::uint32_t& nextRecord,
+                        std::size_t& nextIndex) const
+{
+	const bool inside = Chunk::stepIndex(index, face, nextIndex);
+
+	nextRecord = inside ? record : m_records[record].neighbours[face];
+	return nextRecord != NONE;
+}
+
+void LiquidEngine::wake(std::uint32_t record, std::size_t index)
+{
+	Record& entry = m_records[record];
+	if (!entry.active.test(index))
+	{
+		entry.active.set(index);
+		m_active.push_back({record, static_cast<std::uint16_t>(index)});
+	}
+}
+
+void LiquidEngine::wakeAround(std::uint32_t record, std::size_t index)
+{
+	if (isLiquid(getBlock(record, index)))
+	{
+		wake(record, index);
+	}
+
+	for (std::size_t face = 0; face < FACE_COUNT; ++face)
+	{
+		std::uint32_t next;
+		std::size_t   nextIndex;
+		if (step(record, index, face, next, nextIndex) &&
+		    isLiquid(getBlock(next, nextIndex)))
+		{
+			wake(next, nextIndex);
+		}
+	}
+}
+
+void LiquidEngine::add(Chunk* chunk)
+{
+	if (!m_enabled)
+	{
+		return;
+	}
+
+	PHX_PROFILE_SCOPE("LiquidEngine::add");
+
+	const math::vec3    position = chunk->getChunkPos();
+	const std::uint64_t key      = Chunk::getKey(position);
+	if (m_lookup.find(key) != m_lookup.end())
+	{
+		return;
+	}
+
+	const auto record = static_cast<std::uint32_t>(m_records.size());
+	m_records.push_back({chunk, {}, {}, {}});
+	m_records[record].neighbours.fill(NONE);
+	m_lookup.emplace(key, record);
+
+	for (std::size_t face = 0; face < FACE_COUNT; ++face)
+	{
+		const auto it = m_lookup.find(
+		    Chunk::getKey(Chunk::getNeighbourPos(position, face)));
+		if (it != m_lookup.end())
+		{
+			const std::size_t opposite = Chunk::getOppositeFace(face);
+
+			m_records[record].neighbours[face]         = it->second;
+			m_records[it->second].neighbours[opposite] = record;
+		}
+	}
+
+	// liquid saved while it was flowing carries on, and sources only need
+	// a look if there's air next to them to flow into.
+	const Chunk::BlockList& blocks = chunk->getBlocks();
+	for (std::size_t index = 0; index < blocks.size(); ++index)
+	{
+		if (!isLiquid(blocks[index]))
+		{
+			continue;
+		}
+
+		if (getFlow(record, index) != 0)
+		{
+			wake(record, index);
+			continue;
+		}
+
+		for (std::size_t face = 0; face < FACE_COUNT; ++face)
+		{
+			std::uint32_t next;
+			std::size_t   nextIndex;
+			if (step(record, index, face, next, nextIndex) &&
+			    getBlock(next, nextIndex)->category == BlockCategory::AIR)
+			{
+				wake(record, index);
+				break;
+			}
+		}
+	}
+
+	// liquid on the sides of the chunks around was waiting for this one.
+	for (std::size_t face = 0; face < FACE_COUNT; ++face)
+	{
+		const std::uint32_t neighbour = m_records[record].neighbours[face];
+		if (neighbour == NONE)
+		{
+			continue;
+		}
+
+		const std::size_t opposite = Chunk::getOppositeFace(face);
+		Chunk::forEachOnFace(opposite, [this, neighbour](std::size_t index) {
+			if (isLiquid(getBlock(neighbour, index)))
+			{
+				wake(neighbour, index);
+			}
+		});
+	}
+}
+
+void LiquidEngine::update(Chunk* chunk, std::size_t index,
+                          const BlockType* previous, const BlockType* block)
+{
+	if (!m_enabled || previous == block)
+	{
+		return;
+	}
+
+	const std::uint32_t record = find(chunk);
+	if (record == NONE)
+	{
+		return;
+	}
+
+	// whatever flowed there is gone, and liquid put there is a source.
+	Chunk::LevelList& levels = chunk->getLevels();
+	if (!levels.empty())
+	{
+		levels[index] = 0;
+	}
+
+	wakeAround(record, index);
+}
+
+void LiquidEngine::place(std::uint32_t record, std::size_t index,
+                         BlockType* block, std::uint8_t flow)
+{
+	Chunk*            chunk   = m_records[record].chunk;
+	BlockType*&       current = chunk->getBlocks()[index];
+	Chunk::LevelList& levels  = chunk->getLevels();
+
+	// a block changed twice in a tick is only handed back once.
+	if (!m_records[record].changed.test(index))
+	{
+		m_records[record].changed.set(index);
+		m_changes.push_back(
+		    {chunk, static_cast<std::uint16_t>(index), current});
+	}
+
+	current = block;
+
+	if (levels.empty() && flow != 0)
+	{
+		levels.assign(Chunk::CHUNK_MAX_BLOCKS, 0);
+	}
+
+	if (!levels.empty())
+	{
+		levels[index] = flow;
+	}
+
+	wakeAround(record, index);
+}
+
+void LiquidEngine::flow(const Node& node, BlockType* air)
+{
+	const std::uint32_t record = node.record;
+	const std::size_t   index  = node.index;
+
+	BlockType* liquid = getBlock(record, index);
+	if (!isLiquid(liquid))
+	{
+		return;
+	}
+
+	std::uint32_t next;
+	std::size_t   nextIndex;
+
+	// flowing liquid takes its level from whatever feeds it, from above or
+	// from the side, and drains away once nothing does. it waits rather
+	// than drains if a chunk that might feed it isn't loaded.
+	const std::uint8_t current = getFlow(record, index);
+	if (current != 0)
+	{
+		if (!step(record, index, toIndex(BlockFace::TOP), next, nextIndex))
+		{
+			return;
+		}
+
+		std::uint8_t fed = 0;
+		if (getBlock(next, nextIndex) == liquid)
+		{
+			fed = FALLING_FLOW;
+		}
+		else
+		{
+			for (const BlockFace side : SIDES)
+			{
+				if (!step(record, index, toIndex(side), next, nextIndex))
+				{
+					return;
+				}
+
+				if (getBlock(next, nextIndex) != liquid)
+				{
+					continue;
+				}
+
+				// liquid over a drop falls rather than feeding its sides.
+				const std::uint8_t flow = getFlow(next, nextIndex);
+				if (flow != 0 && !isSupported(next, nextIndex, liquid))
+				{
+					continue;
+				}
+
+				fed = std::max(fed,
+				               static_cast<std::uint8_t>(toLevel(flow) - 1));
+			}
+		}
+
+		if (fed != current)
+		{
+			place(record, index, fed == 0 ? air : liquid, fed);
+			return;
+		}
+	}
+
+	// liquid falls if it can, and only spreads out once it rests on
+	// something.
+	if (!step(record, index, toIndex(BlockFace::BOTTOM), next, nextIndex))
+	{
+		return;
+	}
+
+	if (canFlowInto(next, nextIndex, liquid, FALLING_FLOW))
+	{
+		place(next, nextIndex, liquid, FALLING_FLOW);
+		return;
+	}
+
+	const std::uint8_t level = toLevel(current);
+	if (level <= 1 || !isSupported(record, index, liquid))
+	{
+		return;
+	}
+
+	const auto spread = static_cast<std::uint8_t>(level - 1);
+	for (const BlockFace side : SIDES)
+	{
+		if (step(record, index, toIndex(side), next, nextIndex) &&
+		    canFlowInto(next, nextIndex, liquid, spread))
+		{
+			place(next, nextIndex, liquid, spread);
+		}
+	}
+}
+
+const std::vector<LiquidEngine::Change>& LiquidEngine::tick(BlockType* air)
+{
+	for (const Change& change : m_changes)
+	{
+		m_records[find(change.chunk)].changed.reset(change.index);
+	}
+	m_changes.clear();
+
+	if (!m_enabled || m_active.empty())
+	{
+		return m_changes;
+	}
+
+	PHX_TRACE_SCOPE(TICK, "LiquidEngine::tick");
+	PHX_PROFILE_SCOPE("LiquidEngine::tick");
+
+	// blocks woken during the tick wait for the next, so liquid moves a
+	// block a tick whatever order the blocks are in.
+	std::size_t count = m_active.size();
+	if (m_budget != 0)
+	{
+		count = std::min(count, m_budget);
+	}
+
+	for (; count > 0; --count)
+	{
+		const Node node = m_active.front();
+		m_active.pop_front();
+
+		m_records[node.record].active.reset(node.index);
+		flow(node, air);
+	}
+
+	return m_changes;
+}
@@ -27,15 +27,101 @@
 // POSSIBILITY OF SUCH DAMAGE.
 
 #include <Common/Logger.hpp>
+#include <Common/Profiling/Metrics.hpp>
+#include <Common/Profiling/Profiler.hpp>
+#include <Common/Profiling/Tracer.hpp>
 #include <Common/Voxels/Map.hpp>
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <tuple>
 #include <utility>
 
 using namespace phx::voxels;
 
+namespace
+{
+	phx::profiling::Gauge& getResidentChunks()
+	{
+		static phx::profiling::Gauge& gauge =
+		    phx::profiling::Metrics::get().gauge(
+		        "phoenix_map_chunks", "Chunks held in memory by every map.");
+		return gauge;
+	}
+
+	bool skipNone(const Chunk*) { return false; }
+
+	// rounds down rather than towards zero, so negative positions land in
+	// the right chunk.
+	int floorDiv(int value, int divisor)
+	{
+		return value >= 0 ? value / divisor
+		                  : -((-value + divisor - 1) / divisor);
+	}
+
+	int toBlock(float value) { return static_cast<int>(std::floor(value)); }
+} // namespace
+
+template <typename F>
+void Map::propagateLight(const F& skip)
+{
+	if (!m_light.isEnabled())
+	{
+		return;
+	}
+
+	for (Chunk* chunk : m_light.propagate())
+	{
+		if (!skip(chunk))
+		{
+			dispatchToSubscriber({MapEvent::CHUNK_UPDATE, chunk});
+		}
+	}
+}
+
+template <typename F>
+void Map::dispatchAround(const phx::math::vec3& chunkPos,
+                         const phx::math::vec3& from, const phx::math::vec3& to,
+                         const F& skip)
+{
+	// a side is only reached if the box touches it.
+	const auto reach = [](float low, float high, int size) {
+		return std::make_pair(low == 0.f ? -1 : 0,
+		                      high == static_cast<float>(size - 1) ? 1 : 0);
+	};
+
+	const auto x = reach(from.x, to.x, Chunk::CHUNK_WIDTH);
+	const auto y = reach(from.y, to.y, Chunk::CHUNK_HEIGHT);
+	const auto z = reach(from.z, to.z, Chunk::CHUNK_DEPTH);
+
+	for (int dz = z.first; dz <= z.second; ++dz)
+	{
+		for (int dy = y.first; dy <= y.second; ++dy)
+		{
+			for (int dx = x.first; dx <= x.second; ++dx)
+			{
+				if (dx == 0 && dy == 0 && dz == 0)
+				{
+					continue;
+				}
+
+				Chunk* chunk = findChunk(
+				    {chunkPos.x + static_cast<float>(dx * Chunk::CHUNK_WIDTH),
+				     chunkPos.y + static_cast<float>(dy * Chunk::CHUNK_HEIGHT),
+				     chunkPos.z + static_cast<float>(dz * Chunk::CHUNK_DEPTH)});
+				if (chunk != nullptr && !skip(chunk))
+				{
+					dispatchToSubscriber({MapEvent::CHUNK_UPDATE, chunk});
+				}
+			}
+		}
+	}
+}
+
 Map::Map(phx::Save* save, const std::string& name, BlockReferrer* referrer)
-    : m_referrer(referrer), m_mapName(name)
+    : m_referrer(referrer), m_mapName(name),
+      m_generator(std::make_unique<FlatGenerator>(referrer))
 {
 	m_save = save;
 }
@@ -47,13 +133,23 @@ Map::Map(
 {
 }
 
+Map::~Map()
+{
+	saveChanged();
+	getResidentChunks().add(-static_cast<double>(m_chunks.size()));
+}
+
 Chunk* Map::getChunk(const phx::math::vec3& pos)
 {
+	PHX_PROFILE_SCOPE("Map::getChunk");
+
 	if (m_chunks.find(pos) != m_chunks.end())
 	{
 		return &m_chunks.at(pos);
 	}
 
+	PHX_TRACE_SCOPE(CHUNK, "Map::loadChunk");
+
 	if (m_queue != nullptr)
 	{
 		if (m_queue->empty())
@@ -75,12 +171,14 @@ Chunk* Map::getChunk(const phx::math::vec3& pos)
 			// we have data.
 			Chunk chunk(data.first, m_referrer);
 			phx::Serializer ser;
-			ser.setBuffer(data.second);
-			ser << chunk;
+			ser.setBuffer(std::move(data.second));
+			ser >> chunk;
 			
-			m_chunks.emplace(chunk.getChunkPos(), chunk);
+			addChunk(chunk.getChunkPos(), std::move(chunk));
 		}
 
+		propagateLight(skipNone);
+
 		if (m_chunks.find(pos) != m_chunks.end())
 		{
 			return &m_chunks.at(pos);
@@ -90,137 +188,186 @@ Chunk* Map::getChunk(const phx::math::vec3& pos)
 	}
 
 	// Chunk isn't in memory and we aren't networked, so lets create one
-	std::ifstream saveFile;
-	std::string position = "." + std::to_string(static_cast<int>(pos.x)) + "_" +
-	                       std::to_string(static_cast<int>(pos.y)) + "_" +
-	                       std::to_string(static_cast<int>(pos.z));
-	saveFile.open("Saves/" + m_save->getName() + "/" + m_mapName + position + ".save");
-
-	if (saveFile)
+	if (!loadChunk(pos))
 	{
-		std::string saveString;
-		std::getline(saveFile, saveString);
-
+		// save doesn't exist, generate it.
 		Chunk chunk(pos, m_referrer);
-		Chunk::BlockList& blocks = chunk.getBlocks();
+		m_generator->generate(chunk);
 
-    std::string_view search = saveString;
-		std::size_t      strPos = 0;
-		std::size_t      i      = 0;
-		while ((strPos = search.find_first_of(';')) != std::string_view::npos)
-		{
-			std::string result;
-			result = search.substr(0, strPos);
-			blocks.push_back(m_referrer->blocks.get(*m_referrer->referrer.get(result)));
-			search.remove_prefix(strPos + 1);
-		}
+		addChunk(pos, std::move(chunk));
+		save(pos);
+	}
 
-		// something went wrong if the amount of blocks is different.
-		if (blocks.size() != Chunk::CHUNK_MAX_BLOCKS)
-		{
-			LOG_WARNING("MAP") << "Existing save for chunk at: " << pos
-			                   << " is invalid, regenerating";
+	propagateLight(skipNone);
 
-			blocks.clear();
-			blocks.reserve(4096);
-			
-			BlockType* block = nullptr;
-			if (chunk.getChunkPos().y >= 0)
-			{
-				block = m_referrer->blocks.get(
-				    *m_referrer->referrer.get("core.air"));
-			}
-			else
-			{
-				block = m_referrer->blocks.get(
-				    *m_referrer->referrer.get("core.grass"));
-			}
+	return &m_chunks.at(pos);
+}
 
-			for (int i = 0; i < Chunk::CHUNK_MAX_BLOCKS; ++i)
-			{
-				blocks.push_back(block);
-			}
-		}
+Chunk* Map::findChunk(const phx::math::vec3& pos)
+{
+	const auto it = m_chunks.find(pos);
+	return it == m_chunks.end() ? nullptr : &it->second;
+}
 
-		m_chunks.emplace(pos, std::move(chunk));
-	}
-	else
+void Map::loadChunks(const std::vector<phx::math::vec3>& positions)
+{
+	if (m_queue != nullptr)
 	{
-		// save doesn't exist, generate it.
-		Chunk chunk(pos, m_referrer);
+		return;
+	}
 
-		BlockType* block = nullptr;
-		if (chunk.getChunkPos().y >= 0)
+	PHX_PROFILE_SCOPE("Map::loadChunks");
+
+	std::vector<Chunk> missing;
+	for (const auto& pos : positions)
+	{
+		if (m_chunks.find(pos) == m_chunks.end() && !loadChunk(pos))
 		{
-			block =
-			    m_referrer->blocks.get(*m_referrer->referrer.get("core.air"));
+			missing.emplace_back(pos, m_referrer);
 		}
-		else
+	}
+
+	if (missing.empty())
+	{
+		return;
+	}
+
+	PHX_TRACE_SCOPE(CHUNK, "Map::generateChunks");
+
+	// chunks are generated a column at a time, bottom to top, so generators
+	// can reuse what they work out for each column.
+	std::sort(missing.begin(), missing.end(),
+	          [](const Chunk& lhs, const Chunk& rhs) {
+		          const math::vec3 a = lhs.getChunkPos();
+		          const math::vec3 b = rhs.getChunkPos();
+		          return std::tie(a.x, a.z, a.y) < std::tie(b.x, b.z, b.y);
+	          });
+
+	std::vector<std::size_t> columns;
+	for (std::size_t i = 0; i < missing.size(); ++i)
+	{
+		if (i == 0 ||
+		    missing[i].getChunkPos().x != missing[i - 1].getChunkPos().x ||
+		    missing[i].getChunkPos().z != missing[i - 1].getChunkPos().z)
 		{
-			block =
-			    m_referrer->blocks.get(*m_referrer->referrer.get("core.grass"));
+			columns.push_back(i);
 		}
+	}
+	columns.push_back(missing.size());
 
-		auto& blocks = chunk.getBlocks();
-		for (int i = 0; i < Chunk::CHUNK_MAX_BLOCKS; ++i)
+	const auto generateColumn = [this, &missing, &columns](std::size_t column) {
+		for (std::size_t i = columns[column]; i < columns[column + 1]; ++i)
 		{
-			blocks.push_back(block);
+			m_generator->generate(missing[i]);
 		}
+	};
 
-		auto& blockRef = chunk.getBlocks();
-		for (std::size_t i = 0;
-		     i < Chunk::CHUNK_WIDTH * Chunk::CHUNK_HEIGHT * Chunk::CHUNK_DEPTH;
-		     ++i)
+	if (m_pool != nullptr)
+	{
+		m_pool->parallelFor(columns.size() - 1, generateColumn);
+	}
+	else
+	{
+		for (std::size_t column = 0; column + 1 < columns.size(); ++column)
 		{
-			blockRef.push_back(block);
+			generateColumn(column);
 		}
-		
-		m_chunks.emplace(pos, std::move(chunk));
+	}
+
+	for (auto& chunk : missing)
+	{
+		const math::vec3 pos = chunk.getChunkPos();
+		addChunk(pos, std::move(chunk));
 		save(pos);
 	}
-	
-	return &m_chunks.at(pos);
+
+	propagateLight(skipNone);
 }
 
-std::pair<phx::math::vec3, phx::math::vec3> Map::getBlockPos(
-    phx::math::vec3 position)
+void Map::setGenerator(std::unique_ptr<WorldGenerator> generator)
 {
-	// This mess converts position types between world and inner chunk
-	// positioning
-	int posX = static_cast<int>(position.x / Chunk::CHUNK_WIDTH);
-	int posY = static_cast<int>(position.y / Chunk::CHUNK_HEIGHT);
-	int posZ = static_cast<int>(position.z / Chunk::CHUNK_DEPTH);
+	m_generator = std::move(generator);
+}
+
+void Map::setThreadPool(ThreadPool* pool) { m_pool = pool; }
+
+bool Map::loadChunk(const phx::math::vec3& pos)
+{
+	std::ifstream saveFile;
+	std::string position = "." + std::to_string(static_cast<int>(pos.x)) + "_" +
+	                       std::to_string(static_cast<int>(pos.y)) + "_" +
+	                       std::to_string(static_cast<int>(pos.z));
+	saveFile.open("Saves/" + m_save->getName() + "/" + m_mapName + position + ".save");
 
-	position.x = static_cast<float>(static_cast<int>(position.x) %
-	                                Chunk::CHUNK_WIDTH);
-	if (position.x < 0)
+	if (!saveFile)
 	{
-		posX -= 1;
-		position.x += Chunk::CHUNK_WIDTH;
+		return false;
 	}
 
-	position.y = static_cast<float>(static_cast<int>(position.y) %
-	                                Chunk::CHUNK_HEIGHT);
-	if (position.y < 0)
+	std::string saveString;
+	std::getline(saveFile, saveString);
+
+	Chunk chunk(pos, m_referrer);
+	Chunk::BlockList& blocks = chunk.getBlocks();
+
+	std::string_view search = saveString;
+	std::size_t      strPos = 0;
+	while ((strPos = search.find_first_of(';')) != std::string_view::npos)
 	{
-		posY -= 1;
-		position.y += Chunk::CHUNK_HEIGHT;
+		std::string result;
+		result = search.substr(0, strPos);
+		blocks.push_back(m_referrer->blocks.get(*m_referrer->referrer.get(result)));
+		search.remove_prefix(strPos + 1);
 	}
 
-	position.z = static_cast<float>(static_cast<int>(position.z) %
-	                                Chunk::CHUNK_DEPTH);
-	if (position.z < 0)
+	// something went wrong if the amount of blocks is different.
+	if (blocks.size() != Chunk::CHUNK_MAX_BLOCKS)
+	{
+		LOG_WARNING("MAP") << "Existing save for chunk at: " << pos
+		                   << " is invalid, regenerating";
+
+		blocks.clear();
+		m_generator->generate(chunk);
+	}
+	else
 	{
-		posZ -= 1;
-		position.z += Chunk::CHUNK_DEPTH;
+		// the levels go in before the chunk is added, which starts them
+		// flowing again.
+		std::string ticks;
+		std::string levels;
+		if (std::getline(saveFile, ticks))
+		{
+			m_ticker.read(pos, ticks);
+		}
+
+		if (std::getline(saveFile, levels))
+		{
+			LiquidEngine::read(chunk, levels);
+		}
 	}
 
-	const math::vec3 chunkPosition =
-	    math::vec3(static_cast<float>(posX * Chunk::CHUNK_WIDTH),
-	               static_cast<float>(posY * Chunk::CHUNK_HEIGHT),
-	               static_cast<float>(posZ * Chunk::CHUNK_DEPTH));
+	addChunk(pos, std::move(chunk));
+
+	return true;
+}
 
-	return {chunkPosition, position};
+std::pair<phx::math::vec3, phx::math::vec3> Map::getBlockPos(
+    phx::math::vec3 position)
+{
+	// positions round down, the same as edits do, so a block is found by any
+	// position inside it on either side of zero.
+	const int x = toBlock(position.x);
+	const int y = toBlock(position.y);
+	const int z = toBlock(position.z);
+
+	const int chunkX = floorDiv(x, Chunk::CHUNK_WIDTH) * Chunk::CHUNK_WIDTH;
+	const int chunkY = floorDiv(y, Chunk::CHUNK_HEIGHT) * Chunk::CHUNK_HEIGHT;
+	const int chunkZ = floorDiv(z, Chunk::CHUNK_DEPTH) * Chunk::CHUNK_DEPTH;
+
+	return {{static_cast<float>(chunkX), static_cast<float>(chunkY),
+	         static_cast<float>(chunkZ)},
+	        {static_cast<float>(x - chunkX), static_cast<float>(y - chunkY),
+	         static_cast<float>(z - chunkZ)}};
 }
 
 BlockType* Map::getBlockAt(phx::math::vec3 position)
@@ -240,7 +387,12 @@ void Map::setBlockAt(phx::math::vec3 position, BlockType* block)
 	const auto& pos   = getBlockPos(position);
 	Chunk*      chunk = getChunk(pos.first);
 
+	BlockType*        previous = chunk->getBlockAt(pos.second);
+	const std::size_t index    = Chunk::getVectorIndex(pos.second);
 	chunk->setBlockAt(pos.second, block);
+	m_ticker.track(chunk, block);
+	m_light.update(chunk, index, previous, block);
+	m_liquids.update(chunk, index, previous, block);
 
 	if (m_queue == nullptr)
 	{
@@ -248,6 +400,8 @@ void Map::setBlockAt(phx::math::vec3 position, BlockType* block)
 	}
 
 	dispatchToSubscriber({MapEvent::CHUNK_UPDATE, chunk});
+	dispatchAround(pos.first, pos.second, pos.second, skipNone);
+	propagateLight([chunk](const Chunk* lit) { return lit == chunk; });
 }
 
 void Map::save(const phx::math::vec3& pos)
@@ -258,6 +412,8 @@ void Map::save(const phx::math::vec3& pos)
 		return;
 	}
 
+	m_unsaved.erase(pos);
+
 	std::ofstream saveFile;
 	std::string   position = "." + std::to_string(static_cast<int>(pos.x)) + "_" +
 	                       std::to_string(static_cast<int>(pos.y)) + "_" +
@@ -273,9 +429,431 @@ void Map::save(const phx::math::vec3& pos)
 
 	saveFile << saveString;
 
+	// pending block updates go on a second line and the levels of flowing
+	// liquid on a third, which older saves just don't have.
+	const std::string ticks  = m_ticker.write(pos);
+	const std::string levels = LiquidEngine::write(m_chunks.at(pos));
+	if (!ticks.empty() || !levels.empty())
+	{
+		saveFile << '\n' << ticks;
+	}
+
+	if (!levels.empty())
+	{
+		saveFile << '\n' << levels;
+	}
+
 	saveFile.close();
 }
 
+void Map::markUnsaved(const phx::math::vec3& chunkPos)
+{
+	if (m_queue == nullptr)
+	{
+		m_unsaved.insert(chunkPos);
+	}
+}
+
+void Map::saveChanged()
+{
+	if (m_unsaved.empty())
+	{
+		return;
+	}
+
+	PHX_PROFILE_SCOPE("Map::saveChanged");
+
+	// save takes chunks out of the set as it goes.
+	std::vector<math::vec3> unsaved(m_unsaved.begin(), m_unsaved.end());
+	for (const math::vec3& pos : unsaved)
+	{
+		if (m_chunks.find(pos) != m_chunks.end())
+		{
+			save(pos);
+		}
+	}
+
+	m_unsaved.clear();
+}
+
+Map::Edit Map::beginEdit() { return Edit(this); }
+
+void Map::scheduleTick(const phx::math::vec3& position, std::uint64_t delay)
+{
+	const auto pos = getBlockPos(position);
+	m_ticker.schedule(pos.first, Chunk::getVectorIndex(pos.second), delay);
+
+	// the update is only kept across restarts once the chunk is saved.
+	markUnsaved(pos.first);
+}
+
+void Map::tick()
+{
+	m_ticker.tick(*this);
+	flowLiquids();
+	updateLight();
+
+	if (m_ticker.getTick() % SAVE_INTERVAL == 0)
+	{
+		saveChanged();
+	}
+}
+
+BlockTicker& Map::getTicker() { return m_ticker; }
+
+void Map::enableLighting()
+{
+	if (m_light.isEnabled())
+	{
+		return;
+	}
+
+	m_light.setEnabled(true);
+	for (auto& chunk : m_chunks)
+	{
+		m_light.add(&chunk.second);
+	}
+
+	updateLight();
+}
+
+void Map::updateLight() { propagateLight(skipNone); }
+
+LightEngine& Map::getLightEngine() { return m_light; }
+
+void Map::enableLiquids()
+{
+	if (m_liquids.isEnabled())
+	{
+		return;
+	}
+
+	m_liquids.setEnabled(true);
+	for (auto& chunk : m_chunks)
+	{
+		m_liquids.add(&chunk.second);
+	}
+}
+
+LiquidEngine& Map::getLiquidEngine() { return m_liquids; }
+
+void Map::flowLiquids()
+{
+	const auto& changes =
+	    m_liquids.tick(m_referrer->blocks.get(BlockType::AIR_BLOCK));
+	if (changes.empty())
+	{
+		return;
+	}
+
+	PHX_PROFILE_SCOPE("Map::flowLiquids");
+
+	// everything the liquid changed this tick goes out together, each
+	// chunk dispatched once with the box of it that changed. liquid can
+	// change a chunk every tick, so it's saved with the other unsaved
+	// chunks rather than each time.
+	std::unordered_map<math::vec3, std::pair<math::vec3, math::vec3>,
+	                   math::Vector3Hasher, math::Vector3KeyComparator>
+	    changed;
+	for (const LiquidEngine::Change& change : changes)
+	{
+		BlockType* block = change.chunk->getBlocks()[change.index];
+		m_ticker.track(change.chunk, block);
+		m_light.update(change.chunk, change.index, change.previous, block);
+
+		const math::vec3 local = {
+		    static_cast<float>(change.index % Chunk::CHUNK_WIDTH),
+		    static_cast<float>(change.index / Chunk::CHUNK_WIDTH %
+		                       Chunk::CHUNK_HEIGHT),
+		    static_cast<float>(change.index /
+		                       (Chunk::CHUNK_WIDTH * Chunk::CHUNK_HEIGHT))};
+
+		auto result = changed.emplace(change.chunk->getChunkPos(),
+		                              std::make_pair(local, local));
+		if (!result.second)
+		{
+			math::vec3& from = result.first->second.first;
+			math::vec3& to   = result.first->second.second;
+
+			from = {std::min(from.x, local.x), std::min(from.y, local.y),
+			        std::min(from.z, local.z)};
+			to   = {std::max(to.x, local.x), std::max(to.y, local.y),
+			        std::max(to.z, local.z)};
+		}
+	}
+
+	const auto isChanged = [&changed](const Chunk* chunk) {
+		return changed.find(chunk->getChunkPos()) != changed.end();
+	};
+
+	for (const auto& box : changed)
+	{
+		markUnsaved(box.first);
+
+		dispatchToSubscriber(
+		    {MapEvent::CHUNK_UPDATE, &m_chunks.at(box.first)});
+		dispatchAround(box.first, box.second.first, box.second.second,
+		               isChanged);
+	}
+
+	propagateLight(isChanged);
+}
+
+Map::Edit::Edit(Map* map) : m_map(map) {}
+
+Map::Edit::Edit(Edit&& other) noexcept
+    : m_map(other.m_map), m_lastPos(other.m_lastPos),
+      m_lastChunk(other.m_lastChunk), m_dirty(std::move(other.m_dirty))
+{
+	other.m_map = nullptr;
+	other.m_dirty.clear();
+}
+
+Map::Edit::~Edit()
+{
+	if (m_map != nullptr)
+	{
+		commit();
+	}
+}
+
+bool Map::Edit::set(const phx::math::vec3& position, BlockType* block)
+{
+	const int x = toBlock(position.x);
+	const int y = toBlock(position.y);
+	const int z = toBlock(position.z);
+
+	const int chunkX = floorDiv(x, Chunk::CHUNK_WIDTH);
+	const int chunkY = floorDiv(y, Chunk::CHUNK_HEIGHT);
+	const int chunkZ = floorDiv(z, Chunk::CHUNK_DEPTH);
+
+	const math::vec3 chunkPos = {
+	    static_cast<float>(chunkX * Chunk::CHUNK_WIDTH),
+	    static_cast<float>(chunkY * Chunk::CHUNK_HEIGHT),
+	    static_cast<float>(chunkZ * Chunk::CHUNK_DEPTH)};
+
+	Chunk* chunk = getChunk(chunkPos);
+	if (chunk == nullptr)
+	{
+		return false;
+	}
+
+	const math::vec3 local = {
+	    static_cast<float>(x - chunkX * Chunk::CHUNK_WIDTH),
+	    static_cast<float>(y - chunkY * Chunk::CHUNK_HEIGHT),
+	    static_cast<float>(z - chunkZ * Chunk::CHUNK_DEPTH)};
+
+	const std::size_t index = Chunk::getVectorIndex(local);
+
+	BlockType*& current = chunk->getBlocks()[index];
+	if (current == block)
+	{
+		return false;
+	}
+
+	BlockType* previous = current;
+	current             = block;
+	m_map->m_liquids.update(chunk, index, previous, block);
+	markDirty(chunkPos, chunk, local, local);
+	return true;
+}
+
+std::size_t Map::Edit::fill(const phx::math::vec3& from,
+                            const phx::math::vec3& to, BlockType* block)
+{
+	PHX_PROFILE_SCOPE("Map::Edit::fill");
+
+	return forEachInBox(from, to, [block](BlockType*& current) {
+		if (current == block)
+		{
+			return false;
+		}
+
+		current = block;
+		return true;
+	});
+}
+
+std::size_t Map::Edit::replace(const phx::math::vec3& from,
+                               const phx::math::vec3& to, BlockType* target,
+                               BlockType* block)
+{
+	PHX_PROFILE_SCOPE("Map::Edit::replace");
+
+	if (target == block)
+	{
+		return 0;
+	}
+
+	return forEachInBox(from, to, [target, block](BlockType*& current) {
+		if (current != target)
+		{
+			return false;
+		}
+
+		current = block;
+		return true;
+	});
+}
+
+void Map::Edit::commit()
+{
+	PHX_PROFILE_SCOPE("Map::Edit::commit");
+
+	for (const auto& dirty : m_dirty)
+	{
+		m_map->m_ticker.track(dirty.second.chunk);
+		m_map->m_light.reset(dirty.second.chunk);
+
+		if (m_map->m_queue == nullptr)
+		{
+			m_map->save(dirty.first);
+		}
+
+		m_map->dispatchToSubscriber(
+		    {MapEvent::CHUNK_UPDATE, dirty.second.chunk});
+	}
+
+	// chunks changed by the edit have had their event already.
+	const auto isDirty = [this](const Chunk* chunk) {
+		return m_dirty.find(chunk->getChunkPos()) != m_dirty.end();
+	};
+
+	for (const auto& dirty : m_dirty)
+	{
+		m_map->dispatchAround(dirty.first, dirty.second.from, dirty.second.to,
+		                      isDirty);
+	}
+
+	m_map->propagateLight(isDirty);
+
+	m_dirty.clear();
+}
+
+Chunk* Map::Edit::getChunk(const phx::math::vec3& chunkPos)
+{
+	// edits usually touch the same chunk many times in a row.
+	if (m_lastChunk != nullptr && m_lastPos == chunkPos)
+	{
+		return m_lastChunk;
+	}
+
+	Chunk* chunk = m_map->getChunk(chunkPos);
+	if (chunk != nullptr)
+	{
+		m_lastPos   = chunkPos;
+		m_lastChunk = chunk;
+	}
+
+	return chunk;
+}
+
+template <typename F>
+std::size_t Map::Edit::forEachInBox(const phx::math::vec3& from,
+                                    const phx::math::vec3& to, const F& func)
+{
+	const int minX = toBlock(std::min(from.x, to.x));
+	const int minY = toBlock(std::min(from.y, to.y));
+	const int minZ = toBlock(std::min(from.z, to.z));
+	const int maxX = toBlock(std::max(from.x, to.x));
+	const int maxY = toBlock(std::max(from.y, to.y));
+	const int maxZ = toBlock(std::max(from.z, to.z));
+
+	std::size_t changed = 0;
+
+	for (int chunkZ = floorDiv(minZ, Chunk::CHUNK_DEPTH);
+	     chunkZ <= floorDiv(maxZ, Chunk::CHUNK_DEPTH); ++chunkZ)
+	{
+		for (int chunkY = floorDiv(minY, Chunk::CHUNK_HEIGHT);
+		     chunkY <= floorDiv(maxY, Chunk::CHUNK_HEIGHT); ++chunkY)
+		{
+			for (int chunkX = floorDiv(minX, Chunk::CHUNK_WIDTH);
+			     chunkX <= floorDiv(maxX, Chunk::CHUNK_WIDTH); ++chunkX)
+			{
+				const int originX = chunkX * Chunk::CHUNK_WIDTH;
+				const int originY = chunkY * Chunk::CHUNK_HEIGHT;
+				const int originZ = chunkZ * Chunk::CHUNK_DEPTH;
+
+				const math::vec3 chunkPos = {static_cast<float>(originX),
+				                             static_cast<float>(originY),
+				                             static_cast<float>(originZ)};
+
+				Chunk* chunk = getChunk(chunkPos);
+				if (chunk == nullptr)
+				{
+					continue;
+				}
+
+				// the part of the box inside this chunk.
+				const int startX = std::max(minX - originX, 0);
+				const int startY = std::max(minY - originY, 0);
+				const int startZ = std::max(minZ - originZ, 0);
+				const int endX =
+				    std::min(maxX - originX, Chunk::CHUNK_WIDTH - 1);
+				const int endY =
+				    std::min(maxY - originY, Chunk::CHUNK_HEIGHT - 1);
+				const int endZ =
+				    std::min(maxZ - originZ, Chunk::CHUNK_DEPTH - 1);
+
+				auto&       blocks       = chunk->getBlocks();
+				std::size_t chunkChanged = 0;
+				for (int z = startZ; z <= endZ; ++z)
+				{
+					for (int y = startY; y <= endY; ++y)
+					{
+						std::size_t index = Chunk::getVectorIndex(
+						    static_cast<std::size_t>(startX),
+						    static_cast<std::size_t>(y),
+						    static_cast<std::size_t>(z));
+
+						for (int x = startX; x <= endX; ++x, ++index)
+						{
+							BlockType* previous = blocks[index];
+							if (func(blocks[index]))
+							{
+								m_map->m_liquids.update(chunk, index, previous,
+								                        blocks[index]);
+								++chunkChanged;
+							}
+						}
+					}
+				}
+
+				if (chunkChanged > 0)
+				{
+					markDirty(chunkPos, chunk,
+					          {static_cast<float>(startX),
+					           static_cast<float>(startY),
+					           static_cast<float>(startZ)},
+					          {static_cast<float>(endX),
+					           static_cast<float>(endY),
+					           static_cast<float>(endZ)});
+					changed += chunkChanged;
+				}
+			}
+		}
+	}
+
+	return changed;
+}
+
+void Map::Edit::markDirty(const phx::math::vec3& chunkPos, Chunk* chunk,
+                          const phx::math::vec3& from,
+                          const phx::math::vec3& to)
+{
+	auto result = m_dirty.emplace(chunkPos, Dirty {chunk, from, to});
+	if (!result.second)
+	{
+		// grow the box to take in both.
+		Dirty& dirty = result.first->second;
+		dirty.from = {std::min(dirty.from.x, from.x),
+		              std::min(dirty.from.y, from.y),
+		              std::min(dirty.from.z, from.z)};
+		dirty.to   = {std::max(dirty.to.x, to.x), std::max(dirty.to.y, to.y),
+		              std::max(dirty.to.z, to.z)};
+	}
+}
+
 void Map::registerEventSubscriber(MapEventSubscriber* subscriber)
 {
 	auto it = std::find(m_subscribers.begin(), m_subscribers.end(), subscriber);
@@ -292,3 +870,23 @@ void Map::dispatchToSubscriber(const MapEvent& mapEvent) const
 		sub->onMapEvent(mapEvent);
 	}
 }
+
+void Map::addChunk(const phx::math::vec3& pos, Chunk&& chunk)
+{
+	auto result = m_chunks.emplace(pos, std::move(chunk));
+	if (result.second)
+	{
+		getResidentChunks().add(1.0);
+		m_ticker.track(&result.first->second);
+		m_light.add(&result.first->second);
+		m_liquids.add(&result.first->second);
+
+		// chunks already around this one were meshed against nothing at
+		// their borders, faces, edges and corners all look across.
+		dispatchAround(pos, {0.f, 0.f, 0.f},
+		               {static_cast<float>(Chunk::CHUNK_WIDTH - 1),
+		                static_cast<float>(Chunk::CHUNK_HEIGHT - 1),
+		                static_cast<float>(Chunk::CHUNK_DEPTH - 1)},
+		               skipNone);
+	}
+}
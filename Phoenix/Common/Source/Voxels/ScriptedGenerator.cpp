@@ -0,0 +1,317 @@
+// Copyright 2019-20 Genten Studios
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+// may be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <Common/Logger.hpp>
+#include <Common/Profiling/Profiler.hpp>
+#include <Common/Voxels/ScriptedGenerator.hpp>
+
+#include <unordered_map>
+
+using namespace phx::voxels;
+
+namespace
+{
+	void panicHandler(sol::optional<std::string> message)
+	{
+		LOG_FATAL("WORLDGEN")
+		    << "An unexpected Lua error occured while generating: "
+		    << (message ? *message : std::string("unknown error"));
+	}
+
+	// a seed unique to each chunk, so passes can seed math.random and
+	// place things the same way no matter which thread runs them.
+	std::int64_t chunkSeed(std::uint32_t seed, const phx::math::vec3& pos)
+	{
+		std::uint32_t hash = seed;
+		hash ^= static_cast<std::uint32_t>(static_cast<int>(pos.x)) * 73856093u;
+		hash ^= static_cast<std::uint32_t>(static_cast<int>(pos.y)) * 19349663u;
+		hash ^= static_cast<std::uint32_t>(static_cast<int>(pos.z)) * 83492791u;
+		return static_cast<std::int64_t>(hash);
+	}
+} // namespace
+
+ScriptedGenerator::ScriptedGenerator(BlockReferrer* referrer,
+                                     std::uint32_t seed,
+                                     std::unique_ptr<WorldGenerator> base)
+    : m_referrer(referrer), m_base(std::move(base)), m_noise(seed)
+{
+}
+
+// the workers' Lua states are only destroyed here, once nothing is
+// generating.
+ScriptedGenerator::~ScriptedGenerator() = default;
+
+void ScriptedGenerator::registerAPI(cms::ModManager* manager)
+{
+	manager->registerFunction(
+	    "voxel.worldgen.register", [manager, this](sol::table luaPass) {
+		    Pass pass;
+
+		    const std::string stage = luaPass.get_or<std::string>("stage", "");
+		    if (stage == "terrain")
+		    {
+			    pass.stage = Stage::TERRAIN;
+		    }
+		    else if (stage == "ores")
+		    {
+			    pass.stage = Stage::ORES;
+		    }
+		    else if (stage == "decoration")
+		    {
+			    pass.stage = Stage::DECORATION;
+		    }
+		    else
+		    {
+			    LOG_WARNING("WORLDGEN")
+			        << "Ignoring a generation pass from "
+			        << manager->getCurrentModPath() << " with the stage \""
+			        << stage
+			        << "\", it must be terrain, ores or decoration.";
+			    return;
+		    }
+
+		    const std::string script =
+		        luaPass.get_or<std::string>("script", "");
+		    if (script.empty())
+		    {
+			    LOG_WARNING("WORLDGEN")
+			        << "Ignoring a generation pass from "
+			        << manager->getCurrentModPath() << " without a script.";
+			    return;
+		    }
+
+		    pass.script   = manager->getCurrentModPath() + script;
+		    pass.function = luaPass.get_or<std::string>("func", "generate");
+
+		    addPass(std::move(pass));
+	    });
+}
+
+void ScriptedGenerator::addPass(Pass pass)
+{
+	// keep passes sorted by stage, after everything else in the same stage.
+	auto it = m_passes.begin();
+	while (it != m_passes.end() && it->stage <= pass.stage)
+	{
+		++it;
+	}
+
+	m_passes.insert(it, std::move(pass));
+}
+
+void ScriptedGenerator::generate(Chunk& chunk)
+{
+	m_base->generate(chunk);
+
+	if (m_passes.empty())
+	{
+		return;
+	}
+
+	PHX_PROFILE_SCOPE("ScriptedGenerator::generate");
+
+	Worker&    worker = getWorker();
+	lua_State* state  = worker.lua.lua_state();
+	auto&      blocks = chunk.getBlocks();
+
+	// the ids are copied into the same table for every chunk, so passes can
+	// loop over a plain Lua array and nothing is allocated per chunk.
+	worker.blocks.push();
+	for (std::size_t i = 0; i < blocks.size(); ++i)
+	{
+		lua_pushinteger(state,
+		                static_cast<lua_Integer>(blocks[i]->uniqueIdentifier));
+		lua_rawseti(state, -2, static_cast<lua_Integer>(i + 1));
+	}
+	lua_pop(state, 1);
+
+	const math::vec3 position = chunk.getChunkPos();
+	worker.chunk["x"]         = position.x;
+	worker.chunk["y"]         = position.y;
+	worker.chunk["z"]         = position.z;
+	worker.chunk["seed"]      = chunkSeed(m_noise.getSeed(), position);
+	worker.chunk["blocks"]    = worker.blocks;
+
+	for (std::size_t i = 0; i < m_passes.size(); ++i)
+	{
+		if (worker.failed[i])
+		{
+			continue;
+		}
+
+		PHX_PROFILE_SCOPE("ScriptedGenerator::pass");
+
+		sol::protected_function_result result =
+		    worker.passes[i](worker.chunk);
+		if (!result.valid())
+		{
+			sol::error err = result;
+			LOG_WARNING("WORLDGEN")
+			    << "The generation pass " << m_passes[i].function << " in "
+			    << m_passes[i].script
+			    << " failed and won't run on this thread again: "
+			    << err.what();
+
+			worker.failed[i] = true;
+		}
+	}
+
+	// passes may have replaced the array rather than changing it.
+	sol::object result = worker.chunk["blocks"];
+	if (!result.is<sol::table>())
+	{
+		LOG_WARNING("WORLDGEN") << "A generation pass replaced the blocks of "
+		                        << position << " with something that isn't "
+		                        << "an array, the chunk is left as it was.";
+		return;
+	}
+
+	result.push();
+	for (std::size_t i = 0; i < blocks.size(); ++i)
+	{
+		lua_rawgeti(state, -1, static_cast<lua_Integer>(i + 1));
+
+		int         isNumber = 0;
+		lua_Integer id       = lua_tointegerx(state, -1, &isNumber);
+		lua_pop(state, 1);
+
+		if (isNumber == 0 || id < 0)
+		{
+			id = BlockType::UNKNOWN_BLOCK;
+		}
+
+		// only look up blocks that changed, most are left alone.
+		if (static_cast<std::size_t>(id) != blocks[i]->uniqueIdentifier)
+		{
+			blocks[i] = m_referrer->blocks.get(static_cast<std::size_t>(id));
+		}
+	}
+	lua_pop(state, 1);
+}
+
+ScriptedGenerator::Worker& ScriptedGenerator::getWorker()
+{
+	const std::thread::id thread = std::this_thread::get_id();
+
+	{
+		std::lock_guard<std::mutex> lock(m_workerMutex);
+
+		auto it = m_workers.find(thread);
+		if (it != m_workers.end())
+		{
+			return *it->second;
+		}
+	}
+
+	// loading scripts can take a while, so other threads aren't held up
+	// by it. nothing else uses this thread's worker until it's added.
+	auto worker = std::make_unique<Worker>();
+	loadWorker(*worker);
+
+	std::lock_guard<std::mutex> lock(m_workerMutex);
+	return *m_workers.emplace(thread, std::move(worker)).first->second;
+}
+
+void ScriptedGenerator::loadWorker(Worker& worker) const
+{
+	PHX_PROFILE_SCOPE("ScriptedGenerator::loadWorker");
+
+	sol::state& lua = worker.lua;
+	lua.open_libraries(sol::lib::base, sol::lib::math, sol::lib::string,
+	                   sol::lib::table);
+	lua.set_panic(sol::c_call<decltype(&panicHandler), &panicHandler>);
+
+	sol::table api = lua.create_named_table("worldgen");
+	api["seed"]    = m_noise.getSeed();
+
+	BlockReferrer* referrer = m_referrer;
+	api["id"] =
+	    [referrer](const std::string& id) -> sol::optional<std::size_t> {
+		const std::size_t* uid = referrer->referrer.get(id);
+		if (uid == nullptr)
+		{
+			return sol::nullopt;
+		}
+
+		return *uid;
+	};
+
+	const math::Noise* noise = &m_noise;
+	api["noise"] = [noise](float x, float y, float z) {
+		return noise->perlin(x, y, z);
+	};
+	api["fractal"] = [noise](float x, float y, float z, int octaves) {
+		return noise->fractal(x, y, z, octaves);
+	};
+
+	worker.blocks = lua.create_table(Chunk::CHUNK_MAX_BLOCKS, 0);
+	worker.chunk  = lua.create_table_with(
+	    "width", Chunk::CHUNK_WIDTH, "height", Chunk::CHUNK_HEIGHT, "depth",
+	    Chunk::CHUNK_DEPTH);
+
+	// each script gets its own environment, so mods can't trip over each
+	// other's globals.
+	std::unordered_map<std::string, sol::environment> scripts;
+	for (const Pass& pass : m_passes)
+	{
+		auto it = scripts.find(pass.script);
+		if (it == scripts.end())
+		{
+			sol::environment env(lua, sol::create, lua.globals());
+
+			sol::protected_function_result result = lua.safe_script_file(
+			    pass.script, env, &sol::script_pass_on_error);
+			if (!result.valid())
+			{
+				sol::error err = result;
+				LOG_WARNING("WORLDGEN") << "An error occured loading the "
+				                        << "generation script " << pass.script
+				                        << ": " << err.what();
+			}
+
+			it = scripts.emplace(pass.script, env).first;
+		}
+
+		sol::object function = it->second[pass.function];
+		if (function.is<sol::protected_function>())
+		{
+			worker.passes.push_back(function.as<sol::protected_function>());
+			worker.failed.push_back(false);
+		}
+		else
+		{
+			LOG_WARNING("WORLDGEN")
+			    << "The generation script " << pass.script
+			    << " doesn't define the function " << pass.function
+			    << ", the pass is skipped.";
+
+			worker.passes.emplace_back();
+			worker.failed.push_back(true);
+		}
+	}
+}
@@ -0,0 +1,238 @@
+// Copyright 2019-20 Genten Studios
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+// may be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <Common/Voxels/WorldGenerator.hpp>
+
+#include <Common/Profiling/Profiler.hpp>
+
+#include <algorithm>
+#include <array>
+#include <limits>
+
+using namespace phx::voxels;
+
+namespace
+{
+	constexpr int COLUMN_AREA = Chunk::CHUNK_WIDTH * Chunk::CHUNK_DEPTH;
+
+	// the horizontal and vertical scale of the terrain and caves, smaller is
+	// smoother.
+	constexpr float TERRAIN_FREQUENCY = 0.01f;
+	constexpr int   TERRAIN_OCTAVES   = 4;
+	constexpr float CAVE_FREQUENCY    = 0.06f;
+	constexpr int   CAVE_OCTAVES      = 2;
+	constexpr float CAVE_THRESHOLD    = 0.35f;
+
+	/**
+	 * @brief Buffers reused by every chunk a thread generates.
+	 *
+	 * The heightmap is kept until the thread moves on to another column,
+	 * or another generator.
+	 */
+	struct Scratch
+	{
+		const NoiseGenerator* generator = nullptr;
+		std::uint32_t         seed      = 0;
+		int                   columnX   = 0;
+		int                   columnZ   = 0;
+
+		std::array<int, COLUMN_AREA> heights;
+		int                          lowest  = 0;
+		int                          highest = 0;
+
+		std::array<float, Chunk::CHUNK_MAX_BLOCKS> x;
+		std::array<float, Chunk::CHUNK_MAX_BLOCKS> y;
+		std::array<float, Chunk::CHUNK_MAX_BLOCKS> z;
+		std::array<float, Chunk::CHUNK_MAX_BLOCKS> caves;
+	};
+
+	thread_local Scratch t_scratch;
+
+	BlockType* getBlock(phx::voxels::BlockReferrer* referrer,
+	                    const std::string& id, BlockType* fallback)
+	{
+		const std::size_t* uid = referrer->referrer.get(id);
+		if (uid == nullptr || *uid == BlockType::UNKNOWN_BLOCK)
+		{
+			return fallback;
+		}
+
+		return referrer->blocks.get(*uid);
+	}
+} // namespace
+
+FlatGenerator::FlatGenerator(BlockReferrer* referrer) : m_referrer(referrer) {}
+
+void FlatGenerator::generate(Chunk& chunk)
+{
+	BlockType* block = nullptr;
+	if (chunk.getChunkPos().y >= 0)
+	{
+		block = m_referrer->blocks.get(*m_referrer->referrer.get("core.air"));
+	}
+	else
+	{
+		block = m_referrer->blocks.get(*m_referrer->referrer.get("core.grass"));
+	}
+
+	chunk.getBlocks().assign(Chunk::CHUNK_MAX_BLOCKS, block);
+}
+
+NoiseGenerator::NoiseGenerator(BlockReferrer* referrer, std::uint32_t seed)
+    : m_referrer(referrer), m_terrain(seed), m_caves(seed ^ 0x5BD1E995u)
+{
+}
+
+void NoiseGenerator::generate(Chunk& chunk)
+{
+	PHX_PROFILE_SCOPE("NoiseGenerator::generate");
+
+	// looked up every time, since mods can register blocks after the
+	// generator is made.
+	BlockType* air   = m_referrer->blocks.get(BlockType::AIR_BLOCK);
+	BlockType* grass = getBlock(m_referrer, "core.grass", nullptr);
+	if (grass == nullptr)
+	{
+		grass = m_referrer->blocks.get(BlockType::UNKNOWN_BLOCK);
+	}
+	BlockType* dirt  = getBlock(m_referrer, "core.dirt", grass);
+	BlockType* stone = getBlock(m_referrer, "core.stone", dirt);
+
+	const math::vec3 position = chunk.getChunkPos();
+	const int        chunkX   = static_cast<int>(position.x);
+	const int        chunkY   = static_cast<int>(position.y);
+	const int        chunkZ   = static_cast<int>(position.z);
+
+	Scratch& scratch = t_scratch;
+	if (scratch.generator != this || scratch.seed != m_terrain.getSeed() ||
+	    scratch.columnX != chunkX || scratch.columnZ != chunkZ)
+	{
+		PHX_PROFILE_SCOPE("NoiseGenerator::heightmap");
+
+		for (int z = 0, i = 0; z < Chunk::CHUNK_DEPTH; ++z)
+		{
+			for (int x = 0; x < Chunk::CHUNK_WIDTH; ++x, ++i)
+			{
+				scratch.x[i] =
+				    static_cast<float>(chunkX + x) * TERRAIN_FREQUENCY;
+				scratch.y[i] = 0.f;
+				scratch.z[i] =
+				    static_cast<float>(chunkZ + z) * TERRAIN_FREQUENCY;
+			}
+		}
+
+		m_terrain.fractal(scratch.x.data(), scratch.y.data(),
+		                  scratch.z.data(), scratch.caves.data(), COLUMN_AREA,
+		                  TERRAIN_OCTAVES);
+
+		scratch.lowest  = std::numeric_limits<int>::max();
+		scratch.highest = std::numeric_limits<int>::min();
+		for (int i = 0; i < COLUMN_AREA; ++i)
+		{
+			const int height =
+			    BASE_HEIGHT + static_cast<int>(scratch.caves[i] * HEIGHT_RANGE);
+
+			scratch.heights[i] = height;
+			scratch.lowest     = std::min(scratch.lowest, height);
+			scratch.highest    = std::max(scratch.highest, height);
+		}
+
+		scratch.generator = this;
+		scratch.seed      = m_terrain.getSeed();
+		scratch.columnX   = chunkX;
+		scratch.columnZ   = chunkZ;
+	}
+
+	auto& blocks = chunk.getBlocks();
+	if (chunkY > scratch.highest)
+	{
+		// nothing but sky.
+		blocks.assign(Chunk::CHUNK_MAX_BLOCKS, air);
+		return;
+	}
+
+	// only sample caves if some of this chunk is deep enough to have them.
+	const bool hasCaves = chunkY < scratch.highest - CAVE_DEPTH;
+	if (hasCaves)
+	{
+		for (int z = 0, i = 0; z < Chunk::CHUNK_DEPTH; ++z)
+		{
+			for (int y = 0; y < Chunk::CHUNK_HEIGHT; ++y)
+			{
+				for (int x = 0; x < Chunk::CHUNK_WIDTH; ++x, ++i)
+				{
+					scratch.x[i] =
+					    static_cast<float>(chunkX + x) * CAVE_FREQUENCY;
+					scratch.y[i] =
+					    static_cast<float>(chunkY + y) * CAVE_FREQUENCY;
+					scratch.z[i] =
+					    static_cast<float>(chunkZ + z) * CAVE_FREQUENCY;
+				}
+			}
+		}
+
+		m_caves.fractal(scratch.x.data(), scratch.y.data(), scratch.z.data(),
+		                scratch.caves.data(), Chunk::CHUNK_MAX_BLOCKS,
+		                CAVE_OCTAVES);
+	}
+
+	blocks.resize(Chunk::CHUNK_MAX_BLOCKS);
+	for (int z = 0, i = 0; z < Chunk::CHUNK_DEPTH; ++z)
+	{
+		for (int y = 0; y < Chunk::CHUNK_HEIGHT; ++y)
+		{
+			const int worldY = chunkY + y;
+			for (int x = 0; x < Chunk::CHUNK_WIDTH; ++x, ++i)
+			{
+				const int height = scratch.heights[x + z * Chunk::CHUNK_WIDTH];
+
+				BlockType* block = air;
+				if (worldY < height - SOIL_DEPTH)
+				{
+					block = stone;
+				}
+				else if (worldY < height)
+				{
+					block = dirt;
+				}
+				else if (worldY == height)
+				{
+					block = grass;
+				}
+
+				if (hasCaves && worldY < height - CAVE_DEPTH &&
+				    scratch.caves[i] > CAVE_THRESHOLD)
+				{
+					block = air;
+				}
+
+				blocks[i] = block;
+			}
+		}
+	}
+}
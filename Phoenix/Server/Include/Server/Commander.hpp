@@ -39,6 +39,7 @@
 
 #include <Server/Iris.hpp>
 
+#include <Common/CMS/LuaProfiler.hpp>
 #include <Common/CMS/ModManager.hpp>
 
 #include <entt/entity/registry.hpp>
@@ -64,6 +65,10 @@ namespace phx::server
 	    std::string command;
 	    std::string help;
 	    CommandFunction callback;
+	    /// @brief The mod the command is accounted to.
+	    cms::LuaProfiler::ModID mod = cms::LuaProfiler::UNKNOWN_MOD;
+	    /// @brief The Lua state the command runs in, if it's from a mod.
+	    lua_State* state = nullptr;
 	};
 
 	/**
@@ -86,9 +91,14 @@ namespace phx::server
 		 * @param command The keyword for calling the command.
 		 * @param help A help string that can be displayed to the user.
 		 * @param f The function that is called when the command is executed.
+		 * @param mod The mod the command is accounted to.
+		 * @param state The Lua state the function runs in, if it's from a
+		 * mod.
 		 */
 		void add(const std::string& command, const std::string& help,
-		         const CommandFunction& f);
+		         const CommandFunction&  f,
+		         cms::LuaProfiler::ModID mod   = cms::LuaProfiler::UNKNOWN_MOD,
+		         lua_State*              state = nullptr);
 
 		/**
 		 * @brief Calls a command.
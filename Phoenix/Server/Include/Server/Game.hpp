@@ -30,12 +30,17 @@
 
 #include <Server/Commander.hpp>
 #include <Server/Iris.hpp>
+#include <Server/Replay.hpp>
 #include <Server/Voxels/BlockRegistry.hpp>
 
+#include <Common/Profiling/Metrics.hpp>
 #include <Common/Voxels/Map.hpp>
+#include <Common/Voxels/ScriptedGenerator.hpp>
 
 #include <entt/entt.hpp>
 
+#include <cstdint>
+
 namespace phx::server
 {
 	class Game
@@ -65,6 +70,47 @@ namespace phx::server
 		 */
 		void run();
 
+		/**
+		 * @brief Runs a single tick of the game.
+		 *
+		 * This processes the states in the bundle, then everything waiting in
+		 * the event and message queues of the networking system. It is used
+		 * by run for every bundle, and directly when replaying a session.
+		 *
+		 * @param bundle The input states of this tick.
+		 */
+		void tick(const net::StateBundle& bundle);
+
+		/**
+		 * @brief Records every tick from now on.
+		 *
+		 * @param recorder The recorder to write ticks to, nullptr to stop
+		 * recording. It must outlive the game or be unset before it is
+		 * destroyed.
+		 */
+		void setRecorder(ReplayRecorder* recorder) { m_recorder = recorder; }
+
+		/**
+		 * @brief Gets the ticker running the map's block updates, to set
+		 * its budget and random ticks.
+		 */
+		voxels::BlockTicker& getBlockTicker() { return m_map.getTicker(); }
+
+		/**
+		 * @brief Adds the /setblock command, which changes a block without
+		 * needing a client to aim at it.
+		 *
+		 * Any player can run it on any loaded chunk, so it is only meant
+		 * for PhoenixBot's editing bots and is off unless the server turns
+		 * it on with server:edit_command.
+		 */
+		void enableEditCommand();
+
+		/**
+		 * @brief Gets the number of ticks run so far.
+		 */
+		std::size_t getTickCount() const { return m_tick; }
+
 		/**
 		 * @brief Kills the main game loop.
 		 */
@@ -74,6 +120,11 @@ namespace phx::server
 		/// @TODO Move this to a config file
 		static constexpr float dt = 1.f / 20.f;
 
+	private:
+		/// @brief Gets a block by its id, logging a warning if it doesn't
+		/// exist.
+		voxels::BlockType* getBlock(const std::string& id) const;
+
 	private:
 		/// @brief The main loop runs while this is true
 		bool m_running = false;
@@ -85,7 +136,23 @@ namespace phx::server
 		net::Iris* m_iris;
 		/// @brief A commander object to process commands
 		Commander* m_commander;
+		/// @brief The workers that generate new chunks, this must outlive the
+		/// map
+		ThreadPool m_generationPool;
 		/// @brief The map the players exist on
 		voxels::Map m_map;
+		/// @brief The map's generator, which mods register passes with
+		voxels::ScriptedGenerator* m_generator;
+		/// @brief The number of ticks run so far
+		std::size_t m_tick = 0;
+		/// @brief Records each tick if set
+		ReplayRecorder* m_recorder = nullptr;
+		/// @brief The time taken by each tick
+		profiling::Histogram& m_tickDuration;
+		/// @brief The time taken by the last tick, in microseconds, sent to
+		/// clients with each state
+		std::uint32_t m_lastTickTime = 0;
+		/// @brief Reused to record each tick without reallocating
+		ReplayTick m_recordedTick;
 	};
 } // namespace phx::server
\ No newline at end of file
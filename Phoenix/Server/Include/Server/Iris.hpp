@@ -41,6 +41,9 @@
 #include <enet/enet.h>
 #include <entt/entt.hpp>
 
+#include <cstdint>
+#include <memory>
+
 namespace phx::server::net
 {
 	struct StateBundle
@@ -61,7 +64,8 @@ namespace phx::server::net
 	{
 		enum class Type
 		{
-			CONNECT
+			CONNECT,
+			DISCONNECT
 		};
 		entt::entity player;
 		Type         type;
@@ -79,6 +83,16 @@ namespace phx::server::net
 		 */
 		explicit Iris(entt::registry* registry);
 
+		/**
+		 * @brief Creates a networking object on top of a specific transport
+		 *
+		 * @param registry The shared EnTT registry
+		 * @param transport The transport to listen with, such as a
+		 * LoopbackTransport for running a client in the same process
+		 */
+		Iris(entt::registry*                      registry,
+		     std::unique_ptr<phx::net::Transport> transport);
+
 		/**
 		 * @brief Cleans up any internal only objects
 		 */
@@ -93,7 +107,22 @@ namespace phx::server::net
 		void kill() { m_running = false; };
 
 		/**
-		 * @brief Actions taken when a user disconnects
+		 * @brief Sends everything queued for the users straight away.
+		 */
+		void flush();
+
+		/**
+		 * @brief Creates the player for a user, without letting the game know
+		 * they connected.
+		 *
+		 * @param peerID The user to create a player for
+		 * @return The player's entity
+		 */
+		entt::entity addUser(std::size_t peerID);
+
+		/**
+		 * @brief Actions taken when a user disconnects, the game removes
+		 * their player on its next tick.
 		 *
 		 * @param userRef The user who disconnected
 		 */
@@ -139,8 +168,11 @@ namespace phx::server::net
 		 *
 		 * @param userRef The user to sent the state to
 		 * @param data The state packet data
+		 * @param tickTime How long the server's last tick took, in
+		 * microseconds, for clients measuring the server
 		 */
-		void sendState(entt::registry* registry, std::size_t sequence);
+		void sendState(entt::registry* registry, std::size_t sequence,
+		               std::uint32_t tickTime);
 
 		/**
 		 * @brief Sends a message packet to a client
@@ -180,9 +212,18 @@ namespace phx::server::net
 		BlockingQueue<MessageBundle> messageQueue;
 
 	private:
+		/**
+		 * @brief Adds a single state to the bundle for its sequence
+		 *
+		 * @param userID The user who sent the state
+		 * @param input The state, with its full sequence restored
+		 */
+		void addState(std::size_t userID, const InputState& input);
+
 		bool                                          m_running;
 		phx::net::Host*                               m_server;
 		entt::registry*                               m_registry;
 		std::unordered_map<std::size_t, entt::entity> m_users;
+		std::unordered_map<std::size_t, std::size_t>  m_lastSequences;
 	};
 } // namespace phx::server::net
\ No newline at end of file
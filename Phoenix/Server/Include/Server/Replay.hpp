@@ -0,0 +1,146 @@
+// Copyright 2019-20 Genten Studios
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+// may be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <Server/Iris.hpp>
+
+#include <Common/Input.hpp>
+#include <Common/Utility/Serializer.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace phx::server
+{
+	/**
+	 * @brief Everything the game consumed in a single tick.
+	 *
+	 * Users are identified by their peer ID rather than their entity, since
+	 * entities are only meaningful inside the registry they were created in.
+	 */
+	struct ReplayTick
+	{
+		std::size_t                                     sequence = 0;
+		std::vector<std::pair<std::size_t, InputState>> states;
+		std::vector<std::size_t>                        connects;
+		std::vector<std::size_t>                        disconnects;
+		std::vector<net::MessageBundle>                 messages;
+
+		void clear();
+	};
+
+	/**
+	 * @brief Records the input of every tick to a file, so a session can be
+	 * played back through the game later.
+	 *
+	 * @paragraph Format
+	 * The file starts with the 8 bytes "PHXREPLY" and a 32 bit version,
+	 * followed by records written with the Serializer. Each record starts
+	 * with a byte giving its type. A tick is written as its connects,
+	 * disconnects (varint user) and messages (varint user, string), then a
+	 * TICK record (varint sequence, varint count, then for each state a
+	 * varint user, varint sequence and the packed InputState) which ends
+	 * it.
+	 */
+	class ReplayRecorder
+	{
+	public:
+		static constexpr std::uint32_t VERSION = 1;
+
+		enum class Record : std::uint8_t
+		{
+			TICK       = 0,
+			CONNECT    = 1,
+			DISCONNECT = 2,
+			MESSAGE    = 3
+		};
+
+	public:
+		explicit ReplayRecorder(const std::string& file);
+		~ReplayRecorder();
+
+		ReplayRecorder(const ReplayRecorder&) = delete;
+		ReplayRecorder& operator=(const ReplayRecorder&) = delete;
+
+		bool isOpen() const { return m_file.is_open(); }
+
+		void record(const ReplayTick& tick);
+
+		/**
+		 * @brief Writes every tick recorded so far to the file.
+		 */
+		void flush();
+
+	private:
+		std::ofstream m_file;
+		Serializer    m_buffer;
+	};
+
+	/**
+	 * @brief Reads back the ticks written by a ReplayRecorder.
+	 *
+	 * @paragraph Usage
+	 * @code
+	 * ReplayReader reader("Server.phxreplay");
+	 *
+	 * ReplayTick tick;
+	 * while (reader.next(tick))
+	 * {
+	 *     // ...
+	 * }
+	 * @endcode
+	 */
+	class ReplayReader
+	{
+	public:
+		explicit ReplayReader(const std::string& file);
+
+		/**
+		 * @brief Whether the file could be read and is a replay this version
+		 * of the server understands.
+		 */
+		bool isValid() const { return m_valid; }
+
+		/**
+		 * @brief Reads the next tick.
+		 * @param tick The tick to read into.
+		 * @return false once there are no ticks left.
+		 */
+		bool next(ReplayTick& tick);
+
+	private:
+		std::vector<std::byte> m_data;
+		Serializer             m_ser;
+		bool                   m_valid = false;
+	};
+} // namespace phx::server
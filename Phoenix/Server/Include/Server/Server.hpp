@@ -30,15 +30,19 @@
 
 #include <Server/Game.hpp>
 #include <Server/Iris.hpp>
+#include <Server/Replay.hpp>
 #include <Server/User.hpp>
 #include <Server/Voxels/BlockRegistry.hpp>
 
 #include <Common/CMS/ModManager.hpp>
+#include <Common/Network/LoopbackTransport.hpp>
+#include <Common/Profiling/Metrics.hpp>
 
 #include <entt/entt.hpp>
 #include <enet/enet.h>
 
 #include <array>
+#include <memory>
 #include <string>
 
 namespace phx::server
@@ -50,13 +54,38 @@ namespace phx::server
 		 * @brief Core object for the server
 		 *
 		 * @param save The save we are loading
+		 * @param headless Whether the server should run without listening
+		 * on the network, used for replaying sessions
 		 */
-		Server(const std::string& save);
+		Server(const std::string& save, bool headless = false);
 		~Server();
 
 		/// @brief Main loop for the server
 		void run();
 
+		/**
+		 * @brief Replays a recorded session as fast as possible.
+		 *
+		 * Every tick in the replay is fed straight into the game, in order,
+		 * then a summary of how long it took is printed. The server should be
+		 * headless, anything sent to players goes nowhere.
+		 *
+		 * @param file The replay to play, written with the server:record
+		 * setting.
+		 * @return Whether the replay could be played.
+		 */
+		bool replay(const std::string& file);
+
+	private:
+		/// @brief Starts logging and diagnostics and loads the settings.
+		void initialize();
+
+		/// @brief Loads the mods in the save, exits if they can't be loaded.
+		void loadModules();
+
+		/// @brief Stops everything started by initialize.
+		void shutdown();
+
 	private:
 		/// @brief central boolean to control if the game is running or not
 		bool m_running = true;
@@ -67,6 +96,9 @@ namespace phx::server
 		/// @brief An EnTT registry to store various data in
 		entt::registry m_registry;
 
+		/// @brief The network used in place of a socket when headless
+		std::unique_ptr<phx::net::LoopbackNetwork> m_loopback;
+
 		/// @brief The networking object, this listens for incoming data
 		net::Iris* m_iris;
 
@@ -80,5 +112,11 @@ namespace phx::server
 		cms::ModManager* m_modManager;
 
 		Save* m_save;
+
+		/// @brief Writes metrics to a file if enabled in the settings
+		std::unique_ptr<profiling::MetricsWriter> m_metricsWriter;
+
+		/// @brief Records the session if enabled in the settings
+		std::unique_ptr<ReplayRecorder> m_recorder;
 	};
 } // namespace phx::server
@@ -40,6 +40,9 @@
 #include <Common/Voxels/BlockReferrer.hpp>
 #include <Common/CMS/ModManager.hpp>
 
+#include <algorithm>
+#include <cstdint>
+
 namespace phx::server
 {
 	/**
@@ -83,6 +86,16 @@ namespace phx::server
 					    block.category = voxels::BlockCategory::AIR;
 				    }
 
+				    sol::optional<int> light = luaBlock["light"];
+				    if (light)
+				    {
+					    block.lightLevel = static_cast<std::uint8_t>(
+					        std::clamp(*light, 0, 15));
+				    }
+
+				    block.mod = cms::LuaProfiler::get().getModID(
+				        manager->getCurrentModName());
+
 				    sol::optional<sol::function> onPlace = luaBlock["onPlace"];
 				    if (onPlace)
 				    {
@@ -105,6 +118,20 @@ namespace phx::server
 					    block.onInteract = *onInteract;
 				    }
 
+				    sol::optional<sol::function> onTick = luaBlock["onTick"];
+				    if (onTick)
+				    {
+					    block.onTick = *onTick;
+				    }
+
+				    sol::optional<sol::function> onRandomTick =
+				        luaBlock["onRandomTick"];
+				    if (onRandomTick)
+				    {
+					    block.onRandomTick  = *onRandomTick;
+					    block.ticksRandomly = true;
+				    }
+
 				    std::size_t blockUID   = referrer.referrer.size();
 				    block.uniqueIdentifier = blockUID;
 
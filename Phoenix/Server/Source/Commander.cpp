@@ -36,6 +36,7 @@
  */
 
 #include <Common/Logger.hpp>
+#include <Common/Profiling/Tracer.hpp>
 #include <Server/Commander.hpp>
 
 using namespace phx::server;
@@ -79,19 +80,24 @@ void Commander::registerAPI(phx::cms::ModManager* manager)
 	*/
 	manager->registerFunction(
 	    "core.command.register",
-	    [this](std::string command, std::string help, sol::function f) {
-		    this->add(command, help, f);
+	    [manager, this](std::string command, std::string help,
+	                    sol::function f) {
+		    this->add(command, help, f,
+		              cms::LuaProfiler::get().getModID(
+		                  manager->getCurrentModName()),
+		              f.lua_state());
 	    });
 }
 
 void Commander::add(const std::string& command, const std::string& help,
-                    const CommandFunction& f)
+                    const CommandFunction& f, cms::LuaProfiler::ModID mod,
+                    lua_State* state)
 {
 	if (m_commands.find(command) != m_commands.end())
 	{
 		LOG_INFO("COMMANDER") << "Command overwritten: " << command;
 	}
-	m_commands[command] = {command, help, f};
+	m_commands[command] = {command, help, f, mod, state};
 }
 
 bool Commander::run(std::size_t userRef, const std::string& input)
@@ -164,7 +170,10 @@ bool Commander::run(std::size_t userRef, const std::string& input)
 	auto com = m_commands.find(command);
 	if (com != m_commands.end())
 	{
-		com->second.callback(args);
+		PHX_TRACE_SCOPE(LUA, "Commander::run");
+		const CommandFunction& callback = com->second.callback;
+		cms::LuaProfiler::get().run(com->second.mod, com->second.state,
+		                            [callback, args]() { callback(args); });
 		return true;
 	}
 	// No commands match
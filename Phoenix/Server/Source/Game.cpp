@@ -30,9 +30,18 @@
 #include <Server/User.hpp>
 
 #include <Common/Actor.hpp>
+#include <Common/CMS/EventBus.hpp>
+#include <Common/CMS/LuaProfiler.hpp>
 #include <Common/PlayerView.hpp>
+#include <Common/Profiling/Metrics.hpp>
+#include <Common/Profiling/Profiler.hpp>
+#include <Common/Profiling/Tracer.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
 #include <thread>
+#include <unordered_map>
 
 using namespace phx;
 using namespace phx::server;
@@ -40,9 +49,49 @@ using namespace phx::server;
 Game::Game(BlockRegistry* blockReg, entt::registry* registry,
            phx::server::net::Iris* iris, Save* save)
     : m_blockRegistry(blockReg), m_registry(registry), m_iris(iris),
-      m_map(voxels::Map(save, "map1", &blockReg->referrer))
+      m_generationPool(0, "Worldgen"),
+      m_map(voxels::Map(save, "map1", &blockReg->referrer)),
+      m_tickDuration(profiling::Metrics::get().histogram(
+          "phoenix_tick_duration_seconds", "Time taken by each server tick.",
+          profiling::Histogram::latencyBuckets()))
 {
 	m_commander = new Commander(m_iris);
+
+	// the seed is optional, saves made before world generation get 0.
+	std::uint32_t         seed     = 0;
+	const nlohmann::json& settings = save->getSettings();
+	if (settings.is_object())
+	{
+		const auto it = settings.find("seed");
+		if (it != settings.end() && it->is_number_integer())
+		{
+			seed = it->get<std::uint32_t>();
+		}
+	}
+
+	// mods add their passes to the generator when the API is registered.
+	auto generator = std::make_unique<voxels::ScriptedGenerator>(
+	    &blockReg->referrer, seed,
+	    std::make_unique<voxels::NoiseGenerator>(&blockReg->referrer, seed));
+	m_generator = generator.get();
+
+	m_map.setGenerator(std::move(generator));
+	m_map.setThreadPool(&m_generationPool);
+	m_map.enableLiquids();
+
+	m_map.getTicker().setHandler(
+	    [](const math::vec3& position, voxels::BlockType* block,
+	       voxels::BlockTicker::TickType type) {
+		    const voxels::BlockCallback& callback =
+		        type == voxels::BlockTicker::TickType::SCHEDULED
+		            ? block->onTick
+		            : block->onRandomTick;
+		    if (callback)
+		    {
+			    cms::LuaProfiler::get().call(block->mod, callback, position.x,
+			                                 position.y, position.z);
+		    }
+	    });
 }
 
 Game::~Game()
@@ -51,13 +100,224 @@ Game::~Game()
     delete m_commander;
 }
 
+void Game::enableEditCommand()
+{
+	m_commander->add(
+	    "setblock", "Sets a block, /setblock <x> <y> <z> <block>",
+	    [this](std::vector<std::string> args) {
+		    if (args.size() != 4)
+		    {
+			    LOG_WARNING("COMMANDER")
+			        << "Usage: /setblock <x> <y> <z> <block>";
+			    return;
+		    }
+
+		    float coordinates[3];
+		    for (std::size_t i = 0; i < 3; ++i)
+		    {
+			    char* end      = nullptr;
+			    coordinates[i] = std::strtof(args[i].c_str(), &end);
+			    if (end == args[i].c_str() || *end != '\0')
+			    {
+				    LOG_WARNING("COMMANDER")
+				        << args[i] << " is not a valid coordinate.";
+				    return;
+			    }
+		    }
+
+		    voxels::BlockType* block = getBlock(args[3]);
+		    if (block == nullptr)
+		    {
+			    return;
+		    }
+
+		    math::vec3 position = {coordinates[0], coordinates[1],
+		                           coordinates[2]};
+		    position.floor();
+
+		    // only chunks players already have loaded can be edited, so the
+		    // command can't be used to generate the world far from anyone.
+		    if (m_map.findChunk(voxels::Map::getBlockPos(position).first) ==
+		        nullptr)
+		    {
+			    LOG_WARNING("COMMANDER")
+			        << "The chunk at that position isn't loaded.";
+			    return;
+		    }
+
+		    const voxels::BlockType* previous = m_map.getBlockAt(position);
+		    if (previous == block)
+		    {
+			    return;
+		    }
+
+		    m_map.setBlockAt(position, block);
+
+		    cms::EventBus::get().push(
+		        cms::BlockChangedEvent {position, previous, block});
+	    });
+}
+
+namespace
+{
+	math::vec3 toPosition(const sol::table& table)
+	{
+		return {table.get_or("x", 0.f), table.get_or("y", 0.f),
+		        table.get_or("z", 0.f)};
+	}
+} // namespace
+
+voxels::BlockType* Game::getBlock(const std::string& id) const
+{
+	const std::size_t* uid = m_blockRegistry->referrer.referrer.get(id);
+	if (uid == nullptr)
+	{
+		LOG_WARNING("MAP") << "The block " << id << " doesn't exist.";
+		return nullptr;
+	}
+
+	return m_blockRegistry->referrer.blocks.get(*uid);
+}
+
 void Game::registerAPI(cms::ModManager* manager)
 {
 	m_commander->registerAPI(manager);
+	m_generator->registerAPI(manager);
+
+	/**
+	 * @addtogroup luaapi
+	 *
+	 * @subsubsection voxelmapfill voxel.map.fill
+	 * @brief Sets every block in a box, both corners included.
+	 *
+	 * The blocks are changed in one go, so each chunk is saved once
+	 * however many blocks change. Positions round down to the block they
+	 * are in. Returns the number that changed.
+	 *
+	 * Players that already have a chunk aren't sent the change yet.
+	 *
+	 * @b Example:
+	 * @code {.lua}
+	 * voxel.map.fill({x = 0, y = 0, z = 0}, {x = 31, y = 31, z = 31},
+	 *                "core.dirt")
+	 * @endcode
+	 */
+	manager->registerFunction(
+	    "voxel.map.fill",
+	    [this](sol::table from, sol::table to, const std::string& id) {
+		    voxels::BlockType* block = getBlock(id);
+		    if (block == nullptr)
+		    {
+			    return std::size_t {0};
+		    }
+
+		    return m_map.beginEdit().fill(toPosition(from), toPosition(to),
+		                                  block);
+	    });
+
+	/**
+	 * @addtogroup luaapi
+	 *
+	 * @subsubsection voxelmapreplace voxel.map.replace
+	 * @brief Swaps one block for another in a box, both corners included.
+	 *
+	 * @b Example:
+	 * @code {.lua}
+	 * voxel.map.replace({x = 0, y = 0, z = 0}, {x = 31, y = 31, z = 31},
+	 *                   "core.grass", "core.dirt")
+	 * @endcode
+	 */
+	manager->registerFunction(
+	    "voxel.map.replace", [this](sol::table from, sol::table to,
+	                                const std::string& target,
+	                                const std::string& id) {
+		    voxels::BlockType* targetBlock = getBlock(target);
+		    voxels::BlockType* block       = getBlock(id);
+		    if (targetBlock == nullptr || block == nullptr)
+		    {
+			    return std::size_t {0};
+		    }
+
+		    return m_map.beginEdit().replace(toPosition(from), toPosition(to),
+		                                     targetBlock, block);
+	    });
+
+	/**
+	 * @addtogroup luaapi
+	 *
+	 * @subsubsection voxelmapset voxel.map.set
+	 * @brief Sets a list of blocks at once.
+	 *
+	 * @b Example:
+	 * @code {.lua}
+	 * voxel.map.set({{x = 0, y = 1, z = 0, block = "core.dirt"},
+	 *                {x = 0, y = 2, z = 0, block = "core.grass"}})
+	 * @endcode
+	 */
+	manager->registerFunction("voxel.map.set", [this](sol::table blocks) {
+		std::size_t changed = 0;
+
+		// lists tend to repeat the same few blocks.
+		std::unordered_map<std::string, voxels::BlockType*> lookup;
+
+		voxels::Map::Edit edit = m_map.beginEdit();
+		for (std::size_t i = 1; i <= blocks.size(); ++i)
+		{
+			sol::table        entry = blocks[i];
+			const std::string id    = entry.get_or<std::string>("block", "");
+
+			auto it = lookup.find(id);
+			if (it == lookup.end())
+			{
+				it = lookup.emplace(id, getBlock(id)).first;
+			}
+
+			if (it->second != nullptr &&
+			    edit.set(toPosition(entry), it->second))
+			{
+				++changed;
+			}
+		}
+
+		return changed;
+	});
+
+	/**
+	 * @addtogroup luaapi
+	 *
+	 * @subsubsection voxelmapschedule voxel.map.schedule
+	 * @brief Runs the onTick callback of a block a number of ticks from now.
+	 *
+	 * The callback is given the position of the block, and belongs to
+	 * whichever block is there by then. Scheduling a block that is already
+	 * scheduled keeps the earlier of the two.
+	 *
+	 * @b Example:
+	 * @code {.lua}
+	 * wheat.onTick = function(x, y, z)
+	 *     voxel.map.set({{x = x, y = y, z = z, block = "core.wheat_ripe"}})
+	 * end
+	 *
+	 * voxel.map.schedule({x = 4, y = 40, z = 4}, 200)
+	 * @endcode
+	 */
+	manager->registerFunction("voxel.map.schedule",
+	                          [this](sol::table position, int delay) {
+		                          m_map.scheduleTick(
+		                              toPosition(position),
+		                              static_cast<std::uint64_t>(
+		                                  std::max(delay, 1)));
+	                          });
 }
 
 void Game::run()
 {
+	if (profiling::Tracer::get() != nullptr)
+	{
+		profiling::Tracer::get()->setThreadName("Game");
+	}
+	profiling::Profiler::setThreadName("Game");
+
 	m_running = true;
 	while (m_running)
 	{
@@ -70,68 +330,156 @@ void Game::run()
 		}
 		net::StateBundle m_currentState = m_iris->stateQueue.pop();
 
-		// Process everybody's input first
-		for (const auto& state : m_currentState.states)
+		// a new bundle is a new tick, so this closes the previous one.
+		profiling::Profiler::endFrame();
+
+		tick(m_currentState);
+	}
+}
+
+void Game::tick(const net::StateBundle& bundle)
+{
+	PHX_TRACE_SCOPE(TICK, "Game::tick");
+	PHX_PROFILE_SCOPE("Game::tick");
+	const auto tickStart = std::chrono::steady_clock::now();
+
+	if (m_recorder != nullptr)
+	{
+		m_recordedTick.clear();
+		m_recordedTick.sequence = bundle.sequence;
+	}
+
+	// Process everybody's input first
+	for (const auto& state : bundle.states)
+	{
+		// the player may have disconnected while the bundle was waiting.
+		if (!m_registry->valid(state.first))
 		{
-			auto       player = m_registry->get<Player>(state.first);
-			math::vec3 pos = m_registry->get<Position>(player.actor).position;
-			const math::vec3i oldPos(
-			    static_cast<int>(pos.x) / voxels::Chunk::CHUNK_WIDTH,
-			    static_cast<int>(pos.y) / voxels::Chunk::CHUNK_HEIGHT,
-			    static_cast<int>(pos.z) / voxels::Chunk::CHUNK_DEPTH);
-			ActorSystem::tick(m_registry, player.actor, dt, state.second);
-			pos = m_registry->get<Position>(player.actor).position;
-			const math::vec3i newPos(
-			    static_cast<int>(pos.x) / voxels::Chunk::CHUNK_WIDTH,
-			    static_cast<int>(pos.y) / voxels::Chunk::CHUNK_HEIGHT,
-			    static_cast<int>(pos.z) / voxels::Chunk::CHUNK_DEPTH);
-			// TODO this needs fixed in the math lib
-			if (!(oldPos == newPos))
+			continue;
+		}
+
+		auto player = m_registry->get<Player>(state.first);
+		if (m_recorder != nullptr)
+		{
+			m_recordedTick.states.emplace_back(player.id, state.second);
+		}
+
+		math::vec3 pos = m_registry->get<Position>(player.actor).position;
+		const math::vec3i oldPos(
+		    static_cast<int>(pos.x) / voxels::Chunk::CHUNK_WIDTH,
+		    static_cast<int>(pos.y) / voxels::Chunk::CHUNK_HEIGHT,
+		    static_cast<int>(pos.z) / voxels::Chunk::CHUNK_DEPTH);
+		ActorSystem::tick(m_registry, player.actor, dt, state.second);
+		pos = m_registry->get<Position>(player.actor).position;
+		const math::vec3i newPos(
+		    static_cast<int>(pos.x) / voxels::Chunk::CHUNK_WIDTH,
+		    static_cast<int>(pos.y) / voxels::Chunk::CHUNK_HEIGHT,
+		    static_cast<int>(pos.z) / voxels::Chunk::CHUNK_DEPTH);
+		// TODO this needs fixed in the math lib
+		if (!(oldPos == newPos))
+		{
+			for (const auto& chunk :
+			     PlayerView::update(m_registry, player.actor))
 			{
-				for (const auto& chunk :
-				     PlayerView::update(m_registry, player.actor))
-				{
-					m_iris->sendData(player.id, chunk);
-				}
+				m_iris->sendData(player.id, chunk);
 			}
 		}
+	}
 
-		// Process events second
-		size_t size = m_iris->eventQueue.size();
-		for (size_t i = 0; i < size; i++)
+	// Process events second
+	size_t size = m_iris->eventQueue.size();
+	for (size_t i = 0; i < size; i++)
+	{
+		net::Event event = m_iris->eventQueue.pop();
+		switch (event.type)
 		{
-			net::Event event = m_iris->eventQueue.pop();
-			switch (event.type)
+		case net::Event::Type::CONNECT:
+		{
+			auto entity = m_registry->get<Player>(event.player);
+			if (m_recorder != nullptr)
 			{
-			case net::Event::Type::CONNECT:
+				m_recordedTick.connects.push_back(entity.id);
+			}
+
+			m_registry->emplace<PlayerView>(entity.actor, &m_map);
+			for (const auto& chunk :
+			     PlayerView::update(m_registry, entity.actor))
 			{
-				auto entity = m_registry->get<Player>(event.player);
-				m_registry->emplace<PlayerView>(entity.actor, &m_map);
-				for (const auto& chunk :
-				     PlayerView::update(m_registry, entity.actor))
-				{
-					m_iris->sendData(entity.id, chunk);
-				}
-				break;
+				m_iris->sendData(entity.id, chunk);
 			}
-			default:
-				LOG_WARNING("GAME") << "Invalid network event received";
-				break;
+
+			cms::EventBus::get().push(cms::EventType::PLAYER_JOINED,
+			                          cms::PlayerEvent {entity.id});
+			break;
+		}
+		case net::Event::Type::DISCONNECT:
+		{
+			auto entity = m_registry->get<Player>(event.player);
+			if (m_recorder != nullptr)
+			{
+				m_recordedTick.disconnects.push_back(entity.id);
 			}
+
+			m_registry->destroy(entity.actor);
+			m_registry->destroy(event.player);
+
+			cms::EventBus::get().push(cms::EventType::PLAYER_LEFT,
+			                          cms::PlayerEvent {entity.id});
+			break;
+		}
+		default:
+			LOG_WARNING("GAME") << "Invalid network event received";
+			break;
+		}
+	}
+
+	// Process messages last
+	size = m_iris->messageQueue.size();
+	for (size_t i = 0; i < size; i++)
+	{
+		net::MessageBundle message = m_iris->messageQueue.front();
+		if (m_recorder != nullptr)
+		{
+			m_recordedTick.messages.push_back(message);
 		}
 
-		// Process messages last
-		size = m_iris->messageQueue.size();
-		for (size_t i = 0; i < size; i++)
+		if (message.message.empty() || message.message[0] != '/')
 		{
-			net::MessageBundle message = m_iris->messageQueue.front();
-			m_commander->run(message.userID, message.message);
-			m_iris->messageQueue.pop();
+			cms::EventBus::get().push(
+			    cms::ChatEvent {message.userID, message.message});
 		}
 
-		// Dispatch confirmation states
-		m_iris->sendState(m_registry, m_currentState.sequence);
+		m_commander->run(message.userID, message.message);
+		m_iris->messageQueue.pop();
+	}
+
+	// Dispatch confirmation states
+	m_iris->sendState(m_registry, bundle.sequence, m_lastTickTime);
+
+	if (m_recorder != nullptr)
+	{
+		m_recorder->record(m_recordedTick);
 	}
+
+	// Blocks that change over time go after everything players did.
+	m_map.tick();
+
+	// Lua hears about the tick's events once the world is done changing.
+	cms::EventBus::get().dispatch();
+
+	// checks every mod kept to its Lua budget, and runs whatever was
+	// deferred from earlier ticks.
+	cms::LuaProfiler::get().endTick();
+
+	++m_tick;
+
+	// this tick's state has gone already, so its time goes with the next.
+	const std::chrono::duration<double> tickTime =
+	    std::chrono::steady_clock::now() - tickStart;
+	m_tickDuration.observe(tickTime.count());
+	m_lastTickTime = static_cast<std::uint32_t>(
+	    std::chrono::duration_cast<std::chrono::microseconds>(tickTime)
+	        .count());
 }
 
 void Game::kill() { m_running = false; }
@@ -33,6 +33,9 @@
 #include <Common/Logger.hpp>
 #include <Common/Movement.hpp>
 #include <Common/Position.hpp>
+#include <Common/Profiling/Metrics.hpp>
+#include <Common/Profiling/Profiler.hpp>
+#include <Common/Profiling/Tracer.hpp>
 #include <Common/Utility/Serializer.hpp>
 
 using namespace phx;
@@ -42,25 +45,43 @@ using namespace phx::server::net;
 /// @todo Replace this with the config system
 static const std::size_t MAX_USERS = 32;
 
-Iris::Iris(entt::registry* registry) : m_registry(registry), m_running(false)
+Iris::Iris(entt::registry* registry) : Iris(registry, nullptr) {}
+
+Iris::Iris(entt::registry*                      registry,
+           std::unique_ptr<phx::net::Transport> transport)
+    : m_registry(registry), m_running(false)
 {
-	m_server = new phx::net::Host(phx::net::Address(7777), MAX_USERS, 4);
+	if (transport)
+	{
+		m_server = new phx::net::Host(std::move(transport));
+	}
+	else
+	{
+		m_server = new phx::net::Host(phx::net::Address(7777), MAX_USERS, 4);
+	}
+
+	m_server->enableBatching();
+
+	auto& metrics = profiling::Metrics::get();
+	const std::string depthHelp = "Elements waiting in a server queue.";
+	eventQueue.trackDepth(&metrics.gauge("phoenix_queue_depth", depthHelp,
+	                                     {{"queue", "event"}}));
+	stateQueue.trackDepth(&metrics.gauge("phoenix_queue_depth", depthHelp,
+	                                     {{"queue", "state"}}));
+	messageQueue.trackDepth(&metrics.gauge("phoenix_queue_depth", depthHelp,
+	                                       {{"queue", "message"}}));
 
 	m_server->onConnect([this](Peer& peer, enet_uint32) {
 		LOG_INFO("NETWORK")
 		    << "Client connected from: " << peer.getAddress().getIP();
-		{
-			auto entity = m_registry->create();
-			m_registry->emplace<Player>(
-			    entity, ActorSystem::registerActor(m_registry), peer.getID());
-			m_users.emplace(peer.getID(), entity);
-			eventQueue.push({entity, Event::Type::CONNECT});
-		}
+		eventQueue.push({addUser(peer.getID()), Event::Type::CONNECT});
 	});
 
+	// messages are batched, so we dispatch on the message type rather than
+	// the channel they arrived on.
 	m_server->onReceive(
-	    [this](Peer& peer, Packet&& packet, enet_uint32 channelID) {
-		    switch (channelID)
+	    [this](Peer& peer, Packet&& packet, enet_uint32 type) {
+		    switch (type)
 		    {
 		    case 0:
 			    parseEvent(peer.getID(), packet);
@@ -73,7 +94,7 @@ Iris::Iris(entt::registry* registry) : m_registry(registry), m_running(false)
 			    break;
 		    default:
 			    LOG_WARNING("NETWORK")
-			        << "Received packet on channel " << channelID;
+			        << "Received message of unknown type " << type;
 		    }
 	    });
 
@@ -85,17 +106,44 @@ Iris::~Iris() { delete m_server; }
 
 void Iris::run()
 {
+	if (profiling::Tracer::get() != nullptr)
+	{
+		profiling::Tracer::get()->setThreadName("Network");
+	}
+	profiling::Profiler::setThreadName("Network");
+
 	m_running = true;
 	while (m_running)
 	{
 		m_server->poll(50_ms, 100);
+		profiling::Profiler::endFrame();
 	}
 }
 
+void Iris::flush() { m_server->flush(); }
+
+entt::entity Iris::addUser(std::size_t peerID)
+{
+	auto entity = m_registry->create();
+	m_registry->emplace<Player>(
+	    entity, ActorSystem::registerActor(m_registry), peerID);
+	m_users.emplace(peerID, entity);
+	return entity;
+}
+
 void Iris::disconnect(std::size_t peerID)
 {
 	LOG_INFO("NETWORK") << peerID << " disconnected";
-	m_registry->destroy(m_users.at(peerID));
+	m_lastSequences.erase(peerID);
+
+	auto user = m_users.find(peerID);
+	if (user != m_users.end())
+	{
+		// the game may be using the player right now, so it is left to the
+		// game to destroy it.
+		eventQueue.push({user->second, Event::Type::DISCONNECT});
+		m_users.erase(user);
+	}
 }
 
 void Iris::parseEvent(std::size_t userID, Packet& packet)
@@ -103,7 +151,7 @@ void Iris::parseEvent(std::size_t userID, Packet& packet)
 	std::string data;
 
 	phx::Serializer ser;
-	ser.setBuffer(packet.getData());
+	ser.borrowBuffer(packet.getRawData(), packet.getSize());
 	ser >> data;
 
 	printf("Event received");
@@ -113,13 +161,57 @@ void Iris::parseEvent(std::size_t userID, Packet& packet)
 
 void Iris::parseState(std::size_t userID, phx::net::Packet& packet)
 {
-	InputState input;
-
-	auto data = packet.getData();
+	InputHistory history;
 
 	phx::Serializer ser;
-	ser.setBuffer(data.data(), packet.getSize());
-	ser >> input;
+	ser.borrowBuffer(packet.getRawData(), packet.getSize());
+	ser >> history;
+
+	auto& states = history.getStates();
+	if (states.empty())
+	{
+		return;
+	}
+
+	// Rebuild the full sequences relative to the newest state, which is
+	// itself rebuilt relative to the last sequence we got from this user.
+	auto        last   = m_lastSequences.find(userID);
+	std::size_t newest = states.front().sequence;
+	if (last != m_lastSequences.end())
+	{
+		newest = InputState::unwrapSequence(
+		    static_cast<std::uint16_t>(newest), last->second);
+	}
+
+	// States are sent redundantly, so most of them have already been
+	// received. Only the ones we don't have yet are added, oldest first.
+	for (auto it = states.rbegin(); it != states.rend(); ++it)
+	{
+		it->sequence = InputState::unwrapSequence(
+		    static_cast<std::uint16_t>(it->sequence), newest);
+
+		if (last != m_lastSequences.end() && it->sequence <= last->second)
+		{
+			continue;
+		}
+
+		addState(userID, *it);
+	}
+
+	if (last == m_lastSequences.end() || newest > last->second)
+	{
+		m_lastSequences[userID] = newest;
+	}
+}
+
+void Iris::addState(std::size_t userID, const InputState& input)
+{
+	// states can still arrive from a user who just disconnected.
+	auto user = m_users.find(userID);
+	if (user == m_users.end())
+	{
+		return;
+	}
 
 	// If the queue is empty we need to add a new bundle
 	if (currentBundles.empty())
@@ -136,7 +228,9 @@ void Iris::parseState(std::size_t userID, phx::net::Packet& packet)
 	if (input.sequence < currentBundles.front().sequence &&
 	    currentBundles.back().sequence - input.sequence < 10)
 	{
-		printf("discard %lu \n", input.sequence);
+		PHX_TRACE_EVENT(PACKET, "Iris::discard", input.sequence);
+		LOG_DEBUG("NETWORK") << "Discarded late input " << input.sequence
+		                     << " from " << userID;
 		return;
 	}
 
@@ -163,7 +257,7 @@ void Iris::parseState(std::size_t userID, phx::net::Packet& packet)
 				// Thread safety! If we said a bundle is ready, were too late
 				if (!bundle.ready)
 				{
-					bundle.states[m_users[userID]] = input;
+					bundle.states[user->second] = input;
 					// If we have all the states we need, then the bundle is
 					// ready
 					if (bundle.states.size() >= bundle.users)
@@ -191,10 +285,8 @@ void Iris::parseMessage(std::size_t userID, phx::net::Packet& packet)
 {
 	std::string input;
 
-	auto data = packet.getData();
-
 	phx::Serializer ser;
-	ser.setBuffer(reinterpret_cast<std::byte*>(data.data()), data.size());
+	ser.borrowBuffer(packet.getRawData(), packet.getSize());
 	ser >> input;
 
 	/// @TODO replace userID with userName
@@ -215,34 +307,30 @@ void Iris::parseMessage(std::size_t userID, phx::net::Packet& packet)
 
 void Iris::sendEvent(std::size_t userID, enet_uint8* data) {}
 
-void Iris::sendState(entt::registry* registry, std::size_t sequence)
+void Iris::sendState(entt::registry* registry, std::size_t sequence,
+                     std::uint32_t tickTime)
 {
 	auto       view = registry->view<Position, Movement>();
 	Serializer ser;
-	ser << sequence;
+	ser << sequence << varint(tickTime);
 	for (auto entity : view)
 	{
 		auto pos = view.get<Position>(entity);
 		ser << pos.position.x << pos.position.y << pos.position.z;
 	}
-	Packet packet = Packet(ser.getBuffer(), PacketFlags::UNRELIABLE);
-	m_server->broadcast(packet, 1);
+	m_server->queueBroadcast(1, ser.getBuffer(), PacketFlags::UNRELIABLE, 1);
 }
 
 void Iris::sendMessage(std::size_t userID, const std::string& message)
 {
 	Serializer ser;
 	ser << message;
-	Packet packet = Packet(ser.getBuffer(), PacketFlags::RELIABLE);
-	Peer*  peer   = m_server->getPeer(userID);
-	peer->send(packet, 2);
+	m_server->queue(userID, 2, ser.getBuffer(), PacketFlags::RELIABLE, 2);
 }
 
 void Iris::sendData(std::size_t userID, voxels::Chunk* data)
 {
 	Serializer ser;
 	ser << *data;
-	Packet packet = Packet(ser.getBuffer(), PacketFlags::RELIABLE);
-	Peer*  peer   = m_server->getPeer(userID);
-	peer->send(packet, 3);
+	m_server->queue(userID, 3, ser.getBuffer(), PacketFlags::RELIABLE, 3);
 }
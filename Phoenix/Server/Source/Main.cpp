@@ -28,6 +28,10 @@
 
 #include <Server/Server.hpp>
 
+#include <cstring>
+#include <iostream>
+#include <string>
+
 using namespace phx;
 
 #undef main
@@ -40,6 +44,29 @@ int main(int argc, char** argv)
 	//        save = "save1";
 	//    }
 
+	// --replay <file> plays back a session recorded with server:record
+	// instead of listening for players.
+	std::string replay;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+		{
+			replay = argv[++i];
+		}
+		else
+		{
+			std::cerr << "Unknown argument: " << argv[i] << "\n"
+			          << "Usage: " << argv[0] << " [--replay <file>]\n";
+			return 1;
+		}
+	}
+
+	if (!replay.empty())
+	{
+		server::Server server("save1", true);
+		return server.replay(replay) ? 0 : 1;
+	}
+
 	server::Server* server = new server::Server("save1");
 	server->run();
 
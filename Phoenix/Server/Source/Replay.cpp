@@ -0,0 +1,221 @@
+// Copyright 2019-20 Genten Studios
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+// may be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <Server/Replay.hpp>
+
+#include <Common/Logger.hpp>
+
+#include <cstring>
+#include <iterator>
+
+using namespace phx;
+using namespace phx::server;
+
+namespace
+{
+	const char MAGIC[] = {'P', 'H', 'X', 'R', 'E', 'P', 'L', 'Y'};
+
+	// ticks are written out in batches of about this many bytes.
+	constexpr std::size_t FLUSH_SIZE = 64 * 1024;
+} // namespace
+
+void ReplayTick::clear()
+{
+	sequence = 0;
+	states.clear();
+	connects.clear();
+	disconnects.clear();
+	messages.clear();
+}
+
+ReplayRecorder::ReplayRecorder(const std::string& file)
+{
+	m_file.open(file, std::ios_base::binary | std::ios_base::trunc);
+	if (!m_file.is_open())
+	{
+		LOG_WARNING("REPLAY")
+		    << "Could not open " << file << ", nothing will be recorded.";
+		return;
+	}
+
+	m_file.write(MAGIC, sizeof(MAGIC));
+	m_buffer << VERSION;
+}
+
+ReplayRecorder::~ReplayRecorder() { flush(); }
+
+void ReplayRecorder::record(const ReplayTick& tick)
+{
+	for (const std::size_t user : tick.connects)
+	{
+		m_buffer << static_cast<std::uint8_t>(Record::CONNECT)
+		         << varint(user);
+	}
+
+	for (const std::size_t user : tick.disconnects)
+	{
+		m_buffer << static_cast<std::uint8_t>(Record::DISCONNECT)
+		         << varint(user);
+	}
+
+	for (const auto& message : tick.messages)
+	{
+		m_buffer << static_cast<std::uint8_t>(Record::MESSAGE)
+		         << varint(message.userID) << message.message;
+	}
+
+	const std::size_t count = tick.states.size();
+	m_buffer << static_cast<std::uint8_t>(Record::TICK)
+	         << varint(tick.sequence) << varint(count);
+	for (const auto& state : tick.states)
+	{
+		// the packed state only keeps the low bits of its sequence.
+		m_buffer << varint(state.first) << varint(state.second.sequence)
+		         << state.second;
+	}
+
+	if (m_buffer.getBuffer().size() >= FLUSH_SIZE)
+	{
+		flush();
+	}
+}
+
+void ReplayRecorder::flush()
+{
+	auto& buffer = m_buffer.getBuffer();
+	if (m_file.is_open() && !buffer.empty())
+	{
+		m_file.write(reinterpret_cast<const char*>(buffer.data()),
+		             static_cast<std::streamsize>(buffer.size()));
+		m_file.flush();
+	}
+
+	buffer.clear();
+}
+
+ReplayReader::ReplayReader(const std::string& file)
+{
+	std::ifstream in(file, std::ios_base::binary);
+	if (!in.is_open())
+	{
+		LOG_FATAL("REPLAY") << "Could not open " << file << ".";
+		return;
+	}
+
+	std::vector<char> bytes((std::istreambuf_iterator<char>(in)),
+	                        std::istreambuf_iterator<char>());
+	m_data.resize(bytes.size());
+	std::memcpy(m_data.data(), bytes.data(), bytes.size());
+
+	if (m_data.size() < sizeof(MAGIC) + sizeof(std::uint32_t) ||
+	    std::memcmp(m_data.data(), MAGIC, sizeof(MAGIC)) != 0)
+	{
+		LOG_FATAL("REPLAY") << file << " is not a Phoenix replay.";
+		return;
+	}
+
+	m_ser.borrowBuffer(m_data.data() + sizeof(MAGIC),
+	                   m_data.size() - sizeof(MAGIC));
+
+	std::uint32_t version = 0;
+	m_ser >> version;
+	if (version != ReplayRecorder::VERSION)
+	{
+		LOG_FATAL("REPLAY") << "Unsupported replay version " << version << ".";
+		return;
+	}
+
+	m_valid = true;
+}
+
+bool ReplayReader::next(ReplayTick& tick)
+{
+	using Record = ReplayRecorder::Record;
+
+	tick.clear();
+	if (!m_valid)
+	{
+		return false;
+	}
+
+	while (true)
+	{
+		std::uint8_t type = 0xFF;
+		m_ser >> type;
+
+		switch (static_cast<Record>(type))
+		{
+		case Record::CONNECT:
+		{
+			std::size_t user = 0;
+			m_ser >> varint(user);
+			tick.connects.push_back(user);
+			break;
+		}
+
+		case Record::DISCONNECT:
+		{
+			std::size_t user = 0;
+			m_ser >> varint(user);
+			tick.disconnects.push_back(user);
+			break;
+		}
+
+		case Record::MESSAGE:
+		{
+			net::MessageBundle message;
+			m_ser >> varint(message.userID) >> message.message;
+			tick.messages.push_back(std::move(message));
+			break;
+		}
+
+		case Record::TICK:
+		{
+			std::size_t count = 0;
+			m_ser >> varint(tick.sequence) >> varint(count);
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				std::size_t user     = 0;
+				std::size_t sequence = 0;
+				InputState  state;
+				m_ser >> varint(user) >> varint(sequence) >> state;
+
+				state.sequence = sequence;
+				tick.states.emplace_back(user, state);
+			}
+
+			return true;
+		}
+
+		default:
+			// either the end of the file, or a replay cut off while the
+			// server was still writing it. Either way, we're done.
+			return false;
+		}
+	}
+}
@@ -28,18 +28,28 @@
 
 #include <Server/Server.hpp>
 
+#include <Common/CMS/EventBus.hpp>
+#include <Common/CMS/LuaProfiler.hpp>
 #include <Common/Voxels/BlockReferrer.hpp>
 
 #include <Common/Logger.hpp>
+#include <Common/Profiling/Metrics.hpp>
+#include <Common/Profiling/Profiler.hpp>
+#include <Common/Profiling/Tracer.hpp>
 #include <Common/Settings.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <climits>
 #include <iostream>
+#include <memory>
 #include <thread>
+#include <unordered_map>
 
 using namespace phx::server;
 using namespace phx;
 
-Server::Server(const std::string& save)
+Server::Server(const std::string& save, bool headless)
 {
     // use this as a placeholder until we have command line arguments.
     // even if the list is empty, it can create/load a save as required.
@@ -47,7 +57,18 @@ Server::Server(const std::string& save)
     // must manually edit the JSON to load an another mod after initialization.
     std::vector<std::string> commandLineModList = {"mod1", "mod2", "mod3"};
 	m_save = new Save(save, commandLineModList);
-	m_iris = new server::net::Iris(&m_registry);
+	if (headless)
+	{
+		// nothing connects to this, but the game still sends through it.
+		m_loopback = std::make_unique<phx::net::LoopbackNetwork>();
+		m_iris     = new server::net::Iris(
+		    &m_registry, std::make_unique<phx::net::LoopbackTransport>(
+		                     *m_loopback, 7777, 32, 4));
+	}
+	else
+	{
+		m_iris = new server::net::Iris(&m_registry);
+	}
 	m_game = new Game(&m_blockRegistry, &m_registry, m_iris, m_save);
 }
 
@@ -68,18 +89,82 @@ void registerUnusedAPI(cms::ModManager* manager)
 	manager->registerFunction("audio.play", [=](sol::table source) {});
 }
 
-void Server::run()
+void Server::initialize()
 {
-	std::cout << "Hello, Server!" << std::endl;
-
 	LoggerConfig config;
 	config.verbosity = LogVerbosity::DEBUG;
+	config.threaded  = true;
 	Logger::initialize(config);
 
+	// records a binary trace of the server for finding lag spikes, convert
+	// it with PhoenixTraceConverter.
+	Setting* trace = Settings::get()->add("Trace", "server:trace", 0);
+
+	// how often, in seconds, metrics are written to Server.prom for a node
+	// exporter to pick up, 0 to not write them.
+	Setting* metrics = Settings::get()->add("Metrics", "server:metrics", 0);
+
+	// the time in microseconds each mod's Lua callbacks may take per tick, 0
+	// for no limit. mods can be given their own with lua_budget:<mod>.
+	Setting* luaBudget = Settings::get()->add(
+	    "Lua Budget", "server:lua_budget", 0, 0, INT_MAX);
+
+	// 1 to put off callbacks of mods over budget until a later tick, rather
+	// than just warning about them.
+	Setting* luaDefer =
+	    Settings::get()->add("Lua Defer", "server:lua_defer", 0);
+
+	// the most block updates run per tick, 0 for no limit, and the number
+	// of blocks in each chunk picked for a random tick every tick.
+	Setting* blockTickBudget = Settings::get()->add(
+	    "Block Tick Budget", "server:block_tick_budget",
+	    static_cast<int>(voxels::BlockTicker::DEFAULT_BUDGET), 0, INT_MAX);
+
+	Setting* randomTicks = Settings::get()->add(
+	    "Random Ticks", "server:random_ticks",
+	    static_cast<int>(voxels::BlockTicker::DEFAULT_RANDOM_TICKS));
+
+	// 1 to add the /setblock command for PhoenixBot's editing bots, any
+	// player can use it so it should only be on for capacity tests.
+	Setting* editCommand =
+	    Settings::get()->add("Edit Command", "server:edit_command", 0);
+
 	Settings::get()->load("config.txt");
 
-	// Initialize the Modules //
+	m_game->getBlockTicker().setBudget(
+	    static_cast<std::size_t>(std::max(blockTickBudget->value(), 0)));
+	m_game->getBlockTicker().setRandomTicks(
+	    static_cast<std::size_t>(std::max(randomTicks->value(), 0)));
+
+	if (editCommand->value() != 0)
+	{
+		m_game->enableEditCommand();
+	}
 
+	cms::LuaProfiler::get().setBudget(luaBudget->value() / 1000.0);
+	cms::LuaProfiler::get().setPolicy(luaDefer->value() != 0
+	                                      ? cms::BudgetPolicy::DEFER
+	                                      : cms::BudgetPolicy::WARN);
+
+	if (trace->value() != 0)
+	{
+		profiling::TracerConfig traceConfig;
+		traceConfig.file = "Server.phxtrace";
+		profiling::Tracer::initialize(traceConfig);
+	}
+
+	if (metrics->value() > 0)
+	{
+		profiling::MetricsConfig metricsConfig;
+		metricsConfig.file          = "Server.prom";
+		metricsConfig.writeInterval = std::chrono::seconds(metrics->value());
+		m_metricsWriter =
+		    std::make_unique<profiling::MetricsWriter>(metricsConfig);
+	}
+}
+
+void Server::loadModules()
+{
 	m_modManager = new cms::ModManager(m_save->getModList(), {"Modules"});
 
 	m_modManager->registerFunction("core.print", [=](const std::string& text) {
@@ -88,6 +173,7 @@ void Server::run()
 
 	m_blockRegistry.registerAPI(m_modManager);
 	Settings::get()->registerAPI(m_modManager);
+	cms::EventBus::get().registerAPI(m_modManager);
 	m_game->registerAPI(m_modManager);
 	registerUnusedAPI(m_modManager);
 
@@ -113,6 +199,52 @@ void Server::run()
 		exit(EXIT_FAILURE);
 	}
 
+	// -1 leaves the mod on server:lua_budget.
+	for (const auto& mod : m_modManager->getModList())
+	{
+		Setting* budget = Settings::get()->add(
+		    "Lua Budget: " + mod, "lua_budget:" + mod, -1, -1, INT_MAX);
+		if (budget->value() >= 0)
+		{
+			const auto id = cms::LuaProfiler::get().getModID(mod);
+			cms::LuaProfiler::get().setBudget(id, budget->value() / 1000.0);
+		}
+	}
+}
+
+void Server::shutdown()
+{
+	Settings::get()->save("config.txt");
+
+	// flushes anything still queued by the recorder, tracer and threaded
+	// logger.
+	m_game->setRecorder(nullptr);
+	m_recorder.reset();
+	m_metricsWriter.reset();
+	profiling::Tracer::teardown();
+	Logger::teardown();
+}
+
+void Server::run()
+{
+	std::cout << "Hello, Server!" << std::endl;
+
+	// records everything the game receives to Server.phxreplay, so the
+	// session can be replayed with --replay.
+	Setting* record = Settings::get()->add("Record", "server:record", 0);
+
+	initialize();
+
+	if (record->value() != 0)
+	{
+		m_recorder = std::make_unique<ReplayRecorder>("Server.phxreplay");
+		m_game->setRecorder(m_recorder.get());
+	}
+
+	// Initialize the Modules //
+
+	loadModules();
+
 	// Modules Initialized //
 
 	// Fire up Threads //
@@ -133,19 +265,120 @@ void Server::run()
 			m_running = false;
 			m_iris->kill();
 		}
+		else if (input == "profile")
+		{
+			std::cout << profiling::Profiler::report() << std::flush;
+		}
+		else if (input == "metrics")
+		{
+			std::cout << profiling::Metrics::get().expose() << std::flush;
+		}
+		else if (input == "lua")
+		{
+			std::cout << cms::LuaProfiler::get().report() << std::flush;
+		}
 	}
 
 	// Begin Shutdown //
 
 	t_iris.join();
 	t_game.join();
-	Settings::get()->save("config.txt");
+
+	shutdown();
+}
+
+bool Server::replay(const std::string& file)
+{
+	initialize();
+
+	ReplayReader reader(file);
+	if (!reader.isValid())
+	{
+		shutdown();
+		return false;
+	}
+
+	loadModules();
+
+	if (profiling::Tracer::get() != nullptr)
+	{
+		profiling::Tracer::get()->setThreadName("Game");
+	}
+	profiling::Profiler::setThreadName("Game");
+
+	// users are recorded by their peer ID, this maps them to the entities
+	// made for them in this session.
+	std::unordered_map<std::size_t, entt::entity> users;
+
+	ReplayTick       tick;
+	net::StateBundle bundle;
+
+	const auto start = std::chrono::steady_clock::now();
+	while (reader.next(tick))
+	{
+		profiling::Profiler::endFrame();
+
+		// these go through the queues as they would from the network, so
+		// the game sees them at the same point in the tick.
+		for (const std::size_t user : tick.connects)
+		{
+			const entt::entity entity = m_iris->addUser(user);
+			users[user]               = entity;
+			m_iris->eventQueue.push({entity, net::Event::Type::CONNECT});
+		}
+
+		for (auto& message : tick.messages)
+		{
+			m_iris->messageQueue.push(std::move(message));
+		}
+
+		bundle.ready    = true;
+		bundle.sequence = tick.sequence;
+		bundle.states.clear();
+		for (const auto& state : tick.states)
+		{
+			auto user = users.find(state.first);
+			if (user != users.end())
+			{
+				bundle.states[user->second] = state.second;
+			}
+		}
+		bundle.users = bundle.states.size();
+
+		// the game applies a tick's states before it handles the events, so
+		// a user leaving this tick still has the states recorded for it.
+		for (const std::size_t user : tick.disconnects)
+		{
+			m_iris->disconnect(user);
+			users.erase(user);
+		}
+
+		m_game->tick(bundle);
+		m_iris->flush();
+	}
+	profiling::Profiler::endFrame();
+
+	const double seconds = std::chrono::duration<double>(
+	                           std::chrono::steady_clock::now() - start)
+	                           .count();
+	const std::size_t ticks = m_game->getTickCount();
+
+	std::cout << "Replayed " << ticks << " ticks in " << seconds << "s ("
+	          << (seconds > 0.0 ? static_cast<double>(ticks) / seconds : 0.0)
+	          << " ticks/s)\n"
+	          << profiling::Profiler::report() << std::flush;
+
+	shutdown();
+	return true;
 }
 
 Server::~Server()
 {
 	delete m_iris;
 	delete m_game;
+
+	// the handlers reference the Lua state of the mod manager.
+	cms::EventBus::get().clear();
 	delete m_modManager;
 	delete m_save;
 }
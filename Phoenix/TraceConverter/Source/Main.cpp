@@ -0,0 +1,258 @@
+// Copyright 2019-20 Genten Studios
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors
+// may be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <Common/Profiling/Tracer.hpp>
+#include <Common/Utility/Serializer.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace phx;
+using namespace phx::profiling;
+
+namespace
+{
+	const char* getCategoryName(std::uint8_t category)
+	{
+		switch (static_cast<TraceCategory>(category))
+		{
+		case TraceCategory::TICK:
+			return "tick";
+		case TraceCategory::PACKET:
+			return "packet";
+		case TraceCategory::CHUNK:
+			return "chunk";
+		case TraceCategory::MESH:
+			return "mesh";
+		case TraceCategory::LUA:
+			return "lua";
+		default:
+			return "other";
+		}
+	}
+
+	// writes a string as a JSON string literal.
+	void writeString(std::ostream& out, const std::string& string)
+	{
+		out << '"';
+		for (const char c : string)
+		{
+			switch (c)
+			{
+			case '"':
+				out << "\\\"";
+				break;
+			case '\\':
+				out << "\\\\";
+				break;
+			case '\n':
+				out << "\\n";
+				break;
+			case '\t':
+				out << "\\t";
+				break;
+			default:
+				if (static_cast<unsigned char>(c) < 0x20)
+				{
+					char escaped[8];
+					std::snprintf(escaped, sizeof(escaped), "\\u%04x",
+					              static_cast<unsigned char>(c));
+					out << escaped;
+				}
+				else
+				{
+					out << c;
+				}
+			}
+		}
+		out << '"';
+	}
+
+	// chrome traces are in microseconds.
+	void writeTime(std::ostream& out, std::uint64_t nanoseconds)
+	{
+		out << nanoseconds / 1000 << '.';
+
+		char fraction[4];
+		std::snprintf(fraction, sizeof(fraction), "%03u",
+		              static_cast<unsigned int>(nanoseconds % 1000));
+		out << fraction;
+	}
+
+	bool convert(const std::vector<std::byte>& data, std::ostream& out)
+	{
+		const char magic[] = {'P', 'H', 'X', 'T', 'R', 'A', 'C', 'E'};
+		if (data.size() < sizeof(magic) + sizeof(std::uint32_t) ||
+		    std::memcmp(data.data(), magic, sizeof(magic)) != 0)
+		{
+			std::cerr << "This is not a Phoenix trace.\n";
+			return false;
+		}
+
+		Serializer ser;
+		ser.borrowBuffer(data.data() + sizeof(magic),
+		                 data.size() - sizeof(magic));
+
+		std::uint32_t version = 0;
+		ser >> version;
+		if (version != Tracer::VERSION)
+		{
+			std::cerr << "Unsupported trace version " << version << ".\n";
+			return false;
+		}
+
+		std::unordered_map<std::uint32_t, std::string> strings;
+
+		out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+		bool        first  = true;
+		std::size_t events = 0;
+		while (true)
+		{
+			std::uint8_t type = 0xFF;
+			ser >> type;
+
+			if (type == static_cast<std::uint8_t>(Tracer::Record::STRING))
+			{
+				std::uint32_t id = 0;
+				std::string   string;
+				ser >> id >> string;
+				strings[id] = string;
+				continue;
+			}
+
+			if (type != static_cast<std::uint8_t>(Tracer::Record::THREAD) &&
+			    type != static_cast<std::uint8_t>(Tracer::Record::EVENT))
+			{
+				// either the end of the file, or a trace cut off while the
+				// server was still writing it. Either way, we're done.
+				break;
+			}
+
+			if (!first)
+			{
+				out << ",\n";
+			}
+			first = false;
+
+			if (type == static_cast<std::uint8_t>(Tracer::Record::THREAD))
+			{
+				std::uint32_t thread = 0;
+				std::string   name;
+				ser >> thread >> name;
+
+				out << R"({"ph":"M","name":"thread_name","pid":1,"tid":)"
+				    << thread << R"(,"args":{"name":)";
+				writeString(out, name);
+				out << "}}";
+				continue;
+			}
+
+			std::uint8_t  category  = 0;
+			std::uint8_t  phase     = 0;
+			std::uint32_t thread    = 0;
+			std::uint32_t name      = 0;
+			std::uint64_t timestamp = 0;
+			std::uint64_t duration  = 0;
+			std::int64_t  value     = 0;
+			ser >> category >> phase >> thread >> name >> timestamp >>
+			    duration >> value;
+
+			out << "{\"name\":";
+			writeString(out, strings[name]);
+			out << ",\"cat\":\"" << getCategoryName(category)
+			    << "\",\"pid\":1,\"tid\":" << thread << ",\"ts\":";
+			writeTime(out, timestamp);
+
+			switch (static_cast<TracePhase>(phase))
+			{
+			case TracePhase::COMPLETE:
+				out << ",\"ph\":\"X\",\"dur\":";
+				writeTime(out, duration);
+				break;
+			case TracePhase::COUNTER:
+				out << ",\"ph\":\"C\",\"args\":{\"value\":" << value << '}';
+				break;
+			default:
+				out << R"(,"ph":"i","s":"t","args":{"value":)" << value
+				    << '}';
+				break;
+			}
+
+			out << '}';
+			++events;
+		}
+
+		out << "\n]}\n";
+
+		std::cerr << "Converted " << events << " events.\n";
+		return true;
+	}
+} // namespace
+
+int main(int argc, char** argv)
+{
+	if (argc != 3)
+	{
+		std::cout << "Usage: PhoenixTraceConverter <trace.phxtrace> "
+		             "<trace.json>\n"
+		             "Converts a Phoenix trace into Chrome trace-event JSON, "
+		             "which can be opened\nin chrome://tracing, Perfetto or "
+		             "Speedscope.\n";
+		return EXIT_FAILURE;
+	}
+
+	std::ifstream in(argv[1], std::ios_base::binary);
+	if (!in)
+	{
+		std::cerr << "Could not open " << argv[1] << ".\n";
+		return EXIT_FAILURE;
+	}
+
+	const std::vector<char> bytes((std::istreambuf_iterator<char>(in)),
+	                              std::istreambuf_iterator<char>());
+
+	std::vector<std::byte> data(bytes.size());
+	std::memcpy(data.data(), bytes.data(), bytes.size());
+
+	std::ofstream out(argv[2]);
+	if (!out)
+	{
+		std::cerr << "Could not open " << argv[2] << " for writing.\n";
+		return EXIT_FAILURE;
+	}
+
+	return convert(data, out) ? EXIT_SUCCESS : EXIT_FAILURE;
+}